@@ -0,0 +1,894 @@
+// cli/ksysmon.c
+// top 처럼 보는 실시간 모니터: 프로세스별 / 경로별 / 플래그 종류별 열기 속도, drops, 읽기 지연, 초당 이벤트
+//
+//   gcc -O2 -Wall -I../include -o ksysmon ksysmon.c ../lib/libsys.c ../lib/ksys_fanotify.c
+//       ../lib/ksysd_client.c ../lib/ksys_topk.c
+//   ./ksysmon [--source auto|shm|daemon|direct] [--sock PATH] [--backend auto|mmap|batch|read|fanotify]
+//             [--fps N] [--tau SEC] [--path-sample N] [--batch [--frames N]]
+//
+// 읽는 길은 빠른 것부터 시도함 (auto): ksysd 공유 링 (따라잡는 동안 시스템 콜 없음) -> ksysd 소켓 ->
+// 직접 (libksys, 백엔드는 라이브러리가 mmap 부터 고름). 데몬에 붙어 있으면 데몬의 top-K 표에서
+// 경로 앞부분 순위도 가져옴 (레코드를 다시 세지 않음).
+//
+// 부하가 큰 머신에 띄워 둘 수 있게 이벤트당 일을 줄임:
+//   - 집계는 크기가 정해진 열린 주소 해시 (프로세스 4096, 경로 8192 칸) 에 세기만 함. 할당 없음.
+//     다 차면 "other" 로. 프레임마다 속도를 평활 (--tau) 하고, 살아 있는 항목만 다른 표로 옮겨서
+//     죽은 항목을 치움 (표 비우기는 세대 번호 하나 올리기)
+//   - 경로는 해시 비용이 커서 초당 이벤트가 많으면 N 개 중 하나만 세고 N 을 곱함
+//     (--path-sample, 0 이면 초당 10 만 개마다 두 배씩 자동)
+//   - 화면은 이전 프레임과 칸 단위로 비교해서 바뀐 구간만 커서 이동 + 글자로 보냄. write 는
+//     프레임마다 한 번이고, 프레임 수는 --fps (최대 30) 로 묶임
+//
+// 터미널이 아니거나 --batch 면 프레임마다 전체를 그냥 찍음 (top -b 처럼). q 나 Ctrl-C 로 끝남
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys.h>
+#include <ksys/ksys_topk.h>
+#include <ksys/ksysd.h>
+
+#define MAX_ROWS        200
+#define MAX_COLS        400
+#define READ_MAX        4096            // 공유 링에서 한 번에 복사하는 레코드
+#define FPS_MAX         30
+#define PROC_SLOTS      4096            // 2의 거듭제곱. 3/4 까지만 채움
+#define PATH_SLOTS      8192
+#define PATH_SAMPLE_MAX 64
+#define PATH_SAMPLE_AT  100000          // auto: 초당 이벤트가 이만큼 늘 때마다 샘플 간격 두 배
+#define RATE_MIN        0.05f           // 이보다 느려지면 표에서 치움
+#define TOPK_EVERY_NS   2000000000ull   // 데몬 top-K 질의 주기
+#define TOPK_WINDOW     10
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static volatile sig_atomic_t stop, resized;
+
+static void on_signal(int sig)
+{
+    if (sig == SIGWINCH)
+        resized = 1;
+    else
+        stop = 1;
+}
+
+// --- Source ---
+
+enum { SRC_SHM, SRC_DAEMON, SRC_DIRECT };
+static const char *const src_names[] = { "shm", "daemon", "direct" };
+
+struct src {
+    int kind;
+    const char *sock;
+    struct ksysd_shm shm;
+    struct ksysd_client cl;
+    struct ksys *k;
+    struct ksys_event *buf;     // SRC_SHM 만
+    __u64 drops;                // 소스가 알려 준 누적 (커널 + 데몬/링에서 이 모니터 몫)
+    __u64 last_seq;             // SRC_DIRECT: 마지막으로 본 커널 seq (뒤처진 레코드 계산용)
+};
+
+static int src_open(struct src *s, const char *want, enum ksys_backend backend)
+{
+    bool any = !strcmp(want, "auto");
+
+    if (any || !strcmp(want, "shm")) {
+        if (ksysd_shm_open(&s->shm, s->sock, NULL) == 0) {
+            s->buf = malloc(READ_MAX * sizeof(*s->buf));
+            if (!s->buf)
+                return -1;
+            s->kind = SRC_SHM;
+            return 0;
+        }
+        if (!any)
+            return -1;
+    }
+    if (any || !strcmp(want, "daemon")) {
+        if (ksysd_client_open(&s->cl, s->sock, NULL, NULL) == 0) {
+            s->kind = SRC_DAEMON;
+            return 0;
+        }
+        if (!any)
+            return -1;
+    }
+    if (any || !strcmp(want, "direct")) {
+        struct ksys_open_opts o;
+
+        ksys_open_opts_init(&o);
+        o.backend = backend;
+        o.opts = KSYS_OPT_GAP_RECORDS;
+        s->k = ksys_open(&o);
+        if (!s->k)
+            return -1;
+        s->kind = SRC_DIRECT;
+        return 0;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+static void src_close(struct src *s)
+{
+    if (s->kind == SRC_SHM)
+        ksysd_shm_close(&s->shm);
+    else if (s->kind == SRC_DAEMON)
+        ksysd_client_close(&s->cl);
+    else
+        ksys_close(s->k);
+    free(s->buf);
+}
+
+// 레코드 묶음 하나. 반환: 레코드 수 (timeout 이면 0), 실패 -1 (errno)
+static ssize_t src_read(struct src *s, int timeout_ms, const struct ksys_event **ev)
+{
+    if (s->kind == SRC_SHM) {
+        size_t n = ksysd_shm_read(&s->shm, s->buf, READ_MAX);
+        int r;
+
+        if (!n) {
+            r = ksysd_shm_wait(&s->shm, timeout_ms);
+            if (r <= 0)
+                return r;
+            n = ksysd_shm_read(&s->shm, s->buf, READ_MAX);
+        }
+        s->drops = s->shm.hdr->drops + s->shm.cur.drops;
+        *ev = s->buf;
+        return (ssize_t)n;
+    }
+    if (s->kind == SRC_DAEMON) {
+        ssize_t n = ksysd_client_recv(&s->cl, timeout_ms, ev);
+
+        s->drops = s->cl.drops + s->cl.lost;
+        return n;
+    }
+
+    struct ksys_batch b;
+
+    if (ksys_next_batch(s->k, timeout_ms, &b) != 0)
+        return -1;
+    s->drops = b.drops;
+    if (b.n)
+        s->last_seq = b.ev[b.n - 1].seq;
+    *ev = b.ev;
+    return (ssize_t)b.n;
+}
+
+// 아직 읽지 않고 쌓여 있는 레코드. 모르면 -1
+static long long src_behind(struct src *s)
+{
+    if (s->kind == SRC_SHM)
+        return (long long)(ksys_load_acquire(&s->shm.hdr->cur_seq) - s->shm.cur.next_seq);
+    if (s->kind == SRC_DIRECT && ksys_backend(s->k) != KSYS_BACKEND_FANOTIFY) {
+        struct ksys_stats st;
+
+        if (ksys_get_stats(s->k, &st) == 0 && s->last_seq && st.cur_seq > s->last_seq)
+            return (long long)(st.cur_seq - s->last_seq - 1);
+        return 0;
+    }
+    return -1;
+}
+
+// --- Aggregation ---
+
+enum { FL_RDONLY, FL_WRONLY, FL_RDWR, FL_CREAT, FL_TRUNC, FL_APPEND, FL_EXCL, FL_DIR, FL_PATH, FL_TMPFILE, NFL };
+static const char *const fl_names[NFL] = { "rdonly", "wronly", "rdwr", "creat", "trunc",
+                                           "append", "excl", "dir", "path", "tmpfile" };
+
+// 프레임 안에서 세는 값과 평활한 초당 값
+struct ctr {
+    __u64 n;
+    float rate;
+};
+
+struct proc {
+    __u32 gen;                  // 표의 gen 과 같아야 살아 있는 칸
+    __s32 tgid;
+    char  comm[KSYS_COMM_LEN];
+    struct ctr open, fail, wr;
+};
+
+struct path {
+    __u32 gen;
+    __u32 len;
+    __u64 hash;
+    struct ctr open;
+    char  path[KSYS_PATH_LEN];
+};
+
+struct proc_tab {
+    struct proc s[PROC_SLOTS];
+    __u32 used[PROC_SLOTS];     // 쓴 칸 번호 (돌면서 평활/옮길 때)
+    __u32 nused;
+    __u32 gen;
+};
+
+struct path_tab {
+    struct path s[PATH_SLOTS];
+    __u32 used[PATH_SLOTS];
+    __u32 nused;
+    __u32 gen;
+};
+
+struct mon {
+    struct proc_tab pt[2];      // 프레임마다 살아 있는 것만 다른 쪽으로 옮김
+    struct path_tab qt[2];
+    int pcur, qcur;
+    struct ctr ev, opens, fails, forks, execs, exits, lost, other_proc, other_path;
+    struct ctr fl[NFL];
+    __u32 path_every;           // 경로는 이 개수마다 하나 (2의 거듭제곱)
+    __u32 path_fixed;           // --path-sample (0: 자동)
+    __u32 path_tick;
+    __u64 lag_ns;               // 이번 프레임에 본 최대 (읽은 시각 - 레코드 ts)
+};
+
+static inline __u32 hash_id(__s32 id)
+{
+    return (__u32)id * 2654435761u;
+}
+
+static inline __u64 hash_path(const char *p, __u32 len)
+{
+    __u64 h = 0x9e3779b97f4a7c15ull ^ len, w;
+
+    for (; len >= 8; p += 8, len -= 8) {
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    if (len) {
+        w = 0;
+        memcpy(&w, p, len);
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+// 없으면 새로 (다 찼으면 NULL)
+static struct proc *proc_get(struct proc_tab *t, __s32 tgid)
+{
+    __u32 i = hash_id(tgid) & (PROC_SLOTS - 1);
+
+    for (; t->s[i].gen == t->gen; i = (i + 1) & (PROC_SLOTS - 1)) {
+        if (t->s[i].tgid == tgid)
+            return &t->s[i];
+    }
+    if (t->nused >= PROC_SLOTS / 4 * 3)
+        return NULL;
+    memset(&t->s[i], 0, sizeof(t->s[i]));
+    t->s[i].gen = t->gen;
+    t->s[i].tgid = tgid;
+    t->used[t->nused++] = i;
+    return &t->s[i];
+}
+
+static struct path *path_get(struct path_tab *t, const char *p, __u32 len, __u64 h)
+{
+    __u32 i = (__u32)h & (PATH_SLOTS - 1);
+
+    for (; t->s[i].gen == t->gen; i = (i + 1) & (PATH_SLOTS - 1)) {
+        if (t->s[i].hash == h && t->s[i].len == len && !memcmp(t->s[i].path, p, len))
+            return &t->s[i];
+    }
+    if (t->nused >= PATH_SLOTS / 4 * 3)
+        return NULL;
+    t->s[i].gen = t->gen;
+    t->s[i].len = len;
+    t->s[i].hash = h;
+    memset(&t->s[i].open, 0, sizeof(t->s[i].open));
+    memcpy(t->s[i].path, p, len);
+    if (len < KSYS_PATH_LEN)
+        t->s[i].path[len] = '\0';
+    t->used[t->nused++] = i;
+    return &t->s[i];
+}
+
+static void count_flags(struct mon *m, __u32 f)
+{
+    switch (f & O_ACCMODE) {
+    case O_WRONLY: m->fl[FL_WRONLY].n++; break;
+    case O_RDWR:   m->fl[FL_RDWR].n++; break;
+    default:       m->fl[FL_RDONLY].n++; break;
+    }
+    if (f & O_CREAT)
+        m->fl[FL_CREAT].n++;
+    if (f & O_TRUNC)
+        m->fl[FL_TRUNC].n++;
+    if (f & O_APPEND)
+        m->fl[FL_APPEND].n++;
+    if (f & O_EXCL)
+        m->fl[FL_EXCL].n++;
+    // O_TMPFILE 은 O_DIRECTORY 비트를 포함함
+    if ((f & O_TMPFILE) == O_TMPFILE)
+        m->fl[FL_TMPFILE].n++;
+    else if (f & O_DIRECTORY)
+        m->fl[FL_DIR].n++;
+    if (f & O_PATH)
+        m->fl[FL_PATH].n++;
+}
+
+static void account(struct mon *m, const struct ksys_event *ev, size_t n, __u64 now)
+{
+    struct proc_tab *pt = &m->pt[m->pcur];
+    struct path_tab *qt = &m->qt[m->qcur];
+    __u32 mask = m->path_every - 1;
+
+    m->ev.n += n;
+    for (size_t i = 0; i < n; i++) {
+        const struct ksys_event *e = &ev[i];
+        struct proc *p;
+
+        switch (e->type) {
+        case KSYS_REC_OPENAT:
+        case KSYS_REC_OPENAT_RET:
+            break;
+        case KSYS_REC_GAP:
+            m->lost.n += ((const struct ksys_gap *)e)->count;
+            continue;
+        case KSYS_REC_FORK:
+            m->forks.n++;
+            continue;
+        case KSYS_REC_EXEC:
+            m->execs.n++;
+            continue;
+        case KSYS_REC_EXIT:
+            m->exits.n++;
+            continue;
+        default:
+            continue;
+        }
+
+        bool failed = e->type == KSYS_REC_OPENAT_RET && e->ret < 0;
+        bool wr = (e->flags & O_ACCMODE) != O_RDONLY || (e->flags & (O_CREAT | O_TRUNC));
+
+        m->opens.n++;
+        m->fails.n += failed;
+        count_flags(m, e->flags);
+        p = proc_get(pt, e->tgid);
+        if (p) {
+            p->open.n++;
+            p->fail.n += failed;
+            p->wr.n += wr;
+            if (e->comm[0])
+                memcpy(p->comm, e->comm, KSYS_COMM_LEN);
+        } else {
+            m->other_proc.n++;
+        }
+
+        if (++m->path_tick & mask)
+            continue;
+        __u32 len = strnlen(e->path, KSYS_PATH_LEN);
+        struct path *q = path_get(qt, e->path, len, hash_path(e->path, len));
+        if (q)
+            q->open.n += m->path_every;
+        else
+            m->other_path.n += m->path_every;
+    }
+    if (n && now > ev[n - 1].ts_ns && now - ev[n - 1].ts_ns > m->lag_ns)
+        m->lag_ns = now - ev[n - 1].ts_ns;
+}
+
+static inline void ctr_roll(struct ctr *c, float dt, float a)
+{
+    c->rate += a * ((float)c->n / dt - c->rate);
+    c->n = 0;
+}
+
+static const struct proc *sort_procs;
+static const struct path *sort_paths;
+
+static int proc_cmp(const void *a, const void *b)
+{
+    float x = sort_procs[*(const __u32 *)a].open.rate, y = sort_procs[*(const __u32 *)b].open.rate;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static int path_cmp(const void *a, const void *b)
+{
+    float x = sort_paths[*(const __u32 *)a].open.rate, y = sort_paths[*(const __u32 *)b].open.rate;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// 속도를 갱신하고 살아 있는 항목만 다른 표로 옮김. 한 번에 한 번씩만 보이는 경로가 쏟아져도
+// 새 키가 들어갈 자리가 남게, 많으면 빠른 쪽 1/4 만 옮김
+static void roll(struct mon *m, float dt, float a)
+{
+    static __u32 order[PATH_SLOTS];
+    struct proc_tab *po = &m->pt[m->pcur], *pn = &m->pt[!m->pcur];
+    struct path_tab *qo = &m->qt[m->qcur], *qn = &m->qt[!m->qcur];
+    __u32 n;
+
+    for (__u32 k = 0; k < po->nused; k++) {
+        struct proc *p = &po->s[po->used[k]];
+
+        ctr_roll(&p->open, dt, a);
+        ctr_roll(&p->fail, dt, a);
+        ctr_roll(&p->wr, dt, a);
+        order[k] = po->used[k];
+    }
+    n = po->nused;
+    if (n > PROC_SLOTS / 4) {
+        sort_procs = po->s;
+        qsort(order, n, sizeof(*order), proc_cmp);
+        n = PROC_SLOTS / 4;
+    }
+    pn->gen++;
+    pn->nused = 0;
+    for (__u32 k = 0; k < n; k++) {
+        const struct proc *p = &po->s[order[k]];
+        struct proc *d;
+
+        if (p->open.rate < RATE_MIN || !(d = proc_get(pn, p->tgid)))
+            continue;
+        *d = *p;
+        d->gen = pn->gen;
+    }
+    m->pcur = !m->pcur;
+
+    for (__u32 k = 0; k < qo->nused; k++) {
+        ctr_roll(&qo->s[qo->used[k]].open, dt, a);
+        order[k] = qo->used[k];
+    }
+    n = qo->nused;
+    if (n > PATH_SLOTS / 4) {
+        sort_paths = qo->s;
+        qsort(order, n, sizeof(*order), path_cmp);
+        n = PATH_SLOTS / 4;
+    }
+    qn->gen++;
+    qn->nused = 0;
+    for (__u32 k = 0; k < n; k++) {
+        const struct path *q = &qo->s[order[k]];
+        struct path *d;
+
+        if (q->open.rate < RATE_MIN || !(d = path_get(qn, q->path, q->len, q->hash)))
+            continue;
+        d->open = q->open;
+    }
+    m->qcur = !m->qcur;
+
+    struct ctr *g[] = { &m->ev, &m->opens, &m->fails, &m->forks, &m->execs, &m->exits,
+                        &m->lost, &m->other_proc, &m->other_path };
+    for (size_t i = 0; i < sizeof(g) / sizeof(g[0]); i++)
+        ctr_roll(g[i], dt, a);
+    for (int i = 0; i < NFL; i++)
+        ctr_roll(&m->fl[i], dt, a);
+
+    if (!m->path_fixed) {
+        __u32 e = 1;
+        while (e < PATH_SAMPLE_MAX && m->ev.rate >= (float)PATH_SAMPLE_AT * e)
+            e <<= 1;
+        m->path_every = e;
+    }
+}
+
+// --- Screen ---
+
+struct scr {
+    int rows, cols;
+    bool tty;
+    bool full;                          // 다음 flush 는 전체 (처음, 크기 바뀜)
+    char front[MAX_ROWS * MAX_COLS];    // 터미널에 있는 것
+    char back[MAX_ROWS * MAX_COLS];     // 이번 프레임
+    char out[MAX_ROWS * (MAX_COLS + 16) + 64];
+    size_t last_bytes;
+    struct termios saved;
+};
+
+static void scr_size(struct scr *s)
+{
+    struct winsize ws;
+
+    s->rows = 40;
+    s->cols = 120;
+    if (s->tty && ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row && ws.ws_col) {
+        s->rows = ws.ws_row;
+        // 마지막 칸에 쓰면 줄이 넘어가는 터미널이 있어 비워 둠
+        s->cols = ws.ws_col - 1;
+    }
+    if (s->rows > MAX_ROWS)
+        s->rows = MAX_ROWS;
+    if (s->cols > MAX_COLS)
+        s->cols = MAX_COLS;
+    s->full = true;
+}
+
+static void write_all(const char *p, size_t len)
+{
+    while (len) {
+        ssize_t w = write(STDOUT_FILENO, p, len);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        p += w;
+        len -= (size_t)w;
+    }
+}
+
+static void scr_begin(struct scr *s)
+{
+    memset(s->back, ' ', sizeof(s->back));
+}
+
+static void __attribute__((format(printf, 3, 4))) put(struct scr *s, int row, const char *fmt, ...)
+{
+    char tmp[MAX_COLS + 1];
+    va_list ap;
+    int n;
+
+    if (row >= s->rows)
+        return;
+    va_start(ap, fmt);
+    n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+    if (n < 0)
+        n = 0;
+    if (n > s->cols)
+        n = s->cols;
+    memcpy(&s->back[row * MAX_COLS], tmp, n);
+}
+
+// 줄마다 처음/마지막으로 다른 칸 사이만 보냄
+static void scr_flush(struct scr *s)
+{
+    size_t len = 0;
+
+    if (!s->tty) {
+        for (int r = 0; r < s->rows; r++) {
+            const char *b = &s->back[r * MAX_COLS];
+            int z = s->cols;
+            while (z > 0 && b[z - 1] == ' ')
+                z--;
+            memcpy(s->out + len, b, z);
+            len += z;
+            s->out[len++] = '\n';
+        }
+        s->out[len++] = '\n';
+        write_all(s->out, len);
+        s->last_bytes = len;
+        return;
+    }
+    if (s->full) {
+        len += sprintf(s->out, "\x1b[H\x1b[2J");
+        memset(s->front, ' ', sizeof(s->front));
+        s->full = false;
+        // 지운 화면은 빈칸이니 빈칸이 아닌 곳만 다시 그리면 됨
+    }
+    for (int r = 0; r < s->rows; r++) {
+        char *f = &s->front[r * MAX_COLS];
+        const char *b = &s->back[r * MAX_COLS];
+        int a = 0, z = s->cols - 1;
+
+        while (a < s->cols && f[a] == b[a])
+            a++;
+        if (a == s->cols)
+            continue;
+        while (f[z] == b[z])
+            z--;
+        len += sprintf(s->out + len, "\x1b[%d;%dH", r + 1, a + 1);
+        memcpy(s->out + len, b + a, z - a + 1);
+        memcpy(f + a, b + a, z - a + 1);
+        len += z - a + 1;
+    }
+    if (len)
+        write_all(s->out, len);
+    s->last_bytes = len;
+}
+
+static void scr_enter(struct scr *s)
+{
+    struct termios t;
+
+    if (!s->tty)
+        return;
+    if (tcgetattr(STDIN_FILENO, &s->saved) == 0) {
+        t = s->saved;
+        t.c_lflag &= ~(ICANON | ECHO);
+        t.c_cc[VMIN] = 0;
+        t.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &t);
+    }
+    write_all("\x1b[?1049h\x1b[?25l", 14);
+}
+
+static void scr_leave(struct scr *s)
+{
+    if (!s->tty)
+        return;
+    write_all("\x1b[?25h\x1b[?1049l", 14);
+    tcsetattr(STDIN_FILENO, TCSANOW, &s->saved);
+}
+
+// --- Frame ---
+
+// 폭 6 이하로: 123 / 12.3k / 1.23M
+static const char *fmt_rate(char *buf, double r)
+{
+    if (r < 10)
+        snprintf(buf, 8, "%.1f", r);
+    else if (r < 10000)
+        snprintf(buf, 8, "%.0f", r);
+    else if (r < 1e6)
+        snprintf(buf, 8, "%.1fk", r / 1e3);
+    else
+        snprintf(buf, 8, "%.2fM", r / 1e6);
+    return buf;
+}
+
+struct frame_info {
+    const char *source;
+    __u64 drops, drops_prev;
+    long long behind;
+    double cpu;                 // 이 모니터의 CPU 사용률 (%)
+    double dt;
+    struct ksys_topk_item topk[8];
+    int ntopk;
+    __u32 topk_window;
+};
+
+static void draw(struct scr *s, struct mon *m, const struct frame_info *fi)
+{
+    static __u32 order[PATH_SLOTS];
+    struct proc_tab *pt = &m->pt[m->pcur];
+    struct path_tab *qt = &m->qt[m->qcur];
+    char a[8], b[8], c[8], d[8], e[8];
+    int row = 0, avail, nproc, npath;
+    char line[MAX_COLS + 1];
+    size_t len = 0;
+    time_t wall = time(NULL);
+    struct tm tm;
+
+    localtime_r(&wall, &tm);
+    scr_begin(s);
+    put(s, row++, "ksysmon  %02d:%02d:%02d  source %s  fps %.0f  cpu %.1f%%  out %zu B/frame  path-sample 1/%u",
+        tm.tm_hour, tm.tm_min, tm.tm_sec, fi->source, 1.0 / fi->dt, fi->cpu, s->last_bytes, m->path_every);
+    put(s, row++, "events %s/s  opens %s/s  failed %s/s  fork %s/s  exec %s/s  exit %s/s", fmt_rate(a, m->ev.rate),
+        fmt_rate(b, m->opens.rate), fmt_rate(c, m->fails.rate), fmt_rate(d, m->forks.rate),
+        fmt_rate(e, m->execs.rate), fmt_rate(line, m->exits.rate));
+    if (fi->behind >= 0)
+        snprintf(line, sizeof(line), "%lld rec", fi->behind);
+    else
+        snprintf(line, sizeof(line), "?");
+    put(s, row++, "drops %llu (+%llu)  gap-lost %s/s  lag %.1f ms  behind %s", (unsigned long long)fi->drops,
+        (unsigned long long)(fi->drops - fi->drops_prev), fmt_rate(a, m->lost.rate), m->lag_ns / 1e6, line);
+
+    for (int i = 0; i < NFL && len < sizeof(line) - 24; i++)
+        len += snprintf(line + len, sizeof(line) - len, "%s %s  ", fl_names[i], fmt_rate(a, m->fl[i].rate));
+    put(s, row++, "flags/s  %s", line);
+
+    if (fi->ntopk) {
+        len = 0;
+        for (int i = 0; i < fi->ntopk && len < sizeof(line) - 80; i++)
+            len += snprintf(line + len, sizeof(line) - len, "%.40s %s  ", fi->topk[i].key,
+                            fmt_rate(a, (double)fi->topk[i].count / fi->topk_window));
+        put(s, row++, "ksysd prefix/s (%us)  %s", fi->topk_window, line);
+    }
+    row++;
+
+    // 남은 줄을 프로세스와 경로가 반씩
+    avail = s->rows - row - 3;
+    nproc = avail > 0 ? avail / 2 : 0;
+    npath = avail > 0 ? avail - nproc : 0;
+
+    put(s, row++, "%7s %-16s %7s %7s %7s   (other %s/s)", "TGID", "COMM", "OPEN/s", "FAIL/s", "WRITE/s",
+        fmt_rate(a, m->other_proc.rate));
+    for (__u32 k = 0; k < pt->nused; k++)
+        order[k] = pt->used[k];
+    sort_procs = pt->s;
+    qsort(order, pt->nused, sizeof(*order), proc_cmp);
+    for (int i = 0; i < nproc && (__u32)i < pt->nused; i++) {
+        const struct proc *p = &pt->s[order[i]];
+        put(s, row + i, "%7d %-16.16s %7s %7s %7s", p->tgid, p->comm, fmt_rate(a, p->open.rate),
+            fmt_rate(b, p->fail.rate), fmt_rate(c, p->wr.rate));
+    }
+    row += nproc + 1;
+
+    put(s, row++, "%7s %s   (other %s/s)", "OPEN/s", "PATH", fmt_rate(a, m->other_path.rate));
+    for (__u32 k = 0; k < qt->nused; k++)
+        order[k] = qt->used[k];
+    sort_paths = qt->s;
+    qsort(order, qt->nused, sizeof(*order), path_cmp);
+    for (int i = 0; i < npath && (__u32)i < qt->nused; i++) {
+        const struct path *q = &qt->s[order[i]];
+        put(s, row + i, "%7s %.*s", fmt_rate(a, q->open.rate), (int)q->len, q->path);
+    }
+    scr_flush(s);
+}
+
+static double cpu_seconds(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// --- Main ---
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--source auto|shm|daemon|direct] [--sock PATH] [--backend auto|mmap|batch|read|fanotify]\n"
+            "          [--fps N] [--tau SEC] [--path-sample N] [--batch [--frames N]]\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    static struct mon m;
+    static struct scr s;
+    static struct src src;
+    struct frame_info fi;
+    const char *want = "auto";
+    enum ksys_backend backend = KSYS_BACKEND_AUTO;
+    double fps = 2, tau = 2, cpu0;
+    long frames = -1;
+    bool batch = false, topk = true;
+    __u64 frame_ns, next, prev, topk_next = 0;
+    int qfd = -1;               // top-K 질의용 연결 (열어 두고 계속 씀)
+    struct sigaction sa;
+    int rc = 0;
+
+    src.sock = KSYSD_SOCK_PATH;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--source") && i + 1 < argc) {
+            want = argv[++i];
+        } else if (!strcmp(argv[i], "--sock") && i + 1 < argc) {
+            src.sock = argv[++i];
+        } else if (!strcmp(argv[i], "--backend") && i + 1 < argc) {
+            const char *v = argv[++i];
+            for (backend = KSYS_BACKEND_AUTO; backend <= KSYS_BACKEND_FANOTIFY; backend++) {
+                if (!strcmp(v, ksys_backend_name(backend)))
+                    break;
+            }
+            if (backend > KSYS_BACKEND_FANOTIFY) {
+                fprintf(stderr, "unknown backend: %s\n", v);
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--fps") && i + 1 < argc) {
+            fps = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--tau") && i + 1 < argc) {
+            tau = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--path-sample") && i + 1 < argc) {
+            // 2의 거듭제곱으로 내림. 0 은 자동
+            unsigned long v = strtoul(argv[++i], NULL, 10);
+            m.path_fixed = v ? 1 : 0;
+            while (v && m.path_fixed * 2 <= v && m.path_fixed < PATH_SAMPLE_MAX)
+                m.path_fixed <<= 1;
+        } else if (!strcmp(argv[i], "--batch")) {
+            batch = true;
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = atol(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (fps <= 0)
+        fps = 1;
+    if (fps > FPS_MAX)
+        fps = FPS_MAX;
+    if (tau < 0)
+        tau = 0;
+    frame_ns = (__u64)(1e9 / fps);
+    m.path_every = m.path_fixed ? m.path_fixed : 1;
+    m.pt[0].gen = m.qt[0].gen = 1;
+
+    if (src_open(&src, want, backend) != 0) {
+        perror(want);
+        return 1;
+    }
+    memset(&fi, 0, sizeof(fi));
+    if (src.kind == SRC_DIRECT) {
+        static char name[32];
+        snprintf(name, sizeof(name), "direct/%s", ksys_backend_name(ksys_backend(src.k)));
+        fi.source = name;
+        topk = false;
+    } else {
+        fi.source = src_names[src.kind];
+    }
+
+    s.tty = !batch && isatty(STDOUT_FILENO);
+    scr_size(&s);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGWINCH, &sa, NULL);
+    scr_enter(&s);
+
+    prev = now_ns();
+    next = prev + frame_ns;
+    cpu0 = cpu_seconds();
+    while (!stop) {
+        __u64 now = now_ns();
+        const struct ksys_event *ev;
+        ssize_t n;
+
+        if (now < next) {
+            // 올림 (1ms 미만이 0 이 되면 프레임까지 빈 poll 을 돌며 CPU 를 태움)
+            n = src_read(&src, (int)((next - now + 999999) / 1000000), &ev);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                perror("read");
+                rc = 1;
+                break;
+            }
+            if (n > 0)
+                account(&m, ev, (size_t)n, now_ns());
+            continue;
+        }
+
+        // 프레임
+        double dt = (now - prev) / 1e9, cpu = cpu_seconds();
+        char key;
+
+        if (s.tty && read(STDIN_FILENO, &key, 1) == 1 && (key == 'q' || key == 'Q'))
+            break;
+        if (resized) {
+            resized = 0;
+            scr_size(&s);
+        }
+        if (topk && now >= topk_next) {
+            struct ksysd_topk info = { 0 };
+            int k = -1;
+
+            // 매번 붙었다 끊지 않음 (데몬에 연결/해제가 쌓이지 않게). 끊겼거나 답이 늦었으면
+            // (KSYSD_QUERY_TIMEOUT_MS) 닫고 다음 차례에 다시 붙음
+            if (qfd < 0)
+                qfd = ksysd_query_open(src.sock);
+            if (qfd >= 0)
+                k = ksysd_query_topk_fd(qfd, KSYS_TOPK_PREFIX, TOPK_WINDOW, fi.topk, 8, &info);
+            if (k < 0 && errno == EOPNOTSUPP) {
+                topk = false;
+            } else if (k < 0 && qfd >= 0) {
+                close(qfd);
+                qfd = -1;
+            }
+            fi.ntopk = k > 0 ? k : 0;
+            fi.topk_window = info.window_sec ? info.window_sec : 1;
+            topk_next = now + TOPK_EVERY_NS;
+        }
+        roll(&m, (float)dt, tau > 0 ? (float)(dt / (tau + dt)) : 1.0f);
+        fi.drops_prev = fi.drops;
+        fi.drops = src.drops;
+        fi.behind = src_behind(&src);
+        fi.cpu = dt > 0 ? (cpu - cpu0) / dt * 100 : 0;
+        fi.dt = dt;
+        draw(&s, &m, &fi);
+        m.lag_ns = 0;
+        cpu0 = cpu;
+        prev = now;
+        next += frame_ns;
+        if (next <= now)
+            next = now + frame_ns;
+        if (frames > 0 && --frames == 0)
+            break;
+    }
+
+    scr_leave(&s);
+    if (qfd >= 0)
+        close(qfd);
+    src_close(&src);
+    return rc;
+}
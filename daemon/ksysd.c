@@ -0,0 +1,1373 @@
+// daemon/ksysd.c
+// 커널 쪽 소비자 하나로 여러 로컬 클라이언트에 나눠 주는 수집 데몬. 프로토콜은 include/ksys/ksysd.h
+//
+//   gcc -O2 -Wall -I../include -o ksysd ksysd.c ../lib/libsys.c ../lib/ksys_fanotify.c ../lib/ksys_topk.c
+//   sudo ./ksysd [--backend auto|mmap|batch|read|fanotify] [--sock PATH] [--mode OCTAL] [--stats SEC]
+//                [--shm-slots N] [--policy drop-newest|drop-oldest|disconnect|sample|aggregate]
+//                [--queue KB] [--sample N] [--topk N] [--topk-window SEC] [--topk-depth N]
+//
+// 도구마다 /dev/ksys_trace 를 열면 reader 가 하나씩 늘고, 커널이 이벤트마다 spinlock 안에서
+// reader 수만큼 필터를 돌리고 깨움. ksysd 는 reader 하나 (필터 없음) 로 모두 받고, 클라이언트
+// 필터는 유저 공간에서 이벤트마다 한 번만 봄:
+//
+//   - 클라이언트 필터를 모아 인덱스로 묶음 (연결/필터가 바뀔 때만 다시 만듦)
+//       타입별 클라이언트 집합, tgid/pid/comm 해시 -> 클라이언트 집합, 조건 없는 클라이언트 집합,
+//       서로 다른 경로 앞부분마다 클라이언트 집합
+//   - 이벤트 하나는 해시 조회 몇 번 + 비트 AND 로 받을 클라이언트 집합이 나오고, 경로 비교는
+//     남은 후보가 있는 앞부분만 한 번씩. 클라이언트 수에 비례하는 건 실제로 받는 클라이언트뿐
+//   - 받은 레코드는 클라이언트별 메시지 버퍼에 모았다가 커널 배치 하나가 끝나면 send 한 번
+//
+// 클라이언트마다 크기가 정해진 큐가 있어서 소켓이 받지 않으면 거기에 쌓고 EPOLLOUT 을 기다림.
+// 큐가 차면 클라이언트가 고른 정책 (--policy 가 기본) 대로 버리거나 끊거나 샘플/집계로 낮춤.
+// send 는 모두 MSG_DONTWAIT 라 느린 클라이언트 하나가 읽는 루프를 붙잡지 못함
+//
+// 같은 머신의 소비자는 소켓 대신 공유 링 (--shm-slots, 기본 65536) 을 받아 읽을 수 있음. 데몬은
+// 커널 배치를 링에 한 번 쓰고 futex 로 깨우기만 하고, 클라이언트 수와 상관없이 할 일이 같음
+//
+// 파일 열기 레코드는 모두 top-K 표 (--topk 칸, --topk-window 초 창, 기본 256 / 60) 에도 들어감.
+// 이벤트당 비용이 상수이고 할당이 없어서 읽는 루프에 그대로 둠. TOPK 질의는 표만 보고 답함
+//
+// 단일 스레드 epoll 루프 하나. SIGINT/SIGTERM 으로 끝남
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/sockios.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys.h>
+#include <ksys/ksys_topk.h>
+#include <ksys/ksysd.h>
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010  // linux 5.1
+#endif
+
+#define CSET_WORDS      (KSYSD_MAX_CLIENTS / 64)
+#define NTYPES          32              // ksysd_filter.types 비트 수
+#define ID_LISTEN       (KSYSD_MAX_CLIENTS + 1)
+#define ID_KSYS         (KSYSD_MAX_CLIENTS + 2)
+#define DRAIN_MAX       64              // 한 번 깨어났을 때 읽는 최대 배치 (클라이언트 요청도 봐야 하므로)
+// 소켓 버퍼는 작게. 정책이 걸리는 건 유저 공간 큐라서, 여기가 크면 지연만 숨겨짐
+#define CLIENT_SNDBUF   (256 << 10)
+#define SAMPLE_DEFAULT  16
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// --- Client Set ---
+
+// 클라이언트 자리 번호의 비트 집합
+typedef struct {
+    uint64_t w[CSET_WORDS];
+} cset;
+
+static inline void cset_add(cset *s, int i)
+{
+    s->w[i >> 6] |= 1ull << (i & 63);
+}
+
+static inline bool cset_none(const cset *s)
+{
+    uint64_t x = 0;
+
+    for (int k = 0; k < CSET_WORDS; k++)
+        x |= s->w[k];
+    return !x;
+}
+
+static inline bool cset_meets(const cset *a, const cset *b)
+{
+    for (int k = 0; k < CSET_WORDS; k++) {
+        if (a->w[k] & b->w[k])
+            return true;
+    }
+    return false;
+}
+
+// m &= any | (w 가 있으면 w)
+static inline void cset_narrow(cset *m, const cset *any, const cset *w)
+{
+    for (int k = 0; k < CSET_WORDS; k++)
+        m->w[k] &= any->w[k] | (w ? w->w[k] : 0);
+}
+
+static inline void cset_remove(cset *m, const cset *w)
+{
+    for (int k = 0; k < CSET_WORDS; k++)
+        m->w[k] &= ~w->w[k];
+}
+
+// --- Filter Index ---
+
+struct id_ent {
+    __s32 id;
+    bool used;
+    cset who;
+};
+
+struct comm_ent {
+    char comm[KSYS_COMM_LEN];
+    bool used;
+    cset who;
+};
+
+struct prefix_grp {
+    char p[KSYS_PATH_LEN];
+    size_t len;
+    cset who;
+};
+
+// 열린 주소 해시. 크기는 키 수의 두 배 이상 2의 거듭제곱이라 항상 빈 칸이 있음
+struct fidx {
+    cset active;
+    cset by_type[NTYPES];
+    cset any_type;              // types == 0 (NTYPES 밖의 타입용)
+    cset any_tgid, any_pid, any_comm;
+    cset has_prefix;
+    struct id_ent *tgid, *pid;
+    __u32 tgid_mask, pid_mask;
+    __u32 ntgid, npid;
+    struct comm_ent *comm;
+    __u32 comm_mask, ncomm;
+    struct prefix_grp *prefix;
+    __u32 nprefix;
+};
+
+static inline __u32 hash_id(__s32 id)
+{
+    __u32 h = (__u32)id * 0x9e3779b1u;
+
+    return h ^ (h >> 16);
+}
+
+static inline __u32 hash_comm(const char *c)
+{
+    __u32 h = 2166136261u;
+
+    for (int i = 0; i < KSYS_COMM_LEN && c[i]; i++)
+        h = (h ^ (unsigned char)c[i]) * 16777619u;
+    return h;
+}
+
+static __u32 tab_size(__u32 keys)
+{
+    __u32 n = 8;
+
+    while (n < keys * 2)
+        n <<= 1;
+    return n;
+}
+
+static struct id_ent *id_slot(struct id_ent *t, __u32 mask, __s32 id)
+{
+    for (__u32 i = hash_id(id) & mask;; i = (i + 1) & mask) {
+        if (!t[i].used || t[i].id == id)
+            return &t[i];
+    }
+}
+
+static inline const cset *id_find(const struct id_ent *t, __u32 mask, __s32 id)
+{
+    for (__u32 i = hash_id(id) & mask;; i = (i + 1) & mask) {
+        if (!t[i].used)
+            return NULL;
+        if (t[i].id == id)
+            return &t[i].who;
+    }
+}
+
+static struct comm_ent *comm_slot(struct comm_ent *t, __u32 mask, const char *c)
+{
+    for (__u32 i = hash_comm(c) & mask;; i = (i + 1) & mask) {
+        if (!t[i].used || !strncmp(t[i].comm, c, KSYS_COMM_LEN))
+            return &t[i];
+    }
+}
+
+static inline const cset *comm_find(const struct comm_ent *t, __u32 mask, const char *c)
+{
+    for (__u32 i = hash_comm(c) & mask;; i = (i + 1) & mask) {
+        if (!t[i].used)
+            return NULL;
+        if (!strncmp(t[i].comm, c, KSYS_COMM_LEN))
+            return &t[i].who;
+    }
+}
+
+static void fidx_free(struct fidx *x)
+{
+    if (!x)
+        return;
+    free(x->tgid);
+    free(x->pid);
+    free(x->comm);
+    free(x->prefix);
+    free(x);
+}
+
+// 필터 배열에서 (f[i] 가 NULL 이면 빈 자리) 인덱스를 만듦. 실패 NULL
+static struct fidx *fidx_build(const struct ksysd_filter *const *f, int n)
+{
+    struct fidx *x = calloc(1, sizeof(*x));
+    __u32 ntgid = 0, npid = 0, ncomm = 0, npre = 0;
+
+    if (!x)
+        return NULL;
+    for (int i = 0; i < n; i++) {
+        if (!f[i])
+            continue;
+        ntgid += f[i]->tgid != -1;
+        npid += f[i]->pid != -1;
+        ncomm += f[i]->comm[0] != 0;
+        npre += f[i]->path_prefix[0] != 0;
+    }
+    x->tgid_mask = tab_size(ntgid) - 1;
+    x->pid_mask = tab_size(npid) - 1;
+    x->comm_mask = tab_size(ncomm) - 1;
+    x->tgid = calloc(x->tgid_mask + 1, sizeof(*x->tgid));
+    x->pid = calloc(x->pid_mask + 1, sizeof(*x->pid));
+    x->comm = calloc(x->comm_mask + 1, sizeof(*x->comm));
+    x->prefix = calloc(npre ? npre : 1, sizeof(*x->prefix));
+    if (!x->tgid || !x->pid || !x->comm || !x->prefix) {
+        fidx_free(x);
+        return NULL;
+    }
+
+    for (int i = 0; i < n; i++) {
+        const struct ksysd_filter *fi = f[i];
+
+        if (!fi)
+            continue;
+        cset_add(&x->active, i);
+        if (!fi->types)
+            cset_add(&x->any_type, i);
+        for (int t = 0; t < NTYPES; t++) {
+            if (!fi->types || (fi->types & (1u << t)))
+                cset_add(&x->by_type[t], i);
+        }
+
+        if (fi->tgid == -1) {
+            cset_add(&x->any_tgid, i);
+        } else {
+            struct id_ent *e = id_slot(x->tgid, x->tgid_mask, fi->tgid);
+            x->ntgid += !e->used;
+            e->used = true;
+            e->id = fi->tgid;
+            cset_add(&e->who, i);
+        }
+        if (fi->pid == -1) {
+            cset_add(&x->any_pid, i);
+        } else {
+            struct id_ent *e = id_slot(x->pid, x->pid_mask, fi->pid);
+            x->npid += !e->used;
+            e->used = true;
+            e->id = fi->pid;
+            cset_add(&e->who, i);
+        }
+        if (!fi->comm[0]) {
+            cset_add(&x->any_comm, i);
+        } else {
+            struct comm_ent *e = comm_slot(x->comm, x->comm_mask, fi->comm);
+            x->ncomm += !e->used;
+            e->used = true;
+            memcpy(e->comm, fi->comm, KSYS_COMM_LEN);
+            cset_add(&e->who, i);
+        }
+        if (fi->path_prefix[0]) {
+            size_t len = strnlen(fi->path_prefix, KSYS_PATH_LEN);
+            __u32 g;
+
+            // 같은 앞부분은 한 묶음 (이벤트마다 비교는 한 번)
+            for (g = 0; g < x->nprefix; g++) {
+                if (x->prefix[g].len == len && !memcmp(x->prefix[g].p, fi->path_prefix, len))
+                    break;
+            }
+            if (g == x->nprefix) {
+                memcpy(x->prefix[g].p, fi->path_prefix, len);
+                x->prefix[g].len = len;
+                x->nprefix++;
+            }
+            cset_add(&x->prefix[g].who, i);
+            cset_add(&x->has_prefix, i);
+        }
+    }
+    return x;
+}
+
+// 이 레코드를 받을 클라이언트 집합. 아무도 없으면 false
+static bool fidx_match(const struct fidx *x, const struct ksys_event *ev, cset *out)
+{
+    cset m;
+
+    // gap 은 유실 알림이라 모두에게
+    if (ev->type == KSYS_REC_GAP) {
+        *out = x->active;
+        return !cset_none(out);
+    }
+    m = ev->type < NTYPES ? x->by_type[ev->type] : x->any_type;
+    if (x->ntgid) {
+        cset_narrow(&m, &x->any_tgid, id_find(x->tgid, x->tgid_mask, ev->tgid));
+        if (cset_none(&m))
+            return false;
+    }
+    if (x->npid) {
+        cset_narrow(&m, &x->any_pid, id_find(x->pid, x->pid_mask, ev->pid));
+        if (cset_none(&m))
+            return false;
+    }
+    if (x->ncomm) {
+        cset_narrow(&m, &x->any_comm, comm_find(x->comm, x->comm_mask, ev->comm));
+        if (cset_none(&m))
+            return false;
+    }
+    if (x->nprefix && cset_meets(&m, &x->has_prefix)) {
+        if (!ksysd_rec_has_path(ev->type)) {
+            cset_remove(&m, &x->has_prefix);
+        } else {
+            for (__u32 g = 0; g < x->nprefix; g++) {
+                const struct prefix_grp *p = &x->prefix[g];
+
+                if (cset_meets(&m, &p->who) && strncmp(ev->path, p->p, p->len))
+                    cset_remove(&m, &p->who);
+            }
+        }
+    }
+    *out = m;
+    return !cset_none(&m);
+}
+
+// --- Clients ---
+
+enum { CL_FREE, CL_NEW, CL_ACTIVE };
+
+struct qmsg {
+    struct ksysd_hdr *m;        // KSYSD_MSG_MAX
+    __u64 t_ns;                 // 첫 레코드를 넣은 시각 (lag)
+};
+
+struct client {
+    int state;
+    int fd;
+    pid_t pid;
+    uid_t uid;
+    struct ksysd_filter filter;
+    struct ksysd_qos qos;       // DEFAULT/0 을 데몬 기본값으로 채운 것
+    bool dirty;
+    bool shm;                   // 공유 링을 받아 감
+    bool want_out;              // EPOLLOUT 을 기다리는 중
+    bool degraded;              // SAMPLE/AGGREGATE 로 낮춘 상태
+    // 보낼 메시지 큐 (원형). 아직 안 보낸 맨 뒤 메시지에는 계속 이어 붙임
+    struct qmsg *q;
+    __u32 qcap, qhead, qcount, qmax;
+    struct ksysd_hdr **pool;    // 다 보낸 버퍼 (처음 쓸 때 잡고 끝날 때까지 다시 씀)
+    __u32 npool, nbuf;
+    __u64 queued;               // 큐에 있는 레코드
+    __u64 seen;                 // SAMPLE 카운터
+    // AGGREGATE: tgid 열린 주소 표 (count 0 이면 빈 칸)
+    struct ksysd_agg agg;
+    struct ksysd_agg_ent agg_ent[KSYSD_AGG_MAX];
+    __u32 agg_n;
+    __u64 events;               // 보낸 레코드
+    __u64 lost;                 // 큐가 차서 버린 레코드
+    __u64 skipped;              // 샘플/집계로 뺀 레코드
+    __u64 msgs;
+};
+
+struct ksysd {
+    struct ksys *k;
+    int ep;
+    int lfd;
+    struct client cl[KSYSD_MAX_CLIENTS];
+    int nclients;
+    struct fidx *idx;
+    bool rebuild;
+    int dirty[KSYSD_MAX_CLIENTS];
+    int ndirty;
+    __u64 drops;
+    // 공유 링 (--shm-slots 0 이면 shm == NULL)
+    struct ksysd_shm_hdr *shm;
+    struct ksys_mmap_slot *slots;
+    size_t shm_len;
+    int shm_fd;                 // 클라이언트에 넘기는 읽기 전용 fd
+    int nshm;                   // 링을 받아 간 클라이언트 (0 이면 깨우지 않음)
+    // HELLO 에서 정하지 않은 클라이언트의 기본값
+    struct ksysd_qos qos;
+    // --topk 0 이면 NULL
+    struct ksys_topk *topk;
+    struct ksys_topk_opts topk_opts;
+    // --stats 구간마다 초기화
+    __u64 in;
+    __u64 delivered;
+    __u64 match_ns;
+    __u64 topk_ns;
+};
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop = 1;
+}
+
+static void client_drop(struct ksysd *d, int i, const char *why)
+{
+    struct client *c = &d->cl[i];
+
+    // STATS/TOPK 만 묻고 정상적으로 닫은 연결은 조용히 (모니터가 주기적으로 물어도 로그가 쌓이지 않게)
+    if (c->state != CL_NEW || c->shm || strcmp(why, "closed"))
+        fprintf(stderr, "[ksysd] client %d pid %d gone (%s): events=%llu lost=%llu skipped=%llu\n", i,
+                (int)c->pid, why, (unsigned long long)c->events, (unsigned long long)c->lost,
+                (unsigned long long)c->skipped);
+    epoll_ctl(d->ep, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    for (__u32 k = 0; k < c->qcount; k++)
+        free(c->q[(c->qhead + k) % c->qcap].m);
+    for (__u32 k = 0; k < c->npool; k++)
+        free(c->pool[k]);
+    free(c->q);
+    free(c->pool);
+    if (c->state == CL_ACTIVE)
+        d->rebuild = true;
+    if (c->shm)
+        d->nshm--;
+    // dirty 목록에 남아 있어도 flush 가 CL_FREE 를 건너뜀
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    d->nclients--;
+}
+
+static void client_accept(struct ksysd *d)
+{
+    for (;;) {
+        int fd = accept4(d->lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        int i, sndbuf = CLIENT_SNDBUF;
+        struct epoll_event ee;
+        struct ucred cr;
+        socklen_t crl = sizeof(cr);
+
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EINTR)
+                perror("accept4");
+            return;
+        }
+        for (i = 0; i < KSYSD_MAX_CLIENTS && d->cl[i].state != CL_FREE; i++)
+            ;
+        if (i == KSYSD_MAX_CLIENTS) {
+            fprintf(stderr, "[ksysd] too many clients, refusing\n");
+            close(fd);
+            continue;
+        }
+        struct client *c = &d->cl[i];
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cr, &crl) == 0) {
+            c->pid = cr.pid;
+            c->uid = cr.uid;
+        }
+        memset(&ee, 0, sizeof(ee));
+        ee.events = EPOLLIN | EPOLLRDHUP;
+        ee.data.u64 = i;
+        if (epoll_ctl(d->ep, EPOLL_CTL_ADD, fd, &ee) != 0) {
+            perror("epoll_ctl");
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->state = CL_NEW;
+        d->nclients++;
+    }
+}
+
+static const char *const policy_names[] = {
+    [KSYSD_POLICY_DEFAULT] = "default",
+    [KSYSD_POLICY_DROP_NEWEST] = "drop-newest",
+    [KSYSD_POLICY_DROP_OLDEST] = "drop-oldest",
+    [KSYSD_POLICY_DISCONNECT] = "disconnect",
+    [KSYSD_POLICY_SAMPLE] = "sample",
+    [KSYSD_POLICY_AGGREGATE] = "aggregate",
+};
+
+static void client_welcome(struct ksysd *d, int i, const struct ksysd_qos *want)
+{
+    struct client *c = &d->cl[i];
+    struct ksysd_welcome w;
+
+    c->qos = *want;
+    if (c->qos.policy == KSYSD_POLICY_DEFAULT || c->qos.policy > KSYSD_POLICY_AGGREGATE)
+        c->qos.policy = d->qos.policy;
+    if (!c->qos.sample)
+        c->qos.sample = d->qos.sample;
+    if (!c->qos.queue_kb)
+        c->qos.queue_kb = d->qos.queue_kb;
+    // 소켓에 붙을 수 있는 아무 프로세스나 데몬 메모리를 마음대로 잡게 하지 않음
+    if (c->qos.queue_kb > KSYSD_QUEUE_KB_MAX)
+        c->qos.queue_kb = KSYSD_QUEUE_KB_MAX;
+    c->qcap = (__u32)(((__u64)c->qos.queue_kb << 10) / KSYSD_MSG_MAX);
+    if (c->qcap < 4)
+        c->qcap = 4;
+    c->q = calloc(c->qcap, sizeof(*c->q));
+    c->pool = calloc(c->qcap, sizeof(*c->pool));
+    if (!c->q || !c->pool) {
+        client_drop(d, i, "out of memory");
+        return;
+    }
+
+    memset(&w, 0, sizeof(w));
+    w.h.type = KSYSD_MSG_WELCOME;
+    w.h.version = KSYSD_VERSION;
+    w.h.drops = d->drops;
+    w.rec_size = sizeof(struct ksys_event);
+    w.backend = ksys_backend(d->k);
+    w.clients = d->nclients;
+    w.qos = c->qos;
+    if (send(c->fd, &w, sizeof(w), MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)sizeof(w)) {
+        client_drop(d, i, "welcome failed");
+        return;
+    }
+    c->state = CL_ACTIVE;
+    fprintf(stderr,
+            "[ksysd] client %d pid %d uid %d: pid=%d tgid=%d comm=%.16s types=%#x prefix=%.64s policy=%s queue=%u\n",
+            i, (int)c->pid, (int)c->uid, c->filter.pid, c->filter.tgid, c->filter.comm, c->filter.types,
+            c->filter.path_prefix, policy_names[c->qos.policy], c->qcap);
+}
+
+// 링 memfd 를 SCM_RIGHTS 로. 링이 꺼져 있으면 fd 없이 응답
+static void client_send_shm(struct ksysd *d, int i)
+{
+    struct client *c = &d->cl[i];
+    struct ksysd_hdr h = { .type = KSYSD_MSG_SHM, .version = KSYSD_VERSION };
+    struct iovec iov = { .iov_base = &h, .iov_len = sizeof(h) };
+    union {
+        struct cmsghdr c;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } u;
+    struct msghdr mh;
+
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    if (d->shm) {
+        struct cmsghdr *cm;
+
+        memset(&u, 0, sizeof(u));
+        mh.msg_control = u.buf;
+        mh.msg_controllen = sizeof(u.buf);
+        cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cm), &d->shm_fd, sizeof(int));
+    }
+    if (sendmsg(c->fd, &mh, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)sizeof(h)) {
+        client_drop(d, i, "shm handoff failed");
+        return;
+    }
+    if (d->shm && !c->shm) {
+        c->shm = true;
+        d->nshm++;
+        fprintf(stderr, "[ksysd] client %d pid %d uid %d: shared ring\n", i, (int)c->pid, (int)c->uid);
+    }
+}
+
+static void client_stat(const struct client *c, int i, __u64 now, struct ksysd_client_stat *st)
+{
+    int outq = 0;
+
+    memset(st, 0, sizeof(*st));
+    st->pid = c->pid;
+    st->uid = c->uid;
+    st->slot = i;
+    st->policy = c->qos.policy;
+    st->active = c->state == CL_ACTIVE;
+    st->shm = c->shm;
+    st->degraded = c->degraded;
+    st->events = c->events;
+    st->lost = c->lost;
+    st->skipped = c->skipped;
+    st->queued = c->queued;
+    st->lag_ns = c->qcount ? now - c->q[c->qhead].t_ns : 0;
+    st->queue_msgs = c->qcount;
+    st->queue_max = c->qmax;
+    st->queue_cap = c->qcap;
+    if (ioctl(c->fd, SIOCOUTQ, &outq) == 0)
+        st->sock_bytes = outq;
+}
+
+// 모든 클라이언트의 지연/유실. 받는 쪽이 못 받으면 그냥 버림 (통계는 다시 물으면 됨)
+static void client_send_stats(struct ksysd *d, int i)
+{
+    static union {
+        struct ksysd_hdr h;
+        char buf[KSYSD_STATS_MSG_MAX];
+    } u;
+    struct ksysd_client_stat *st = (struct ksysd_client_stat *)(&u.h + 1);
+    __u64 now = now_ns();
+    __u32 n = 0;
+
+    memset(&u.h, 0, sizeof(u.h));
+    u.h.type = KSYSD_MSG_STATS;
+    u.h.version = KSYSD_VERSION;
+    u.h.drops = d->drops;
+    for (int k = 0; k < KSYSD_MAX_CLIENTS; k++) {
+        if (d->cl[k].state != CL_FREE)
+            client_stat(&d->cl[k], k, now, &st[n++]);
+    }
+    u.h.n = n;
+    send(d->cl[i].fd, &u, sizeof(u.h) + n * sizeof(*st), MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+// 표만 합쳐서 답함. 받는 쪽이 못 받으면 버림 (STATS 와 같음)
+static void client_send_topk(struct ksysd *d, int i, const struct ksysd_topk_req *q)
+{
+    static union {
+        struct ksysd_hdr h;
+        char buf[KSYSD_TOPK_MSG_MAX];
+    } u;
+    struct ksysd_topk *info = (struct ksysd_topk *)(&u.h + 1);
+    struct ksys_topk_item *it = (struct ksys_topk_item *)(info + 1);
+    int max = q->max && q->max <= KSYSD_TOPK_MAX ? q->max : KSYSD_TOPK_MAX, n = 0;
+
+    memset(&u.h, 0, sizeof(u.h));
+    memset(info, 0, sizeof(*info));
+    u.h.type = KSYSD_MSG_TOPK;
+    u.h.version = KSYSD_VERSION;
+    u.h.drops = d->drops;
+    info->dim = q->dim;
+    if (d->topk) {
+        __u32 pane = d->topk_opts.pane_sec, full = ksys_topk_window(d->topk);
+        __u32 w = q->window_sec ? (q->window_sec + pane - 1) / pane * pane : full;
+
+        ksys_topk_tick(d->topk, now_ns());
+        n = ksys_topk_query(d->topk, q->dim, q->window_sec, it, max, &info->total);
+        if (n < 0)
+            n = 0;
+        info->window_sec = w < full ? w : full;
+        info->window_max = full;
+        info->capacity = d->topk_opts.capacity;
+    }
+    u.h.n = n;
+    send(d->cl[i].fd, &u, sizeof(u.h) + sizeof(*info) + n * sizeof(*it), MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+static void client_input(struct ksysd *d, int i)
+{
+    struct client *c = &d->cl[i];
+    struct ksysd_hello m;
+    ssize_t r;
+
+    for (;;) {
+        r = recv(c->fd, &m, sizeof(m), MSG_DONTWAIT);
+        if (r < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                return;
+            client_drop(d, i, strerror(errno));
+            return;
+        }
+        if (r == 0) {
+            client_drop(d, i, "closed");
+            return;
+        }
+        if (r < (ssize_t)sizeof(m.h) || m.h.version != KSYSD_VERSION) {
+            client_drop(d, i, "bad message");
+            return;
+        }
+        if (m.h.type == KSYSD_MSG_SHM || m.h.type == KSYSD_MSG_STATS || m.h.type == KSYSD_MSG_TOPK) {
+            if (m.h.type == KSYSD_MSG_SHM) {
+                client_send_shm(d, i);
+            } else if (m.h.type == KSYSD_MSG_STATS) {
+                client_send_stats(d, i);
+            } else {
+                struct ksysd_topk_req q;
+
+                if (r != (ssize_t)sizeof(q)) {
+                    client_drop(d, i, "bad message");
+                    return;
+                }
+                memcpy(&q, &m, sizeof(q));
+                client_send_topk(d, i, &q);
+            }
+            if (c->state == CL_FREE)
+                return;
+            continue;
+        }
+        if (r != (ssize_t)sizeof(m) || (m.h.type != KSYSD_MSG_HELLO && m.h.type != KSYSD_MSG_FILTER) ||
+            (m.h.type == KSYSD_MSG_HELLO) != (c->state == CL_NEW)) {
+            client_drop(d, i, "bad message");
+            return;
+        }
+        // 받은 문자열은 끝이 NUL 이 아닐 수도 있음 (비교는 길이 제한으로 함)
+        c->filter = m.filter;
+        d->rebuild = true;
+        if (c->state == CL_NEW) {
+            client_welcome(d, i, &m.qos);
+            if (c->state == CL_FREE)
+                return;
+        }
+    }
+}
+
+static int rebuild_index(struct ksysd *d)
+{
+    const struct ksysd_filter *f[KSYSD_MAX_CLIENTS];
+    struct fidx *x;
+
+    for (int i = 0; i < KSYSD_MAX_CLIENTS; i++)
+        f[i] = d->cl[i].state == CL_ACTIVE ? &d->cl[i].filter : NULL;
+    x = fidx_build(f, KSYSD_MAX_CLIENTS);
+    if (!x)
+        return -1;
+    fidx_free(d->idx);
+    d->idx = x;
+    d->rebuild = false;
+    return 0;
+}
+
+// --- Shared Ring ---
+
+static int shm_create(struct ksysd *d, __u32 slots)
+{
+    size_t off = (sizeof(struct ksysd_shm_hdr) + 4095) & ~(size_t)4095;
+    char self[64];
+    int fd, err;
+    void *p;
+
+    d->shm_len = off + (size_t)slots * sizeof(struct ksys_mmap_slot);
+    fd = memfd_create("ksysd-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+        return -1;
+    // 크기를 못 바꾸게 봉인 (클라이언트가 보는 길이가 그대로)
+    if (ftruncate(fd, d->shm_len) != 0 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) != 0)
+        goto fail;
+    p = mmap(NULL, d->shm_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (p == MAP_FAILED)
+        goto fail;
+    // 데몬의 쓰기 매핑을 만든 뒤에는 누구도 새로 쓸 수 없게 봉인. 읽기 전용 fd 를 받은 클라이언트가
+    // /proc/self/fd 로 O_RDWR 로 다시 열어도 write() 나 쓰기 가능한 mmap 은 EPERM
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE | F_SEAL_SEAL) != 0) {
+        munmap(p, d->shm_len);
+        goto fail;
+    }
+    snprintf(self, sizeof(self), "/proc/self/fd/%d", fd);
+    d->shm_fd = open(self, O_RDONLY | O_CLOEXEC);
+    if (d->shm_fd < 0) {
+        munmap(p, d->shm_len);
+        goto fail;
+    }
+    close(fd);
+
+    d->shm = p;
+    d->slots = (struct ksys_mmap_slot *)((char *)p + off);
+    memcpy(d->shm->magic, KSYSD_SHM_MAGIC, 8);
+    d->shm->version = KSYSD_VERSION;
+    d->shm->rec_size = sizeof(struct ksys_event);
+    d->shm->ring_size = slots;
+    d->shm->slot_size = sizeof(struct ksys_mmap_slot);
+    d->shm->data_off = off;
+    d->shm->map_size = d->shm_len;
+    return 0;
+
+fail:
+    err = errno;
+    close(fd);
+    errno = err;
+    return -1;
+}
+
+// 배치를 링에 쓰고 cur_seq 를 한 번 올린 뒤 깨움. 슬롯 쓰기 순서는 ksys_slot_publish 와 같지만
+// 레코드의 커널 seq 는 그대로 둠 (링 위치는 seq_begin/seq_end 에만)
+static void shm_publish(struct ksysd *d, const struct ksys_event *ev, size_t n)
+{
+    struct ksysd_shm_hdr *h = d->shm;
+    __u32 mask = h->ring_size - 1;
+    __u64 pos = h->cur_seq;
+
+    for (size_t k = 0; k < n; k++, pos++) {
+        struct ksys_mmap_slot *slot = ksys_ring_slot(d->slots, mask, pos);
+
+        KSYS_WRITE_ONCE(slot->seq_begin, pos);
+        ksys_wmb();
+        slot->et = ev[k];
+        ksys_wmb();
+        KSYS_WRITE_ONCE(slot->seq_end, pos);
+    }
+    KSYS_WRITE_ONCE(h->drops, d->drops);
+    ksys_store_release(&h->cur_seq, pos);
+    __atomic_add_fetch(&h->futex, 1, __ATOMIC_RELEASE);
+    // 링을 받아 간 클라이언트가 없으면 시스템 콜도 없음
+    if (d->nshm)
+        syscall(SYS_futex, &h->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void shm_close(struct ksysd *d)
+{
+    if (!d->shm)
+        return;
+    __atomic_or_fetch(&d->shm->flags, KSYSD_SHM_CLOSED, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&d->shm->futex, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &d->shm->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    munmap(d->shm, d->shm_len);
+    close(d->shm_fd);
+    d->shm = NULL;
+}
+
+// --- Fan-out ---
+
+static void set_want_out(struct ksysd *d, int i, bool on)
+{
+    struct client *c = &d->cl[i];
+    struct epoll_event ee;
+
+    if (c->want_out == on)
+        return;
+    memset(&ee, 0, sizeof(ee));
+    ee.events = EPOLLIN | EPOLLRDHUP | (on ? EPOLLOUT : 0);
+    ee.data.u64 = i;
+    if (epoll_ctl(d->ep, EPOLL_CTL_MOD, c->fd, &ee) == 0)
+        c->want_out = on;
+}
+
+static struct ksysd_hdr *msg_get(struct client *c)
+{
+    struct ksysd_hdr *m;
+
+    if (c->npool)
+        return c->pool[--c->npool];
+    // 큐 깊이가 qcap 을 넘지 않으므로 버퍼도 qcap 개면 충분
+    if (c->nbuf == c->qcap)
+        return NULL;
+    m = malloc(KSYSD_MSG_MAX);
+    if (m)
+        c->nbuf++;
+    return m;
+}
+
+static struct qmsg *q_tail(struct client *c)
+{
+    return c->qcount ? &c->q[(c->qhead + c->qcount - 1) % c->qcap] : NULL;
+}
+
+static struct ksysd_hdr *q_push(struct client *c, __u16 type, __u32 sample)
+{
+    struct ksysd_hdr *m = msg_get(c);
+    struct qmsg *q;
+
+    if (!m)
+        return NULL;
+    memset(m, 0, sizeof(*m));
+    m->type = type;
+    m->version = KSYSD_VERSION;
+    m->sample = sample;
+    q = &c->q[(c->qhead + c->qcount) % c->qcap];
+    q->m = m;
+    q->t_ns = now_ns();
+    c->qcount++;
+    if (c->qcount > c->qmax)
+        c->qmax = c->qcount;
+    return m;
+}
+
+static void q_pop(struct client *c)
+{
+    struct ksysd_hdr *m = c->q[c->qhead].m;
+
+    if (m->type == KSYSD_MSG_EVENTS)
+        c->queued -= m->n;
+    c->pool[c->npool++] = m;
+    c->qhead = (c->qhead + 1) % c->qcap;
+    c->qcount--;
+}
+
+static void agg_add(struct client *c, const struct ksys_event *ev)
+{
+    __u32 h = hash_id(ev->tgid) & (KSYSD_AGG_MAX - 1);
+
+    if (!c->agg.total++)
+        c->agg.ts_from = ev->ts_ns;
+    c->agg.ts_to = ev->ts_ns;
+    // 3/4 넘게 차면 새 tgid 는 other 로 (찾는 길이가 짧게)
+    for (__u32 k = 0; k < KSYSD_AGG_MAX; k++, h = (h + 1) & (KSYSD_AGG_MAX - 1)) {
+        struct ksysd_agg_ent *e = &c->agg_ent[h];
+
+        if (e->count && e->tgid == ev->tgid) {
+            e->count++;
+            return;
+        }
+        if (!e->count) {
+            if (c->agg_n >= KSYSD_AGG_MAX * 3 / 4)
+                break;
+            e->tgid = ev->tgid;
+            e->count = 1;
+            memcpy(e->comm, ev->comm, KSYS_COMM_LEN);
+            c->agg_n++;
+            return;
+        }
+    }
+    c->agg.other++;
+}
+
+// 모은 집계를 AGG 메시지 하나로 큐에 넣고 표를 비움
+static void agg_emit(struct client *c)
+{
+    struct ksysd_hdr *m;
+    struct ksysd_agg_ent *out;
+
+    if (!c->agg.total)
+        return;
+    m = q_push(c, KSYSD_MSG_AGG, 1);
+    if (!m)
+        return;
+    memcpy(m + 1, &c->agg, sizeof(c->agg));
+    out = (struct ksysd_agg_ent *)((char *)(m + 1) + sizeof(c->agg));
+    for (__u32 k = 0; k < KSYSD_AGG_MAX; k++) {
+        if (c->agg_ent[k].count)
+            out[m->n++] = c->agg_ent[k];
+    }
+    memset(&c->agg, 0, sizeof(c->agg));
+    memset(c->agg_ent, 0, sizeof(c->agg_ent));
+    c->agg_n = 0;
+}
+
+// 큐 맨 앞부터 소켓이 받는 만큼 보냄. 못 받으면 EPOLLOUT 을 켜고 돌아감 (기다리지 않음)
+static void client_send(struct ksysd *d, int i)
+{
+    struct client *c = &d->cl[i];
+
+    c->dirty = false;
+    if (c->state != CL_ACTIVE)
+        return;
+    while (c->qcount) {
+        struct ksysd_hdr *m = c->q[c->qhead].m;
+        size_t len = sizeof(*m);
+        ssize_t r;
+
+        len += m->type == KSYSD_MSG_EVENTS ? m->n * sizeof(struct ksys_event)
+                                           : sizeof(struct ksysd_agg) + m->n * sizeof(struct ksysd_agg_ent);
+        m->lost = c->lost;
+        m->skipped = c->skipped;
+        m->drops = d->drops;
+        r = send(c->fd, m, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (r < 0 && (errno == EAGAIN || errno == ENOBUFS)) {
+            set_want_out(d, i, true);
+            return;
+        }
+        if (r != (ssize_t)len) {
+            client_drop(d, i, r < 0 ? strerror(errno) : "short send");
+            return;
+        }
+        if (m->type == KSYSD_MSG_EVENTS)
+            c->events += m->n;
+        c->msgs++;
+        q_pop(c);
+
+        // 1/4 까지 빠지면 원래대로. 집계는 여기서 한 번에 보냄
+        if (c->degraded && c->qcount <= c->qcap / 4) {
+            c->degraded = false;
+            if (c->qos.policy == KSYSD_POLICY_AGGREGATE)
+                agg_emit(c);
+        }
+    }
+    set_want_out(d, i, false);
+}
+
+// 큐가 꽉 찼을 때. 자리를 만들었으면 true
+static bool client_full(struct ksysd *d, int i)
+{
+    struct client *c = &d->cl[i];
+
+    switch (c->qos.policy) {
+        case KSYSD_POLICY_DROP_OLDEST:
+            if (c->q[c->qhead].m->type == KSYSD_MSG_EVENTS)
+                c->lost += c->q[c->qhead].m->n;
+            q_pop(c);
+            return true;
+        case KSYSD_POLICY_DISCONNECT:
+            client_drop(d, i, "queue full");
+            return false;
+        default:
+            // DROP_NEWEST, 그리고 샘플/집계로도 못 따라갈 때
+            c->lost++;
+            return false;
+    }
+}
+
+static void client_put(struct ksysd *d, int i, const struct ksys_event *ev)
+{
+    struct client *c = &d->cl[i];
+    struct qmsg *t;
+    struct ksysd_hdr *m;
+    __u32 sample = 1;
+
+    // gap 은 유실 알림이라 낮춘 동안에도 (샘플/집계 모두) 항상 그대로 보냄
+    if (c->degraded && ev->type != KSYS_REC_GAP) {
+        if (c->qos.policy == KSYSD_POLICY_AGGREGATE) {
+            agg_add(c, ev);
+            c->skipped++;
+            return;
+        }
+        // SAMPLE
+        if (c->seen++ % c->qos.sample) {
+            c->skipped++;
+            return;
+        }
+        sample = c->qos.sample;
+    }
+
+    t = q_tail(c);
+    if (t && t->m->type == KSYSD_MSG_EVENTS && t->m->sample == sample && t->m->n < KSYSD_BATCH_MAX) {
+        m = t->m;
+    } else {
+        if (c->qcount == c->qcap && !client_full(d, i))
+            return;
+        m = q_push(c, KSYSD_MSG_EVENTS, sample);
+        if (!m) {
+            c->lost++;
+            return;
+        }
+        // 3/4 가 차면 낮춤
+        if (!c->degraded && c->qcount >= c->qcap * 3 / 4 &&
+            (c->qos.policy == KSYSD_POLICY_SAMPLE || c->qos.policy == KSYSD_POLICY_AGGREGATE)) {
+            c->degraded = true;
+            c->seen = 0;
+        }
+    }
+    ((struct ksys_event *)(m + 1))[m->n++] = *ev;
+    c->queued++;
+    d->delivered++;
+    if (!c->dirty) {
+        c->dirty = true;
+        d->dirty[d->ndirty++] = i;
+    }
+}
+
+static void deliver(struct ksysd *d, const struct ksys_event *ev, size_t n)
+{
+    const struct fidx *x = d->idx;
+    uint64_t t0 = now_ns();
+
+    for (size_t e = 0; e < n; e++) {
+        cset m;
+
+        if (!fidx_match(x, &ev[e], &m))
+            continue;
+        for (int w = 0; w < CSET_WORDS; w++) {
+            for (uint64_t bits = m.w[w]; bits; bits &= bits - 1) {
+                int i = w * 64 + __builtin_ctzll(bits);
+
+                // 이 배치 중에 끊긴 클라이언트 (인덱스는 배치가 끝난 뒤 다시 만듦)
+                if (d->cl[i].state == CL_ACTIVE)
+                    client_put(d, i, &ev[e]);
+            }
+        }
+    }
+    d->match_ns += now_ns() - t0;
+}
+
+// 쌓인 것을 읽어 나눔. 배치가 끝나면 받은 클라이언트마다 보낼 수 있는 만큼 send
+static int drain(struct ksysd *d)
+{
+    struct ksys_batch b;
+
+    for (int k = 0; k < DRAIN_MAX; k++) {
+        if (ksys_next_batch(d->k, 0, &b) != 0)
+            return errno == EINTR ? 0 : -1;
+        d->drops = b.drops;
+        if (!b.n)
+            break;
+        d->in += b.n;
+        if (d->shm)
+            shm_publish(d, b.ev, b.n);
+        if (d->topk) {
+            __u64 t0 = now_ns();
+
+            ksys_topk_tick(d->topk, t0);
+            for (size_t j = 0; j < b.n; j++)
+                ksys_topk_add(d->topk, &b.ev[j]);
+            d->topk_ns += now_ns() - t0;
+        }
+        if (d->nclients)
+            deliver(d, b.ev, b.n);
+        for (int j = 0; j < d->ndirty; j++) {
+            if (d->cl[d->dirty[j]].dirty)
+                client_send(d, d->dirty[j]);
+        }
+        d->ndirty = 0;
+    }
+    return 0;
+}
+
+// --- Main ---
+
+static void print_stats(struct ksysd *d, double secs)
+{
+    __u64 lost = 0, skipped = 0, lag = 0, now = now_ns();
+    int slow = -1, degraded = 0;
+
+    for (int i = 0; i < KSYSD_MAX_CLIENTS; i++) {
+        const struct client *c = &d->cl[i];
+
+        if (c->state != CL_ACTIVE)
+            continue;
+        lost += c->lost;
+        skipped += c->skipped;
+        degraded += c->degraded;
+        if (c->qcount && now - c->q[c->qhead].t_ns > lag) {
+            lag = now - c->q[c->qhead].t_ns;
+            slow = i;
+        }
+    }
+    fprintf(stderr,
+            "[ksysd] %.0f ev/s  clients=%d (shm %d)  delivered=%.0f/s  match=%.1f ns/ev  topk=%.1f ns/ev"
+            "  drops=%llu  lost=%llu  skipped=%llu  degraded=%d  max-lag=%.1f ms (client %d)\n",
+            d->in / secs, d->nclients, d->nshm, d->delivered / secs, d->in ? (double)d->match_ns / d->in : 0.0,
+            d->in ? (double)d->topk_ns / d->in : 0.0, (unsigned long long)d->drops, (unsigned long long)lost, (unsigned long long)skipped, degraded, lag / 1e6,
+            slow);
+    d->in = d->delivered = d->match_ns = d->topk_ns = 0;
+}
+
+static int listen_on(const char *path, mode_t mode)
+{
+    struct sockaddr_un sa;
+    int fd;
+
+    if (strlen(path) >= sizeof(sa.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strcpy(sa.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0 || chmod(path, mode) != 0 || listen(fd, 64) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--backend auto|mmap|batch|read|fanotify] [--sock PATH] [--mode OCTAL] [--stats SEC]\n"
+            "          [--shm-slots N] [--policy drop-newest|drop-oldest|disconnect|sample|aggregate]\n"
+            "          [--queue KB] [--sample N] [--topk N] [--topk-window SEC] [--topk-depth N]\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    static struct ksysd d;
+    struct ksys_open_opts o;
+    struct epoll_event ee, evs[64];
+    const char *sock = KSYSD_SOCK_PATH;
+    mode_t mode = 0600;
+    int stats_sec = 0, rc = 0;
+    unsigned long shm_slots = 65536;
+    uint64_t stats_t0;
+    struct sigaction sa;
+
+    ksys_open_opts_init(&o);
+    d.qos.policy = KSYSD_POLICY_DROP_OLDEST;
+    d.qos.sample = SAMPLE_DEFAULT;
+    d.qos.queue_kb = 2048;
+    ksys_topk_opts_init(&d.topk_opts);
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--backend") && i + 1 < argc) {
+            const char *v = argv[++i];
+            for (o.backend = KSYS_BACKEND_AUTO; o.backend <= KSYS_BACKEND_FANOTIFY; o.backend++) {
+                if (!strcmp(v, ksys_backend_name(o.backend)))
+                    break;
+            }
+            if (o.backend > KSYS_BACKEND_FANOTIFY) {
+                fprintf(stderr, "unknown backend: %s\n", v);
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--sock") && i + 1 < argc) {
+            sock = argv[++i];
+        } else if (!strcmp(argv[i], "--mode") && i + 1 < argc) {
+            mode = (mode_t)strtoul(argv[++i], NULL, 8);
+        } else if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+            stats_sec = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--policy") && i + 1 < argc) {
+            const char *v = argv[++i];
+            for (d.qos.policy = KSYSD_POLICY_DROP_NEWEST; d.qos.policy <= KSYSD_POLICY_AGGREGATE; d.qos.policy++) {
+                if (!strcmp(v, policy_names[d.qos.policy]))
+                    break;
+            }
+            if (d.qos.policy > KSYSD_POLICY_AGGREGATE) {
+                fprintf(stderr, "unknown policy: %s\n", v);
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--queue") && i + 1 < argc) {
+            d.qos.queue_kb = (__u32)strtoul(argv[++i], NULL, 10);
+            if (d.qos.queue_kb > KSYSD_QUEUE_KB_MAX) {
+                fprintf(stderr, "--queue must be at most %u KB\n", KSYSD_QUEUE_KB_MAX);
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--sample") && i + 1 < argc) {
+            d.qos.sample = (__u16)strtoul(argv[++i], NULL, 10);
+            if (!d.qos.sample)
+                d.qos.sample = 1;
+        } else if (!strcmp(argv[i], "--topk") && i + 1 < argc) {
+            d.topk_opts.capacity = (__u32)strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--topk-window") && i + 1 < argc) {
+            // 조각 수는 그대로 두고 조각 길이를 맞춤. 올림이라 창은 요청보다 짧아지지 않음
+            // (나눠떨어지지 않으면 조금 길어지고, 조각 수보다 짧으면 조각당 1 초)
+            __u32 w = (__u32)strtoul(argv[++i], NULL, 10);
+            if (!w) {
+                fprintf(stderr, "--topk-window must be at least 1 second\n");
+                return 2;
+            }
+            d.topk_opts.pane_sec = (w + d.topk_opts.panes - 1) / d.topk_opts.panes;
+        } else if (!strcmp(argv[i], "--topk-depth") && i + 1 < argc) {
+            d.topk_opts.prefix_depth = (__u32)strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--shm-slots") && i + 1 < argc) {
+            shm_slots = strtoul(argv[++i], NULL, 10);
+            if (shm_slots & (shm_slots - 1) || shm_slots > (1ul << 24)) {
+                fprintf(stderr, "--shm-slots must be 0 or a power of two up to 16M\n");
+                return 2;
+            }
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    for (int i = 0; i < KSYSD_MAX_CLIENTS; i++)
+        d.cl[i].fd = -1;
+    d.idx = fidx_build(NULL, 0);
+    d.k = ksys_open(&o);
+    if (!d.idx || !d.k) {
+        perror("ksys_open");
+        return 1;
+    }
+    if (d.topk_opts.capacity && !(d.topk = ksys_topk_new(&d.topk_opts))) {
+        perror("topk");
+        ksys_close(d.k);
+        return 1;
+    }
+    if (shm_slots && shm_create(&d, (__u32)shm_slots) != 0) {
+        perror("shared ring");
+        ksys_close(d.k);
+        return 1;
+    }
+    d.lfd = listen_on(sock, mode);
+    if (d.lfd < 0) {
+        perror(sock);
+        ksys_close(d.k);
+        return 1;
+    }
+    d.ep = epoll_create1(EPOLL_CLOEXEC);
+    memset(&ee, 0, sizeof(ee));
+    ee.events = EPOLLIN;
+    ee.data.u64 = ID_LISTEN;
+    if (d.ep < 0 || epoll_ctl(d.ep, EPOLL_CTL_ADD, d.lfd, &ee) != 0) {
+        perror("epoll");
+        return 1;
+    }
+    ee.data.u64 = ID_KSYS;
+    if (epoll_ctl(d.ep, EPOLL_CTL_ADD, ksys_fd(d.k), &ee) != 0) {
+        perror("epoll_ctl ksys");
+        return 1;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "[ksysd] backend=%s sock=%s shm-slots=%lu topk=%u/%us\n", ksys_backend_name(ksys_backend(d.k)),
+            sock, shm_slots, d.topk_opts.capacity, d.topk ? ksys_topk_window(d.topk) : 0);
+
+    stats_t0 = now_ns();
+    while (!stop) {
+        int timeout = -1, n, ready;
+
+        if (stats_sec > 0) {
+            uint64_t due = stats_t0 + (uint64_t)stats_sec * 1000000000ull, t = now_ns();
+            timeout = due > t ? (int)((due - t) / 1000000) + 1 : 0;
+        }
+        ready = ksys_prepare_wait(d.k);
+        if (ready < 0) {
+            perror("ksys_prepare_wait");
+            rc = 1;
+            break;
+        }
+        n = epoll_wait(d.ep, evs, 64, ready ? 0 : timeout);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            rc = 1;
+            break;
+        }
+        for (int e = 0; e < n; e++) {
+            __u64 id = evs[e].data.u64;
+
+            if (id == ID_KSYS) {
+                ready = 1;
+            } else if (id == ID_LISTEN) {
+                client_accept(&d);
+            } else if (d.cl[id].state != CL_FREE) {
+                if (evs[e].events & EPOLLIN)
+                    client_input(&d, (int)id);
+                if (d.cl[id].state != CL_FREE && (evs[e].events & EPOLLOUT))
+                    client_send(&d, (int)id);
+                if (d.cl[id].state != CL_FREE && (evs[e].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)))
+                    client_drop(&d, (int)id, "hangup");
+            }
+        }
+        // 필터가 바뀐 클라이언트는 다음 이벤트부터 새 인덱스로
+        if (d.rebuild && rebuild_index(&d) != 0) {
+            perror("rebuild_index");
+            rc = 1;
+            break;
+        }
+        if (ready && drain(&d) != 0) {
+            perror("ksys_next_batch");
+            rc = 1;
+            break;
+        }
+        if (stats_sec > 0 && now_ns() - stats_t0 >= (uint64_t)stats_sec * 1000000000ull) {
+            print_stats(&d, (now_ns() - stats_t0) / 1e9);
+            stats_t0 = now_ns();
+        }
+    }
+
+    for (int i = 0; i < KSYSD_MAX_CLIENTS; i++) {
+        if (d.cl[i].state != CL_FREE)
+            client_drop(&d, i, "shutdown");
+    }
+    shm_close(&d);
+    close(d.lfd);
+    unlink(sock);
+    close(d.ep);
+    fidx_free(d.idx);
+    ksys_topk_free(d.topk);
+    ksys_close(d.k);
+    return rc;
+}
@@ -0,0 +1,260 @@
+// include/ksys/ksys.h
+// /dev/ksys_trace ABI (ioctl, 레코드, mmap 레이아웃) 와 libksys 소비자 API
+//
+// 커널 모듈과 모든 유저 공간 도구가 이 헤더 하나를 씀. __KERNEL__ 이면 ABI 부분만 보임.
+// 유저 공간: gcc -I<repo>/include ... <repo>/lib/libsys.c <repo>/lib/ksys_fanotify.c
+#ifndef KSYS_H
+#define KSYS_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#include <ksys/ksys_core.h>
+
+#define KSYS_DEV_PATH   "/dev/ksys_trace"
+#define KSYS_IOC_MAGIC  'k'
+
+// --- Reader Options (KSYS_IOC_SET_OPTS) ---
+#define KSYS_OPT_GAP_RECORDS    (1u << 0)   // drop 구간을 read 스트림에 gap 레코드로 끼워 넣음
+#define KSYS_OPT_MASK           (KSYS_OPT_GAP_RECORDS)
+
+// --- Projection Fields (KSYS_IOC_SET_PROJECTION) ---
+// 0 이 아니면 read 는 struct ksys_event 대신 ksys_rec_hdr + 선택한 필드만 담은 packed 레코드를 냄.
+// 필드는 크기별로 묶고 그 안에서 bit 순서: u64(seq, ts_ns, ino) -> u32(pid, tgid, dfd, flags, mode, ret, dev, gen)
+// -> comm[16] -> path(NUL 까지)
+#define KSYS_FIELD_SEQ          (1u << 0)
+#define KSYS_FIELD_TS           (1u << 1)
+#define KSYS_FIELD_PID          (1u << 2)
+#define KSYS_FIELD_TGID         (1u << 3)
+#define KSYS_FIELD_DFD          (1u << 4)
+#define KSYS_FIELD_FLAGS        (1u << 5)
+#define KSYS_FIELD_MODE         (1u << 6)
+#define KSYS_FIELD_COMM         (1u << 7)
+#define KSYS_FIELD_PATH         (1u << 8)
+#define KSYS_FIELD_RET          (1u << 9)
+#define KSYS_FIELD_DEV          (1u << 10)
+#define KSYS_FIELD_GEN          (1u << 11)
+#define KSYS_FIELD_INO          (1u << 12)
+#define KSYS_FIELD_ALL          ((1u << 13) - 1)
+#define KSYS_FIELD_U64S         (KSYS_FIELD_SEQ | KSYS_FIELD_TS | KSYS_FIELD_INO)
+#define KSYS_FIELD_U32S         (KSYS_FIELD_PID | KSYS_FIELD_TGID | KSYS_FIELD_DFD | \
+                                 KSYS_FIELD_FLAGS | KSYS_FIELD_MODE | KSYS_FIELD_RET | \
+                                 KSYS_FIELD_DEV | KSYS_FIELD_GEN)
+#define KSYS_PROJ_REC_MAX       128     // packed 레코드 최대 크기 (read 버퍼는 최소 이만큼)
+
+// --- Capture Modes (ksys_config.capture) ---
+#define KSYS_CAP_INODE          (1u << 0)   // kretprobe 로 열린 파일의 (dev, ino, gen) 기록
+#define KSYS_CAP_PROC           (1u << 1)   // sched_process_{fork,exec,exit} 레코드
+#define KSYS_CAP_NO_COMM        (1u << 2)   // openat 레코드에 comm 을 싣지 않음 (프로세스 테이블로 조인)
+#define KSYS_CAP_MASK           (KSYS_CAP_INODE | KSYS_CAP_PROC | KSYS_CAP_NO_COMM)
+
+// --- Attach Points (ksys_config.attach) ---
+enum ksys_attach {
+    KSYS_ATTACH_WRAPPER     = 0,    // kprobe __x64_sys_openat
+    KSYS_ATTACH_OPENAT2     = 1,    // kprobe do_sys_openat2 (open/openat/openat2/creat 전부)
+    KSYS_ATTACH_TRACEPOINT  = 2,    // raw_syscalls:sys_enter 에서 __NR_openat 만
+    KSYS_ATTACH_NONE        = 3,    // openat 캡처 끔 (proc 레코드만, 벤치 기준선)
+    KSYS_ATTACH_MAX,
+};
+
+// --- Data Structures ---
+
+enum ksys_start_mode {
+    KSYS_START_NOW    = 0,
+    KSYS_START_OLDEST = 1,
+    KSYS_START_SEQ    = 2,
+};
+
+struct ksys_start {
+    __u32 mode;
+    __u32 _pad;
+    __u64 seq;
+};
+
+// KSYS_IOC_READ_BATCH: min_events 개가 모이거나 timeout 이 지나면 한 번에 채워서 반환
+// read() 와 마찬가지로 한 번에 최대 1024 레코드 (min_events 도 거기서 잘림)
+struct ksys_read_batch {
+    __u64 buf;          // in: 레코드 버퍼 (user 포인터), read() 와 같은 형식
+    __u32 buf_len;      // in: buf 바이트 크기
+    __u32 min_events;   // in: 이만큼 모일 때까지 대기
+    __s32 timeout_ms;   // in: <0 무한 대기, 0 대기 없음
+    __u32 nr_events;    // out: 채운 레코드 수
+    __u32 nr_bytes;     // out: 채운 바이트 수
+    __u32 _pad;
+    __u64 drops;        // out: 이 리더의 누적 drops
+    __u64 cur_seq;      // out: 반환 시점의 ksys_seq
+};
+
+// KSYS_IOC_JOIN_GROUP: 같은 스트림을 여러 리더가 나눠서 한 번만 소비
+enum ksys_group_mode {
+    KSYS_GROUP_CLAIM      = 0,  // 같은 id 끼리 커서 공유, read 마다 배치 단위로 가져감
+    KSYS_GROUP_SHARD_TGID = 1,  // tgid % nr_shards == shard 인 이벤트만
+    KSYS_GROUP_SHARD_SEQ  = 2,  // seq % nr_shards == shard 인 이벤트만
+};
+
+struct ksys_group_join {
+    __u32 id;           // CLAIM: 그룹 식별자
+    __u32 mode;         // enum ksys_group_mode
+    __u32 shard;        // SHARD_*: 0 .. nr_shards-1
+    __u32 nr_shards;    // SHARD_*: 멤버 수
+};
+
+// KSYS_IOC_SET_CONFIG: probe 단계 전역 설정 (CAP_SYS_ADMIN). 통째로 RCU 로 교체되므로 probe 는 락 없이 일관된 값을 봄
+struct ksys_config {
+    __s32 pid;                  // -1: 전체
+    __s32 tgid;                 // -1: 전체
+    char  comm[KSYS_COMM_LEN];  // "": 전체
+    __u32 sample_every;         // CPU 별로 N 개 중 1개만 기록 (0/1: 전부)
+    __u32 wake_batch;           // seq 가 N 의 배수일 때만 reader 깨움 (0/1: 매번). 못 깨운 것도 wake_flush_ms 안에
+    __u32 capture;              // KSYS_CAP_*
+    __u32 attach;               // enum ksys_attach
+};
+
+struct ksys_stats {
+    __u64 cur_seq;
+    __u64 drops;        // 이 리더의 누적 drops
+    __u32 ring_size;
+    __s32 ring_node;    // 링 메모리가 있는 NUMA 노드 (reader 스레드를 여기 CPU 에 두면 로컬 접근)
+};
+
+// 링 오토튜너의 상태와 마지막 결정 (KSYS_IOC_GET_TUNE)
+enum ksys_tune_reason {
+    KSYS_TUNE_NONE = 0,
+    KSYS_TUNE_GROW_DROPS,   // 구간 안에 drops 발생 (또는 링 한 바퀴 이상 뒤처진 reader)
+    KSYS_TUNE_GROW_LAG,     // 최대 lag 가 링의 3/4 초과
+    KSYS_TUNE_SHRINK_IDLE,  // 한동안 drops 없고 lag 가 1/8 미만
+    KSYS_TUNE_ALLOC_FAIL,   // 새 링 할당 실패, 크기 유지
+};
+
+struct ksys_tune_stats {
+    __u32 enabled;
+    __u32 ring_size;
+    __u32 ring_min;
+    __u32 ring_max;
+    __u32 interval_ms;
+    __u32 last_reason;  // enum ksys_tune_reason
+    __u64 last_ns;      // 마지막 리사이즈 시도 시각 (ktime_get_ns)
+    __u32 last_from;
+    __u32 last_to;
+    __u64 grows;
+    __u64 shrinks;
+    __u64 drops_total;  // 모든 커서의 누적 drops
+    __u64 lag_max;      // 마지막 틱에서 본 최대 reader lag (그 사이 읽은 reader 만)
+    __u64 base_seq;     // 리사이즈 후 링에 남아 있는 가장 작은 seq
+};
+
+// projection 모드 레코드 헤더. KSYS_REC_GAP 이면 fields = 0 이고 뒤에 u64 lost_from/lost_to/count
+struct ksys_rec_hdr {
+    __u16 type;         // enum ksys_rec_type
+    __u16 len;          // 헤더 포함 레코드 길이 (8의 배수)
+    __u32 fields;       // 이 레코드에 담긴 KSYS_FIELD_*
+};
+
+#define KSYS_MMAP_VERSION 1
+
+// mmap 영역 맨 앞 페이지. 슬롯은 hdr_size 오프셋부터 ring_size 개
+struct ksys_mmap_hdr {
+    __u32 version;
+    __u32 ring_size;
+    __u32 slot_size;
+    __u32 hdr_size;
+    __u64 cur_seq;      // 다음에 쓸 seq (release store)
+    __u32 chunk_size;   // 백킹 페이지 크기 (PMD 크기면 huge page)
+    __s32 node;
+    __u64 map_size;     // mmap 가능한 전체 길이
+    __u64 base_seq;     // 유효 범위는 [max(cur_seq - ring_size, base_seq), cur_seq)
+    __u32 flags;        // KSYS_MMAP_*
+    __u32 _pad;
+};
+
+#define KSYS_MMAP_STALE (1u << 0)   // 리사이즈로 교체된 링. 다시 mmap 할 것
+
+// --- IOCTL Commands ---
+#define KSYS_IOC_GET_STATS      _IOR(KSYS_IOC_MAGIC, 1, struct ksys_stats)
+#define KSYS_IOC_SET_FILTER     _IOW(KSYS_IOC_MAGIC, 2, struct ksys_filter)
+#define KSYS_IOC_SET_START      _IOW(KSYS_IOC_MAGIC, 3, struct ksys_start)
+#define KSYS_IOC_SET_OPTS       _IOW(KSYS_IOC_MAGIC, 4, __u32)
+#define KSYS_IOC_READ_BATCH     _IOWR(KSYS_IOC_MAGIC, 5, struct ksys_read_batch)
+#define KSYS_IOC_JOIN_GROUP     _IOW(KSYS_IOC_MAGIC, 6, struct ksys_group_join)
+#define KSYS_IOC_LEAVE_GROUP    _IO(KSYS_IOC_MAGIC, 7)
+#define KSYS_IOC_SET_PROJECTION _IOW(KSYS_IOC_MAGIC, 8, __u32)
+#define KSYS_IOC_GET_CONFIG     _IOR(KSYS_IOC_MAGIC, 9, struct ksys_config)
+#define KSYS_IOC_SET_CONFIG     _IOW(KSYS_IOC_MAGIC, 10, struct ksys_config)
+#define KSYS_IOC_GET_TUNE       _IOR(KSYS_IOC_MAGIC, 11, struct ksys_tune_stats)
+
+#ifndef __KERNEL__
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- libksys ---
+// 장치 (또는 fanotify) 를 열고, 필터/시작 위치를 정한 뒤 ksys_next_batch 로 레코드 묶음을 받음.
+// 받는 버퍼는 open 때 한 번 잡고 계속 재사용. 백엔드마다 배치 하나에 드는 syscall:
+//   MMAP   0 (데이터가 있을 때), 대기할 때만 SET_START + poll
+//   BATCH  READ_BATCH ioctl 1 번 (대기 포함)
+//   READ   poll + read + GET_STATS
+//   FANOTIFY  read 1 번 + 캐시 miss 때 경로/comm 조회
+
+enum ksys_backend {
+    KSYS_BACKEND_AUTO = 0,  // MMAP -> BATCH -> READ 순서, 장치를 못 열면 FANOTIFY
+    KSYS_BACKEND_MMAP,      // 링을 mmap 해서 락 없이 복사 (필터는 유저 공간에서)
+    KSYS_BACKEND_BATCH,     // KSYS_IOC_READ_BATCH
+    KSYS_BACKEND_READ,      // poll + read()
+    KSYS_BACKEND_FANOTIFY,  // lib/ksys_fanotify.c (모듈 없는 호스트). drops 는 0, 유실은 gap 레코드로만
+};
+
+struct ksys_fan_opts;
+
+struct ksys_open_opts {
+    const char *dev;            // NULL: KSYS_DEV_PATH
+    enum ksys_backend backend;
+    __u32 batch;                // ksys_next_batch 한 번의 최대 레코드 수
+    __u32 opts;                 // KSYS_OPT_*
+    struct ksys_filter filter;
+    struct ksys_start start;
+    const struct ksys_fan_opts *fan;    // FANOTIFY 옵션 (NULL: "/" 전체). filter 는 위의 것을 씀
+};
+
+// ksys_next_batch 결과. ev 는 다음 ksys_next_batch/ksys_close 전까지만 유효
+struct ksys_batch {
+    const struct ksys_event *ev;
+    size_t n;
+    __u64 drops;                // 이 소비자의 누적 drops
+};
+
+struct ksys;
+
+// 기본값: 장치 경로 기본, AUTO, batch 1024, 필터 전체, START_NOW
+void ksys_open_opts_init(struct ksys_open_opts *o);
+
+// 실패하면 NULL, errno 설정
+struct ksys *ksys_open(const struct ksys_open_opts *o);
+void ksys_close(struct ksys *k);
+
+enum ksys_backend ksys_backend(const struct ksys *k);
+const char *ksys_backend_name(enum ksys_backend b);
+
+// 외부 이벤트 루프용 대기 fd. 기다리기 전에 ksys_prepare_wait 를 부르고,
+// 1 이 나오면 이미 읽을 게 있으니 기다리지 말 것
+int ksys_fd(const struct ksys *k);
+int ksys_prepare_wait(struct ksys *k);
+
+// 레코드를 최대 batch 개 받음. timeout_ms: <0 무한, 0 대기 없음.
+// 반환 0 (timeout 이거나 깨어난 뒤 필터에 다 걸러지면 out->n == 0), 실패 -1 (errno, EINTR 포함)
+int ksys_next_batch(struct ksys *k, int timeout_ms, struct ksys_batch *out);
+
+int ksys_set_filter(struct ksys *k, const struct ksys_filter *f);
+
+// 장치 백엔드만 (FANOTIFY 면 ENOTSUP)
+int ksys_get_stats(struct ksys *k, struct ksys_stats *st);
+int ksys_get_config(struct ksys *k, struct ksys_config *c);
+int ksys_set_config(struct ksys *k, const struct ksys_config *c);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // !__KERNEL__
+
+#endif // KSYS_H
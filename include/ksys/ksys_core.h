@@ -0,0 +1,209 @@
+// include/ksys/ksys_core.h
+// 링/필터/커서 코어. 커널 모듈과 유저 공간 (벤치 하네스, 라이브러리) 이 같은 코드를 씀
+//
+// 락은 여기서 잡지 않음. 커널은 ksys_rb_lock, 유저 공간 하네스는 자기 락을 호출자가 잡음.
+// 슬롯 쓰기/읽기는 seq_begin/seq_end 로 검증하므로 mmap reader 는 락 없이 읽을 수 있음
+#ifndef KSYS_CORE_H
+#define KSYS_CORE_H
+
+#include <linux/types.h>
+
+#ifdef __KERNEL__
+#include <linux/stddef.h>
+#include <linux/string.h>
+#include <asm/barrier.h>
+
+#define ksys_wmb()                  smp_wmb()
+#define ksys_rmb()                  smp_rmb()
+#define KSYS_READ_ONCE(x)           READ_ONCE(x)
+#define KSYS_WRITE_ONCE(x, v)       WRITE_ONCE(x, v)
+#define ksys_load_acquire(p)        smp_load_acquire(p)
+#define ksys_store_release(p, v)    smp_store_release(p, v)
+#else
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define ksys_wmb()                  __atomic_thread_fence(__ATOMIC_RELEASE)
+#define ksys_rmb()                  __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define KSYS_READ_ONCE(x)           __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define KSYS_WRITE_ONCE(x, v)       __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define ksys_load_acquire(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ksys_store_release(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+#define KSYS_COMM_LEN   16
+#define KSYS_PATH_LEN   64
+
+enum ksys_rec_type {
+    KSYS_REC_OPENAT     = 0,
+    KSYS_REC_GAP        = 1,
+    KSYS_REC_OPENAT_RET = 2,    // KSYS_CAP_INODE: 리턴 시점에 기록, ret/dev/ino/gen 유효
+    KSYS_REC_FORK       = 3,    // KSYS_CAP_PROC: pid/tgid = 자식, ppid/ptgid = 부모
+    KSYS_REC_EXEC       = 4,    // KSYS_CAP_PROC: path = 실행 파일, comm = 새 이름
+    KSYS_REC_EXIT       = 5,    // KSYS_CAP_PROC: 스레드마다 하나. 프로세스 종료는 group_dead (리더가 먼저 끝날 수 있음)
+};
+
+// 커널 pid_t/umode_t 와 같은 크기 (x86_64)
+struct ksys_event {
+    __u64 seq;
+    __u64 ts_ns;
+    __s32 pid;
+    __s32 tgid;
+    char  comm[KSYS_COMM_LEN];
+    char  path[KSYS_PATH_LEN];
+    union { __s32 dfd;   __s32 ppid;  };    // FORK: 부모 pid
+    union { __s32 flags; __s32 ptgid; __s32 group_dead; };  // FORK: 부모 tgid / EXIT: 1 이면 그룹의 마지막 스레드
+    __u16 mode;
+    __u16 type;         // enum ksys_rec_type
+    union { __s32 ret; __s32 exit_code; };  // OPENAT_RET: fd 또는 -errno / EXIT: exit_code
+    __u32 dev;          // OPENAT_RET: new_encode_dev(s_dev), 실패면 0
+    __u32 gen;          // OPENAT_RET: i_generation
+    __u64 ino;          // OPENAT_RET: i_ino
+};
+
+// KSYS_REC_GAP 레코드: ksys_event 와 크기 및 type 위치가 같아서 같은 배열에 섞여 나감
+struct ksys_gap {
+    __u64 seq;              // == lost_to_seq (스트림이 다시 이어지는 지점)
+    __u64 ts_ns;            // gap 을 감지한 시각
+    __u64 lost_from_seq;    // 유실 구간 시작 (포함)
+    __u64 lost_to_seq;      // 유실 구간 끝 (미포함)
+    __u64 count;            // lost_to_seq - lost_from_seq
+    __u8  _rsv[offsetof(struct ksys_event, type) - 5 * sizeof(__u64)];
+    __u16 type;             // KSYS_REC_GAP
+    __u8  _tail[sizeof(struct ksys_event) - offsetof(struct ksys_event, type) - sizeof(__u16)];
+};
+
+// reader: seq_end(acquire) -> 본문 복사 -> seq_begin 이 둘 다 원하는 seq 면 유효
+struct ksys_mmap_slot {
+    __u64 seq_begin;    // write 시작
+    struct ksys_event et;
+    __u64 seq_end;      // write 완료
+};
+
+struct ksys_filter {
+    __s32 pid;          // -1: 전체
+    __s32 tgid;         // -1: 전체
+    char  comm[KSYS_COMM_LEN];  // "": 전체
+};
+
+// 읽기 위치. 보통은 reader 가 혼자 갖고, CLAIM 그룹이면 멤버들이 하나를 공유
+struct ksys_cursor {
+    __u64 next_seq;     // 다음에 읽어야 할 시퀀스 번호
+    __u64 drops;        // 늦어서 놓친 이벤트 수
+    bool  gap_pending;  // 아직 read 로 내보내지 않은 gap 이 있음
+    __u64 gap_from;
+    __u64 gap_to;
+};
+
+// ABI 고정 (x86_64 기준). 커널과 유저 공간이 같은 크기로 보는지 컴파일 때 확인
+#ifdef __cplusplus
+#define KSYS_ABI_ASSERT(c, m)   static_assert(c, m)
+#else
+#define KSYS_ABI_ASSERT(c, m)   _Static_assert(c, m)
+#endif
+KSYS_ABI_ASSERT(sizeof(struct ksys_event) == 136, "ksys_event ABI");
+KSYS_ABI_ASSERT(sizeof(struct ksys_gap) == sizeof(struct ksys_event), "ksys_gap ABI");
+KSYS_ABI_ASSERT(sizeof(struct ksys_mmap_slot) == 152, "ksys_mmap_slot ABI");
+
+// --- Ring ---
+
+// 링에 아직 남아 있는 가장 작은 seq. base 는 리사이즈 때 옮기지 못한 경계 (없으면 0)
+static inline __u64 ksys_ring_oldest(__u64 cur_seq, __u32 size, __u64 base)
+{
+    __u64 oldest = (cur_seq > size) ? (cur_seq - size) : 0;
+
+    return oldest > base ? oldest : base;
+}
+
+// 크기가 2의 거듭제곱이라 나눗셈 대신 마스크
+static inline struct ksys_mmap_slot *ksys_ring_slot(struct ksys_mmap_slot *slots, __u32 mask, __u64 seq)
+{
+    return &slots[seq & mask];
+}
+
+// 슬롯에 seq 번 이벤트를 씀 (쓰는 쪽끼리는 호출자가 직렬화). begin -> 본문 -> end 순서로 보이게
+static inline void ksys_slot_publish(struct ksys_mmap_slot *slot, const struct ksys_event *ev, __u64 seq)
+{
+    KSYS_WRITE_ONCE(slot->seq_begin, seq);
+    ksys_wmb();
+    slot->et = *ev;
+    slot->et.seq = seq; // 이벤트 내부에 시퀀스 저장
+    ksys_wmb();
+    KSYS_WRITE_ONCE(slot->seq_end, seq);
+}
+
+// 락 없이 seq 번 이벤트를 복사. 덮어써졌거나 쓰는 중이면 false
+static inline bool ksys_slot_read(const struct ksys_mmap_slot *slot, __u64 seq, struct ksys_event *out)
+{
+    if (ksys_load_acquire(&slot->seq_end) != seq)
+        return false;
+    memcpy(out, &slot->et, sizeof(*out));
+    ksys_rmb();
+    return KSYS_READ_ONCE(slot->seq_begin) == seq;
+}
+
+// --- Cursor ---
+
+// 커서가 oldest 보다 뒤처졌으면 점프하고 놓친 수를 돌려줌
+// gap 모드면 유실 구간을 기억했다가 다음 read 에서 레코드로 내보냄. 연속된 유실은 하나로 합침
+static inline __u64 ksys_cursor_skip(struct ksys_cursor *c, __u64 oldest_seq, bool gaps)
+{
+    __u64 lost;
+
+    if (c->next_seq >= oldest_seq)
+        return 0;
+
+    lost = oldest_seq - c->next_seq;
+    c->drops += lost;
+    if (gaps) {
+        if (!c->gap_pending) {
+            c->gap_from = c->next_seq;
+            c->gap_pending = true;
+        }
+        c->gap_to = oldest_seq;
+    }
+    c->next_seq = oldest_seq;
+    return lost;
+}
+
+// 밀린 gap 을 out 자리에 레코드로 씀. 쓴 레코드 수 (0 또는 1)
+static inline size_t ksys_cursor_gap(struct ksys_cursor *c, struct ksys_event *out, __u64 now_ns)
+{
+    struct ksys_gap *g = (struct ksys_gap *)out;
+
+    if (!c->gap_pending)
+        return 0;
+    memset(g, 0, sizeof(*g));
+    g->seq = c->gap_to;
+    g->ts_ns = now_ns;
+    g->lost_from_seq = c->gap_from;
+    g->lost_to_seq = c->gap_to;
+    g->count = c->gap_to - c->gap_from;
+    g->type = KSYS_REC_GAP;
+    c->gap_pending = false;
+    return 1;
+}
+
+// --- Filter ---
+
+static inline bool ksys_filter_empty(const struct ksys_filter *f)
+{
+    return f->pid == -1 && f->tgid == -1 && !f->comm[0];
+}
+
+// Reader별 필터 확인 (Read 단계에서 사용)
+static inline bool ksys_match_event(const struct ksys_filter *f, const struct ksys_event *event)
+{
+    if (f->pid != -1 && event->pid != f->pid)
+        return false;
+    if (f->tgid != -1 && event->tgid != f->tgid)
+        return false;
+    if (f->comm[0]) {
+        if (strncmp(event->comm, f->comm, KSYS_COMM_LEN) != 0)
+            return false;
+    }
+    return true;
+}
+
+#endif // KSYS_CORE_H
@@ -0,0 +1,68 @@
+// include/ksys/ksys_fanotify.h
+// 모듈을 못 올리는 호스트용 유저 공간 백엔드. fanotify (FAN_OPEN/FAN_OPEN_EXEC, FAN_REPORT_FID)
+// 이벤트를 /dev/ksys_trace 와 같은 ksys_event 레코드로 바꿔서 냄
+//
+// 모듈과 다른 점
+//  - 성공한 open 만 보임 (KSYS_REC_OPENAT_RET, ret = 0, dfd = AT_FDCWD, flags/mode 는 0)
+//  - path 는 사용자가 넘긴 문자열이 아니라 handle 로 푼 절대 경로 (KSYS_PATH_LEN 에서 잘림)
+//  - pid == tgid (fanotify 는 프로세스 단위), ts_ns 는 읽은 시각 (CLOCK_MONOTONIC)
+//  - 큐에 남아 있는 같은 (파일, 프로세스) 이벤트는 커널이 하나로 합침 -> 합쳐진 만큼은 안 보임
+//  - 큐 overflow 는 count = 0 (개수 모름) 인 KSYS_REC_GAP 으로 알림
+//
+// CAP_SYS_ADMIN (fanotify_init) 과 CAP_DAC_READ_SEARCH (open_by_handle_at) 가 필요
+#ifndef KSYS_FANOTIFY_H
+#define KSYS_FANOTIFY_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <ksys/ksys_core.h>
+
+// ksys_fan_opts.flags
+#define KSYS_FAN_EXEC       (1u << 0)   // FAN_OPEN_EXEC 도 받아서 KSYS_REC_EXEC 로 냄
+#define KSYS_FAN_MOUNT      (1u << 1)   // 파일시스템 전체 대신 마운트 단위로 mark
+#define KSYS_FAN_UNLIMITED  (1u << 2)   // FAN_UNLIMITED_QUEUE (overflow 대신 커널 메모리 사용)
+#define KSYS_FAN_NO_PATH    (1u << 3)   // 경로를 풀지 않음. ino/gen 은 handle 에서 읽을 수 있을 때만
+
+struct ksys_fan_opts {
+    const char *const *paths;   // mark 할 경로들 (NULL 이면 "/")
+    unsigned int npaths;
+    unsigned int flags;         // KSYS_FAN_*
+    struct ksys_filter filter;  // 모듈 reader 필터와 같은 의미 (-1 / "" 는 전체)
+};
+
+struct ksys_fan_stats {
+    __u64 events;           // fanotify 에서 읽은 이벤트
+    __u64 emitted;          // 내보낸 레코드 (gap 포함)
+    __u64 filtered;         // 필터/자기 자신으로 버린 이벤트
+    __u64 overflows;        // FAN_Q_OVERFLOW 횟수
+    __u64 fid_hits;         // handle -> 경로 캐시 적중
+    __u64 fid_misses;       // open_by_handle_at 으로 푼 횟수
+    __u64 resolve_fail;     // 풀지 못함 (지워졌거나 모르는 fsid)
+    __u64 comm_misses;      // /proc/<pid>/comm 을 읽은 횟수
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ksys_fan;
+
+// 실패하면 NULL, errno 설정
+struct ksys_fan *ksys_fan_open(const struct ksys_fan_opts *opts);
+void ksys_fan_close(struct ksys_fan *fan);
+
+// poll/epoll 용 fanotify fd (O_NONBLOCK)
+int ksys_fan_fd(const struct ksys_fan *fan);
+
+// 쌓여 있는 이벤트를 최대 max 개 레코드로 변환. 기다리지 않음.
+// 반환: 레코드 수 (없으면 0), 실패 -1 (errno). 남은 이벤트는 다음 호출에서 이어서 냄
+ssize_t ksys_fan_read(struct ksys_fan *fan, struct ksys_event *out, size_t max);
+
+void ksys_fan_get_stats(const struct ksys_fan *fan, struct ksys_fan_stats *st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KSYS_FANOTIFY_H
@@ -0,0 +1,51 @@
+// include/ksys/ksys_json.h
+// ksys 레코드 -> JSON Lines 인코더. 출력은 버퍼에 모았다가 ksys_json_flush 때 write() 로 한 번에.
+// 정수는 두 자리 룩업 테이블, 문자열 이스케이프는 16 바이트씩 SSE2 로 훑어서
+// 이스케이프가 필요 없는 구간은 통째로 복사. 출력 형식은 예전 printf 버전과 바이트 단위로 같음
+#ifndef KSYS_JSON_H
+#define KSYS_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <ksys/ksys.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KSYS_JSON_BUF_DEFAULT   (256 * 1024)
+
+struct ksys_json {
+    int fd;
+    char *buf;
+    size_t len;
+    size_t cap;
+    unsigned long long bytes;   // 지금까지 write 한 바이트
+};
+
+// cap 0 이면 KSYS_JSON_BUF_DEFAULT. 실패하면 -1 (errno)
+// fd 가 -1 이면 메모리 모드: write 하지 않고 버퍼를 늘려 가며 모음 (buf/len 을 가져다 쓰고 len = 0)
+int ksys_json_init(struct ksys_json *j, int fd, size_t cap);
+// 남은 것을 flush 하고 버퍼 해제
+void ksys_json_free(struct ksys_json *j);
+
+// 모은 것을 모두 write. 실패 -1 (errno). 버퍼가 차면 인코딩 중에도 알아서 부름
+int ksys_json_flush(struct ksys_json *j);
+
+// ksys_event 배열 (openat/openat_ret/gap/fork/exec/exit 가 섞여 있어도 됨)
+int ksys_json_records(struct ksys_json *j, const struct ksys_event *ev, size_t n);
+// packed 레코드 하나 (ksys_rec_hdr + 고른 필드)
+int ksys_json_packed(struct ksys_json *j, const struct ksys_rec_hdr *h);
+// read()/READ_BATCH 로 받은 버퍼 전체. 반환: 레코드 수, 실패 -1
+long ksys_json_buf(struct ksys_json *j, const void *buf, size_t bytes, bool packed);
+
+int ksys_json_stats(struct ksys_json *j, const struct ksys_stats *st);
+// 드물게 나가는 줄 (tune 등) 용. 형식 그대로 버퍼에 붙임
+int ksys_json_printf(struct ksys_json *j, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KSYS_JSON_H
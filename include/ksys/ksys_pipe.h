@@ -0,0 +1,85 @@
+// include/ksys/ksys_pipe.h
+// 읽기 / 인코딩 / 쓰기를 스레드로 나눈 캡처 파이프라인
+//
+//   reader ──work[i] (SPSC)──> encoder i ──done (MPSC)──> writer ──free (SPSC)──> reader
+//
+// reader 는 장치에서 받은 배치를 풀에서 꺼낸 슬롯에 복사해서 가장 덜 밀린 인코더로 넘김.
+// 인코더는 슬롯 안 출력 버퍼에 인코딩하고, writer 는 배치 번호 순서대로 다시 맞춰서 (seq 순서 그대로)
+// 이어진 배치를 writev 한 번으로 씀. 슬롯 수가 고정이라 메모리는 늘지 않고, 뒤 단계가 느리면
+// reader 가 빈 슬롯을 기다림 (reader_stall_ns 로 보임). 큐는 모두 슬롯 수 이상이라 넣기는 실패하지 않음
+#ifndef KSYS_PIPE_H
+#define KSYS_PIPE_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include <ksys/ksys.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 슬롯 하나의 출력. 인코더가 모자라면 realloc 해도 됨 (buf/cap 갱신)
+struct ksys_pipe_buf {
+    char *buf;
+    size_t len;
+    size_t cap;
+};
+
+struct ksys_pipe_opts {
+    unsigned int encoders;      // 0: 온라인 CPU - 2 (1..16)
+    unsigned int slots;         // 풀 크기. 0: encoders * 4 + 4
+    size_t batch;               // 슬롯 하나의 최대 레코드 수. 0: 1024
+    size_t out_cap;             // 슬롯 출력 버퍼 처음 크기. 0: 256KB
+    unsigned int idle_ms;       // idle 콜백 간격. 0: 1000
+
+    // 인코더 스레드에서 부름 (여러 스레드가 동시에). 0 이 아니면 파이프라인을 멈춤.
+    // NULL 이면 인코딩 없이 ksys_event 배열을 그대로 씀 (raw)
+    int (*encode)(void *arg, const struct ksys_event *ev, size_t n, struct ksys_pipe_buf *out);
+    // writer 스레드에서만 부름. iov 는 배치 순서대로. 0 이 아니면 멈춤
+    int (*write)(void *arg, const struct iovec *iov, int cnt);
+    // writer 스레드에서만 부름. 쓸 배치 없이 idle_ms 동안 조용할 때마다. NULL 이면 안 부름. 0 이 아니면 멈춤
+    int (*idle)(void *arg);
+    void *arg;
+};
+
+void ksys_pipe_opts_init(struct ksys_pipe_opts *o);
+
+struct ksys_pipe_stats {
+    __u64 batches;              // 쓴 배치
+    __u64 events;
+    __u64 bytes;                // write 로 넘긴 바이트
+    __u64 drops;                // 커널 쪽 누적 drops (마지막 배치 기준)
+    __u64 reader_stall_ns;      // reader 가 빈 슬롯을 기다린 시간 (뒤 단계가 못 따라옴)
+    __u64 encode_ns;            // 인코더 스레드들이 인코딩에 쓴 시간 합
+    __u64 write_ns;             // writer 가 write 콜백 안에 있던 시간
+    __u64 writer_wait_ns;       // writer 가 다음 순서 배치를 기다린 시간
+    __u32 encoders;
+    __u32 slots;
+    // 지금 깊이 (대략) / 최대
+    __u32 free_depth;
+    __u32 work_depth;           // 인코더 큐 합
+    __u32 done_depth;
+    __u32 reorder_depth;        // writer 가 들고 있는 순서 안 맞는 배치
+    __u32 work_depth_max;
+    __u32 done_depth_max;
+    __u32 reorder_depth_max;
+};
+
+struct ksys_pipe;
+
+// 스레드들을 띄움. k 는 이제 reader 스레드만 씀 (멈출 때까지 건드리지 말 것). 실패 NULL, errno
+// 새 스레드들은 시그널을 모두 막은 채로 시작함 (시그널은 부른 스레드로)
+struct ksys_pipe *ksys_pipe_start(struct ksys *k, const struct ksys_pipe_opts *o);
+// 멈추라고 알리고, 이미 읽은 배치는 다 쓴 뒤 정리. st 가 있으면 마지막 통계.
+// 반환 0, 어느 단계가 실패했으면 -1 (errno)
+int ksys_pipe_stop(struct ksys_pipe *p, struct ksys_pipe_stats *st);
+// 실패한 단계가 있으면 그 errno, 없으면 0
+int ksys_pipe_error(const struct ksys_pipe *p);
+void ksys_pipe_stats(const struct ksys_pipe *p, struct ksys_pipe_stats *st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KSYS_PIPE_H
@@ -0,0 +1,147 @@
+// include/ksys/ksys_seg.h
+// 열 단위로 저장하는 트레이스 세그먼트 파일 (.kseg). NDJSON 보다 작고, 블록 푸터의 min/max 로
+// 조건에 안 걸리는 블록은 풀지 않고 건너뜀
+//
+// 파일: [ksys_seg_file_hdr][블록 0][블록 1]...[블록 인덱스: __u64 오프셋 x N][ksys_seg_trailer]
+// 블록: [ksys_seg_blk_hdr][열 0]...[열 KSYS_SEG_NCOLS-1][ksys_seg_footer]
+//
+// 열 인코딩 (블록 안에서만 참조하므로 블록 하나만 읽어도 풀 수 있음)
+//   delta   첫 값은 varint, 나머지는 앞 행과의 차이를 zigzag varint  (seq, ts_ns, tgid)
+//   dict    블록 사전 [varint 개수][varint 길이 + 바이트]... 뒤에 행마다 사전 번호를 bitpack (comm, path)
+//   bitpack [u8 폭][행마다 폭 비트, LSB 부터]  (type, flags, mode, dev, gen)
+//   varint  zigzag varint  (pid 는 pid - tgid, dfd, ret)  /  ino 는 그냥 varint
+//   gap     gap 행마다 lost_from_seq, lost_to_seq, count 를 varint 로 (다른 행은 아무것도 없음)
+//
+// 숫자는 호스트 바이트 순서 (x86_64 에서 little endian). 쓰는 중에 죽어서 인덱스/트레일러가 없으면
+// 읽는 쪽이 블록 헤더를 따라가며 온전한 블록까지 복구함
+#ifndef KSYS_SEG_H
+#define KSYS_SEG_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <ksys/ksys.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KSYS_SEG_MAGIC          "KSYSSEG"   // 8 바이트 (NUL 포함)
+#define KSYS_SEG_VERSION        1
+#define KSYS_SEG_BLK_MAGIC      0x3142534bu // "KSB1"
+#define KSYS_SEG_IDX_MAGIC      0x3158534bu // "KSX1"
+#define KSYS_SEG_BLOCK_ROWS     8192        // 기본 블록 크기 (행)
+#define KSYS_SEG_BLOCK_ROWS_MAX 65536
+
+enum ksys_seg_col {
+    KSYS_SEG_COL_TYPE = 0,
+    KSYS_SEG_COL_SEQ,
+    KSYS_SEG_COL_TS,
+    KSYS_SEG_COL_TGID,
+    KSYS_SEG_COL_PID,
+    KSYS_SEG_COL_COMM,
+    KSYS_SEG_COL_PATH,
+    KSYS_SEG_COL_DFD,       // FORK: ppid
+    KSYS_SEG_COL_FLAGS,     // FORK: ptgid / EXIT: group_dead
+    KSYS_SEG_COL_MODE,
+    KSYS_SEG_COL_RET,       // EXIT: exit_code
+    KSYS_SEG_COL_DEV,
+    KSYS_SEG_COL_GEN,
+    KSYS_SEG_COL_INO,
+    KSYS_SEG_COL_GAP,
+    KSYS_SEG_NCOLS,
+};
+
+struct ksys_seg_file_hdr {
+    char  magic[8];         // KSYS_SEG_MAGIC
+    __u16 version;
+    __u16 ncols;            // KSYS_SEG_NCOLS
+    __u32 block_rows;       // 블록 하나의 최대 행 수
+    __u32 rec_size;         // 쓴 쪽의 sizeof(struct ksys_event)
+    __u32 _rsv;
+};
+
+struct ksys_seg_blk_hdr {
+    __u32 magic;            // KSYS_SEG_BLK_MAGIC
+    __u32 len;              // 헤더와 푸터를 포함한 블록 길이
+};
+
+// 블록 맨 끝. 통계는 블록 안 모든 행 기준 (tgid 는 gap 행 제외, gap 만 있으면 min > max)
+struct ksys_seg_footer {
+    __u64 seq_min, seq_max;
+    __u64 ts_min, ts_max;
+    __s32 tgid_min, tgid_max;
+    __u32 nrows;
+    __u32 col_off[KSYS_SEG_NCOLS];  // 블록 시작부터. 열 길이는 다음 열 (마지막은 푸터) 까지
+    __u32 magic;                    // KSYS_SEG_BLK_MAGIC
+};
+
+struct ksys_seg_trailer {
+    __u64 index_off;        // 블록 오프셋 배열 위치
+    __u32 nblocks;
+    __u32 magic;            // KSYS_SEG_IDX_MAGIC
+};
+
+// --- Writer ---
+
+struct ksys_seg_writer;
+
+// path 를 새로 만듦 (있으면 덮어씀). block_rows 0 이면 KSYS_SEG_BLOCK_ROWS. 실패 NULL, errno
+struct ksys_seg_writer *ksys_seg_writer_open(const char *path, __u32 block_rows);
+// 레코드를 모으다가 block_rows 가 차면 블록 하나를 인코딩해서 write 한 번. 실패 -1 (errno)
+int ksys_seg_append(struct ksys_seg_writer *w, const struct ksys_event *ev, size_t n);
+// 모은 것을 블록으로 내보냄 (주기적으로 부르면 죽어도 그만큼은 남음)
+int ksys_seg_flush(struct ksys_seg_writer *w);
+// 남은 블록 + 인덱스 + 트레일러를 쓰고 닫음. 실패 -1 (그래도 해제는 함)
+int ksys_seg_writer_close(struct ksys_seg_writer *w);
+
+struct ksys_seg_wstats {
+    __u64 rows;
+    __u64 blocks;
+    __u64 bytes;            // 파일에 쓴 바이트
+    __u64 col_bytes[KSYS_SEG_NCOLS];
+};
+void ksys_seg_writer_stats(const struct ksys_seg_writer *w, struct ksys_seg_wstats *st);
+
+// --- Reader ---
+
+struct ksys_seg_reader;
+
+// 파일 전체를 mmap. 트레일러가 없으면 블록 헤더를 따라가며 복구. 실패 NULL, errno (형식 오류 EPROTO)
+struct ksys_seg_reader *ksys_seg_open(const char *path);
+void ksys_seg_close(struct ksys_seg_reader *r);
+
+__u32 ksys_seg_nblocks(const struct ksys_seg_reader *r);
+__u32 ksys_seg_block_rows(const struct ksys_seg_reader *r);     // 블록 하나의 최대 행 수
+const struct ksys_seg_footer *ksys_seg_block(const struct ksys_seg_reader *r, __u32 i);
+
+// 블록 i 를 풀어서 out 에 (ksys_seg_block_rows 개 이상). 반환: 행 수, 깨졌으면 -1 (EPROTO)
+ssize_t ksys_seg_read_block(struct ksys_seg_reader *r, __u32 i, struct ksys_event *out);
+
+// 조건. 범위는 양쪽 포함, 0 / ~0 이면 제한 없음
+struct ksys_seg_query {
+    __u64 seq_min, seq_max;
+    __u64 ts_min, ts_max;
+    __s32 tgid;             // -1: 전체 (gap 행은 tgid 조건이 있으면 안 나감)
+};
+
+void ksys_seg_query_init(struct ksys_seg_query *q);
+
+struct ksys_seg_scan_stats {
+    __u64 blocks;           // 전체
+    __u64 blocks_skipped;   // 푸터만 보고 건너뜀
+    __u64 rows_decoded;
+    __u64 rows_matched;
+};
+
+// 블록 단위로 맞는 행만 모아서 cb 로 (ev 는 cb 안에서만 유효). cb 가 0 이 아니면 멈춤.
+// 반환: 0, 실패 -1 (EPROTO)
+typedef int (*ksys_seg_cb)(void *arg, const struct ksys_event *ev, size_t n);
+int ksys_seg_scan(struct ksys_seg_reader *r, const struct ksys_seg_query *q, ksys_seg_cb cb, void *arg,
+                  struct ksys_seg_scan_stats *st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KSYS_SEG_H
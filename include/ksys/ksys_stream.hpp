@@ -0,0 +1,407 @@
+// include/ksys/ksys_stream.hpp
+// libksys 위의 C++20 코루틴 스트림 (헤더만). 서비스 안의 이벤트 루프에서 co_await 로 배치를 받음
+//
+//   ksys_co::loop lp;
+//   ksys_co::stream s(lp);                          // opts 생략하면 ksys_open_opts_init 기본값
+//
+//   // 코루틴 안에서 (task 타입은 아무거나, std::coroutine_handle<> 만 씀)
+//   for (;;) {
+//       ksys_co::batch b = co_await s.next_batch(stop);   // stop: std::stop_token (생략 가능)
+//       if (b.ec)
+//           break;                                     // 취소면 std::errc::operation_canceled
+//       for (const ksys_event &e : b.events) ...
+//   }
+//
+//   lp.run();                  // 직접 돌리거나,
+//   lp.fd() 를 자기 epoll/poll/io_uring(POLL_ADD) 에 넣고 읽을 수 있을 때 lp.run_once(0)
+//
+//   g++ -std=c++20 -O2 -I../include -c app.cpp
+//   gcc -O2 -I../include -c ../lib/libsys.c ../lib/ksys_fanotify.c
+//   g++ -o app app.o libsys.o ksys_fanotify.o
+//
+// 규칙
+//  - b.events 는 링/배치 버퍼를 그대로 가리킴 (복사 없음). 같은 stream 의 다음 next_batch 까지만 유효
+//  - gap 레코드 (KSYS_REC_GAP) 도 그대로 들어 있음
+//  - stream 하나에 기다리는 next_batch 는 하나만 (두 번째는 EBUSY 로 바로 끝남)
+//  - run/run_once, 코루틴 재개, stream 생성/소멸은 루프 스레드에서. stop_token 의 request_stop,
+//    stream::cancel, loop::stop 은 아무 스레드에서 불러도 됨
+//  - 기다리는 중인 stream 을 없애려면 먼저 취소해서 코루틴이 끝나게 할 것. loop 보다 먼저 없앨 것
+#ifndef KSYS_STREAM_HPP
+#define KSYS_STREAM_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <ksys/ksys.h>
+
+namespace ksys_co {
+
+// next_batch 결과. ec 가 있으면 events 는 비어 있음
+struct batch {
+    std::span<const ksys_event> events;
+    __u64 drops = 0;            // 이 소비자의 누적 drops
+    std::error_code ec;
+
+    explicit operator bool() const noexcept { return !ec; }
+};
+
+class stream;
+
+namespace detail {
+
+// epoll data.ptr 로 등록되는 대상
+class waiter {
+public:
+    virtual void on_ready() noexcept = 0;   // fd 를 읽을 수 있음
+    virtual void on_wake() noexcept = 0;    // loop::post 로 깨움 (취소)
+
+protected:
+    ~waiter() = default;
+};
+
+} // namespace detail
+
+// --- Loop ---
+
+// epoll 하나 + 다른 스레드에서 깨우기 위한 eventfd. epoll fd 자체를 다른 루프에 넣을 수 있음
+class loop {
+public:
+    loop()
+    {
+        ep_ = epoll_create1(EPOLL_CLOEXEC);
+        wake_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (ep_ >= 0 && wake_ >= 0) {
+            epoll_event e{};
+            e.events = EPOLLIN;
+            e.data.ptr = &wake_;
+            if (epoll_ctl(ep_, EPOLL_CTL_ADD, wake_, &e) == 0)
+                return;
+        }
+        int err = errno;
+        close_fds();
+        throw std::system_error(err, std::generic_category(), "ksys_co::loop");
+    }
+
+    ~loop() { close_fds(); }
+
+    loop(const loop &) = delete;
+    loop &operator=(const loop &) = delete;
+
+    int fd() const noexcept { return ep_; }
+
+    // 준비된 것을 한 번 처리. timeout_ms: <0 무한, 0 대기 없음.
+    // 반환: epoll 이벤트 수, 실패 -1 (errno, EINTR 포함)
+    int run_once(int timeout_ms) noexcept
+    {
+        bool woke = false;
+        int n = epoll_wait(ep_, evs_, max_events, timeout_ms);
+
+        if (n < 0)
+            return -1;
+        nready_ = n;
+        for (int i = 0; i < n; i++) {
+            void *p = evs_[i].data.ptr;
+            if (p == &wake_) {
+                eventfd_t v;
+                eventfd_read(wake_, &v);
+                woke = true;
+            } else if (p) {     // null: 처리 중에 없어진 stream
+                static_cast<detail::waiter *>(p)->on_ready();
+            }
+        }
+        nready_ = 0;
+        if (woke) {
+            {
+                std::lock_guard<std::mutex> g(mu_);
+                dispatch_.swap(posted_);
+            }
+            for (size_t i = 0; i < dispatch_.size(); i++) {
+                if (dispatch_[i])
+                    dispatch_[i]->on_wake();
+            }
+            dispatch_.clear();
+        }
+        return n;
+    }
+
+    // stop() 까지 돌림
+    void run()
+    {
+        while (!stop_.load(std::memory_order_acquire)) {
+            if (run_once(-1) < 0 && errno != EINTR)
+                throw std::system_error(errno, std::generic_category(), "epoll_wait");
+        }
+        stop_.store(false, std::memory_order_relaxed);
+    }
+
+    void stop() noexcept
+    {
+        stop_.store(true, std::memory_order_release);
+        eventfd_write(wake_, 1);
+    }
+
+private:
+    friend class stream;
+
+    static constexpr int max_events = 64;
+
+    void close_fds() noexcept
+    {
+        if (wake_ >= 0)
+            ::close(wake_);
+        if (ep_ >= 0)
+            ::close(ep_);
+    }
+
+    // 한 번만 알림 (EPOLLONESHOT). 레벨 트리거라 걸 때 이미 읽을 수 있으면 바로 옴
+    int arm(int fd, detail::waiter *w, bool added) noexcept
+    {
+        epoll_event e{};
+        e.events = EPOLLIN | EPOLLONESHOT;
+        e.data.ptr = w;
+        return epoll_ctl(ep_, added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &e);
+    }
+
+    void disarm(int fd, detail::waiter *w) noexcept
+    {
+        epoll_event e{};
+        e.data.ptr = w;
+        epoll_ctl(ep_, EPOLL_CTL_MOD, fd, &e);
+    }
+
+    void remove(int fd) noexcept { epoll_ctl(ep_, EPOLL_CTL_DEL, fd, nullptr); }
+
+    // 아무 스레드에서. 루프 스레드에서 w->on_wake() 가 불림
+    void post(detail::waiter *w) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> g(mu_);
+            posted_.push_back(w);
+        }
+        eventfd_write(wake_, 1);
+    }
+
+    void unpost(detail::waiter *w) noexcept
+    {
+        std::lock_guard<std::mutex> g(mu_);
+        std::erase(posted_, w);
+    }
+
+    // 루프 스레드에서 w 가 없어질 때. 이번 run_once 에서 아직 못 돌린 것도 지움
+    void forget(detail::waiter *w) noexcept
+    {
+        for (int i = 0; i < nready_; i++) {
+            if (evs_[i].data.ptr == w)
+                evs_[i].data.ptr = nullptr;
+        }
+        for (auto &p : dispatch_) {
+            if (p == w)
+                p = nullptr;
+        }
+        unpost(w);
+    }
+
+    int ep_ = -1;
+    int wake_ = -1;
+    std::atomic<bool> stop_{false};
+    epoll_event evs_[max_events];
+    int nready_ = 0;
+    std::mutex mu_;
+    std::vector<detail::waiter *> posted_;      // mu_
+    std::vector<detail::waiter *> dispatch_;    // 루프 스레드만
+};
+
+// --- Stream ---
+
+class stream : private detail::waiter {
+public:
+    class awaiter {
+    public:
+        bool await_ready() noexcept
+        {
+            if (s_.busy_) {
+                own_.ec = std::make_error_code(std::errc::device_or_resource_busy);
+                return true;
+            }
+            s_.busy_ = true;
+            s_.cancel_.store(false, std::memory_order_relaxed);
+            if (st_.stop_requested()) {
+                s_.res_.ec = std::make_error_code(std::errc::operation_canceled);
+                return true;
+            }
+            return s_.try_read();
+        }
+
+        bool await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            if (s_.read_or_arm(false))
+                return false;
+            s_.h_ = h;
+            if (st_.stop_possible())
+                s_.cb_.emplace(std::move(st_), canceller{&s_});
+            return true;
+        }
+
+        batch await_resume() noexcept
+        {
+            if (own_.ec)
+                return own_;
+            s_.busy_ = false;
+            return std::exchange(s_.res_, batch{});
+        }
+
+    private:
+        friend class stream;
+
+        awaiter(stream &s, std::stop_token st) noexcept : s_(s), st_(std::move(st)) {}
+
+        stream &s_;
+        std::stop_token st_;
+        batch own_;             // EBUSY 일 때만 (기다리는 쪽 상태를 건드리지 않게)
+    };
+
+    // o: NULL 이면 ksys_open_opts_init 기본값. 실패하면 std::system_error
+    explicit stream(loop &lp, const ksys_open_opts *o = nullptr) : lp_(lp)
+    {
+        ksys_open_opts def;
+
+        if (!o) {
+            ksys_open_opts_init(&def);
+            o = &def;
+        }
+        k_.reset(ksys_open(o));
+        if (!k_)
+            throw std::system_error(errno, std::generic_category(), "ksys_open");
+    }
+
+    ~stream()
+    {
+        cb_.reset();
+        if (added_)
+            lp_.remove(ksys_fd(k_.get()));
+        lp_.forget(this);
+    }
+
+    stream(const stream &) = delete;
+    stream &operator=(const stream &) = delete;
+
+    // stop 이 요청되면 기다리던 next_batch 가 operation_canceled 로 끝남
+    awaiter next_batch(std::stop_token stop = {}) noexcept { return awaiter(*this, std::move(stop)); }
+
+    // 기다리는 next_batch 를 operation_canceled 로 끝냄 (루프에서 재개). 기다리는 게 없으면 아무 일 없음
+    void cancel() noexcept
+    {
+        cancel_.store(true, std::memory_order_release);
+        lp_.post(this);
+    }
+
+    enum ksys_backend backend() const noexcept { return ksys_backend(k_.get()); }
+
+    // set_filter/get_stats 같은 나머지는 C API 로
+    struct ksys *handle() const noexcept { return k_.get(); }
+
+private:
+    struct closer {
+        void operator()(struct ksys *k) const noexcept { ksys_close(k); }
+    };
+
+    struct canceller {
+        stream *s;
+        void operator()() const noexcept { s->cancel(); }
+    };
+
+    // 기다리지 않고 한 배치. 결과 (레코드 또는 에러) 가 res_ 에 들어가면 true
+    bool try_read() noexcept
+    {
+        ksys_batch b;
+
+        while (ksys_next_batch(k_.get(), 0, &b) != 0) {
+            if (errno != EINTR) {
+                res_.ec = std::error_code(errno, std::generic_category());
+                return true;
+            }
+        }
+        if (b.n == 0)
+            return false;
+        res_.events = std::span<const ksys_event>(b.ev, b.n);
+        res_.drops = b.drops;
+        return true;
+    }
+
+    // 결과가 생기면 true, epoll 에 걸었으면 false
+    bool read_or_arm(bool read_first) noexcept
+    {
+        if (read_first && try_read())
+            return true;
+        for (;;) {
+            int rc = ksys_prepare_wait(k_.get());
+
+            if (rc == 0)
+                break;
+            if (rc < 0) {
+                res_.ec = std::error_code(errno, std::generic_category());
+                return true;
+            }
+            if (try_read())     // 기다리기 전에 이미 들어와 있음
+                return true;
+        }
+        if (lp_.arm(ksys_fd(k_.get()), this, added_) != 0) {
+            res_.ec = std::error_code(errno, std::generic_category());
+            return true;
+        }
+        added_ = true;
+        return false;
+    }
+
+    // 재개는 마지막에 (코루틴이 이 stream 을 없앨 수 있음)
+    void finish() noexcept
+    {
+        cb_.reset();            // 다른 스레드에서 도는 중이면 끝날 때까지 기다림
+        lp_.unpost(this);
+        std::exchange(h_, nullptr).resume();
+    }
+
+    void on_ready() noexcept override
+    {
+        if (!h_)
+            return;
+        // 깨어났지만 필터에 다 걸러졌으면 다시 걺
+        if (read_or_arm(true))
+            finish();
+    }
+
+    void on_wake() noexcept override
+    {
+        if (!h_ || !cancel_.load(std::memory_order_acquire))
+            return;
+        lp_.disarm(ksys_fd(k_.get()), this);
+        res_.ec = std::make_error_code(std::errc::operation_canceled);
+        finish();
+    }
+
+    loop &lp_;
+    std::unique_ptr<struct ksys, closer> k_;
+    std::coroutine_handle<> h_;                     // 기다리는 코루틴
+    std::optional<std::stop_callback<canceller>> cb_;
+    std::atomic<bool> cancel_{false};
+    bool busy_ = false;                             // next_batch 가 끝나지 않음
+    bool added_ = false;                            // fd 가 epoll 에 들어 있음
+    batch res_;
+};
+
+} // namespace ksys_co
+
+#endif // KSYS_STREAM_HPP
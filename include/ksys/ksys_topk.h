@@ -0,0 +1,72 @@
+// include/ksys/ksys_topk.h
+// "지금 파일을 제일 많이 여는 프로세스/경로" 를 스트림에서 바로 답하는 top-K 표 (lib/ksys_topk.c)
+//
+// 차원 (tgid, comm, path, path 앞부분) 마다 Space-Saving 카운터 capacity 개를 stream-summary
+// (같은 count 끼리 묶은 버킷의 정렬된 목록) 로 들고 있어서, 이벤트 하나는 해시 조회 한 번 +
+// 포인터 몇 개 옮기기로 끝남 (capacity 와 상관없이 상수, 할당 없음). 표에 없는 키가 오면 count 가
+// 가장 작은 카운터를 물려받음 (error = 그때의 count). 같은 키로 count-min sketch (4 x cm_width) 도
+// 올려 두고, 질의 때 Space-Saving 추정과 둘 중 작은 값을 씀 (둘 다 실제보다 크게만 틀림).
+//
+// 미끄러지는 창: 창을 panes 개 조각 (pane_sec 초씩) 으로 나눠 조각마다 따로 셈. 시간이 지나면
+// 가장 오래된 조각을 비우고 다시 씀 (조각 하나를 비우는 비용은 pane_sec 마다 한 번).
+// 질의는 최근 조각 몇 개를 합쳐서 답함. 메모리는 panes * 차원 * (capacity + sketch) 로 고정
+#ifndef KSYS_TOPK_H
+#define KSYS_TOPK_H
+
+#include <ksys/ksys.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum ksys_topk_dim {
+    KSYS_TOPK_TGID = 0,
+    KSYS_TOPK_COMM,
+    KSYS_TOPK_PATH,
+    KSYS_TOPK_PREFIX,       // 경로 앞 prefix_depth 개 성분 ("/usr/lib"), '/' 가 없는 상대 경로는 "."
+    KSYS_TOPK_NDIMS,
+};
+
+struct ksys_topk_opts {
+    __u32 capacity;         // 차원/조각마다 카운터 수. 0: 256
+    __u32 panes;            // 0: 6
+    __u32 pane_sec;         // 0: 10 (창 = panes * pane_sec)
+    __u32 prefix_depth;     // 0: 2
+    __u32 cm_width;         // count-min 한 줄 폭 (2의 거듭제곱으로 올림). 0: 1024
+};
+
+void ksys_topk_opts_init(struct ksys_topk_opts *o);
+
+struct ksys_topk_item {
+    char  key[KSYS_PATH_LEN];   // TGID 는 마지막으로 본 comm. 64 자를 다 쓰면 NUL 이 없음
+    __s32 tgid;                 // TGID 만
+    __u32 _rsv;
+    __u64 count;                // 추정 (실제 이상)
+    __u64 error;                // count - error 는 실제 이하가 보장됨
+};
+
+struct ksys_topk;
+
+// 실패 NULL, errno
+struct ksys_topk *ksys_topk_new(const struct ksys_topk_opts *o);
+void ksys_topk_free(struct ksys_topk *t);
+
+// 시간을 알려 줌 (CLOCK_MONOTONIC ns). 조각이 끝났으면 다음 조각으로. 배치마다 한 번이면 충분
+void ksys_topk_tick(struct ksys_topk *t, __u64 now_ns);
+// 파일 열기 레코드 (OPENAT/OPENAT_RET) 만 셈. 나머지는 무시
+void ksys_topk_add(struct ksys_topk *t, const struct ksys_event *ev);
+
+// 최근 window_sec 초 (조각 단위로 올림, 0 이면 창 전체) 의 상위 max 개를 count 순으로.
+// total 이 있으면 그 구간에 센 레코드 수. 반환: 채운 수. 할당 없음
+int ksys_topk_query(struct ksys_topk *t, enum ksys_topk_dim dim, __u32 window_sec, struct ksys_topk_item *out,
+                    int max, __u64 *total);
+
+// 창 전체 길이 (panes * pane_sec)
+__u32 ksys_topk_window(const struct ksys_topk *t);
+const char *ksys_topk_dim_name(enum ksys_topk_dim dim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KSYS_TOPK_H
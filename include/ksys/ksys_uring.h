@@ -0,0 +1,71 @@
+// include/ksys/ksys_uring.h
+// io_uring 으로 파일에 쓰는 출력. liburing 없이 시스템 콜 세 개 (setup/enter/register) 만 씀
+//
+// 버퍼 nbufs 개를 미리 등록 (IORING_REGISTER_BUFFERS) 해 두고, 하나가 차면 WRITE_FIXED 로
+// 넘기고 바로 다음 버퍼에 이어서 씀. write 가 디스크를 기다리는 동안 호출한 쪽은 멈추지 않고,
+// 버퍼가 다 나가 있을 때만 하나가 끝나기를 기다림 (stall_ns). 버퍼 하나에 시스템 콜 한 번.
+//
+// 파일은 PREFIX.000001, PREFIX.000002 ... 로 크기/시간 기준으로 돌림. 다음 파일은 미리
+// io_uring 의 OPENAT + FALLOCATE (KEEP_SIZE) 로 열고 공간을 잡아 두므로 돌릴 때 기다리지 않음.
+// 등록 파일 자리 두 개를 현재/다음으로 번갈아 씀. 끝난 파일은 쓰기가 다 끝나면 실제 크기로
+// ftruncate (남은 선할당 해제) 하고 닫음.
+//
+// direct 면 O_DIRECT. 버퍼는 4096 정렬, 쓰기는 4096 단위라 flush 때 남는 꼬리는 다음 버퍼로
+// 옮겨 두고, 파일을 닫을 때만 0 을 채워 쓰고 실제 크기로 자름
+#ifndef KSYS_URING_H
+#define KSYS_URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <ksys/ksys.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KSYS_URING_ALIGN    4096
+
+struct ksys_uring_opts {
+    const char *prefix;         // 파일 이름 앞부분 (PREFIX.NNNNNN)
+    size_t buf_size;            // 버퍼 하나. 0: 1MB (4096 배수로 올림)
+    unsigned int nbufs;         // 등록 버퍼 수 = 동시에 나가 있을 수 있는 쓰기. 0: 8
+    __u64 rotate_bytes;         // 0: 크기로 안 돌림
+    unsigned int rotate_sec;    // 0: 시간으로 안 돌림
+    __u64 prealloc;             // 파일마다 미리 잡을 크기. 0: rotate_bytes (그것도 0 이면 안 잡음)
+    bool direct;                // O_DIRECT
+    const void *file_hdr;       // 파일마다 맨 앞에 쓸 바이트 (wire 헤더 등). NULL 이면 없음
+    size_t file_hdr_len;
+};
+
+void ksys_uring_opts_init(struct ksys_uring_opts *o);
+
+struct ksys_uring_stats {
+    __u64 bytes;                // 파일에 쓴 바이트 (패딩 제외)
+    __u64 writes;               // 넘긴 WRITE_FIXED 수
+    __u64 enters;               // io_uring_enter 수
+    __u64 stall_ns;             // 빈 버퍼나 다음 파일을 기다린 시간
+    __u64 files;                // 연 파일 수
+    __u32 inflight;             // 지금 나가 있는 쓰기
+    __u32 inflight_max;
+};
+
+struct ksys_uring_writer;
+
+// 첫 파일을 열고 링을 만듦. 실패 NULL, errno (커널이 io_uring 을 막아 두면 ENOSYS/EPERM)
+struct ksys_uring_writer *ksys_uring_open(const struct ksys_uring_opts *o);
+// 버퍼에 복사. 차면 넘김. 앞서 실패한 쓰기가 있으면 -1 (errno)
+int ksys_uring_write(struct ksys_uring_writer *w, const void *data, size_t len);
+// 모은 것을 넘김 (direct 면 4096 단위까지). 끝나기를 기다리지는 않음. 시간으로 돌릴 때도 여기서 봄
+int ksys_uring_flush(struct ksys_uring_writer *w);
+// 남은 것을 쓰고 모두 끝나기를 기다린 뒤 닫음. 실패 -1 (그래도 해제는 함)
+int ksys_uring_close(struct ksys_uring_writer *w);
+void ksys_uring_stats(const struct ksys_uring_writer *w, struct ksys_uring_stats *st);
+// 지금 쓰고 있는 파일 이름
+const char *ksys_uring_path(const struct ksys_uring_writer *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KSYS_URING_H
@@ -0,0 +1,89 @@
+// include/ksys/ksys_wire.h
+// 프로세스 사이로 ksys 레코드를 넘기는 바이너리 형식 (JSON 을 다시 파싱하지 않게)
+//
+//   RAW      ksys_wire_hdr + ksys_event 배열 그대로. 가장 빠름 (읽는 쪽은 memcpy 만)
+//   LP       ksys_wire_hdr + 프레임 [__u32 len][payload]. payload 는 ksys_event 에서 path 만 NUL 까지로
+//            줄인 것: path 앞부분 | path 뒷부분 (고정 KSYS_WIRE_LP_FIXED 바이트) | path 문자열
+//   MSGPACK  헤더 없이 레코드마다 MessagePack map 하나. 키는 ksysdump_json 과 같은 이름
+//            (type 문자열, seq, ts_ns, pid, ...) 이라 다른 언어에서 표준 디코더로 읽을 수 있음
+//
+// RAW/LP 는 호스트 바이트 순서 (x86_64 에서 little endian). MessagePack 은 규격대로 big endian
+#ifndef KSYS_WIRE_H
+#define KSYS_WIRE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <ksys/ksys.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum ksys_wire_fmt {
+    KSYS_WIRE_AUTO = 0,     // 읽을 때만: 헤더 magic 이 있으면 RAW/LP, 아니면 MSGPACK
+    KSYS_WIRE_RAW,
+    KSYS_WIRE_LP,
+    KSYS_WIRE_MSGPACK,
+};
+
+#define KSYS_WIRE_MAGIC     "KSYSWIRE"
+#define KSYS_WIRE_VERSION   1
+
+// LP payload 의 고정부: path 를 뺀 ksys_event
+#define KSYS_WIRE_LP_FIXED  (sizeof(struct ksys_event) - KSYS_PATH_LEN)
+
+struct ksys_wire_hdr {
+    char  magic[8];         // KSYS_WIRE_MAGIC (NUL 없음)
+    __u16 version;          // KSYS_WIRE_VERSION
+    __u16 format;           // KSYS_WIRE_RAW / KSYS_WIRE_LP
+    __u32 rec_size;         // 쓴 쪽의 sizeof(struct ksys_event). 다르면 읽지 않음
+    __u64 _rsv;
+};
+
+// --- Writer ---
+
+struct ksys_wire_writer {
+    int fd;
+    enum ksys_wire_fmt fmt;
+    char *buf;
+    size_t len;
+    size_t cap;
+    unsigned long long bytes;   // 지금까지 write 한 바이트
+};
+
+// cap 0 이면 256KB. RAW/LP 는 파일 헤더를 버퍼에 먼저 넣어 둠. 실패 -1 (errno)
+// fd 가 -1 이면 메모리 모드: 헤더 없이 레코드만, write 하지 않고 버퍼를 늘려 가며 모음
+int ksys_wire_writer_init(struct ksys_wire_writer *w, int fd, enum ksys_wire_fmt fmt, size_t cap);
+// 남은 것을 flush 하고 해제
+void ksys_wire_writer_free(struct ksys_wire_writer *w);
+
+// 레코드 n 개를 버퍼에 붙이고, 차면 알아서 flush. RAW 는 배치가 크면 (cap/4 이상) 복사하지 않고
+// 버퍼에 남은 것과 함께 writev 한 번으로 바로 씀. 실패 -1 (errno)
+int ksys_wire_write(struct ksys_wire_writer *w, const struct ksys_event *ev, size_t n);
+int ksys_wire_flush(struct ksys_wire_writer *w);
+
+// 스트림 맨 앞에 올 헤더를 채움. 반환: 헤더 길이 (MSGPACK 은 헤더가 없어서 0)
+size_t ksys_wire_hdr_init(struct ksys_wire_hdr *h, enum ksys_wire_fmt fmt);
+
+// --- Reader ---
+
+struct ksys_wire_reader;
+
+// fd 는 파이프여도 됨 (앞에서부터 순서대로 읽음). 실패하면 NULL, errno
+struct ksys_wire_reader *ksys_wire_reader_open(int fd, enum ksys_wire_fmt fmt);
+void ksys_wire_reader_close(struct ksys_wire_reader *r);
+enum ksys_wire_fmt ksys_wire_reader_fmt(const struct ksys_wire_reader *r);
+
+// 최대 max 개. 반환: 레코드 수, 끝이면 0, 실패 -1 (errno, 형식이 깨졌으면 EPROTO)
+ssize_t ksys_wire_read(struct ksys_wire_reader *r, struct ksys_event *out, size_t max);
+
+const char *ksys_wire_fmt_name(enum ksys_wire_fmt fmt);
+// "raw" / "lp" / "msgpack" -> 형식, 모르면 -1
+int ksys_wire_fmt_parse(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KSYS_WIRE_H
@@ -0,0 +1,288 @@
+// include/ksys/ksysd.h
+// ksysd (daemon/ksysd.c) 와 클라이언트 사이의 프로토콜, 그리고 클라이언트 쪽 함수 (lib/ksysd_client.c)
+//
+// ksysd 가 커널 쪽 유일한 소비자 (ksys_reader 하나) 가 되고, 도구들은 Unix 소켓으로 붙어서
+// 각자 필터로 걸러진 레코드를 받음. 필터는 커널이 아니라 데몬에서, 이벤트마다 한 번만 봄
+// (모든 클라이언트 필터를 tgid/pid/comm 해시 + 타입별 집합으로 묶어 둔 인덱스).
+//
+// 소켓은 SOCK_SEQPACKET 이라 메시지 경계가 그대로 유지됨. 메시지는 모두 ksysd_hdr 로 시작
+//
+//   클라이언트 -> 데몬   HELLO  (ksysd_hello)     붙자마자 한 번. 버전이 다르면 데몬이 끊음
+//                        FILTER (ksysd_hello)     필터 바꾸기
+//                        SHM    (ksysd_hdr)       공유 링 요청 (HELLO 없이 보내도 됨)
+//                        STATS  (ksysd_hdr)       클라이언트별 지연/유실 요청 (HELLO 없이 보내도 됨)
+//                        TOPK   (ksysd_topk_req)  상위 tgid/comm/경로 요청 (HELLO 없이 보내도 됨)
+//   데몬 -> 클라이언트   WELCOME (ksysd_welcome)  HELLO 응답
+//                        EVENTS  (ksysd_hdr + ksys_event[n])
+//                        AGG     (ksysd_hdr + ksysd_agg + ksysd_agg_ent[n])  집계로 낮춘 동안의 요약
+//                        SHM     (ksysd_hdr + SCM_RIGHTS 로 링 memfd, 읽기 전용)
+//                        STATS   (ksysd_hdr + ksysd_client_stat[n])
+//                        TOPK    (ksysd_hdr + ksysd_topk + ksys_topk_item[n])
+//
+// 느린 클라이언트 (SSH 너머의 대시보드 등) 때문에 데몬이 커널을 못 따라가면 모두가 drops 를 봄.
+// 그래서 클라이언트마다 크기가 정해진 큐 (ksysd_qos.queue_kb) 를 두고, 소켓이 받지 않으면 거기에
+// 쌓고 EPOLLOUT 을 기다림. 읽는 루프는 절대 send 에 묶이지 않음. 큐가 차면 정책대로:
+//   DROP_NEWEST   새 레코드를 버림             DROP_OLDEST  가장 오래된 메시지를 버림
+//   DISCONNECT    끊음                        SAMPLE       3/4 가 차면 N 개 중 하나만 (1/4 까지 빠지면 복귀)
+//   AGGREGATE     3/4 가 차면 레코드 대신 tgid 별 개수만 모았다가 1/4 까지 빠지면 AGG 하나로 보냄
+//                 (gap 레코드는 샘플/집계 중에도 그대로 보냄)
+// 버린 것은 hdr.lost, 샘플/집계로 뺀 것은 hdr.skipped (둘 다 클라이언트별 누적)
+//
+// 공유 링: 소켓은 클라이언트마다 바이트를 복사하므로, 같은 머신의 소비자는 데몬이 모든 레코드를
+// 한 번 써 두는 memfd 링 (ksysd_shm_hdr + ksys_mmap_slot 배열) 을 mmap 해서 읽을 수 있음.
+// 모듈 mmap 링과 같은 방식: 커서는 클라이언트가 각자 갖고, 슬롯은 seq_begin/seq_end 로 검증,
+// 뒤처지면 ksys_ring_oldest 로 알아채고 gap 레코드로 알림. 데몬은 배치마다 futex 값을 올리고
+// 깨우므로, 따라잡고 있는 동안은 시스템 콜이 없고 비었을 때만 futex 로 잠. 필터는 클라이언트 쪽에서 봄
+//
+// top-K: 데몬은 모든 파일 열기 레코드를 미끄러지는 창의 top-K 표 (ksys_topk.h) 에 넣어 둠.
+// TOPK 질의는 레코드를 다시 훑지 않고 표만 합쳐서 바로 답함 (필터와 상관없이 전체 기준)
+#ifndef KSYSD_H
+#define KSYSD_H
+
+#include <sys/types.h>
+
+#include <ksys/ksys.h>
+#include <ksys/ksys_topk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KSYSD_SOCK_PATH     "/run/ksysd.sock"
+#define KSYSD_VERSION       2
+#define KSYSD_MAX_CLIENTS   256
+// 질의 (stats / top-K) 연결의 보내기/받기 제한. 데몬이 멈춰 있어도 묻는 쪽은 이만큼만 기다림
+#define KSYSD_QUERY_TIMEOUT_MS  1000
+// EVENTS 메시지 하나에 들어가는 최대 레코드 (메시지가 32KB 를 넘지 않게)
+#define KSYSD_BATCH_MAX     240
+
+enum ksysd_msg_type {
+    KSYSD_MSG_HELLO = 1,
+    KSYSD_MSG_WELCOME,
+    KSYSD_MSG_FILTER,
+    KSYSD_MSG_EVENTS,
+    KSYSD_MSG_SHM,
+    KSYSD_MSG_AGG,
+    KSYSD_MSG_STATS,
+    KSYSD_MSG_TOPK,
+};
+
+struct ksysd_hdr {
+    __u16 type;             // KSYSD_MSG_*
+    __u16 version;          // KSYSD_VERSION
+    __u32 n;                // EVENTS: ksys_event 수 / AGG: ksysd_agg_ent 수 / STATS: ksysd_client_stat 수
+                            // TOPK: ksys_topk_item 수
+    __u32 sample;           // EVENTS: 이 메시지의 샘플링 (1 이면 전부, N 이면 N 개 중 하나)
+    __u32 _rsv;
+    __u64 lost;             // EVENTS/AGG: 이 클라이언트 몫으로 데몬이 버린 누적 레코드
+    __u64 skipped;          // EVENTS/AGG: 샘플/집계로 뺀 누적 레코드
+    __u64 drops;            // EVENTS/AGG/WELCOME: 데몬의 커널 쪽 누적 drops
+};
+
+enum ksysd_policy {
+    KSYSD_POLICY_DEFAULT = 0,   // 데몬의 --policy
+    KSYSD_POLICY_DROP_NEWEST,
+    KSYSD_POLICY_DROP_OLDEST,
+    KSYSD_POLICY_DISCONNECT,
+    KSYSD_POLICY_SAMPLE,
+    KSYSD_POLICY_AGGREGATE,
+};
+
+// 클라이언트가 달라고 할 수 있는 큐의 최대 (데몬이 이 값으로 자름, WELCOME 의 qos 에 실제 값)
+#define KSYSD_QUEUE_KB_MAX  (64u << 10)
+
+struct ksysd_qos {
+    __u16 policy;           // enum ksysd_policy
+    __u16 sample;           // SAMPLE: 밀리는 동안 N 개 중 하나. 0: 16
+    __u32 queue_kb;         // 큐 크기. 0: 데몬의 --queue. KSYSD_QUEUE_KB_MAX 까지
+};
+
+// ksys_filter 에 타입과 경로 앞부분을 더한 것. 조건끼리는 AND
+struct ksysd_filter {
+    __s32 pid;                      // -1: 전체
+    __s32 tgid;                     // -1: 전체
+    char  comm[KSYS_COMM_LEN];      // "": 전체
+    __u32 types;                    // (1 << KSYS_REC_*) 비트. 0: 전체. GAP 은 항상 받음
+    __u32 _rsv;
+    char  path_prefix[KSYS_PATH_LEN];   // "": 전체. 있으면 경로가 있는 레코드 (OPENAT/OPENAT_RET/EXEC) 만
+};
+
+// path_prefix 를 보는 레코드
+static inline bool ksysd_rec_has_path(__u16 type)
+{
+    return type == KSYS_REC_OPENAT || type == KSYS_REC_OPENAT_RET || type == KSYS_REC_EXEC;
+}
+
+struct ksysd_hello {
+    struct ksysd_hdr h;
+    struct ksysd_filter filter;
+    struct ksysd_qos qos;   // FILTER 에서는 무시
+};
+
+struct ksysd_welcome {
+    struct ksysd_hdr h;
+    __u32 rec_size;         // 데몬의 sizeof(struct ksys_event). 다르면 읽지 말 것
+    __u32 backend;          // 데몬이 쓰는 enum ksys_backend
+    __u32 clients;          // 이 클라이언트를 포함한 연결 수
+    struct ksysd_qos qos;   // 정해진 정책 (DEFAULT/0 을 데몬 기본값으로 채운 것)
+};
+
+#define KSYSD_MSG_MAX   (sizeof(struct ksysd_hdr) + KSYSD_BATCH_MAX * sizeof(struct ksys_event))
+
+// --- Backpressure ---
+
+#define KSYSD_AGG_MAX   64
+
+// AGG 본문. 표에 못 들어간 tgid 는 other 로
+struct ksysd_agg {
+    __u64 ts_from;          // 집계한 첫/마지막 레코드의 ts_ns
+    __u64 ts_to;
+    __u64 total;            // 집계한 레코드 수
+    __u64 other;
+};
+
+struct ksysd_agg_ent {
+    __s32 tgid;
+    __u32 count;
+    char  comm[KSYS_COMM_LEN];  // 처음 본 레코드의 comm
+};
+
+struct ksysd_client_stat {
+    __s32 pid;              // SO_PEERCRED
+    __u32 uid;
+    __u16 slot;
+    __u16 policy;           // 정해진 정책 (DEFAULT 아님)
+    __u8  active;           // HELLO 로 레코드를 받는 중
+    __u8  shm;              // 공유 링을 받아 감
+    __u8  degraded;         // 샘플/집계로 낮춘 상태
+    __u8  _rsv;
+    __u64 events;           // 소켓으로 보낸 레코드
+    __u64 lost;
+    __u64 skipped;
+    __u64 queued;           // 지금 큐에 있는 레코드
+    __u64 lag_ns;           // 큐 맨 앞 레코드가 기다린 시간
+    __u32 queue_msgs;       // 지금 큐 깊이 (메시지)
+    __u32 queue_max;        // 최대로 찼던 깊이
+    __u32 queue_cap;
+    __u32 sock_bytes;       // 소켓 버퍼에 아직 남은 바이트 (SIOCOUTQ)
+};
+
+#define KSYSD_STATS_MSG_MAX (sizeof(struct ksysd_hdr) + KSYSD_MAX_CLIENTS * sizeof(struct ksysd_client_stat))
+
+// --- Top-K ---
+
+#define KSYSD_TOPK_MAX  256
+
+struct ksysd_topk_req {
+    struct ksysd_hdr h;
+    __u16 dim;              // enum ksys_topk_dim
+    __u16 max;              // 0 또는 KSYSD_TOPK_MAX 보다 크면 KSYSD_TOPK_MAX
+    __u32 window_sec;       // 최근 몇 초. 0: 데몬 창 전체
+};
+
+// TOPK 응답 본문. 데몬이 --topk 0 이면 window_max == 0 이고 항목 없음
+struct ksysd_topk {
+    __u64 total;            // 그 구간에 센 파일 열기 레코드
+    __u32 dim;
+    __u32 window_sec;       // 실제로 합친 구간 (조각 단위로 올린 것)
+    __u32 window_max;       // 데몬의 창 전체 (--topk-window)
+    __u32 capacity;         // 차원/조각마다 카운터 수 (--topk)
+};
+
+#define KSYSD_TOPK_MSG_MAX  (sizeof(struct ksysd_hdr) + sizeof(struct ksysd_topk) + \
+                             KSYSD_TOPK_MAX * sizeof(struct ksys_topk_item))
+
+// --- Shared Ring ---
+
+#define KSYSD_SHM_MAGIC     "KSYSDSHM"
+#define KSYSD_SHM_CLOSED    (1u << 0)   // 데몬이 끝남. 더 쓰지 않음
+
+// 위치 (pos) 는 링 안의 번호라 레코드의 커널 seq 와 다름. 링에서 난 gap 레코드의 lost_from/to 도 pos
+struct ksysd_shm_hdr {
+    char  magic[8];         // KSYSD_SHM_MAGIC (NUL 없음)
+    __u32 version;          // KSYSD_VERSION
+    __u32 rec_size;         // sizeof(struct ksys_event)
+    __u32 ring_size;        // 슬롯 수 (2의 거듭제곱)
+    __u32 slot_size;        // sizeof(struct ksys_mmap_slot)
+    __u64 data_off;         // 슬롯 배열 시작 (페이지 정렬)
+    __u64 map_size;
+    __u8  _pad0[64 - 40];
+    // 배치마다 바뀌는 것은 다른 캐시 라인
+    __u64 cur_seq;          // 다음에 쓸 pos (release store). 유효 범위 [max(cur_seq - ring_size, 0), cur_seq)
+    __u64 drops;            // 데몬의 커널 쪽 누적 drops
+    __u32 futex;            // 배치를 낼 때마다 +1 한 뒤 FUTEX_WAKE
+    __u32 flags;            // KSYSD_SHM_*
+};
+
+// --- Client ---
+
+struct ksysd_client {
+    int fd;
+    struct ksysd_welcome info;
+    // 마지막으로 받은 메시지 기준
+    __u64 lost;
+    __u64 skipped;
+    __u64 drops;
+    __u32 sample;
+    // 마지막 AGG (aggs 가 늘었으면 새로 온 것)
+    __u64 aggs;
+    struct ksysd_agg agg;
+    struct ksysd_agg_ent agg_ent[KSYSD_AGG_MAX];
+    __u32 agg_n;
+    void *buf;              // KSYSD_MSG_MAX
+};
+
+// 전체를 받는 필터
+void ksysd_filter_init(struct ksysd_filter *f);
+
+// path 가 NULL 이면 KSYSD_SOCK_PATH, qos 가 NULL 이면 데몬 기본값. 붙고 HELLO/WELCOME 까지.
+// 실패 -1 (errno, 버전이 다르면 EPROTO)
+int ksysd_client_open(struct ksysd_client *c, const char *path, const struct ksysd_filter *f,
+                      const struct ksysd_qos *qos);
+void ksysd_client_close(struct ksysd_client *c);
+int ksysd_client_set_filter(struct ksysd_client *c, const struct ksysd_filter *f);
+
+// EVENTS 메시지 하나를 받음. timeout_ms: <0 무한, 0 대기 없음. ev 는 다음 recv/close 전까지만 유효
+// 반환: 레코드 수 (timeout 이거나 AGG 를 받았으면 0, AGG 는 c->agg*), 실패 -1 (errno, 데몬이 끊었으면 EPIPE)
+ssize_t ksysd_client_recv(struct ksysd_client *c, int timeout_ms, const struct ksys_event **ev);
+
+// 잠깐 붙어서 클라이언트별 통계를 받아 옴. 반환: 채운 수 (max 까지), 실패 -1 (errno)
+int ksysd_query_stats(const char *path, struct ksysd_client_stat *out, int max);
+// 잠깐 붙어서 최근 window_sec 초의 상위 max 개를 받아 옴. info 는 NULL 이어도 됨.
+// 반환: 채운 수, 실패 -1 (errno, 데몬이 top-K 를 끄고 떴으면 EOPNOTSUPP)
+int ksysd_query_topk(const char *path, enum ksys_topk_dim dim, __u32 window_sec, struct ksys_topk_item *out,
+                     int max, struct ksysd_topk *info);
+// 주기적으로 묻는 쪽은 질의용 연결 하나를 열어 두고 거기로 (닫을 때는 close). 실패 -1 (errno).
+// 보내기/받기는 KSYSD_QUERY_TIMEOUT_MS 에서 끊김
+int ksysd_query_open(const char *path);
+// ksysd_query_topk 와 같지만 ksysd_query_open 으로 연 fd 로. 데몬이 끊었으면 -1 (EPIPE),
+// 답이 늦으면 -1 (EAGAIN). 어느 쪽이든 늦은 답이 다음 질의에 섞이지 않게 닫고 다시 열 것
+int ksysd_query_topk_fd(int fd, enum ksys_topk_dim dim, __u32 window_sec, struct ksys_topk_item *out, int max,
+                        struct ksysd_topk *info);
+
+// --- Shared Ring Client ---
+
+struct ksysd_shm {
+    int fd;                 // 데몬 소켓 (열어 두는 동안 클라이언트로 보임)
+    const struct ksysd_shm_hdr *hdr;
+    const struct ksys_mmap_slot *slots;
+    size_t map_len;
+    __u32 mask;
+    struct ksys_cursor cur; // cur.drops: 링에서 뒤처져 놓친 레코드
+    struct ksysd_filter filter;
+    bool flt_all;
+};
+
+// 공유 링을 받아 mmap 하고 지금 위치부터 읽음. f 가 NULL 이면 전체. 실패 -1 (errno)
+int ksysd_shm_open(struct ksysd_shm *s, const char *path, const struct ksysd_filter *f);
+void ksysd_shm_close(struct ksysd_shm *s);
+// 쌓인 것을 최대 max 개 복사 (필터 통과한 것만, 뒤처졌으면 맨 앞에 gap). 시스템 콜 없음
+size_t ksysd_shm_read(struct ksysd_shm *s, struct ksys_event *out, size_t max);
+// 읽을 것이 생길 때까지 futex 로 기다림. 반환 1 있음, 0 timeout, -1 실패 (errno, 데몬이 끝났으면 EPIPE)
+int ksysd_shm_wait(struct ksysd_shm *s, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KSYSD_H
@@ -0,0 +1,1950 @@
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/file.h>
+#include <linux/fcntl.h>
+#include <linux/kref.h>
+#include <linux/log2.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+#include <linux/numa.h>
+#include <linux/poll.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+#include <linux/types.h>
+#include <linux/ioctl.h>
+#include <linux/binfmts.h>
+#include <linux/kdev_t.h>
+#include <linux/percpu.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/kprobes.h>
+#include <linux/nodemask.h>
+#include <linux/version.h>
+#include <linux/huge_mm.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
+#include <linux/timer.h>
+#include <linux/vmalloc.h>
+#include <linux/rcupdate.h>
+#include <linux/capability.h>
+#include <linux/tracepoint.h>
+#include <linux/miscdevice.h>
+#include <linux/moduleparam.h>
+#include <linux/timekeeping.h>
+#include <asm/unistd.h>
+
+#include <ksys/ksys.h>        // ABI + ksys_core.h (유저 공간과 공유)
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 17, 0)
+#include <linux/pfn_t.h>
+#endif
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("kt5965");
+MODULE_DESCRIPTION("Simple syscall tracer using kprobe/tracepoint (ksys v2)");
+
+// --- Constants ---
+#define KSYS_RING_SIZE  1024    // ring_size 기본값
+#define KSYS_RING_MIN   64
+#define KSYS_RING_MAX   (1u << 22)
+#define KSYS_READ_MAX   1024    // read/READ_BATCH 한 번에 내보내는 최대 레코드 수 (gap 포함)
+#define KSYS_FILL_CHUNK 256     // read/poll 이 ksys_rb_lock (irq off) 을 한 번 잡고 보는 최대 슬롯 수
+
+// 실제로 등록하는 probe 단위 (내부용). ksys_units_for() 가 설정에서 계산
+#define KSYS_U_WRAPPER          (1u << 0)
+#define KSYS_U_OPENAT2          (1u << 1)
+#define KSYS_U_SYS_ENTER        (1u << 2)
+#define KSYS_U_RET_WRAPPER      (1u << 3)
+#define KSYS_U_RET_OPENAT2      (1u << 4)
+#define KSYS_U_PROC             (1u << 5)
+#define KSYS_U_ALL              ((1u << 6) - 1)
+
+// --- Data Structures ---
+// 유저 공간과 공유하는 ABI 구조체는 include/ksys/ksys.h
+
+struct ksys_group {
+    struct list_head node;  // ksys_groups
+    u32 id;
+    u32 users;              // ksys_group_lock 으로 보호
+    struct ksys_cursor cur; // ksys_rb_lock 으로 보호
+};
+
+struct ksys_reader {
+    struct list_head node;      // ksys_readers (ksys_rb_lock)
+    struct ksys_cursor *cur;    // &own 또는 &grp->cur (ksys_rb_lock 으로 보호)
+    struct ksys_cursor own;
+    struct ksys_group *grp;     // CLAIM 그룹 (없으면 NULL)
+    u32 opts;                   // KSYS_OPT_*
+    u32 proj;                   // KSYS_FIELD_* (0 이면 struct ksys_event 그대로)
+    u32 shard;                  // SHARD_* 모드: 이 리더가 맡은 조각
+    u32 nr_shards;              // 0 이면 샤딩 없음
+    u32 shard_mode;
+    struct ksys_filter flt;
+    struct mutex read_lock;     // 같은 fd 로 동시에 읽는 스레드끼리 buf 를 나눠 쓰지 않게
+    struct ksys_event *buf;     // 바운스 버퍼 KSYS_READ_MAX 개. 처음 읽을 때 할당 (read_lock)
+    u8 *pbuf;                   // projection 인코딩 버퍼 KSYS_READ_MAX * KSYS_PROJ_REC_MAX. 처음 쓸 때 할당 (read_lock)
+    u64 tune_seq;               // 지난 tune tick 때의 커서 위치 (ksys_rb_lock)
+};
+
+// 링 메모리 한 벌. 리사이즈하면 새로 만들고, 옛 것은 마지막 mmap 이 풀릴 때 해제
+struct ksys_shm {
+    struct kref ref;
+    struct page **pages;        // 4K 페이지 단위 (mmap fault 용)
+    unsigned int nr_pages;
+    unsigned int order;         // 청크 order, 0 이면 4K 폴백
+    void *base;                 // 청크들을 vmap 으로 이어 붙인 커널 주소
+    struct ksys_mmap_hdr *hdr;
+    struct ksys_mmap_slot *slot;
+};
+
+// --- Globals ---
+static u64 ksys_seq = 0; // 단조 증가 시퀀스 번호
+static u32 ksys_ring_size;
+static u32 ksys_ring_mask;
+static int ksys_ring_node;
+static DEFINE_SPINLOCK(ksys_rb_lock);
+static DECLARE_WAIT_QUEUE_HEAD(ksys_wq);
+static LIST_HEAD(ksys_groups);
+static DEFINE_MUTEX(ksys_group_lock);
+
+struct ksys_rt_config {
+    struct ksys_config c;
+    struct rcu_head rcu;
+};
+static struct ksys_rt_config __rcu *ksys_cfg;
+static DEFINE_MUTEX(ksys_cfg_lock);     // writer 끼리만 직렬화
+static DEFINE_PER_CPU(u32, ksys_sample_ctr);
+static struct ksys_shm *ksys_shm;       // 현재 링 (ksys_rb_lock 안에서 교체)
+static struct ksys_mmap_hdr *ksys_hdr;  // == ksys_shm->hdr
+static struct ksys_mmap_slot *ksys_slot;
+static u64 ksys_ring_base;              // 리사이즈 때 옮기지 못한 seq 의 경계
+static u64 ksys_drops_total;            // ksys_rb_lock
+static LIST_HEAD(ksys_readers);         // ksys_rb_lock
+static struct ksys_tune_stats ksys_tune; // ksys_rb_lock
+static void ksys_tune_tick(struct work_struct *work);
+static DECLARE_DELAYED_WORK(ksys_tune_work, ksys_tune_tick);
+
+
+// --- Module Parameters ---
+// 링 슬롯 수 (2의 거듭제곱으로 올림) 와 링을 둘 NUMA 노드 (-1: 로드한 CPU 의 노드)
+static unsigned int ring_size = KSYS_RING_SIZE;
+module_param(ring_size, uint, 0444);
+
+static int ring_node = NUMA_NO_NODE;
+module_param(ring_node, int, 0444);
+
+// 가능하면 PMD 크기 (2MB) 페이지로 링을 할당, 실패하면 4K 로 폴백
+static bool ring_huge = true;
+module_param(ring_huge, bool, 0444);
+
+// 오토튜닝: drops 와 reader lag 를 보고 [ring_min, ring_max] 안에서 링 크기 조절 (기본 꺼짐)
+static bool ring_autotune;
+module_param(ring_autotune, bool, 0444);
+
+static unsigned int ring_min = KSYS_RING_SIZE;
+module_param(ring_min, uint, 0444);
+
+static unsigned int ring_max = 1u << 20;
+module_param(ring_max, uint, 0444);
+
+static unsigned int ring_tune_ms = 1000;
+module_param(ring_tune_ms, uint, 0444);
+
+// wake_batch 로 깨우기를 미룬 이벤트도 이 시간 안에는 자는 reader 를 깨움 (배치가 안 차고 조용해져도)
+static unsigned int wake_flush_ms = 10;
+module_param(wake_flush_ms, uint, 0444);
+
+// 로드 시 초기 설정으로만 사용. 런타임 변경은 KSYS_IOC_SET_CONFIG
+static const char * const ksys_attach_names[] = {
+    [KSYS_ATTACH_WRAPPER]    = "wrapper",
+    [KSYS_ATTACH_OPENAT2]    = "openat2",
+    [KSYS_ATTACH_TRACEPOINT] = "tracepoint",
+    [KSYS_ATTACH_NONE]       = "none",
+};
+static char attach[16] = "wrapper";
+module_param_string(attach, attach, sizeof(attach), 0444);
+
+static int pid_filter = -1;
+module_param(pid_filter, int, 0444);
+
+static int tgid_filter = -1;
+module_param(tgid_filter, int, 0444);
+
+static char comm_filter[KSYS_COMM_LEN];
+module_param_string(comm_filter, comm_filter, sizeof(comm_filter), 0444);
+
+// --- Helper Functions ---
+
+// 전역 필터 확인 (Probe 단계에서 사용, rcu_read_lock 안에서)
+static inline bool ksys_pass_filter(const struct ksys_config *cfg, const struct ksys_event *ev)
+{
+    if (cfg->pid != -1 && ev->pid != cfg->pid)
+        return false;
+    if (cfg->tgid != -1 && ev->tgid != cfg->tgid)
+        return false;
+    if (cfg->comm[0]) {
+        if (strncmp(ev->comm, cfg->comm, KSYS_COMM_LEN) != 0)
+            return false;
+    }
+    return true;
+}
+
+// 샘플링: CPU 별 카운터라 공유 캐시라인 없음
+static inline bool ksys_sample_keep(const struct ksys_config *cfg)
+{
+    if (cfg->sample_every <= 1)
+        return true;
+    return (this_cpu_inc_return(ksys_sample_ctr) % cfg->sample_every) == 0;
+}
+
+// 설정 교체: 새 객체를 만들어 포인터만 바꾸고, 옛 객체는 grace period 뒤에 해제 (ksys_cfg_lock 필요)
+static int ksys_set_config_locked(const struct ksys_config *nc)
+{
+    struct ksys_rt_config *n, *old;
+
+    n = kmalloc(sizeof(*n), GFP_KERNEL);
+    if (!n)
+        return -ENOMEM;
+    n->c = *nc;
+    n->c.comm[KSYS_COMM_LEN - 1] = '\0';
+
+    old = rcu_replace_pointer(ksys_cfg, n, lockdep_is_held(&ksys_cfg_lock));
+    if (old)
+        kfree_rcu(old, rcu);
+    return 0;
+}
+
+static inline u64 ksys_oldest_seq(u64 cur_seq)
+{
+    return ksys_ring_oldest(cur_seq, ksys_ring_size, ksys_ring_base);
+}
+
+static inline struct ksys_event *ksys_rb_slot(u64 seq)
+{
+    return &ksys_ring_slot(ksys_slot, ksys_ring_mask, seq)->et;
+}
+
+// Reader가 너무 뒤쳐졌으면 가장 오래된 데이터로 점프 (Lock은 호출자가 잡고 있어야 함)
+static void ksys_reader_skip_locked(struct ksys_reader *r, u64 oldest_seq)
+{
+    ksys_drops_total += ksys_cursor_skip(r->cur, oldest_seq, r->opts & KSYS_OPT_GAP_RECORDS);
+}
+
+// 필터 + 샤드 조건
+static inline bool ksys_reader_match(const struct ksys_reader *r, const struct ksys_event *ev)
+{
+    if (r->nr_shards) {
+        u32 key = (r->shard_mode == KSYS_GROUP_SHARD_TGID) ? (u32)ev->tgid : (u32)ev->seq;
+        if (key % r->nr_shards != r->shard)
+            return false;
+    }
+    return ksys_match_event(&r->flt, ev);
+}
+
+// 링 버퍼에 이벤트 푸시 (Lock은 호출자가 잡고 있어야 함)
+static void ksys_rb_push_locked(const struct ksys_event *event)
+{
+    ksys_slot_publish(ksys_ring_slot(ksys_slot, ksys_ring_mask, ksys_seq), event, ksys_seq);
+    ksys_seq++;
+    smp_store_release(&ksys_hdr->cur_seq, ksys_seq);
+}
+
+// --- KProbe Handler ---
+
+// 어느 attach point 에서 왔든 openat 인자를 같은 모양으로
+struct ksys_open_args {
+    int dfd;
+    const char __user *filename;
+    int flags;
+    umode_t mode;
+};
+
+// 유저 레지스터에서 (x86_64 syscall ABI: di, si, dx, r10, r8, r9)
+static inline void ksys_args_from_uregs(const struct pt_regs *uregs, struct ksys_open_args *a)
+{
+    a->dfd      = (int)uregs->di;
+    a->filename = (const char __user *)uregs->si;
+    a->flags    = (int)uregs->dx;
+    a->mode     = (umode_t)uregs->r10;
+}
+
+// x86_64: syscall wrapper는 pt_regs 포인터를 di 레지스터에 넣음
+static bool ksys_args_wrapper(struct pt_regs *regs, struct ksys_open_args *a)
+{
+    const struct pt_regs *uregs = (const struct pt_regs *)regs->di;
+
+    if (!uregs)
+        return false;
+    ksys_args_from_uregs(uregs, a);
+    return true;
+}
+
+// do_sys_openat2(int dfd, const char __user *filename, struct open_how *how): how 는 커널 메모리
+static bool ksys_args_openat2(struct pt_regs *regs, struct ksys_open_args *a)
+{
+    const struct open_how *how = (const struct open_how *)regs->dx;
+
+    if (!how)
+        return false;
+    a->dfd      = (int)regs->di;
+    a->filename = (const char __user *)regs->si;
+    a->flags    = (int)how->flags;
+    a->mode     = (umode_t)how->mode;
+    return true;
+}
+
+static int handler_pre(struct kprobe *p, struct pt_regs *regs);
+static int ksys_openat2_pre(struct kprobe *p, struct pt_regs *regs);
+
+static struct kprobe kp = {
+    .symbol_name = "__x64_sys_openat",
+    .pre_handler = handler_pre,
+};
+
+// open/openat/openat2/creat 가 모두 지나감. static 이라 inline 된 커널에서는 등록 실패
+static struct kprobe kp_openat2 = {
+    .symbol_name = "do_sys_openat2",
+    .pre_handler = ksys_openat2_pre,
+};
+
+// exit-side 캡처 (KSYS_CAP_INODE): 진입에서 이벤트를 만들어 두고 리턴에서 fd -> (dev, ino, gen) 채움
+struct ksys_krp_data {
+    struct ksys_event ev;
+    u32 wake_batch;
+};
+
+static int krp_entry(struct kretprobe_instance *ri, struct pt_regs *regs);
+static int krp_openat2_entry(struct kretprobe_instance *ri, struct pt_regs *regs);
+static int krp_ret(struct kretprobe_instance *ri, struct pt_regs *regs);
+
+static struct kretprobe krp = {
+    .kp.symbol_name = "__x64_sys_openat",
+    .entry_handler  = krp_entry,
+    .handler        = krp_ret,
+    .data_size      = sizeof(struct ksys_krp_data),
+};
+
+static struct kretprobe krp_openat2 = {
+    .kp.symbol_name = "do_sys_openat2",
+    .entry_handler  = krp_openat2_entry,
+    .handler        = krp_ret,
+    .data_size      = sizeof(struct ksys_krp_data),
+};
+static u32 ksys_units_active;       // 지금 등록된 KSYS_U_* (ksys_cfg_lock 으로 보호)
+
+// 설정이 요구하는 probe 단위. 핸들러는 자기 단위가 여기 없으면 버림 (전환 중 옛 probe 가 섞이지 않게)
+static u32 ksys_units_for(const struct ksys_config *c)
+{
+    bool ret_side = c->capture & KSYS_CAP_INODE;
+    u32 u = (c->capture & KSYS_CAP_PROC) ? KSYS_U_PROC : 0;
+
+    switch (c->attach) {
+        case KSYS_ATTACH_WRAPPER:
+            return u | (ret_side ? KSYS_U_RET_WRAPPER : KSYS_U_WRAPPER);
+        case KSYS_ATTACH_OPENAT2:
+            return u | (ret_side ? KSYS_U_RET_OPENAT2 : KSYS_U_OPENAT2);
+        case KSYS_ATTACH_TRACEPOINT:
+            // tracepoint 에는 진입/리턴을 잇는 저장소가 없어서 INODE 는 wrapper kretprobe 로
+            return u | (ret_side ? KSYS_U_RET_WRAPPER : KSYS_U_SYS_ENTER);
+        default:
+            return u;
+    }
+}
+
+// 진입 시점 이벤트 구성. 필터/샘플링에서 버려지거나 지금 설정의 probe 가 아니면 false
+static bool ksys_build_event(const struct ksys_open_args *a, u32 unit,
+                             struct ksys_event *event, u32 *wake_batch)
+{
+    const struct ksys_rt_config *cfg;
+    char tmp[KSYS_PATH_LEN];
+    long ret;
+
+    // padding 까지 0으로 (유저로 스택 쓰레기가 새지 않게, type = KSYS_REC_OPENAT)
+    memset(event, 0, sizeof(*event));
+
+    event->dfd   = a->dfd;
+    event->flags = a->flags;
+    event->mode  = a->mode;
+
+    event->ts_ns = ktime_get_ns();
+    event->pid   = current->pid;
+    event->tgid  = current->tgid;
+
+    // 전역 필터/샘플링은 경로 복사 전에 (버릴 이벤트에 strncpy_from_user 하지 않게)
+    rcu_read_lock();
+    cfg = rcu_dereference(ksys_cfg);
+    if (!(ksys_units_for(&cfg->c) & unit))
+        goto drop;
+
+    // 커널 내에서는 strscpy 권장. NO_COMM 이어도 comm 필터가 있으면 비교용으로 필요
+    if (!(cfg->c.capture & KSYS_CAP_NO_COMM) || cfg->c.comm[0])
+        strscpy(event->comm, current->comm, sizeof(event->comm));
+    if (!ksys_pass_filter(&cfg->c, event) || !ksys_sample_keep(&cfg->c))
+        goto drop;
+    if (cfg->c.capture & KSYS_CAP_NO_COMM)
+        memset(event->comm, 0, sizeof(event->comm));
+    *wake_batch = cfg->c.wake_batch;
+    rcu_read_unlock();
+
+    // 유저 공간 경로 복사
+    ret = strncpy_from_user(tmp, a->filename, sizeof(tmp));
+    if (ret < 0) {
+        strscpy(event->path, "<badptr>", sizeof(event->path));
+    } else {
+        tmp[sizeof(tmp) - 1] = '\0';
+        strscpy(event->path, tmp, sizeof(event->path));
+    }
+    return true;
+
+drop:
+    rcu_read_unlock();
+    return false;
+}
+
+// wake_batch 로 미룬 깨우기를 wake_flush_ms 뒤에 대신 함
+static void ksys_wake_flush(struct timer_list *t)
+{
+    if (wq_has_sleeper(&ksys_wq))
+        wake_up_interruptible(&ksys_wq);
+}
+static DEFINE_TIMER(ksys_wake_timer, ksys_wake_flush);
+
+static void ksys_commit_event(const struct ksys_event *event, u32 wake_batch)
+{
+    unsigned long flags;
+    u64 seq;
+
+    // Critical Section
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    ksys_rb_push_locked(event);
+    seq = ksys_seq;
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    // 자는 reader 가 없으면 waitqueue 락도 잡지 않음
+    if (!wq_has_sleeper(&ksys_wq))
+        return;
+    if (wake_batch <= 1 || (seq % wake_batch) == 0) {
+        wake_up_interruptible(&ksys_wq);
+        return;
+    }
+    // 배치 경계 전에 쓰는 쪽이 조용해질 수 있음 (seq 는 전역이라 경계가 이 reader 몫이 아닐 수도).
+    // 걸려 있는 타이머는 뒤로 밀지 않음 (이벤트가 계속 와도 처음 미룬 것부터 wake_flush_ms 안에)
+    if (!timer_pending(&ksys_wake_timer))
+        timer_reduce(&ksys_wake_timer, jiffies + max(msecs_to_jiffies(wake_flush_ms), 1ul));
+}
+
+static int handler_pre(struct kprobe *p, struct pt_regs *regs)
+{
+    struct ksys_open_args a;
+    struct ksys_event event;
+    u32 wake_batch;
+
+    if (ksys_args_wrapper(regs, &a) && ksys_build_event(&a, KSYS_U_WRAPPER, &event, &wake_batch))
+        ksys_commit_event(&event, wake_batch);
+    return 0;
+}
+
+static int ksys_openat2_pre(struct kprobe *p, struct pt_regs *regs)
+{
+    struct ksys_open_args a;
+    struct ksys_event event;
+    u32 wake_batch;
+
+    if (ksys_args_openat2(regs, &a) && ksys_build_event(&a, KSYS_U_OPENAT2, &event, &wake_batch))
+        ksys_commit_event(&event, wake_batch);
+    return 0;
+}
+
+// raw_syscalls:sys_enter. 모든 syscall 에서 불리므로 번호부터 거름
+static void ksys_tp_sys_enter(void *data, struct pt_regs *regs, long id)
+{
+    struct ksys_open_args a;
+    struct ksys_event event;
+    u32 wake_batch;
+
+    if (id != __NR_openat)
+        return;
+    ksys_args_from_uregs(regs, &a);
+    if (ksys_build_event(&a, KSYS_U_SYS_ENTER, &event, &wake_batch))
+        ksys_commit_event(&event, wake_batch);
+}
+
+static int krp_entry(struct kretprobe_instance *ri, struct pt_regs *regs)
+{
+    struct ksys_krp_data *d = (struct ksys_krp_data *)ri->data;
+    struct ksys_open_args a;
+
+    // 0 이 아니면 이 호출에는 리턴 핸들러를 걸지 않음
+    if (!ksys_args_wrapper(regs, &a) ||
+        !ksys_build_event(&a, KSYS_U_RET_WRAPPER, &d->ev, &d->wake_batch))
+        return 1;
+    d->ev.type = KSYS_REC_OPENAT_RET;
+    return 0;
+}
+
+static int krp_openat2_entry(struct kretprobe_instance *ri, struct pt_regs *regs)
+{
+    struct ksys_krp_data *d = (struct ksys_krp_data *)ri->data;
+    struct ksys_open_args a;
+
+    if (!ksys_args_openat2(regs, &a) ||
+        !ksys_build_event(&a, KSYS_U_RET_OPENAT2, &d->ev, &d->wake_batch))
+        return 1;
+    d->ev.type = KSYS_REC_OPENAT_RET;
+    return 0;
+}
+
+static int krp_ret(struct kretprobe_instance *ri, struct pt_regs *regs)
+{
+    struct ksys_krp_data *d = (struct ksys_krp_data *)ri->data;
+    long fd = regs_return_value(regs);
+
+    d->ev.ret = (s32)fd;
+    if (fd >= 0) {
+        // 리턴 직후라 같은 프로세스의 다른 스레드가 이미 닫았을 수도 있음 (그땐 dev/ino = 0)
+        struct file *f = fget((unsigned int)fd);
+
+        if (f) {
+            struct inode *inode = file_inode(f);
+
+            d->ev.dev = new_encode_dev(inode->i_sb->s_dev);
+            d->ev.ino = inode->i_ino;
+            d->ev.gen = inode->i_generation;
+            fput(f);
+        }
+    }
+
+    // ts_ns 는 진입 시각 그대로, seq 는 리턴 순서
+    ksys_commit_event(&d->ev, d->wake_batch);
+    return 0;
+}
+
+// --- Process Lifecycle (KSYS_CAP_PROC) ---
+
+// 같은 링으로 fork/exec/exit 을 흘려서 consumer 가 /proc 을 뒤지지 않고 프로세스 테이블을 유지하게 함.
+// 전역 필터는 적용하지만 샘플링은 하지 않음 (빠지면 테이블이 틀어짐)
+static void ksys_proc_event_init(struct ksys_event *ev, u16 type, struct task_struct *p)
+{
+    memset(ev, 0, sizeof(*ev));
+    ev->type  = type;
+    ev->ts_ns = ktime_get_ns();
+    ev->pid   = p->pid;
+    ev->tgid  = p->tgid;
+    strscpy(ev->comm, p->comm, sizeof(ev->comm));
+}
+
+static void ksys_proc_commit(const struct ksys_event *ev)
+{
+    const struct ksys_rt_config *cfg;
+    u32 wake_batch;
+
+    rcu_read_lock();
+    cfg = rcu_dereference(ksys_cfg);
+    if (!ksys_pass_filter(&cfg->c, ev)) {
+        rcu_read_unlock();
+        return;
+    }
+    wake_batch = cfg->c.wake_batch;
+    rcu_read_unlock();
+
+    ksys_commit_event(ev, wake_batch);
+}
+
+static void ksys_tp_fork(void *data, struct task_struct *parent, struct task_struct *child)
+{
+    struct ksys_event ev;
+
+    ksys_proc_event_init(&ev, KSYS_REC_FORK, child);
+    ev.ppid  = parent->pid;
+    ev.ptgid = parent->tgid;
+    ksys_proc_commit(&ev);
+}
+
+static void ksys_tp_exec(void *data, struct task_struct *p, pid_t old_pid,
+                         struct linux_binprm *bprm)
+{
+    struct ksys_event ev;
+
+    ksys_proc_event_init(&ev, KSYS_REC_EXEC, p);
+    strscpy(ev.path, bprm->filename, sizeof(ev.path));
+    ksys_proc_commit(&ev);
+}
+
+// 6.16 부터 sched_process_exit 에 group_dead 인자가 붙음. 그 전에는 do_exit 가 signal->live 를
+// 먼저 줄인 뒤 tracepoint 를 부르므로 0 이면 마지막 스레드. 리더 (pid == tgid) 가 끝나도 다른 스레드는
+// 계속 돌 수 있어서 프로세스 종료는 이것으로만 판단
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 16, 0)
+static void ksys_tp_exit(void *data, struct task_struct *p, bool group_dead)
+#else
+static void ksys_tp_exit(void *data, struct task_struct *p)
+#endif
+{
+    struct ksys_event ev;
+
+    ksys_proc_event_init(&ev, KSYS_REC_EXIT, p);
+    ev.exit_code = p->exit_code;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 16, 0)
+    ev.group_dead = group_dead;
+#else
+    ev.group_dead = atomic_read(&p->signal->live) == 0;
+#endif
+    ksys_proc_commit(&ev);
+}
+
+// sched_process_* 는 모듈에 export 되지 않으므로 이름으로 찾아서 등록
+static struct ksys_tp {
+    const char *name;
+    void *probe;
+    struct tracepoint *tp;
+} ksys_tps[] = {
+    { "sched_process_fork", ksys_tp_fork },
+    { "sched_process_exec", ksys_tp_exec },
+    { "sched_process_exit", ksys_tp_exit },
+};
+
+// KSYS_ATTACH_TRACEPOINT
+static struct ksys_tp ksys_tp_enter = { "sys_enter", ksys_tp_sys_enter };
+
+static void ksys_tp_lookup(struct tracepoint *tp, void *priv)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(ksys_tps); i++) {
+        if (!strcmp(tp->name, ksys_tps[i].name))
+            ksys_tps[i].tp = tp;
+    }
+    if (!strcmp(tp->name, ksys_tp_enter.name))
+        ksys_tp_enter.tp = tp;
+}
+
+static int ksys_proc_tp_register(void)
+{
+    int i, ret = 0;
+
+    for_each_kernel_tracepoint(ksys_tp_lookup, NULL);
+
+    for (i = 0; i < ARRAY_SIZE(ksys_tps); i++) {
+        if (!ksys_tps[i].tp) {
+            pr_err("ksys: tracepoint %s not found\n", ksys_tps[i].name);
+            ret = -ENOENT;
+            break;
+        }
+        ret = tracepoint_probe_register(ksys_tps[i].tp, ksys_tps[i].probe, NULL);
+        if (ret) {
+            pr_err("ksys: tracepoint_probe_register(%s) failed, ret=%d\n", ksys_tps[i].name, ret);
+            break;
+        }
+    }
+    if (!ret)
+        return 0;
+
+    while (--i >= 0)
+        tracepoint_probe_unregister(ksys_tps[i].tp, ksys_tps[i].probe, NULL);
+    tracepoint_synchronize_unregister();
+    return ret;
+}
+
+static void ksys_proc_tp_unregister(void)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(ksys_tps); i++)
+        tracepoint_probe_unregister(ksys_tps[i].tp, ksys_tps[i].probe, NULL);
+    // 실행 중인 probe 가 끝나야 모듈이 내려갈 수 있음
+    tracepoint_synchronize_unregister();
+}
+
+static int ksys_enter_tp_register(void)
+{
+    for_each_kernel_tracepoint(ksys_tp_lookup, NULL);
+    if (!ksys_tp_enter.tp) {
+        pr_err("ksys: tracepoint %s not found\n", ksys_tp_enter.name);
+        return -ENOENT;
+    }
+    return tracepoint_probe_register(ksys_tp_enter.tp, ksys_tp_enter.probe, NULL);
+}
+
+static void ksys_enter_tp_unregister(void)
+{
+    tracepoint_probe_unregister(ksys_tp_enter.tp, ksys_tp_enter.probe, NULL);
+    tracepoint_synchronize_unregister();
+}
+
+// --- Capture Switching ---
+
+// 재등록하려면 이전 등록에서 채워진 주소/플래그를 비워야 함
+static int ksys_kprobe_on(struct kprobe *p)
+{
+    p->addr = NULL;
+    p->flags = 0;
+    return register_kprobe(p);
+}
+
+static int ksys_kretprobe_on(struct kretprobe *rp)
+{
+    rp->kp.addr = NULL;
+    rp->kp.flags = 0;
+    rp->maxactive = max_t(int, 64, 4 * num_possible_cpus());
+    return register_kretprobe(rp);
+}
+
+static int ksys_unit_on(u32 unit)
+{
+    switch (unit) {
+        case KSYS_U_WRAPPER:        return ksys_kprobe_on(&kp);
+        case KSYS_U_OPENAT2:        return ksys_kprobe_on(&kp_openat2);
+        case KSYS_U_SYS_ENTER:      return ksys_enter_tp_register();
+        case KSYS_U_RET_WRAPPER:    return ksys_kretprobe_on(&krp);
+        case KSYS_U_RET_OPENAT2:    return ksys_kretprobe_on(&krp_openat2);
+        case KSYS_U_PROC:           return ksys_proc_tp_register();
+    }
+    return -EINVAL;
+}
+
+static void ksys_unit_off(u32 unit)
+{
+    switch (unit) {
+        case KSYS_U_WRAPPER:        unregister_kprobe(&kp); break;
+        case KSYS_U_OPENAT2:        unregister_kprobe(&kp_openat2); break;
+        case KSYS_U_SYS_ENTER:      ksys_enter_tp_unregister(); break;
+        case KSYS_U_RET_WRAPPER:    unregister_kretprobe(&krp); break;
+        case KSYS_U_RET_OPENAT2:    unregister_kretprobe(&krp_openat2); break;
+        case KSYS_U_PROC:           ksys_proc_tp_unregister(); break;
+    }
+}
+
+static void ksys_units_off(u32 units)
+{
+    u32 u;
+
+    for (u = 1; u & KSYS_U_ALL; u <<= 1) {
+        if (units & u)
+            ksys_unit_off(u);
+    }
+}
+
+// 하나라도 실패하면 이번에 켠 것만 되돌림
+static int ksys_units_on(u32 units)
+{
+    u32 u, done = 0;
+    int ret;
+
+    for (u = 1; u & KSYS_U_ALL; u <<= 1) {
+        if (!(units & u))
+            continue;
+        ret = ksys_unit_on(u);
+        if (ret < 0) {
+            pr_err("ksys: probe unit %#x register failed, ret=%d\n", u, ret);
+            ksys_units_off(done);
+            return ret;
+        }
+        done |= u;
+    }
+    return 0;
+}
+
+// 설정 교체 + 필요한 probe 가 바뀌면 등록/해제 (capture 비트, attach point 둘 다)
+// 켤 때는 등록 후 교체, 끌 때는 교체 후 해제. 설정 교체는 한 번의 RCU 포인터 교체라 어느 순간에도
+// 한 attach point 만 기록함. 다만 핸들러는 불린 그 순간의 설정을 보므로, 한 open 이 교체를 사이에
+// 두고 두 probe 를 지나면 틀어짐: syscall 진입 (wrapper, sys_enter) 에서 옛 설정, 그 안의
+// do_sys_openat2 에서 새 설정을 보면 wrapper -> openat2 전환은 그 open 을 두 번, openat2 -> wrapper
+// 전환은 0 번 기록함. 교체 순간 진행 중이던 open 몇 개에만 해당 (seq 로 구분되는 별개 레코드)
+static int ksys_update_config(const struct ksys_config *nc)
+{
+    u32 want, on, off;
+    int ret;
+
+    if ((nc->capture & ~KSYS_CAP_MASK) || nc->attach >= KSYS_ATTACH_MAX)
+        return -EINVAL;
+
+    mutex_lock(&ksys_cfg_lock);
+    want = ksys_units_for(nc);
+    on = want & ~ksys_units_active;
+    off = ksys_units_active & ~want;
+
+    ret = ksys_units_on(on);
+    if (ret)
+        goto out;
+
+    ret = ksys_set_config_locked(nc);
+    if (ret) {
+        ksys_units_off(on);
+        goto out;
+    }
+
+    ksys_units_off(off);
+    ksys_units_active = want;
+out:
+    mutex_unlock(&ksys_cfg_lock);
+    return ret;
+}
+
+// --- File Operations ---
+
+static int ksys_dev_open(struct inode *inode, struct file *file)
+{
+    struct ksys_reader *r;
+    unsigned long flags;
+
+    r = kzalloc(sizeof(*r), GFP_KERNEL);
+    if (!r)
+        return -ENOMEM;
+
+    r->own.drops = 0;
+    r->own.gap_pending = false;
+    r->cur = &r->own;
+    r->grp = NULL;
+    r->opts = 0;
+    r->proj = 0;
+    r->nr_shards = 0;
+    r->flt.pid = -1;
+    r->flt.tgid = -1;
+    r->flt.comm[0] = '\0';
+    mutex_init(&r->read_lock);
+
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    r->own.next_seq = ksys_seq; // Open 시점부터의 데이터만 수신
+    r->tune_seq = ksys_seq;
+    list_add(&r->node, &ksys_readers);
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    file->private_data = r;
+    return 0;
+}
+
+// CLAIM 그룹 탈퇴: 공유 커서 위치에서 자기 커서로 이어서 읽음 (ksys_group_lock 필요)
+static void ksys_group_leave_locked(struct ksys_reader *r)
+{
+    struct ksys_group *g = r->grp;
+    unsigned long flags;
+
+    if (!g)
+        return;
+
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    r->own = g->cur;
+    r->own.gap_pending = false;
+    r->cur = &r->own;
+    r->grp = NULL;
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    if (--g->users == 0) {
+        list_del(&g->node);
+        kfree(g);
+    }
+}
+
+static int ksys_group_attach(struct ksys_reader *r, const struct ksys_group_join *j)
+{
+    struct ksys_group *g;
+    unsigned long flags;
+
+    switch (j->mode) {
+        case KSYS_GROUP_CLAIM:
+            break;
+        case KSYS_GROUP_SHARD_TGID:
+        case KSYS_GROUP_SHARD_SEQ:
+            if (j->nr_shards == 0 || j->shard >= j->nr_shards)
+                return -EINVAL;
+            break;
+        default:
+            return -EINVAL;
+    }
+
+    mutex_lock(&ksys_group_lock);
+    ksys_group_leave_locked(r);
+
+    if (j->mode != KSYS_GROUP_CLAIM) {
+        spin_lock_irqsave(&ksys_rb_lock, flags);
+        r->shard_mode = j->mode;
+        r->shard = j->shard;
+        r->nr_shards = j->nr_shards;
+        spin_unlock_irqrestore(&ksys_rb_lock, flags);
+        mutex_unlock(&ksys_group_lock);
+        return 0;
+    }
+
+    list_for_each_entry(g, &ksys_groups, node) {
+        if (g->id == j->id)
+            goto found;
+    }
+
+    // 첫 멤버의 현재 위치에서 그룹 커서 시작
+    g = kzalloc(sizeof(*g), GFP_KERNEL);
+    if (!g) {
+        mutex_unlock(&ksys_group_lock);
+        return -ENOMEM;
+    }
+    g->id = j->id;
+    list_add(&g->node, &ksys_groups);
+
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    g->cur.next_seq = r->own.next_seq;
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+found:
+    g->users++;
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    r->nr_shards = 0;
+    r->grp = g;
+    r->cur = &g->cur;
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+    mutex_unlock(&ksys_group_lock);
+    return 0;
+}
+
+static int ksys_dev_release(struct inode *inode, struct file *file)
+{
+    struct ksys_reader *r = file->private_data;
+    unsigned long flags;
+
+    mutex_lock(&ksys_group_lock);
+    ksys_group_leave_locked(r);
+    mutex_unlock(&ksys_group_lock);
+
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    list_del(&r->node);
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    kvfree(r->pbuf);
+    kvfree(r->buf);
+    kfree(r);
+    return 0;
+}
+
+// 지금 바로 내보낼 수 있는 레코드 수 (gap 포함, limit 에서 멈춤)
+// 필터/샤드가 있으면 슬롯을 KSYS_FILL_CHUNK 개까지만 보고, 그 뒤에 안 본 슬롯이 남았으면 limit 로
+// 답함 (준비된 것으로 봄). 나머지는 read 가 청크마다 락을 놓으며 걸러냄. 0 개로 끝날 수 있음
+static u32 ksys_ready_locked(struct ksys_reader *r, u64 cur_seq, u32 limit)
+{
+    u64 oldest_seq = ksys_oldest_seq(cur_seq);
+    u64 s = r->cur->next_seq;
+    u32 n = 0, scanned = 0;
+
+    // 내보낼 gap 이 있거나 생길 예정이면 그것도 한 건
+    if (r->cur->gap_pending || (s < oldest_seq && (r->opts & KSYS_OPT_GAP_RECORDS)))
+        n++;
+    if (s < oldest_seq)
+        s = oldest_seq;
+
+    // 필터가 없으면 스캔할 필요 없음
+    if (!r->nr_shards && ksys_filter_empty(&r->flt))
+        return (u32)min_t(u64, limit, n + (cur_seq - s));
+
+    for (; s < cur_seq && n < limit; s++) {
+        if (scanned++ == KSYS_FILL_CHUNK)
+            return limit;
+        if (ksys_reader_match(r, ksys_rb_slot(s)))
+            n++;
+    }
+    return n;
+}
+
+static bool ksys_batch_ready(struct ksys_reader *r, u32 min_events)
+{
+    unsigned long flags;
+    u32 n;
+
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    n = ksys_ready_locked(r, ksys_seq, min_events);
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    return n >= min_events;
+}
+
+// --- Projection ---
+
+// 레코드 하나가 유저 버퍼에서 차지할 바이트 수
+static size_t ksys_rec_size(u32 proj, const struct ksys_event *ev)
+{
+    size_t sz = sizeof(struct ksys_rec_hdr);
+
+    if (!proj)
+        return sizeof(struct ksys_event);
+    if (ev->type == KSYS_REC_GAP)
+        return sz + 3 * sizeof(u64);
+
+    sz += hweight32(proj & KSYS_FIELD_U64S) * sizeof(u64);
+    sz += hweight32(proj & KSYS_FIELD_U32S) * sizeof(u32);
+    if (proj & KSYS_FIELD_COMM)
+        sz += KSYS_COMM_LEN;
+    if (proj & KSYS_FIELD_PATH)
+        sz += strnlen(ev->path, KSYS_PATH_LEN - 1) + 1;
+    return ALIGN(sz, 8);
+}
+
+static u8 *ksys_put(u8 *p, const void *v, size_t n)
+{
+    memcpy(p, v, n);
+    return p + n;
+}
+
+// packed 레코드 하나를 p 에 씀. 쓴 바이트 수 반환
+static size_t ksys_proj_encode(u32 proj, const struct ksys_event *ev, u8 *p)
+{
+    struct ksys_rec_hdr *h = (struct ksys_rec_hdr *)p;
+    size_t len = ksys_rec_size(proj, ev);
+    u8 *q = p + sizeof(*h);
+
+    memset(p, 0, len);
+    h->type = ev->type;
+    h->len = (u16)len;
+
+    if (ev->type == KSYS_REC_GAP) {
+        const struct ksys_gap *g = (const struct ksys_gap *)ev;
+
+        q = ksys_put(q, &g->lost_from_seq, sizeof(u64));
+        q = ksys_put(q, &g->lost_to_seq, sizeof(u64));
+        ksys_put(q, &g->count, sizeof(u64));
+        return len;
+    }
+
+    h->fields = proj;
+    if (proj & KSYS_FIELD_SEQ)   q = ksys_put(q, &ev->seq, sizeof(u64));
+    if (proj & KSYS_FIELD_TS)    q = ksys_put(q, &ev->ts_ns, sizeof(u64));
+    if (proj & KSYS_FIELD_INO)   q = ksys_put(q, &ev->ino, sizeof(u64));
+    if (proj & KSYS_FIELD_PID)   q = ksys_put(q, &ev->pid, sizeof(u32));
+    if (proj & KSYS_FIELD_TGID)  q = ksys_put(q, &ev->tgid, sizeof(u32));
+    if (proj & KSYS_FIELD_DFD)   q = ksys_put(q, &ev->dfd, sizeof(u32));
+    if (proj & KSYS_FIELD_FLAGS) q = ksys_put(q, &ev->flags, sizeof(u32));
+    if (proj & KSYS_FIELD_MODE) {
+        u32 mode = ev->mode;
+        q = ksys_put(q, &mode, sizeof(u32));
+    }
+    if (proj & KSYS_FIELD_RET)   q = ksys_put(q, &ev->ret, sizeof(u32));
+    if (proj & KSYS_FIELD_DEV)   q = ksys_put(q, &ev->dev, sizeof(u32));
+    if (proj & KSYS_FIELD_GEN)   q = ksys_put(q, &ev->gen, sizeof(u32));
+    if (proj & KSYS_FIELD_COMM)  q = ksys_put(q, ev->comm, KSYS_COMM_LEN);
+    if (proj & KSYS_FIELD_PATH)  ksys_put(q, ev->path, strnlen(ev->path, KSYS_PATH_LEN - 1));
+    return len;
+}
+
+// tmp 의 레코드를 유저 버퍼로 (projection 이면 r->pbuf 에 packed 로 인코딩). 복사한 바이트 수 반환
+// (read_lock 필요)
+static ssize_t ksys_copy_out(struct ksys_reader *r, u32 proj, const struct ksys_event *tmp, size_t n,
+                             char __user *buf)
+{
+    size_t bytes = 0, i;
+
+    if (!proj) {
+        bytes = n * sizeof(*tmp);
+        if (copy_to_user(buf, tmp, bytes))
+            return -EFAULT;
+        return bytes;
+    }
+
+    for (i = 0; i < n; i++)
+        bytes += ksys_proj_encode(proj, &tmp[i], r->pbuf + bytes);
+    if (copy_to_user(buf, r->pbuf, bytes))
+        return -EFAULT;
+    return bytes;
+}
+
+// 유저 버퍼 len 바이트에 들어갈 수 있는 최대 레코드 수 (0 이면 버퍼가 너무 작음)
+static size_t ksys_max_recs(u32 proj, size_t len)
+{
+    size_t n;
+
+    if (proj)
+        n = (len < KSYS_PROJ_REC_MAX) ? 0 : len / (sizeof(struct ksys_rec_hdr) + sizeof(u32));
+    else
+        n = len / sizeof(struct ksys_event);
+
+    // 한 번에 링 한 바퀴 + gap 이상은 나올 수 없음. 바운스 버퍼 크기로도 자름
+    n = min_t(size_t, n, ksys_ring_size + 1);
+    return min_t(size_t, n, KSYS_READ_MAX);
+}
+
+// reader 의 바운스 버퍼 (read_lock 필요). 큰 연속 페이지를 요구하지 않게 kvmalloc 으로 한 번만.
+// projection 이면 인코딩 버퍼도 여기서 잡아 둠 (채운 뒤에 할당이 실패해 레코드를 잃지 않게)
+static struct ksys_event *ksys_reader_buf(struct ksys_reader *r, u32 proj)
+{
+    if (!r->buf)
+        r->buf = kvmalloc_array(KSYS_READ_MAX, sizeof(*r->buf), GFP_KERNEL);
+    if (proj && !r->pbuf)
+        r->pbuf = kvmalloc_array(KSYS_READ_MAX, KSYS_PROJ_REC_MAX, GFP_KERNEL);
+    if (proj && !r->pbuf)
+        return NULL;
+    return r->buf;
+}
+
+// Copy + Filter Loop: 레코드 max_evs 개, 유저 쪽 크기로 budget 바이트까지, end 앞까지 tmp 로.
+// out/used 는 이어서 채움. 락 한 번에 슬롯을 KSYS_FILL_CHUNK 개까지만 봄. 더 볼 것이 남았으면 true
+// (Lock은 호출자가 잡고 있어야 함)
+static bool ksys_fill_locked(struct ksys_reader *r, u32 proj, struct ksys_event *tmp, size_t max_evs,
+                             size_t budget, u64 end, size_t *out, size_t *used)
+{
+    struct ksys_cursor *c = r->cur;
+    u32 scanned = 0;
+
+    ksys_reader_skip_locked(r, ksys_oldest_seq(ksys_seq));
+
+    // 유실 구간은 그 자리에 gap 레코드로 먼저 내보냄 (첫 청크에서는 버퍼가 최소 레코드 하나 크기 이상)
+    if (c->gap_pending) {
+        size_t sz;
+
+        if (*out >= max_evs)
+            return false;
+        ksys_cursor_gap(c, &tmp[*out], ktime_get_ns());
+        sz = ksys_rec_size(proj, &tmp[*out]);
+        if (*used + sz > budget) {
+            c->gap_pending = true;  // 다음 read 로
+            return false;
+        }
+        *used += sz;
+        (*out)++;
+    }
+
+    while (*out < max_evs && c->next_seq < end) {
+        const struct ksys_event *ev = ksys_rb_slot(c->next_seq);
+        size_t sz;
+
+        if (scanned++ == KSYS_FILL_CHUNK)
+            return true;
+
+        // Reader별 필터 적용
+        if (!ksys_reader_match(r, ev)) {
+            c->next_seq++;
+            continue;
+        }
+
+        sz = ksys_rec_size(proj, ev);
+        if (*used + sz > budget)
+            return false;
+        *used += sz;
+        c->next_seq++;
+        tmp[(*out)++] = *ev;
+    }
+    return false;
+}
+
+// ksys_fill_locked 를 청크마다 락을 놓았다 다시 잡으며 반복. 채운 레코드 수
+// 락을 놓은 사이 링이 한 바퀴 돌았으면 다음 청크 맨 앞에 gap 이 들어감. 필터가 다 걸러내는 동안
+// 쓰는 쪽이 계속 앞서 가도 끝나도록 처음 잡았을 때의 ksys_seq 까지만 봄
+static size_t ksys_fill(struct ksys_reader *r, u32 proj, struct ksys_event *tmp,
+                        size_t max_evs, size_t budget)
+{
+    size_t out = 0, used = 0;
+    unsigned long flags;
+    u64 end = 0;
+    bool more;
+
+    do {
+        spin_lock_irqsave(&ksys_rb_lock, flags);
+        if (!end)
+            end = ksys_seq;
+        more = ksys_fill_locked(r, proj, tmp, max_evs, budget, end, &out, &used);
+        spin_unlock_irqrestore(&ksys_rb_lock, flags);
+    } while (more);
+    return out;
+}
+
+static ssize_t ksys_dev_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+    struct ksys_reader *r = file->private_data;
+    struct ksys_event *tmp;
+    u64 cur_seq, oldest_seq;
+    u32 proj = READ_ONCE(r->proj);
+    size_t max_evs = ksys_max_recs(proj, count);
+    size_t out = 0;
+    ssize_t bytes;
+
+    if (max_evs == 0)
+        return -EINVAL;
+
+retry:
+    // 데이터 가용성 확인
+    {
+        unsigned long flags;
+        bool avail;
+
+        spin_lock_irqsave(&ksys_rb_lock, flags);
+        cur_seq = ksys_seq;
+        oldest_seq = ksys_oldest_seq(cur_seq);
+
+        ksys_reader_skip_locked(r, oldest_seq);
+        avail = r->cur->gap_pending || (r->cur->next_seq < cur_seq);
+        spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+        if (!avail) {
+            if (file->f_flags & O_NONBLOCK)
+                return -EAGAIN;
+
+            if (wait_event_interruptible(ksys_wq, ({
+                unsigned long f2;
+                u64 s2;
+                spin_lock_irqsave(&ksys_rb_lock, f2);
+                s2 = ksys_seq;
+                spin_unlock_irqrestore(&ksys_rb_lock, f2);
+                s2 != cur_seq;
+            })))
+                return -ERESTARTSYS;
+
+            goto retry;
+        }
+    }
+
+    if (mutex_lock_interruptible(&r->read_lock))
+        return -ERESTARTSYS;
+    tmp = ksys_reader_buf(r, proj);
+    if (!tmp) {
+        mutex_unlock(&r->read_lock);
+        return -ENOMEM;
+    }
+
+    // 락을 다시 잡았으니 시퀀스 재확인 후 복사
+    out = ksys_fill(r, proj, tmp, max_evs, count);
+
+    // 필터링 결과 읽을 게 없으면 다시 대기
+    if (out == 0) {
+        mutex_unlock(&r->read_lock);
+        if (file->f_flags & O_NONBLOCK)
+            return -EAGAIN;
+        goto retry;
+    }
+
+    // 유저 공간으로 복사
+    bytes = ksys_copy_out(r, proj, tmp, out, buf);
+    mutex_unlock(&r->read_lock);
+    return bytes;
+}
+
+static __poll_t ksys_dev_poll(struct file *file, poll_table *wait)
+{
+    struct ksys_reader *r = file->private_data;
+    unsigned long flags;
+    u64 cur_seq;
+    __poll_t mask = 0;
+
+    poll_wait(file, &ksys_wq, wait);
+
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    cur_seq = ksys_seq;
+    
+    if (ksys_ready_locked(r, cur_seq, 1))
+        mask |= POLLIN | POLLRDNORM;
+        
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    return mask;
+}
+
+// 한 번 채워서 유저 버퍼 off 바이트 뒤에 이어 붙임. 붙인 레코드 수, 실패 음수
+static ssize_t ksys_batch_fill(struct ksys_reader *r, u32 proj, char __user *ubuf, size_t max_evs,
+                               size_t budget, size_t *off)
+{
+    struct ksys_event *tmp;
+    ssize_t bytes = 0;
+    size_t out;
+
+    // read() 와 같은 바운스 버퍼 (max_evs 는 ksys_max_recs 가 KSYS_READ_MAX 로 자름)
+    if (mutex_lock_interruptible(&r->read_lock))
+        return -ERESTARTSYS;
+    tmp = ksys_reader_buf(r, proj);
+    if (!tmp) {
+        mutex_unlock(&r->read_lock);
+        return -ENOMEM;
+    }
+    out = ksys_fill(r, proj, tmp, max_evs, budget);
+    if (out)
+        bytes = ksys_copy_out(r, proj, tmp, out, ubuf + *off);
+    mutex_unlock(&r->read_lock);
+    if (bytes < 0)
+        return bytes;
+    *off += bytes;
+    return out;
+}
+
+// 채우고, min_events 에 모자라면 남은 시간만큼 다시 기다렸다 이어 채움. 준비됐다고 본 것이
+// 필터에 다 걸러지거나 (ksys_ready_locked 는 일부만 봄) 그 사이 링이 돌아도 timeout 전에는 돌아가지 않음
+static long ksys_ioctl_read_batch(struct ksys_reader *r, struct ksys_read_batch __user *ubatch)
+{
+    struct ksys_read_batch rb;
+    unsigned long flags;
+    size_t max_evs, nr = 0, off = 0;
+    u32 min_events;
+    u32 proj = READ_ONCE(r->proj);
+    long left;
+
+    if (copy_from_user(&rb, ubatch, sizeof(rb)))
+        return -EFAULT;
+
+    max_evs = ksys_max_recs(proj, rb.buf_len);
+    if (max_evs == 0)
+        return -EINVAL;
+    min_events = min_t(u32, rb.min_events, max_evs);
+    left = rb.timeout_ms < 0 ? MAX_SCHEDULE_TIMEOUT : (long)msecs_to_jiffies(rb.timeout_ms);
+
+    for (;;) {
+        size_t room = ksys_max_recs(proj, rb.buf_len - off);
+        ssize_t n;
+
+        n = ksys_batch_fill(r, proj, u64_to_user_ptr(rb.buf), min(room, max_evs - nr), rb.buf_len - off, &off);
+        if (n < 0) {
+            // 이미 꺼낸 레코드는 커서가 지나갔으므로 돌려줌
+            if (nr && n != -EFAULT)
+                break;
+            return n;
+        }
+        nr += n;
+
+        // 다 모았거나, 시간이 없거나, 버퍼에 레코드 (gap 포함) 하나 더 들어갈 자리가 없으면 끝
+        if (nr >= min_events || !left || nr == max_evs || !ksys_max_recs(proj, rb.buf_len - off))
+            break;
+        left = wait_event_interruptible_timeout(ksys_wq, ksys_batch_ready(r, min_events - nr), left);
+        if (left < 0) {
+            if (nr)
+                break;
+            return left;
+        }
+    }
+
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    rb.drops = r->cur->drops;
+    rb.cur_seq = ksys_seq;
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    rb.nr_events = (u32)nr;
+    rb.nr_bytes = (u32)off;
+    if (copy_to_user(ubatch, &rb, sizeof(rb)))
+        return -EFAULT;
+    return 0;
+}
+
+static long ksys_dev_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct ksys_reader *r = file->private_data;
+    if (!r) return -EINVAL;
+
+    switch (cmd)
+    {
+        case KSYS_IOC_GET_STATS: {
+            struct ksys_stats st;
+            unsigned long flags;
+
+            spin_lock_irqsave(&ksys_rb_lock, flags);
+            st.cur_seq = ksys_seq;
+            st.drops = r->cur->drops;
+            st.ring_size = ksys_ring_size;  // 오토튜닝 중이면 바뀔 수 있음
+            spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+            st.ring_node = ksys_ring_node;
+
+            if (copy_to_user((void __user*)arg, &st, sizeof(st)))
+                return -EFAULT;
+            return 0;
+        }
+
+        case KSYS_IOC_GET_TUNE: {
+            struct ksys_tune_stats ts;
+            unsigned long flags;
+
+            spin_lock_irqsave(&ksys_rb_lock, flags);
+            ts = ksys_tune;
+            ts.ring_size = ksys_ring_size;
+            ts.base_seq = ksys_ring_base;
+            spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+            if (copy_to_user((void __user *)arg, &ts, sizeof(ts)))
+                return -EFAULT;
+            return 0;
+        }
+
+        case KSYS_IOC_SET_FILTER: {
+            struct ksys_filter ft;
+            unsigned long flags;
+
+            if (copy_from_user(&ft, (void __user*)arg, sizeof(ft)))
+                return -EFAULT;
+
+            // 필터는 ksys_rb_lock 안에서 읽으므로 (ready/fill) 다 만든 뒤 락 안에서 한 번에 바꿈
+            spin_lock_irqsave(&ksys_rb_lock, flags);
+            r->flt = ft;
+            spin_unlock_irqrestore(&ksys_rb_lock, flags);
+            return 0;
+        }
+
+        case KSYS_IOC_SET_START: {
+            struct ksys_start st;
+            unsigned long flags;
+            u64 cur_seq, oldest;
+
+            // 오타 수정: sizeof(St) -> sizeof(st)
+            if (copy_from_user(&st, (void __user*)arg, sizeof(st)))
+                return -EFAULT; // 오타 수정: -EFAULT: -> -EFAULT;
+
+            spin_lock_irqsave(&ksys_rb_lock, flags);
+            cur_seq = ksys_seq;
+            oldest = ksys_oldest_seq(cur_seq);
+
+            switch (st.mode) {
+                case KSYS_START_NOW:
+                    r->cur->next_seq = cur_seq;
+                    break;
+                case KSYS_START_OLDEST:
+                    r->cur->next_seq = oldest;
+                    break;
+                case KSYS_START_SEQ:
+                    if (st.seq < oldest)
+                        r->cur->next_seq = oldest;
+                    else if (st.seq > cur_seq)
+                        r->cur->next_seq = cur_seq;
+                    else
+                        r->cur->next_seq = st.seq;
+                    break;
+                default:
+                    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+                    return -EINVAL;
+            }
+            
+            r->cur->drops = 0; 
+            r->cur->gap_pending = false;
+            spin_unlock_irqrestore(&ksys_rb_lock, flags);
+            return 0;
+        }
+
+        case KSYS_IOC_SET_OPTS: {
+            u32 opts;
+            unsigned long flags;
+
+            if (copy_from_user(&opts, (void __user*)arg, sizeof(opts)))
+                return -EFAULT;
+            if (opts & ~KSYS_OPT_MASK)
+                return -EINVAL;
+
+            spin_lock_irqsave(&ksys_rb_lock, flags);
+            r->opts = opts;
+            if (!(opts & KSYS_OPT_GAP_RECORDS))
+                r->cur->gap_pending = false;
+            spin_unlock_irqrestore(&ksys_rb_lock, flags);
+            return 0;
+        }
+
+        case KSYS_IOC_READ_BATCH:
+            return ksys_ioctl_read_batch(r, (struct ksys_read_batch __user *)arg);
+
+        case KSYS_IOC_SET_PROJECTION: {
+            u32 proj;
+
+            if (copy_from_user(&proj, (void __user*)arg, sizeof(proj)))
+                return -EFAULT;
+            if (proj & ~KSYS_FIELD_ALL)
+                return -EINVAL;
+            // 전부 고르면 packed 로 만들 이유가 없음
+            WRITE_ONCE(r->proj, proj == KSYS_FIELD_ALL ? 0 : proj);
+            return 0;
+        }
+
+        case KSYS_IOC_GET_CONFIG: {
+            struct ksys_config c;
+
+            rcu_read_lock();
+            c = rcu_dereference(ksys_cfg)->c;
+            rcu_read_unlock();
+
+            if (copy_to_user((void __user*)arg, &c, sizeof(c)))
+                return -EFAULT;
+            return 0;
+        }
+
+        case KSYS_IOC_SET_CONFIG: {
+            struct ksys_config c;
+
+            // 모든 reader 에 영향을 주는 전역 설정
+            if (!capable(CAP_SYS_ADMIN))
+                return -EPERM;
+            if (copy_from_user(&c, (void __user*)arg, sizeof(c)))
+                return -EFAULT;
+            return ksys_update_config(&c);
+        }
+
+        case KSYS_IOC_JOIN_GROUP: {
+            struct ksys_group_join j;
+
+            if (copy_from_user(&j, (void __user*)arg, sizeof(j)))
+                return -EFAULT;
+            return ksys_group_attach(r, &j);
+        }
+
+        case KSYS_IOC_LEAVE_GROUP: {
+            unsigned long flags;
+
+            mutex_lock(&ksys_group_lock);
+            ksys_group_leave_locked(r);
+            spin_lock_irqsave(&ksys_rb_lock, flags);
+            r->nr_shards = 0;
+            spin_unlock_irqrestore(&ksys_rb_lock, flags);
+            mutex_unlock(&ksys_group_lock);
+            return 0;
+        }
+        
+        default:
+            return -ENOTTY;
+    }
+}
+
+// --- Ring Memory ---
+// [hdr 1 페이지][ksys_mmap_slot * ring_size]. 청크 단위로 할당해 커널 쪽은 vmap 으로 이어 붙임
+// 가능하면 청크 = PMD 크기 compound page (2MB), 실패하면 4K 로 폴백
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#define KSYS_HUGE_ORDER HPAGE_PMD_ORDER
+#else
+#define KSYS_HUGE_ORDER 0
+#endif
+
+// huge_fault(vmf, order) 형태는 6.6 부터. 그 전 커널은 4K 매핑만
+#if defined(CONFIG_TRANSPARENT_HUGEPAGE) && LINUX_VERSION_CODE >= KERNEL_VERSION(6, 6, 0)
+#define KSYS_HUGE_MAP 1
+#else
+#define KSYS_HUGE_MAP 0
+#endif
+
+static void ksys_shm_release(struct kref *ref)
+{
+    struct ksys_shm *shm = container_of(ref, struct ksys_shm, ref);
+    unsigned int i;
+
+    if (shm->base)
+        vunmap(shm->base);
+    // 청크 첫 페이지만 해제 (뒤쪽은 같은 compound page)
+    for (i = 0; shm->pages && i < shm->nr_pages; i += 1u << shm->order) {
+        if (shm->pages[i])
+            __free_pages(shm->pages[i], shm->order);
+    }
+    kvfree(shm->pages);
+    kfree(shm);
+}
+
+// order 크기 청크로 bytes 이상을 할당
+static int ksys_shm_alloc_pages(struct ksys_shm *shm, size_t bytes, int node, unsigned int order)
+{
+    gfp_t gfp = GFP_KERNEL | __GFP_ZERO;
+    unsigned int i, j, step = 1u << order;
+
+    if (order)
+        gfp |= __GFP_COMP | __GFP_NOWARN | __GFP_NORETRY;
+
+    shm->order = order;
+    shm->nr_pages = ALIGN(bytes, PAGE_SIZE << order) >> PAGE_SHIFT;
+    shm->pages = kvcalloc(shm->nr_pages, sizeof(*shm->pages), GFP_KERNEL);
+    if (!shm->pages)
+        return -ENOMEM;
+
+    for (i = 0; i < shm->nr_pages; i += step) {
+        struct page *page = alloc_pages_node(node, gfp, order);
+
+        if (!page)
+            return -ENOMEM;
+        for (j = 0; j < step; j++)
+            shm->pages[i + j] = page + j;
+    }
+
+    shm->base = vmap(shm->pages, shm->nr_pages, VM_MAP, PAGE_KERNEL);
+    return shm->base ? 0 : -ENOMEM;
+}
+
+static struct ksys_shm *ksys_shm_try(size_t bytes, int node, unsigned int order)
+{
+    struct ksys_shm *shm = kzalloc(sizeof(*shm), GFP_KERNEL);
+
+    if (!shm)
+        return NULL;
+    kref_init(&shm->ref);
+    if (ksys_shm_alloc_pages(shm, bytes, node, order)) {
+        kref_put(&shm->ref, ksys_shm_release);  // 부분 할당 정리
+        return NULL;
+    }
+    return shm;
+}
+
+static struct ksys_shm *ksys_shm_create(u32 nr_slots, int node)
+{
+    size_t bytes = PAGE_SIZE + array_size(nr_slots, sizeof(struct ksys_mmap_slot));
+    struct ksys_shm *shm = NULL;
+
+    // 청크 하나도 못 채우는 작은 링은 huge page 를 쓰지 않음
+    if (KSYS_HUGE_ORDER && ring_huge && bytes >= (PAGE_SIZE << KSYS_HUGE_ORDER))
+        shm = ksys_shm_try(bytes, node, KSYS_HUGE_ORDER);
+    if (!shm)
+        shm = ksys_shm_try(bytes, node, 0);
+    if (!shm)
+        return NULL;
+
+    shm->hdr = shm->base;
+    shm->slot = shm->base + PAGE_SIZE;
+    shm->hdr->version = KSYS_MMAP_VERSION;
+    shm->hdr->ring_size = nr_slots;
+    shm->hdr->slot_size = sizeof(struct ksys_mmap_slot);
+    shm->hdr->hdr_size = PAGE_SIZE;
+    shm->hdr->chunk_size = PAGE_SIZE << shm->order;
+    shm->hdr->node = node;
+    shm->hdr->map_size = (u64)shm->nr_pages << PAGE_SHIFT;
+    return shm;
+}
+
+// --- mmap ---
+// 링 전체를 읽기 전용으로 노출. 청크가 huge page 면 PMD 단위로 매핑해 reader 의 TLB miss 를 줄임
+// 매핑은 만들 때의 ksys_shm 을 잡고 있음. 리사이즈되면 옛 hdr 에 STALE 이 서고 다시 mmap 해야 함
+
+static void ksys_vm_open(struct vm_area_struct *vma)
+{
+    struct ksys_shm *shm = vma->vm_private_data;
+
+    kref_get(&shm->ref);
+}
+
+static void ksys_vm_close(struct vm_area_struct *vma)
+{
+    struct ksys_shm *shm = vma->vm_private_data;
+
+    kref_put(&shm->ref, ksys_shm_release);
+}
+
+static vm_fault_t ksys_vm_fault(struct vm_fault *vmf)
+{
+    struct ksys_shm *shm = vmf->vma->vm_private_data;
+
+    if (vmf->pgoff >= shm->nr_pages)
+        return VM_FAULT_SIGBUS;
+    return vmf_insert_page(vmf->vma, vmf->address, shm->pages[vmf->pgoff]);
+}
+
+#if KSYS_HUGE_MAP
+static vm_fault_t ksys_vm_huge_fault(struct vm_fault *vmf, unsigned int order)
+{
+    struct ksys_shm *shm = vmf->vma->vm_private_data;
+    pgoff_t pgoff;
+
+    // PMD 한 칸이 청크 하나와 정확히 겹칠 때만. 나머지는 4K fault 로
+    if (order != KSYS_HUGE_ORDER || shm->order != KSYS_HUGE_ORDER)
+        return VM_FAULT_FALLBACK;
+
+    pgoff = vmf->pgoff - ((vmf->address & ~HPAGE_PMD_MASK) >> PAGE_SHIFT);
+    if (!IS_ALIGNED(pgoff, 1u << order) || pgoff + (1u << order) > shm->nr_pages)
+        return VM_FAULT_FALLBACK;
+
+    // VM_MIXEDMAP 이라 special PMD 로 들어감. 페이지 수명은 vma 가 잡은 kref 가 보장
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 17, 0)
+    return vmf_insert_pfn_pmd(vmf, page_to_pfn(shm->pages[pgoff]), false);
+#else
+    return vmf_insert_pfn_pmd(vmf, page_to_pfn_t(shm->pages[pgoff]), false);
+#endif
+}
+#endif
+
+static const struct vm_operations_struct ksys_vm_ops = {
+    .open = ksys_vm_open,
+    .close = ksys_vm_close,
+    .fault = ksys_vm_fault,
+#if KSYS_HUGE_MAP
+    .huge_fault = ksys_vm_huge_fault,
+#endif
+};
+
+static int ksys_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    unsigned long pages = vma_pages(vma);
+    vm_flags_t set = VM_MIXEDMAP | VM_DONTEXPAND | VM_DONTDUMP;
+    struct ksys_shm *shm;
+    unsigned long flags;
+
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    shm = ksys_shm;
+    kref_get(&shm->ref);
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    if (vma->vm_pgoff >= shm->nr_pages || pages > shm->nr_pages - vma->vm_pgoff) {
+        kref_put(&shm->ref, ksys_shm_release);
+        return -EINVAL;
+    }
+
+    // madvise 모드 THP 에서도 huge_fault 가 불리도록
+    if (KSYS_HUGE_MAP && shm->order)
+        set |= VM_HUGEPAGE;
+    vm_flags_mod(vma, set, VM_MAYWRITE);
+    vma->vm_private_data = shm;
+    vma->vm_ops = &ksys_vm_ops;
+    return 0;
+}
+
+// --- Ring Auto-Tuning ---
+// ring_autotune=1 이면 ring_tune_ms 마다 drops 증가와 reader lag 를 보고 [ring_min, ring_max] 안에서 2배씩 조절
+// 리사이즈는 2단계: 락 없이 대부분 복사한 뒤, 그 사이 들어온 것만 락 안에서 복사하고 교체
+
+#define KSYS_TUNE_CALM_TICKS 30     // 이만큼 연속으로 한가하면 줄임
+
+static u64 ksys_tune_prev_drops;
+static u32 ksys_tune_calm;
+
+// 지난 tick 이후 읽은 reader 중 가장 뒤처진 거리 (ksys_rb_lock 필요). 열어만 두고 읽지 않는 reader
+// (멈춘 ksysdump, 읽기를 그만둔 mmap 소비자) 는 lag 가 링 크기 이상으로 남아 링을 ring_max 까지
+// 키우게 되므로 뺌. mmap 소비자도 SET_START 로 커서를 옮기므로 읽는 중이면 여기서 보임
+static u64 ksys_lag_max_locked(u64 cur_seq)
+{
+    struct ksys_reader *r;
+    u64 lag = 0;
+
+    list_for_each_entry(r, &ksys_readers, node) {
+        u64 s = r->cur->next_seq;
+        bool moved = s != r->tune_seq;
+
+        r->tune_seq = s;
+        if (moved && s < cur_seq)
+            lag = max(lag, cur_seq - s);
+    }
+    return lag;
+}
+
+// 리사이즈는 tune work 에서만 하므로 ksys_shm/ksys_ring_* 를 락 없이 읽어도 됨
+static int ksys_ring_resize(u32 new_size)
+{
+    u32 old_size = ksys_ring_size;
+    struct ksys_shm *ns, *old = ksys_shm;
+    u64 cur1, cur2, from, base, s;
+    unsigned long flags;
+
+    ns = ksys_shm_create(new_size, ksys_ring_node);
+    if (!ns)
+        return -ENOMEM;
+
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    cur1 = ksys_seq;
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    // 1단계: 도중에 덮어써진 슬롯은 2단계에서 base 로 잘라냄
+    from = ksys_oldest_seq(cur1);
+    if (cur1 > new_size)
+        from = max(from, cur1 - new_size);
+    for (s = from; s < cur1; s++)
+        ns->slot[s & (new_size - 1)] = old->slot[s & (old_size - 1)];
+
+    // 2단계
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    cur2 = ksys_seq;
+    base = from;
+    if (cur2 > old_size)
+        base = max(base, cur2 - old_size);
+    if (cur2 > new_size)
+        base = max(base, cur2 - new_size);
+    for (s = max(cur1, base); s < cur2; s++)
+        ns->slot[s & (new_size - 1)] = old->slot[s & (old_size - 1)];
+
+    ns->hdr->base_seq = base;
+    ns->hdr->cur_seq = cur2;
+    ksys_shm = ns;
+    ksys_hdr = ns->hdr;
+    ksys_slot = ns->slot;
+    ksys_ring_size = new_size;
+    ksys_ring_mask = new_size - 1;
+    ksys_ring_base = base;
+    WRITE_ONCE(old->hdr->flags, old->hdr->flags | KSYS_MMAP_STALE);
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    kref_put(&old->ref, ksys_shm_release);
+    return 0;
+}
+
+static void ksys_tune_tick(struct work_struct *work)
+{
+    u32 size = ksys_ring_size, want = size, reason = KSYS_TUNE_NONE;
+    unsigned long flags;
+    u64 drops, lag;
+    int ret;
+
+    spin_lock_irqsave(&ksys_rb_lock, flags);
+    drops = ksys_drops_total;
+    lag = ksys_lag_max_locked(ksys_seq);
+    ksys_tune.drops_total = drops;
+    ksys_tune.lag_max = lag;
+    spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+    // lag >= size 면 다음 read 에서 drops 로 잡힐 것이므로 같은 취급
+    if (drops != ksys_tune_prev_drops || lag >= size)
+        reason = KSYS_TUNE_GROW_DROPS;
+    else if (lag > size - size / 4)
+        reason = KSYS_TUNE_GROW_LAG;
+    else if (lag < size / 8 && ++ksys_tune_calm >= KSYS_TUNE_CALM_TICKS)
+        reason = KSYS_TUNE_SHRINK_IDLE;
+    ksys_tune_prev_drops = drops;
+
+    if (reason == KSYS_TUNE_GROW_DROPS || reason == KSYS_TUNE_GROW_LAG)
+        want = min(size * 2, ksys_tune.ring_max);
+    else if (reason == KSYS_TUNE_SHRINK_IDLE)
+        want = max(size / 2, ksys_tune.ring_min);
+    if (reason != KSYS_TUNE_NONE || lag >= size / 8)
+        ksys_tune_calm = 0;
+
+    if (want != size) {
+        ret = ksys_ring_resize(want);
+
+        spin_lock_irqsave(&ksys_rb_lock, flags);
+        ksys_tune.last_reason = ret ? KSYS_TUNE_ALLOC_FAIL : reason;
+        ksys_tune.last_ns = ktime_get_ns();
+        ksys_tune.last_from = size;
+        ksys_tune.last_to = ret ? size : want;
+        if (!ret && want > size)
+            ksys_tune.grows++;
+        else if (!ret)
+            ksys_tune.shrinks++;
+        ksys_tune.ring_size = ksys_ring_size;
+        ksys_tune.base_seq = ksys_ring_base;
+        spin_unlock_irqrestore(&ksys_rb_lock, flags);
+
+        pr_info_ratelimited("ksys: ring %u -> %u slots (reason %u%s)\n",
+                            size, want, reason, ret ? ", alloc failed" : "");
+    }
+
+    schedule_delayed_work(&ksys_tune_work, msecs_to_jiffies(ksys_tune.interval_ms));
+}
+
+static const struct file_operations ksys_fops = {
+    .owner = THIS_MODULE,
+    .open = ksys_dev_open,
+    .release = ksys_dev_release,
+    .read = ksys_dev_read,
+    .poll = ksys_dev_poll,
+    .unlocked_ioctl = ksys_dev_ioctl,
+    .mmap = ksys_dev_mmap,
+#if KSYS_HUGE_MAP
+    .get_unmapped_area = thp_get_unmapped_area,  // 주소를 PMD 경계에 맞춤
+#endif
+    .llseek = noop_llseek,
+};
+
+static struct miscdevice ksys_miscdev = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name  = "ksys_trace",
+    .fops  = &ksys_fops,
+    .mode  = 0444,
+};
+
+// --- Init/Exit ---
+
+// 링을 지정한 노드 (없으면 로드한 CPU 의 노드) 에 할당. 크기는 2의 거듭제곱
+static int __init ksys_ring_alloc(void)
+{
+    int node = ring_node;
+
+    if (node != NUMA_NO_NODE && (node < 0 || node >= nr_node_ids || !node_online(node))) {
+        pr_warn("ksys: ring_node=%d is not online, using local node\n", node);
+        node = NUMA_NO_NODE;
+    }
+    if (node == NUMA_NO_NODE)
+        node = numa_node_id();
+
+    ksys_ring_size = roundup_pow_of_two(clamp_t(u32, ring_size, KSYS_RING_MIN, KSYS_RING_MAX));
+    ksys_ring_mask = ksys_ring_size - 1;
+    ksys_ring_node = node;
+
+    ksys_shm = ksys_shm_create(ksys_ring_size, node);
+    if (!ksys_shm)
+        return -ENOMEM;
+    ksys_hdr = ksys_shm->hdr;
+    ksys_slot = ksys_shm->slot;
+    return 0;
+}
+
+// 오토튜닝 범위도 2의 거듭제곱으로 맞추고, 시작 크기를 그 안으로
+static void __init ksys_tune_init(void)
+{
+    u32 lo = roundup_pow_of_two(clamp_t(u32, ring_min, KSYS_RING_MIN, KSYS_RING_MAX));
+    u32 hi = roundup_pow_of_two(clamp_t(u32, ring_max, KSYS_RING_MIN, KSYS_RING_MAX));
+
+    ksys_tune.enabled = ring_autotune;
+    ksys_tune.ring_min = min(lo, hi);
+    ksys_tune.ring_max = max(lo, hi);
+    ksys_tune.interval_ms = max(ring_tune_ms, 100u);
+    if (ring_autotune)
+        ring_size = clamp_t(u32, ring_size, ksys_tune.ring_min, ksys_tune.ring_max);
+}
+
+static int __init ksys_init(void)
+{
+    int ret;
+
+    BUILD_BUG_ON(sizeof(struct ksys_gap) != sizeof(struct ksys_event));
+    BUILD_BUG_ON(offsetof(struct ksys_gap, type) != offsetof(struct ksys_event, type));
+
+    // module param 으로 초기 설정 구성
+    {
+        struct ksys_config c = {
+            .pid = pid_filter,
+            .tgid = tgid_filter,
+            .sample_every = 1,
+            .wake_batch = 1,
+        };
+
+        ret = match_string(ksys_attach_names, ARRAY_SIZE(ksys_attach_names), attach);
+        if (ret < 0) {
+            pr_err("ksys: unknown attach point '%s'\n", attach);
+            return ret;
+        }
+        c.attach = ret;
+
+        strscpy(c.comm, comm_filter, sizeof(c.comm));
+        mutex_lock(&ksys_cfg_lock);
+        ret = ksys_set_config_locked(&c);
+        mutex_unlock(&ksys_cfg_lock);
+        if (ret)
+            return ret;
+    }
+
+    ksys_tune_init();
+    ret = ksys_ring_alloc();
+    if (ret)
+        goto err_cfg;
+
+    // 링이 준비된 뒤에 probe 등록
+    mutex_lock(&ksys_cfg_lock);
+    ret = ksys_units_on(ksys_units_for(&rcu_dereference_protected(ksys_cfg, 1)->c));
+    if (!ret)
+        ksys_units_active = ksys_units_for(&rcu_dereference_protected(ksys_cfg, 1)->c);
+    mutex_unlock(&ksys_cfg_lock);
+    if (ret)
+        goto err_ring;
+
+    ret = misc_register(&ksys_miscdev);
+    if (ret) {
+        pr_err("ksys: misc_register failed, ret=%d\n", ret);
+        ksys_units_off(ksys_units_active);
+        goto err_ring;
+    }
+
+    if (ring_autotune)
+        schedule_delayed_work(&ksys_tune_work, msecs_to_jiffies(ksys_tune.interval_ms));
+
+    pr_info("ksys: module loaded. attach %s, ring %u slots on node %d (%lu KB pages)\n",
+            attach, ksys_ring_size, ksys_ring_node, (PAGE_SIZE << ksys_shm->order) >> 10);
+    return 0;
+
+err_ring:
+    kref_put(&ksys_shm->ref, ksys_shm_release);
+err_cfg:
+    kfree(rcu_dereference_protected(ksys_cfg, 1));
+    return ret;
+}
+
+static void __exit ksys_exit(void)
+{
+    misc_deregister(&ksys_miscdev);
+    cancel_delayed_work_sync(&ksys_tune_work);
+    ksys_units_off(ksys_units_active);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)
+    timer_delete_sync(&ksys_wake_timer);
+#else
+    del_timer_sync(&ksys_wake_timer);
+#endif
+    // kfree_rcu 로 넘긴 옛 설정들이 모두 해제될 때까지 대기
+    rcu_barrier();
+    kfree(rcu_dereference_protected(ksys_cfg, 1));
+    // 모듈이 내려갈 때는 열린 파일도 매핑도 없으므로 마지막 참조
+    kref_put(&ksys_shm->ref, ksys_shm_release);
+    pr_info("ksys: module unloaded\n");
+}
+
+module_init(ksys_init);
+module_exit(ksys_exit);
\ No newline at end of file
@@ -0,0 +1,454 @@
+// lib/ksys_fanotify.c
+// fanotify 백엔드: FAN_REPORT_FID 이벤트 -> ksys_event (include/ksys/ksys_fanotify.h 참고)
+//
+// 이벤트마다 드는 syscall 을 줄이려고 handle -> (경로, dev, ino) 와 pid -> comm 을
+// 고정 크기 direct-mapped 캐시에 둠. 읽기 버퍼와 캐시는 open 때 한 번만 잡음.
+// 캐시된 경로는 rename 을 따라가지 않고, pid 재사용 시 comm 이 잠깐 틀릴 수 있음 (exec 때 다시 읽음)
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/fanotify.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/sysmacros.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys_fanotify.h>
+
+#ifndef FAN_OPEN_EXEC
+#define FAN_OPEN_EXEC           0x00001000
+#endif
+#ifndef FAN_REPORT_FID
+#define FAN_REPORT_FID          0x00000200
+#endif
+#ifndef FAN_MARK_FILESYSTEM
+#define FAN_MARK_FILESYSTEM     0x00000100
+#endif
+#ifndef FAN_EVENT_INFO_TYPE_FID
+#define FAN_EVENT_INFO_TYPE_FID 1
+#endif
+
+#define KSYS_FAN_BUF        (64 * 1024)
+#define KSYS_FAN_FID_SLOTS  4096        // 2의 거듭제곱
+#define KSYS_FAN_COMM_SLOTS 1024        // 2의 거듭제곱
+#define KSYS_FAN_FH_MAX     40          // 이보다 긴 handle 은 캐시하지 않음 (보통 8~20 바이트)
+#define KSYS_FAN_MARKS_MAX  16
+
+// include/linux/exportfs.h
+#define FILEID_INO32_GEN        1
+#define FILEID_INO32_GEN_PARENT 2
+
+struct ksys_fan_mark {
+    int fd;                 // open_by_handle_at 의 mount_fd
+    __kernel_fsid_t fsid;
+    __u32 dev;              // new_encode_dev
+};
+
+struct ksys_fan_fid {
+    __u64 hash;             // 0: 빈 슬롯
+    __kernel_fsid_t fsid;
+    int type;
+    __u8 len;
+    __u8 handle[KSYS_FAN_FH_MAX];
+    __u32 dev;
+    __u64 ino;
+    char path[KSYS_PATH_LEN];
+};
+
+struct ksys_fan_comm {
+    __s32 pid;              // 0: 빈 슬롯
+    char comm[KSYS_COMM_LEN];
+};
+
+struct ksys_fan {
+    int fd;
+    unsigned int flags;
+    pid_t self;
+    struct ksys_filter filter;
+    __u64 seq;              // 이 백엔드가 매기는 시퀀스
+    struct ksys_fan_mark marks[KSYS_FAN_MARKS_MAX];
+    unsigned int nmarks;
+    char *buf;
+    size_t len;             // buf 에 읽어 둔 바이트
+    size_t off;             // 아직 변환하지 않은 위치
+    struct ksys_fan_fid *fids;
+    struct ksys_fan_comm *comms;
+    struct ksys_fan_stats st;
+};
+
+// 커널 new_encode_dev 와 같은 인코딩 (모듈 레코드의 dev 와 비교 가능하게)
+static __u32 ksys_fan_encode_dev(dev_t d)
+{
+    unsigned int ma = major(d), mi = minor(d);
+
+    return (mi & 0xff) | (ma << 8) | ((mi & ~0xffu) << 12);
+}
+
+static __u64 ksys_fan_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (__u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static bool ksys_fan_fsid_eq(const __kernel_fsid_t *a, const __kernel_fsid_t *b)
+{
+    return a->val[0] == b->val[0] && a->val[1] == b->val[1];
+}
+
+// FNV-1a. 0 은 빈 슬롯 표시라 피함
+static __u64 ksys_fan_hash(const __kernel_fsid_t *fsid, const struct file_handle *fh)
+{
+    __u64 h = 1469598103934665603ull;
+    const __u8 *p;
+
+    h = (h ^ (__u32)fsid->val[0]) * 1099511628211ull;
+    h = (h ^ (__u32)fsid->val[1]) * 1099511628211ull;
+    h = (h ^ (__u32)fh->handle_type) * 1099511628211ull;
+    p = fh->f_handle;
+    for (unsigned int i = 0; i < fh->handle_bytes; i++)
+        h = (h ^ p[i]) * 1099511628211ull;
+    return h ? h : 1;
+}
+
+// --- Open/Close ---
+
+static int ksys_fan_add_mark(struct ksys_fan *fan, const char *path, __u64 mask)
+{
+    struct ksys_fan_mark *m;
+    struct statfs sfs;
+    struct stat sb;
+    unsigned int how = (fan->flags & KSYS_FAN_MOUNT) ? FAN_MARK_MOUNT : FAN_MARK_FILESYSTEM;
+
+    if (fan->nmarks >= KSYS_FAN_MARKS_MAX) {
+        errno = E2BIG;
+        return -1;
+    }
+    if (fanotify_mark(fan->fd, FAN_MARK_ADD | how, mask, AT_FDCWD, path) != 0)
+        return -1;
+
+    // O_PATH fd 는 open_by_handle_at 의 mount_fd 로 못 씀
+    m = &fan->marks[fan->nmarks];
+    m->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (m->fd < 0)
+        return -1;
+    if (fstatfs(m->fd, &sfs) != 0 || fstat(m->fd, &sb) != 0) {
+        close(m->fd);
+        return -1;
+    }
+    memcpy(&m->fsid, &sfs.f_fsid, sizeof(m->fsid));
+    m->dev = ksys_fan_encode_dev(sb.st_dev);
+    fan->nmarks++;
+    return 0;
+}
+
+struct ksys_fan *ksys_fan_open(const struct ksys_fan_opts *opts)
+{
+    static const char *const root[] = { "/" };
+    const char *const *paths = (opts && opts->paths) ? opts->paths : root;
+    unsigned int npaths = (opts && opts->paths) ? opts->npaths : 1;
+    unsigned int init = FAN_CLASS_NOTIF | FAN_REPORT_FID | FAN_CLOEXEC | FAN_NONBLOCK;
+    struct ksys_fan *fan;
+    __u64 mask = FAN_OPEN;
+    int err;
+
+    fan = calloc(1, sizeof(*fan));
+    if (!fan)
+        return NULL;
+    fan->fd = -1;
+    fan->flags = opts ? opts->flags : 0;
+    fan->self = getpid();
+    if (opts) {
+        fan->filter = opts->filter;
+    } else {
+        fan->filter.pid = -1;
+        fan->filter.tgid = -1;
+    }
+
+    fan->buf = malloc(KSYS_FAN_BUF);
+    fan->fids = calloc(KSYS_FAN_FID_SLOTS, sizeof(*fan->fids));
+    fan->comms = calloc(KSYS_FAN_COMM_SLOTS, sizeof(*fan->comms));
+    if (!fan->buf || !fan->fids || !fan->comms) {
+        errno = ENOMEM;
+        goto err;
+    }
+
+    if (fan->flags & KSYS_FAN_UNLIMITED)
+        init |= FAN_UNLIMITED_QUEUE;
+    if (fan->flags & KSYS_FAN_EXEC)
+        mask |= FAN_OPEN_EXEC;
+
+    fan->fd = fanotify_init(init, O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+    if (fan->fd < 0)
+        goto err;
+    for (unsigned int i = 0; i < npaths; i++) {
+        if (ksys_fan_add_mark(fan, paths[i], mask) != 0)
+            goto err;
+    }
+    return fan;
+
+err:
+    err = errno;
+    ksys_fan_close(fan);
+    errno = err;
+    return NULL;
+}
+
+void ksys_fan_close(struct ksys_fan *fan)
+{
+    if (!fan)
+        return;
+    for (unsigned int i = 0; i < fan->nmarks; i++)
+        close(fan->marks[i].fd);
+    if (fan->fd >= 0)
+        close(fan->fd);
+    free(fan->buf);
+    free(fan->fids);
+    free(fan->comms);
+    free(fan);
+}
+
+int ksys_fan_fd(const struct ksys_fan *fan)
+{
+    return fan->fd;
+}
+
+void ksys_fan_get_stats(const struct ksys_fan *fan, struct ksys_fan_stats *st)
+{
+    *st = fan->st;
+}
+
+// --- Resolve ---
+
+static const struct ksys_fan_mark *ksys_fan_mark_for(const struct ksys_fan *fan, const __kernel_fsid_t *fsid)
+{
+    for (unsigned int i = 0; i < fan->nmarks; i++) {
+        if (ksys_fan_fsid_eq(&fan->marks[i].fsid, fsid))
+            return &fan->marks[i];
+    }
+    return NULL;
+}
+
+// ext4/xfs 등이 쓰는 FILEID_INO32_GEN 계열만 경로 없이 ino/gen 을 꺼낼 수 있음
+static void ksys_fan_decode_fh(const struct file_handle *fh, struct ksys_event *ev)
+{
+    __u32 v[2];
+
+    if ((fh->handle_type != FILEID_INO32_GEN && fh->handle_type != FILEID_INO32_GEN_PARENT) ||
+        fh->handle_bytes < sizeof(v))
+        return;
+    memcpy(v, fh->f_handle, sizeof(v));
+    if (!ev->ino)
+        ev->ino = v[0];
+    ev->gen = v[1];
+}
+
+static const struct ksys_fan_fid *ksys_fan_resolve(struct ksys_fan *fan, const __kernel_fsid_t *fsid,
+                                                   struct file_handle *fh)
+{
+    __u64 h = ksys_fan_hash(fsid, fh);
+    struct ksys_fan_fid *e = &fan->fids[h & (KSYS_FAN_FID_SLOTS - 1)];
+    const struct ksys_fan_mark *m;
+    char link[32], target[PATH_MAX];
+    struct stat sb;
+    ssize_t n;
+    int fd;
+
+    if (e->hash == h && e->type == fh->handle_type && e->len == fh->handle_bytes &&
+        ksys_fan_fsid_eq(&e->fsid, fsid) && !memcmp(e->handle, fh->f_handle, e->len)) {
+        fan->st.fid_hits++;
+        return e;
+    }
+
+    m = ksys_fan_mark_for(fan, fsid);
+    if (!m) {
+        fan->st.resolve_fail++;
+        return NULL;
+    }
+    fan->st.fid_misses++;
+    fd = open_by_handle_at(m->fd, fh, O_PATH | O_CLOEXEC);
+    if (fd < 0) {
+        fan->st.resolve_fail++;
+        return NULL;
+    }
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    n = readlink(link, target, sizeof(target) - 1);
+    if (n < 0 || fstat(fd, &sb) != 0) {
+        close(fd);
+        fan->st.resolve_fail++;
+        return NULL;
+    }
+    close(fd);
+    target[n] = '\0';
+
+    if (fh->handle_bytes > KSYS_FAN_FH_MAX) {
+        // 캐시하지 않고 임시 슬롯에만 채움 (다음 miss 가 덮어씀)
+        e = &fan->fids[0];
+        e->hash = 0;
+    } else {
+        e->hash = h;
+        e->fsid = *fsid;
+        e->type = fh->handle_type;
+        e->len = (__u8)fh->handle_bytes;
+        memcpy(e->handle, fh->f_handle, e->len);
+    }
+    e->dev = ksys_fan_encode_dev(sb.st_dev);
+    e->ino = sb.st_ino;
+    strncpy(e->path, target, KSYS_PATH_LEN - 1);
+    e->path[KSYS_PATH_LEN - 1] = '\0';
+    return e;
+}
+
+static void ksys_fan_comm(struct ksys_fan *fan, __s32 pid, bool refresh, char *out)
+{
+    struct ksys_fan_comm *c = &fan->comms[(__u32)pid & (KSYS_FAN_COMM_SLOTS - 1)];
+    char p[32];
+    ssize_t n;
+    int fd;
+
+    if (c->pid == pid && !refresh) {
+        memcpy(out, c->comm, KSYS_COMM_LEN);
+        return;
+    }
+    fan->st.comm_misses++;
+    memset(c->comm, 0, sizeof(c->comm));
+    c->pid = pid;
+    snprintf(p, sizeof(p), "/proc/%d/comm", pid);
+    fd = open(p, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        n = read(fd, c->comm, KSYS_COMM_LEN - 1);
+        if (n > 0 && c->comm[n - 1] == '\n')
+            c->comm[n - 1] = '\0';
+        close(fd);
+    }
+    memcpy(out, c->comm, KSYS_COMM_LEN);
+}
+
+// --- Read ---
+
+static void ksys_fan_emit_gap(struct ksys_fan *fan, struct ksys_event *out)
+{
+    struct ksys_gap *g = (struct ksys_gap *)out;
+
+    memset(g, 0, sizeof(*g));
+    g->seq = fan->seq;
+    g->ts_ns = ksys_fan_now_ns();
+    g->lost_from_seq = fan->seq;
+    g->lost_to_seq = fan->seq;
+    g->count = 0;       // fanotify 는 몇 개를 버렸는지 알려주지 않음
+    g->type = KSYS_REC_GAP;
+}
+
+// 이벤트 하나를 0~2 개 레코드로. out 에는 최소 2칸이 있어야 함
+static size_t ksys_fan_convert(struct ksys_fan *fan, const struct fanotify_event_metadata *md, struct ksys_event *out)
+{
+    const struct fanotify_event_info_fid *info;
+    struct file_handle *fh;
+    const struct ksys_fan_fid *fid = NULL;
+    const struct ksys_fan_mark *m;
+    struct ksys_event ev;
+    bool exec = (fan->flags & KSYS_FAN_EXEC) && (md->mask & FAN_OPEN_EXEC);
+    size_t n = 0;
+
+    fan->st.events++;
+    if (md->mask & FAN_Q_OVERFLOW) {
+        fan->st.overflows++;
+        ksys_fan_emit_gap(fan, out);
+        return 1;
+    }
+    if (md->event_len < md->metadata_len + sizeof(*info))
+        return 0;
+    info = (const struct fanotify_event_info_fid *)((const char *)md + md->metadata_len);
+    if (info->hdr.info_type != FAN_EVENT_INFO_TYPE_FID)
+        return 0;
+
+    // pid/tgid 필터는 비싼 조회 전에
+    if (md->pid == fan->self ||
+        (fan->filter.pid != -1 && md->pid != fan->filter.pid) ||
+        (fan->filter.tgid != -1 && md->pid != fan->filter.tgid)) {
+        fan->st.filtered++;
+        return 0;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.ts_ns = ksys_fan_now_ns();
+    ev.pid = md->pid;
+    ev.tgid = md->pid;
+    ev.dfd = AT_FDCWD;
+    ksys_fan_comm(fan, md->pid, exec, ev.comm);
+    if (!ksys_match_event(&fan->filter, &ev)) {
+        fan->st.filtered++;
+        return 0;
+    }
+
+    fh = (struct file_handle *)info->handle;
+    if (!(fan->flags & KSYS_FAN_NO_PATH))
+        fid = ksys_fan_resolve(fan, &info->fsid, fh);
+    if (fid) {
+        memcpy(ev.path, fid->path, KSYS_PATH_LEN);
+        ev.dev = fid->dev;
+        ev.ino = fid->ino;
+    } else {
+        m = ksys_fan_mark_for(fan, &info->fsid);
+        if (m)
+            ev.dev = m->dev;
+    }
+    ksys_fan_decode_fh(fh, &ev);
+
+    if (md->mask & FAN_OPEN) {
+        out[n] = ev;
+        out[n].type = KSYS_REC_OPENAT_RET;
+        out[n].seq = fan->seq++;
+        n++;
+    }
+    if (exec) {
+        out[n] = ev;
+        out[n].type = KSYS_REC_EXEC;
+        out[n].ppid = 0;
+        out[n].ptgid = 0;
+        out[n].seq = fan->seq++;
+        n++;
+    }
+    return n;
+}
+
+ssize_t ksys_fan_read(struct ksys_fan *fan, struct ksys_event *out, size_t max)
+{
+    size_t n = 0;
+
+    while (n + 2 <= max) {
+        const struct fanotify_event_metadata *md;
+        size_t left = fan->len - fan->off;
+
+        if (left == 0) {
+            ssize_t r = read(fan->fd, fan->buf, KSYS_FAN_BUF);
+            if (r < 0) {
+                if (errno == EAGAIN || errno == EINTR)
+                    break;
+                return n ? (ssize_t)n : -1;
+            }
+            if (r == 0)
+                break;
+            fan->len = (size_t)r;
+            fan->off = 0;
+            continue;
+        }
+
+        md = (const struct fanotify_event_metadata *)(fan->buf + fan->off);
+        if (!FAN_EVENT_OK(md, left) || md->vers != FANOTIFY_METADATA_VERSION) {
+            // read 는 이벤트 단위로만 잘라 주므로 여기 오면 버퍼가 깨진 것
+            fan->len = fan->off = 0;
+            errno = EPROTO;
+            return n ? (ssize_t)n : -1;
+        }
+        n += ksys_fan_convert(fan, md, out + n);
+        fan->off += md->event_len;
+    }
+    fan->st.emitted += n;
+    return (ssize_t)n;
+}
@@ -0,0 +1,459 @@
+// lib/ksys_json.c
+// ksys 레코드 JSON 인코더. API 는 include/ksys/ksys_json.h
+//
+// 레코드 하나를 쓰기 전에 최악의 길이만큼 자리를 확보하고 (모자라면 flush), 그 뒤로는 검사 없이
+// 포인터만 밀면서 씀. 문자열은 16 바이트 단위로 통째로 저장하므로 확보량에 16 바이트 여유를 둠
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <ksys/ksys_json.h>
+
+// 문자열 하나가 최악으로 늘어나는 길이: 모두 \u00XX + 따옴표 2 + SSE2 저장 여유
+#define KSYS_JSON_STR_MAX(n)    (6 * (n) + 2 + 16)
+// ksys_event 하나의 최악 길이 (키/숫자 부분은 넉넉히 512)
+#define KSYS_JSON_REC_MAX       (KSYS_JSON_STR_MAX(KSYS_COMM_LEN) + KSYS_JSON_STR_MAX(KSYS_PATH_LEN) + 512)
+#define KSYS_JSON_BUF_MIN       (4 * KSYS_JSON_REC_MAX)
+
+#define PUT_LIT(p, s)   do { memcpy((p), (s), sizeof(s) - 1); (p) += sizeof(s) - 1; } while (0)
+
+// --- Integers ---
+
+static const char dig2[200] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// 뒤에서부터 두 자리씩 채운 뒤 한 번에 복사
+static char *put_u64(char *p, uint64_t v)
+{
+    char tmp[20];
+    char *t = tmp + sizeof(tmp);
+    size_t n;
+
+    while (v >= 100) {
+        unsigned int r = (unsigned int)(v % 100);
+        v /= 100;
+        t -= 2;
+        memcpy(t, &dig2[r * 2], 2);
+    }
+    if (v >= 10) {
+        t -= 2;
+        memcpy(t, &dig2[v * 2], 2);
+    } else {
+        *--t = (char)('0' + v);
+    }
+    n = (size_t)(tmp + sizeof(tmp) - t);
+    memcpy(p, t, n);
+    return p + n;
+}
+
+static char *put_s64(char *p, int64_t v)
+{
+    if (v < 0) {
+        *p++ = '-';
+        return put_u64(p, (uint64_t)0 - (uint64_t)v);
+    }
+    return put_u64(p, (uint64_t)v);
+}
+
+// --- Strings ---
+
+static const char hex[] = "0123456789abcdef";
+
+static char *put_esc(char *p, unsigned char c)
+{
+    *p++ = '\\';
+    switch (c) {
+        case '"':  *p++ = '"';  break;
+        case '\\': *p++ = '\\'; break;
+        case '\b': *p++ = 'b';  break;
+        case '\f': *p++ = 'f';  break;
+        case '\n': *p++ = 'n';  break;
+        case '\r': *p++ = 'r';  break;
+        case '\t': *p++ = 't';  break;
+        default:
+            PUT_LIT(p, "u00");
+            *p++ = hex[c >> 4];
+            *p++ = hex[c & 0xf];
+            break;
+    }
+    return p;
+}
+
+static inline int needs_esc(unsigned char c)
+{
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+// s 는 NUL 또는 max 바이트에서 끝남
+static char *put_str(char *p, const char *s, size_t max)
+{
+    size_t i = 0;
+
+    *p++ = '"';
+#ifdef __SSE2__
+    const __m128i ctl = _mm_set1_epi8(0x1f);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+
+    while (i + 16 <= max) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        // c <= 0x1f (NUL 포함) | '"' | '\\'
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, ctl), ctl),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)));
+        unsigned int bits = (unsigned int)_mm_movemask_epi8(m);
+        unsigned int k;
+
+        _mm_storeu_si128((__m128i *)p, v);     // 일단 16 바이트 다 쓰고 유효한 만큼만 전진
+        if (!bits) {
+            p += 16;
+            i += 16;
+            continue;
+        }
+        k = (unsigned int)__builtin_ctz(bits);
+        p += k;
+        i += k;
+        if (!s[i])
+            goto out;
+        p = put_esc(p, (unsigned char)s[i++]);
+    }
+#endif
+    for (; i < max && s[i]; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (needs_esc(c))
+            p = put_esc(p, c);
+        else
+            *p++ = (char)c;
+    }
+#ifdef __SSE2__
+out:
+#endif
+    *p++ = '"';
+    return p;
+}
+
+// --- Buffer ---
+
+int ksys_json_init(struct ksys_json *j, int fd, size_t cap)
+{
+    if (!cap)
+        cap = KSYS_JSON_BUF_DEFAULT;
+    if (cap < KSYS_JSON_BUF_MIN)
+        cap = KSYS_JSON_BUF_MIN;
+    j->buf = malloc(cap);
+    if (!j->buf)
+        return -1;
+    j->fd = fd;
+    j->len = 0;
+    j->cap = cap;
+    j->bytes = 0;
+    return 0;
+}
+
+void ksys_json_free(struct ksys_json *j)
+{
+    if (!j->buf)
+        return;
+    ksys_json_flush(j);
+    free(j->buf);
+    j->buf = NULL;
+}
+
+int ksys_json_flush(struct ksys_json *j)
+{
+    size_t off = 0;
+
+    if (j->fd < 0)
+        return 0;       // 메모리 모드: 호출한 쪽이 buf/len 을 가져감
+    while (off < j->len) {
+        ssize_t w = write(j->fd, j->buf + off, j->len - off);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            j->len = 0;         // 못 쓴 것은 버림 (다음 배치가 밀리지 않게)
+            return -1;
+        }
+        off += (size_t)w;
+    }
+    j->bytes += j->len;
+    j->len = 0;
+    return 0;
+}
+
+// 메모리 모드에서는 비우는 대신 버퍼를 늘림
+static int make_room(struct ksys_json *j, size_t n)
+{
+    size_t cap = j->cap;
+    char *buf;
+
+    if (j->fd >= 0)
+        return ksys_json_flush(j);
+    while (cap < j->len + n)
+        cap *= 2;
+    buf = realloc(j->buf, cap);
+    if (!buf)
+        return -1;
+    j->buf = buf;
+    j->cap = cap;
+    return 0;
+}
+
+// n 바이트를 쓸 자리를 확보하고 쓸 위치를 돌려줌. 실패 NULL
+static char *reserve(struct ksys_json *j, size_t n)
+{
+    if (j->len + n > j->cap && make_room(j, n) != 0)
+        return NULL;
+    return j->buf + j->len;
+}
+
+static void commit(struct ksys_json *j, char *end)
+{
+    j->len = (size_t)(end - j->buf);
+}
+
+// --- Records ---
+
+static char *put_event(char *p, const struct ksys_event *e)
+{
+    PUT_LIT(p, "{\"type\":\"openat\",\"seq\":");
+    p = put_u64(p, e->seq);
+    PUT_LIT(p, ",\"ts_ns\":");
+    p = put_u64(p, e->ts_ns);
+    PUT_LIT(p, ",\"pid\":");
+    p = put_s64(p, e->pid);
+    PUT_LIT(p, ",\"tgid\":");
+    p = put_s64(p, e->tgid);
+    PUT_LIT(p, ",\"dfd\":");
+    p = put_s64(p, e->dfd);
+    PUT_LIT(p, ",\"flags\":");
+    p = put_u64(p, (uint32_t)e->flags);
+    PUT_LIT(p, ",\"mode\":");
+    p = put_u64(p, e->mode);
+    PUT_LIT(p, ",\"comm\":");
+    p = put_str(p, e->comm, sizeof(e->comm));
+    PUT_LIT(p, ",\"path\":");
+    p = put_str(p, e->path, sizeof(e->path));
+    if (e->type == KSYS_REC_OPENAT_RET) {
+        PUT_LIT(p, ",\"ret\":");
+        p = put_s64(p, e->ret);
+        PUT_LIT(p, ",\"dev\":");
+        p = put_u64(p, e->dev);
+        PUT_LIT(p, ",\"ino\":");
+        p = put_u64(p, e->ino);
+        PUT_LIT(p, ",\"gen\":");
+        p = put_u64(p, e->gen);
+    }
+    PUT_LIT(p, "}\n");
+    return p;
+}
+
+static char *put_gap(char *p, const struct ksys_gap *g)
+{
+    PUT_LIT(p, "{\"type\":\"gap\",\"seq\":");
+    p = put_u64(p, g->seq);
+    PUT_LIT(p, ",\"ts_ns\":");
+    p = put_u64(p, g->ts_ns);
+    PUT_LIT(p, ",\"lost_from_seq\":");
+    p = put_u64(p, g->lost_from_seq);
+    PUT_LIT(p, ",\"lost_to_seq\":");
+    p = put_u64(p, g->lost_to_seq);
+    PUT_LIT(p, ",\"count\":");
+    p = put_u64(p, g->count);
+    PUT_LIT(p, "}\n");
+    return p;
+}
+
+static char *put_proc(char *p, const struct ksys_event *e)
+{
+    PUT_LIT(p, "{\"type\":\"");
+    if (e->type == KSYS_REC_FORK)
+        PUT_LIT(p, "fork");
+    else if (e->type == KSYS_REC_EXEC)
+        PUT_LIT(p, "exec");
+    else
+        PUT_LIT(p, "exit");
+    PUT_LIT(p, "\",\"seq\":");
+    p = put_u64(p, e->seq);
+    PUT_LIT(p, ",\"ts_ns\":");
+    p = put_u64(p, e->ts_ns);
+    PUT_LIT(p, ",\"pid\":");
+    p = put_s64(p, e->pid);
+    PUT_LIT(p, ",\"tgid\":");
+    p = put_s64(p, e->tgid);
+    if (e->type == KSYS_REC_FORK) {
+        PUT_LIT(p, ",\"ppid\":");
+        p = put_s64(p, e->ppid);
+        PUT_LIT(p, ",\"ptgid\":");
+        p = put_s64(p, e->ptgid);
+    }
+    if (e->type == KSYS_REC_EXIT) {
+        PUT_LIT(p, ",\"exit_code\":");
+        p = put_s64(p, e->exit_code);
+        if (e->group_dead)
+            PUT_LIT(p, ",\"group_dead\":true");
+        else
+            PUT_LIT(p, ",\"group_dead\":false");
+    }
+    PUT_LIT(p, ",\"comm\":");
+    p = put_str(p, e->comm, sizeof(e->comm));
+    if (e->type == KSYS_REC_EXEC) {
+        PUT_LIT(p, ",\"path\":");
+        p = put_str(p, e->path, sizeof(e->path));
+    }
+    PUT_LIT(p, "}\n");
+    return p;
+}
+
+int ksys_json_records(struct ksys_json *j, const struct ksys_event *ev, size_t n)
+{
+    for (size_t k = 0; k < n; k++) {
+        const struct ksys_event *e = &ev[k];
+        char *p = reserve(j, KSYS_JSON_REC_MAX);
+
+        if (!p)
+            return -1;
+        if (e->type == KSYS_REC_GAP)
+            p = put_gap(p, (const struct ksys_gap *)e);
+        else if (e->type >= KSYS_REC_FORK && e->type <= KSYS_REC_EXIT)
+            p = put_proc(p, e);
+        else
+            p = put_event(p, e);
+        commit(j, p);
+    }
+    return 0;
+}
+
+static uint64_t get_u64(const uint8_t **p) { uint64_t v; memcpy(&v, *p, 8); *p += 8; return v; }
+static int32_t  get_s32(const uint8_t **p) { int32_t v;  memcpy(&v, *p, 4); *p += 4; return v; }
+
+int ksys_json_packed(struct ksys_json *j, const struct ksys_rec_hdr *h)
+{
+    static const char *const names[] = { "openat", "gap", "openat", "fork", "exec", "exit" };
+    const uint8_t *s = (const uint8_t *)(h + 1);
+    uint32_t f = h->fields;
+    char *p = reserve(j, KSYS_JSON_REC_MAX);
+
+    if (!p)
+        return -1;
+    if (h->type == KSYS_REC_GAP) {
+        PUT_LIT(p, "{\"type\":\"gap\",\"lost_from_seq\":");
+        p = put_u64(p, get_u64(&s));
+        PUT_LIT(p, ",\"lost_to_seq\":");
+        p = put_u64(p, get_u64(&s));
+        PUT_LIT(p, ",\"count\":");
+        p = put_u64(p, get_u64(&s));
+        PUT_LIT(p, "}\n");
+        commit(j, p);
+        return 0;
+    }
+
+    const char *name = h->type < 6 ? names[h->type] : "unknown";
+    size_t nl = strlen(name);
+
+    PUT_LIT(p, "{\"type\":\"");
+    memcpy(p, name, nl);
+    p += nl;
+    *p++ = '"';
+    if (f & KSYS_FIELD_SEQ)   { PUT_LIT(p, ",\"seq\":");   p = put_u64(p, get_u64(&s)); }
+    if (f & KSYS_FIELD_TS)    { PUT_LIT(p, ",\"ts_ns\":"); p = put_u64(p, get_u64(&s)); }
+    if (f & KSYS_FIELD_INO)   { PUT_LIT(p, ",\"ino\":");   p = put_u64(p, get_u64(&s)); }
+    if (f & KSYS_FIELD_PID)   { PUT_LIT(p, ",\"pid\":");   p = put_s64(p, get_s32(&s)); }
+    if (f & KSYS_FIELD_TGID)  { PUT_LIT(p, ",\"tgid\":");  p = put_s64(p, get_s32(&s)); }
+    if (f & KSYS_FIELD_DFD)   { PUT_LIT(p, ",\"dfd\":");   p = put_s64(p, get_s32(&s)); }
+    if (f & KSYS_FIELD_FLAGS) { PUT_LIT(p, ",\"flags\":"); p = put_u64(p, (uint32_t)get_s32(&s)); }
+    if (f & KSYS_FIELD_MODE)  { PUT_LIT(p, ",\"mode\":");  p = put_u64(p, (uint32_t)get_s32(&s)); }
+    if (f & KSYS_FIELD_RET)   { PUT_LIT(p, ",\"ret\":");   p = put_s64(p, get_s32(&s)); }
+    if (f & KSYS_FIELD_DEV)   { PUT_LIT(p, ",\"dev\":");   p = put_u64(p, (uint32_t)get_s32(&s)); }
+    if (f & KSYS_FIELD_GEN)   { PUT_LIT(p, ",\"gen\":");   p = put_u64(p, (uint32_t)get_s32(&s)); }
+    if (f & KSYS_FIELD_COMM) {
+        PUT_LIT(p, ",\"comm\":");
+        p = put_str(p, (const char *)s, KSYS_COMM_LEN);
+        s += KSYS_COMM_LEN;
+    }
+    if (f & KSYS_FIELD_PATH) {
+        size_t left = (size_t)((const uint8_t *)h + h->len - s);
+        PUT_LIT(p, ",\"path\":");
+        // 경로는 KSYS_PATH_LEN 을 넘지 않음 (확보량 계산도 그 기준)
+        p = put_str(p, (const char *)s, left < KSYS_PATH_LEN ? left : KSYS_PATH_LEN);
+    }
+    PUT_LIT(p, "}\n");
+    commit(j, p);
+    return 0;
+}
+
+long ksys_json_buf(struct ksys_json *j, const void *buf, size_t bytes, bool packed)
+{
+    long cnt = 0;
+
+    if (!packed) {
+        size_t n = bytes / sizeof(struct ksys_event);
+        return ksys_json_records(j, buf, n) == 0 ? (long)n : -1;
+    }
+    for (size_t off = 0; off + sizeof(struct ksys_rec_hdr) <= bytes; cnt++) {
+        const struct ksys_rec_hdr *h = (const struct ksys_rec_hdr *)((const uint8_t *)buf + off);
+        if (h->len < sizeof(*h))
+            break;
+        if (ksys_json_packed(j, h) != 0)
+            return -1;
+        off += h->len;
+    }
+    return cnt;
+}
+
+// --- Misc Lines ---
+
+int ksys_json_stats(struct ksys_json *j, const struct ksys_stats *st)
+{
+    char *p = reserve(j, 256);
+
+    if (!p)
+        return -1;
+    PUT_LIT(p, "{\"type\":\"stats\",\"cur_seq\":");
+    p = put_u64(p, st->cur_seq);
+    PUT_LIT(p, ",\"drops\":");
+    p = put_u64(p, st->drops);
+    PUT_LIT(p, ",\"ring_size\":");
+    p = put_u64(p, st->ring_size);
+    PUT_LIT(p, ",\"ring_node\":");
+    p = put_s64(p, st->ring_node);
+    PUT_LIT(p, "}\n");
+    commit(j, p);
+    return 0;
+}
+
+int ksys_json_printf(struct ksys_json *j, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    for (int tries = 0; tries < 2; tries++) {
+        size_t room = j->cap - j->len;
+
+        va_start(ap, fmt);
+        n = vsnprintf(j->buf + j->len, room, fmt, ap);
+        va_end(ap);
+        if (n < 0)
+            return -1;
+        if ((size_t)n < room) {
+            j->len += (size_t)n;
+            return 0;
+        }
+        // 안 들어가면 비우고 (메모리 모드면 늘리고) 한 번 더
+        if (make_room(j, (size_t)n + 1) != 0)
+            return -1;
+    }
+    errno = ENOSPC;
+    return -1;
+}
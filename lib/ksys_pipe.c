@@ -0,0 +1,607 @@
+// lib/ksys_pipe.c
+// 캡처 파이프라인. 구조는 include/ksys/ksys_pipe.h
+//
+// 큐는 슬롯 포인터만 오가는 고정 크기 링 (락 없음). 비었을 때만 futex 로 잠들고, 넣는 쪽은
+// 잠든 소비자가 있을 때만 깨움. 슬롯 수보다 많이 들어갈 일이 없으므로 가득 참 처리는 없음
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys_pipe.h>
+
+#define PIPE_CACHELINE  64
+#define PIPE_IOV_MAX    16      // writer 가 한 번에 묶는 배치 수
+#define PIPE_ENC_MAX    16
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// --- Park ---
+
+// 소비자 하나가 잠드는 자리. seq 는 넣을 때마다 올라감
+struct park {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t sleepers;
+};
+
+static void park_wake(struct park *pk)
+{
+    atomic_fetch_add(&pk->seq, 1);
+    if (atomic_load(&pk->sleepers))
+        syscall(SYS_futex, &pk->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+// 잠들기 직전 seq 를 돌려줌. 이걸 받은 뒤 조건을 다시 보고 park_sleep
+static uint32_t park_prepare(struct park *pk)
+{
+    atomic_fetch_add(&pk->sleepers, 1);
+    return atomic_load(&pk->seq);
+}
+
+// timeout 이 있으면 그만큼만 (상대 시간)
+static void park_sleep(struct park *pk, uint32_t seq, bool sleep, const struct timespec *timeout)
+{
+    if (sleep)
+        syscall(SYS_futex, &pk->seq, FUTEX_WAIT_PRIVATE, seq, timeout, NULL, 0);
+    atomic_fetch_sub(&pk->sleepers, 1);
+}
+
+// --- Queues ---
+
+struct slot {
+    __u64 id;                   // 배치 번호 (reader 가 0 부터)
+    size_t n;
+    struct ksys_event *ev;
+    struct ksys_pipe_buf out;
+};
+
+struct spsc {
+    _Alignas(PIPE_CACHELINE) _Atomic size_t head;  // 소비자
+    _Alignas(PIPE_CACHELINE) _Atomic size_t tail;  // 생산자
+    _Alignas(PIPE_CACHELINE) struct park park;
+    struct slot **q;
+    size_t mask;
+};
+
+static void spsc_push(struct spsc *s, struct slot *sl)
+{
+    size_t t = atomic_load_explicit(&s->tail, memory_order_relaxed);
+
+    s->q[t & s->mask] = sl;
+    atomic_store_explicit(&s->tail, t + 1, memory_order_release);
+    park_wake(&s->park);
+}
+
+static struct slot *spsc_pop(struct spsc *s)
+{
+    size_t h = atomic_load_explicit(&s->head, memory_order_relaxed);
+    struct slot *sl;
+
+    if (h == atomic_load_explicit(&s->tail, memory_order_acquire))
+        return NULL;
+    sl = s->q[h & s->mask];
+    atomic_store_explicit(&s->head, h + 1, memory_order_release);
+    return sl;
+}
+
+static size_t spsc_depth(const struct spsc *s)
+{
+    return atomic_load_explicit(&s->tail, memory_order_relaxed) -
+           atomic_load_explicit(&s->head, memory_order_relaxed);
+}
+
+// 생산자 여럿 / 소비자 하나. 칸마다 순번을 두는 방식 (칸의 seq == pos 면 빈칸, pos + 1 이면 찬 칸)
+struct mpsc_cell {
+    _Atomic size_t seq;
+    struct slot *sl;
+};
+
+struct mpsc {
+    _Alignas(PIPE_CACHELINE) _Atomic size_t enq;
+    _Alignas(PIPE_CACHELINE) _Atomic size_t deq;   // 소비자만 씀 (깊이 보려고 atomic)
+    _Alignas(PIPE_CACHELINE) struct park park;
+    struct mpsc_cell *cells;
+    size_t mask;
+};
+
+static void mpsc_push(struct mpsc *m, struct slot *sl)
+{
+    size_t pos = atomic_load_explicit(&m->enq, memory_order_relaxed);
+    struct mpsc_cell *c;
+
+    for (;;) {
+        intptr_t dif;
+
+        c = &m->cells[pos & m->mask];
+        dif = (intptr_t)atomic_load_explicit(&c->seq, memory_order_acquire) - (intptr_t)pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&m->enq, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        } else {
+            pos = atomic_load_explicit(&m->enq, memory_order_relaxed);
+        }
+    }
+    c->sl = sl;
+    atomic_store_explicit(&c->seq, pos + 1, memory_order_release);
+    park_wake(&m->park);
+}
+
+static struct slot *mpsc_pop(struct mpsc *m)
+{
+    size_t pos = atomic_load_explicit(&m->deq, memory_order_relaxed);
+    struct mpsc_cell *c = &m->cells[pos & m->mask];
+    struct slot *sl;
+
+    if (atomic_load_explicit(&c->seq, memory_order_acquire) != pos + 1)
+        return NULL;
+    sl = c->sl;
+    atomic_store_explicit(&c->seq, pos + m->mask + 1, memory_order_release);
+    atomic_store_explicit(&m->deq, pos + 1, memory_order_relaxed);
+    return sl;
+}
+
+static size_t mpsc_depth(const struct mpsc *m)
+{
+    size_t e = atomic_load_explicit(&m->enq, memory_order_relaxed);
+    size_t d = atomic_load_explicit(&m->deq, memory_order_relaxed);
+
+    return e > d ? e - d : 0;
+}
+
+// --- Pipeline ---
+
+struct encoder {
+    struct ksys_pipe *p;
+    struct spsc work;
+    pthread_t th;
+};
+
+struct ksys_pipe {
+    struct ksys *k;
+    struct ksys_pipe_opts o;
+    unsigned int nslots;
+    struct slot *slots;
+    struct spsc free;           // writer -> reader
+    struct mpsc done;           // 인코더 (raw 면 reader) -> writer
+    struct encoder *enc;
+    struct slot **pending;      // writer 의 순서 맞추기 (배치 번호 % nslots)
+    pthread_t reader, writer;
+
+    _Atomic int stop;
+    _Atomic int reader_done;
+    _Atomic __u64 nbatches;     // reader 가 만든 배치 수 (reader_done 뒤에는 최종값)
+    _Atomic int err;
+
+    // 통계 (쓰는 스레드는 하나씩, encode_ns 만 여럿)
+    _Atomic __u64 st_batches, st_events, st_bytes, st_drops;
+    _Atomic __u64 st_stall_ns, st_encode_ns, st_write_ns, st_wait_ns;
+    _Atomic __u32 st_reorder, st_work_max, st_done_max, st_reorder_max;
+};
+
+static void pipe_fail(struct ksys_pipe *p, int err)
+{
+    int zero = 0;
+
+    atomic_compare_exchange_strong(&p->err, &zero, err ? err : EIO);
+    atomic_store(&p->stop, 1);
+}
+
+static void stat_max(_Atomic __u32 *m, size_t v)
+{
+    if (v > atomic_load_explicit(m, memory_order_relaxed))
+        atomic_store_explicit(m, (__u32)v, memory_order_relaxed);
+}
+
+static void stat_add(_Atomic __u64 *c, __u64 v)
+{
+    atomic_fetch_add_explicit(c, v, memory_order_relaxed);
+}
+
+// 빈 슬롯 하나. 멈추라고 했으면 NULL
+static struct slot *get_free(struct ksys_pipe *p)
+{
+    struct slot *sl = spsc_pop(&p->free);
+    uint64_t t0;
+
+    if (sl)
+        return sl;
+    t0 = now_ns();
+    while (!(sl = spsc_pop(&p->free))) {
+        uint32_t seq;
+
+        if (atomic_load(&p->stop))
+            break;
+        seq = park_prepare(&p->free.park);
+        sl = spsc_pop(&p->free);
+        park_sleep(&p->free.park, seq, !sl && !atomic_load(&p->stop), NULL);
+        if (sl)
+            break;
+    }
+    stat_add(&p->st_stall_ns, now_ns() - t0);
+    return sl;
+}
+
+static void dispatch(struct ksys_pipe *p, struct slot *sl)
+{
+    struct encoder *best;
+
+    if (!p->o.encode) {
+        mpsc_push(&p->done, sl);
+        stat_max(&p->st_done_max, mpsc_depth(&p->done));
+        return;
+    }
+    // 가장 덜 밀린 인코더로
+    best = &p->enc[0];
+    for (unsigned int i = 1; i < p->o.encoders && spsc_depth(&best->work); i++) {
+        if (spsc_depth(&p->enc[i].work) < spsc_depth(&best->work))
+            best = &p->enc[i];
+    }
+    spsc_push(&best->work, sl);
+    stat_max(&p->st_work_max, spsc_depth(&best->work));
+}
+
+static void *reader_main(void *arg)
+{
+    struct ksys_pipe *p = arg;
+    __u64 id = 0;
+
+    while (!atomic_load(&p->stop)) {
+        struct ksys_batch b;
+
+        // 멈춤을 보려고 100ms 마다 깨어남
+        if (ksys_next_batch(p->k, 100, &b) != 0) {
+            if (errno == EINTR)
+                continue;
+            pipe_fail(p, errno);
+            break;
+        }
+        atomic_store_explicit(&p->st_drops, b.drops, memory_order_relaxed);
+        // 슬롯보다 큰 배치는 나눠서
+        for (size_t off = 0; off < b.n;) {
+            struct slot *sl = get_free(p);
+            size_t n = b.n - off < p->o.batch ? b.n - off : p->o.batch;
+
+            if (!sl)
+                break;
+            memcpy(sl->ev, b.ev + off, n * sizeof(*sl->ev));
+            sl->n = n;
+            sl->id = id++;
+            sl->out.len = 0;
+            dispatch(p, sl);
+            off += n;
+        }
+    }
+    atomic_store(&p->nbatches, id);
+    atomic_store(&p->reader_done, 1);
+    for (unsigned int i = 0; i < p->o.encoders; i++)
+        park_wake(&p->enc[i].work.park);
+    park_wake(&p->done.park);
+    return NULL;
+}
+
+static void *encoder_main(void *arg)
+{
+    struct encoder *e = arg;
+    struct ksys_pipe *p = e->p;
+
+    for (;;) {
+        struct slot *sl = spsc_pop(&e->work);
+        uint64_t t0;
+
+        if (!sl) {
+            uint32_t seq = park_prepare(&e->work.park);
+            bool done = atomic_load(&p->reader_done);
+
+            sl = spsc_pop(&e->work);
+            park_sleep(&e->work.park, seq, !sl && !done, NULL);
+            if (!sl) {
+                if (done)
+                    break;
+                continue;
+            }
+        }
+        t0 = now_ns();
+        // 실패한 뒤에도 슬롯은 writer 로 보내서 순서가 막히지 않게 (출력은 비움)
+        if (!atomic_load(&p->err) && p->o.encode(p->o.arg, sl->ev, sl->n, &sl->out) != 0) {
+            pipe_fail(p, errno);
+            sl->out.len = 0;
+        }
+        stat_add(&p->st_encode_ns, now_ns() - t0);
+        mpsc_push(&p->done, sl);
+        stat_max(&p->st_done_max, mpsc_depth(&p->done));
+    }
+    return NULL;
+}
+
+static void *writer_main(void *arg)
+{
+    struct ksys_pipe *p = arg;
+    struct slot **pending = p->pending;
+    uint64_t idle_ns = (uint64_t)p->o.idle_ms * 1000000ull, last = now_ns();
+    struct timespec idle_ts = { p->o.idle_ms / 1000, (long)(p->o.idle_ms % 1000) * 1000000 };
+    __u64 next = 0;
+    size_t held = 0;
+
+    for (;;) {
+        struct iovec iov[PIPE_IOV_MAX];
+        struct slot *batch[PIPE_IOV_MAX];
+        struct slot *sl;
+        int cnt = 0;
+
+        while ((sl = mpsc_pop(&p->done))) {
+            pending[sl->id % p->nslots] = sl;
+            held++;
+        }
+        stat_max(&p->st_reorder_max, held);
+        atomic_store_explicit(&p->st_reorder, (__u32)held, memory_order_relaxed);
+
+        // 순서가 맞는 것부터 이어서
+        while (cnt < PIPE_IOV_MAX && (sl = pending[next % p->nslots]) && sl->id == next) {
+            pending[next % p->nslots] = NULL;
+            held--;
+            batch[cnt] = sl;
+            if (p->o.encode) {
+                iov[cnt].iov_base = sl->out.buf;
+                iov[cnt].iov_len = sl->out.len;
+            } else {
+                iov[cnt].iov_base = sl->ev;
+                iov[cnt].iov_len = sl->n * sizeof(*sl->ev);
+            }
+            cnt++;
+            next++;
+        }
+
+        if (cnt) {
+            uint64_t t0 = now_ns();
+            size_t bytes = 0, events = 0;
+
+            for (int i = 0; i < cnt; i++) {
+                bytes += iov[i].iov_len;
+                events += batch[i]->n;
+            }
+            if (!atomic_load(&p->err) && p->o.write(p->o.arg, iov, cnt) != 0)
+                pipe_fail(p, errno);
+            stat_add(&p->st_write_ns, now_ns() - t0);
+            stat_add(&p->st_batches, (__u64)cnt);
+            stat_add(&p->st_events, events);
+            stat_add(&p->st_bytes, bytes);
+            for (int i = 0; i < cnt; i++)
+                spsc_push(&p->free, batch[i]);
+            last = now_ns();
+            continue;
+        }
+
+        // 조용하면 idle 콜백 (모아 둔 출력 내보내기, 시간 기준 회전 등)
+        if (p->o.idle && now_ns() - last >= idle_ns) {
+            if (!atomic_load(&p->err) && p->o.idle(p->o.arg) != 0)
+                pipe_fail(p, errno);
+            last = now_ns();
+        }
+
+        // reader 가 끝났고 만든 배치를 다 썼으면 끝
+        if (atomic_load(&p->reader_done) && next == atomic_load(&p->nbatches))
+            break;
+        {
+            uint64_t t0 = now_ns();
+            uint32_t seq = park_prepare(&p->done.park);
+            bool finished = atomic_load(&p->reader_done) && next == atomic_load(&p->nbatches);
+
+            park_sleep(&p->done.park, seq, !finished && !mpsc_depth(&p->done), p->o.idle ? &idle_ts : NULL);
+            stat_add(&p->st_wait_ns, now_ns() - t0);
+        }
+    }
+    return NULL;
+}
+
+// --- API ---
+
+void ksys_pipe_opts_init(struct ksys_pipe_opts *o)
+{
+    memset(o, 0, sizeof(*o));
+}
+
+static size_t pow2_at_least(size_t n)
+{
+    size_t v = 1;
+
+    while (v < n)
+        v <<= 1;
+    return v;
+}
+
+static void pipe_free(struct ksys_pipe *p)
+{
+    if (p->slots) {
+        for (unsigned int i = 0; i < p->nslots; i++) {
+            free(p->slots[i].ev);
+            free(p->slots[i].out.buf);
+        }
+    }
+    if (p->enc) {
+        for (unsigned int i = 0; i < p->o.encoders; i++)
+            free(p->enc[i].work.q);
+    }
+    free(p->slots);
+    free(p->pending);
+    free(p->enc);
+    free(p->free.q);
+    free(p->done.cells);
+    free(p);
+}
+
+struct ksys_pipe *ksys_pipe_start(struct ksys *k, const struct ksys_pipe_opts *o)
+{
+    struct ksys_pipe *p;
+    sigset_t all, old;
+    size_t qcap;
+    unsigned int started = 0;
+    int err = 0;
+
+    if (!o->write) {
+        errno = EINVAL;
+        return NULL;
+    }
+    p = calloc(1, sizeof(*p));
+    if (!p)
+        return NULL;
+    p->k = k;
+    p->o = *o;
+    if (!p->o.encoders) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        p->o.encoders = cpus > 3 ? (unsigned int)cpus - 2 : 1;
+    }
+    if (p->o.encoders > PIPE_ENC_MAX)
+        p->o.encoders = PIPE_ENC_MAX;
+    if (!p->o.encode)
+        p->o.encoders = 0;      // raw: 인코더 없이 reader -> writer
+    if (!p->o.slots)
+        p->o.slots = p->o.encoders * 4 + 4;
+    if (!p->o.batch)
+        p->o.batch = 1024;
+    if (!p->o.out_cap)
+        p->o.out_cap = 256 * 1024;
+    if (!p->o.idle_ms)
+        p->o.idle_ms = 1000;
+    p->nslots = p->o.slots;
+    qcap = pow2_at_least(p->nslots);
+
+    p->slots = calloc(p->nslots, sizeof(*p->slots));
+    p->free.q = calloc(qcap, sizeof(*p->free.q));
+    p->done.cells = calloc(qcap, sizeof(*p->done.cells));
+    p->enc = calloc(p->o.encoders ? p->o.encoders : 1, sizeof(*p->enc));
+    p->pending = calloc(p->nslots, sizeof(*p->pending));
+    if (!p->slots || !p->free.q || !p->done.cells || !p->enc || !p->pending)
+        goto fail;
+    p->free.mask = p->done.mask = qcap - 1;
+    for (size_t i = 0; i < qcap; i++)
+        atomic_init(&p->done.cells[i].seq, i);
+    for (unsigned int i = 0; i < p->o.encoders; i++) {
+        p->enc[i].p = p;
+        p->enc[i].work.q = calloc(qcap, sizeof(*p->enc[i].work.q));
+        p->enc[i].work.mask = qcap - 1;
+        if (!p->enc[i].work.q)
+            goto fail;
+    }
+    for (unsigned int i = 0; i < p->nslots; i++) {
+        struct slot *sl = &p->slots[i];
+
+        sl->ev = malloc(p->o.batch * sizeof(*sl->ev));
+        if (p->o.encode) {
+            sl->out.buf = malloc(p->o.out_cap);
+            sl->out.cap = p->o.out_cap;
+            if (!sl->out.buf)
+                goto fail;
+        }
+        if (!sl->ev)
+            goto fail;
+        spsc_push(&p->free, sl);
+    }
+
+    // 시그널은 부른 스레드가 받게
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (; started < p->o.encoders; started++) {
+        err = pthread_create(&p->enc[started].th, NULL, encoder_main, &p->enc[started]);
+        if (err)
+            break;
+    }
+    if (!err)
+        err = pthread_create(&p->writer, NULL, writer_main, p);
+    if (!err) {
+        err = pthread_create(&p->reader, NULL, reader_main, p);
+        if (err) {
+            // writer 는 reader_done 을 보고 끝남
+            atomic_store(&p->reader_done, 1);
+            park_wake(&p->done.park);
+            pthread_join(p->writer, NULL);
+        }
+    } else {
+        atomic_store(&p->reader_done, 1);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (err) {
+        for (unsigned int i = 0; i < started; i++) {
+            park_wake(&p->enc[i].work.park);
+            pthread_join(p->enc[i].th, NULL);
+        }
+        pipe_free(p);
+        errno = err;
+        return NULL;
+    }
+    return p;
+
+fail:
+    err = errno;
+    pipe_free(p);
+    errno = err;
+    return NULL;
+}
+
+int ksys_pipe_stop(struct ksys_pipe *p, struct ksys_pipe_stats *st)
+{
+    int err;
+
+    atomic_store(&p->stop, 1);
+    park_wake(&p->free.park);
+    pthread_join(p->reader, NULL);
+    for (unsigned int i = 0; i < p->o.encoders; i++)
+        pthread_join(p->enc[i].th, NULL);
+    pthread_join(p->writer, NULL);
+    if (st)
+        ksys_pipe_stats(p, st);
+    err = atomic_load(&p->err);
+    pipe_free(p);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+int ksys_pipe_error(const struct ksys_pipe *p)
+{
+    return atomic_load(&p->err);
+}
+
+void ksys_pipe_stats(const struct ksys_pipe *p, struct ksys_pipe_stats *st)
+{
+    struct ksys_pipe *q = (struct ksys_pipe *)p;  // atomic load 는 const 를 못 받음
+    size_t work = 0;
+
+    memset(st, 0, sizeof(*st));
+    st->batches = atomic_load_explicit(&q->st_batches, memory_order_relaxed);
+    st->events = atomic_load_explicit(&q->st_events, memory_order_relaxed);
+    st->bytes = atomic_load_explicit(&q->st_bytes, memory_order_relaxed);
+    st->drops = atomic_load_explicit(&q->st_drops, memory_order_relaxed);
+    st->reader_stall_ns = atomic_load_explicit(&q->st_stall_ns, memory_order_relaxed);
+    st->encode_ns = atomic_load_explicit(&q->st_encode_ns, memory_order_relaxed);
+    st->write_ns = atomic_load_explicit(&q->st_write_ns, memory_order_relaxed);
+    st->writer_wait_ns = atomic_load_explicit(&q->st_wait_ns, memory_order_relaxed);
+    st->encoders = p->o.encoders;
+    st->slots = p->nslots;
+    st->free_depth = (__u32)spsc_depth(&p->free);
+    for (unsigned int i = 0; i < p->o.encoders; i++)
+        work += spsc_depth(&p->enc[i].work);
+    st->work_depth = (__u32)work;
+    st->done_depth = (__u32)mpsc_depth(&p->done);
+    st->reorder_depth = atomic_load_explicit(&q->st_reorder, memory_order_relaxed);
+    st->work_depth_max = atomic_load_explicit(&q->st_work_max, memory_order_relaxed);
+    st->done_depth_max = atomic_load_explicit(&q->st_done_max, memory_order_relaxed);
+    st->reorder_depth_max = atomic_load_explicit(&q->st_reorder_max, memory_order_relaxed);
+}
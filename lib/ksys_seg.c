@@ -0,0 +1,854 @@
+// lib/ksys_seg.c
+// 열 단위 세그먼트 파일 쓰기/읽기. 형식 설명은 include/ksys/ksys_seg.h
+//
+// 쓰는 쪽은 레코드를 block_rows 개 모은 뒤 열마다 인코딩해서 블록 하나를 write 한 번으로 냄.
+// 블록 하나의 최악 길이를 미리 잡아 두고 인코딩 중에는 길이 검사를 하지 않음.
+// 읽는 쪽은 파일을 mmap 하고, 파일 내용은 믿지 않으므로 모든 읽기에서 범위를 확인함
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ksys/ksys_seg.h>
+
+// 행 하나가 최악으로 차지하는 바이트 (varint 10 x 9, 사전 항목 2 개, bitpack 5 개, gap 3 varint)
+#define SEG_ROW_MAX     (10 * 9 + (10 + KSYS_COMM_LEN + 4) + (10 + KSYS_PATH_LEN + 4) + 5 * 4 + 30)
+// 열마다 bitpack 폭 바이트 / 사전 개수 varint 같은 머리
+#define SEG_BLK_SLACK   (sizeof(struct ksys_seg_blk_hdr) + sizeof(struct ksys_seg_footer) + 16 * KSYS_SEG_NCOLS)
+
+static inline bool is_gap(const struct ksys_event *e)
+{
+    return e->type == KSYS_REC_GAP;
+}
+
+// --- Varint / Bitpack ---
+
+static inline uint64_t zz(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzz(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline uint8_t *put_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+// 폭은 최대값에 맞춤 (0 이면 값 없이 폭 바이트만). 값은 32 비트까지
+static uint8_t *put_bits(uint8_t *p, const uint32_t *v, size_t n)
+{
+    uint32_t any = 0;
+    uint64_t acc = 0;
+    unsigned int w, nb = 0;
+
+    for (size_t i = 0; i < n; i++)
+        any |= v[i];
+    w = any ? 32 - (unsigned int)__builtin_clz(any) : 0;
+    *p++ = (uint8_t)w;
+    if (!w)
+        return p;
+    for (size_t i = 0; i < n; i++) {
+        acc |= (uint64_t)v[i] << nb;
+        nb += w;
+        while (nb >= 8) {
+            *p++ = (uint8_t)acc;
+            acc >>= 8;
+            nb -= 8;
+        }
+    }
+    if (nb)
+        *p++ = (uint8_t)acc;
+    return p;
+}
+
+struct cur {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool bad;
+};
+
+static uint64_t get_varint(struct cur *c)
+{
+    uint64_t v = 0;
+
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        uint8_t b;
+
+        if (c->p >= c->end)
+            break;
+        b = *c->p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+    c->bad = true;
+    return 0;
+}
+
+static void get_bits(struct cur *c, uint32_t *out, size_t n)
+{
+    uint64_t acc = 0;
+    unsigned int w, nb = 0;
+    uint32_t mask;
+
+    if (c->p >= c->end || *c->p > 32) {
+        c->bad = true;
+        return;
+    }
+    w = *c->p++;
+    if (!w) {
+        memset(out, 0, n * sizeof(*out));
+        return;
+    }
+    if ((size_t)(c->end - c->p) < (n * w + 7) / 8) {
+        c->bad = true;
+        return;
+    }
+    mask = w == 32 ? ~0u : (1u << w) - 1;
+    for (size_t i = 0; i < n; i++) {
+        while (nb < w) {
+            acc |= (uint64_t)*c->p++ << nb;
+            nb += 8;
+        }
+        out[i] = (uint32_t)acc & mask;
+        acc >>= w;
+        nb -= w;
+    }
+}
+
+// --- Writer ---
+
+struct ksys_seg_writer {
+    int fd;
+    __u32 block_rows;
+    struct ksys_event *rows;    // 모으는 중인 블록
+    __u32 n;
+    uint32_t *tmp;              // 열 하나 분량 (bitpack/사전 번호)
+
+    // 블록 사전 (comm/path 를 번갈아 씀). slots 는 번호 + 1, 0 이면 빈칸
+    uint32_t *slots;
+    uint32_t slot_mask;
+    const char **dstr;
+    uint8_t *dlen;
+
+    uint8_t *out;               // 인코딩한 블록
+    __u64 *index;               // 블록 오프셋
+    __u32 index_cap;
+    __u64 off;                  // 파일 끝
+    struct ksys_seg_wstats st;
+};
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+
+    while (len) {
+        ssize_t r = write(fd, p, len);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += r;
+        len -= (size_t)r;
+    }
+    return 0;
+}
+
+struct ksys_seg_writer *ksys_seg_writer_open(const char *path, __u32 block_rows)
+{
+    struct ksys_seg_writer *w;
+    struct ksys_seg_file_hdr h;
+    uint32_t slots = 1;
+
+    if (!block_rows)
+        block_rows = KSYS_SEG_BLOCK_ROWS;
+    if (block_rows > KSYS_SEG_BLOCK_ROWS_MAX) {
+        errno = EINVAL;
+        return NULL;
+    }
+    while (slots < 2 * block_rows)
+        slots <<= 1;
+
+    w = calloc(1, sizeof(*w));
+    if (!w)
+        return NULL;
+    w->fd = -1;
+    w->block_rows = block_rows;
+    w->slot_mask = slots - 1;
+    w->rows = malloc(block_rows * sizeof(*w->rows));
+    w->tmp = malloc(block_rows * sizeof(*w->tmp));
+    w->slots = malloc(slots * sizeof(*w->slots));
+    w->dstr = malloc(block_rows * sizeof(*w->dstr));
+    w->dlen = malloc(block_rows);
+    w->out = malloc(block_rows * SEG_ROW_MAX + SEG_BLK_SLACK);
+    if (!w->rows || !w->tmp || !w->slots || !w->dstr || !w->dlen || !w->out)
+        goto fail;
+
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (w->fd < 0)
+        goto fail;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, KSYS_SEG_MAGIC, sizeof(h.magic));
+    h.version = KSYS_SEG_VERSION;
+    h.ncols = KSYS_SEG_NCOLS;
+    h.block_rows = block_rows;
+    h.rec_size = sizeof(struct ksys_event);
+    if (write_all(w->fd, &h, sizeof(h)) != 0)
+        goto fail;
+    w->off = sizeof(h);
+    w->st.bytes = sizeof(h);
+    return w;
+
+fail:
+    {
+        int err = errno;
+        if (w->fd >= 0)
+            close(w->fd);
+        free(w->rows);
+        free(w->tmp);
+        free(w->slots);
+        free(w->dstr);
+        free(w->dlen);
+        free(w->out);
+        free(w);
+        errno = err;
+    }
+    return NULL;
+}
+
+// 문자열 열 하나 (comm 이면 true): [개수][길이+바이트]... [bitpack 번호]
+static uint8_t *put_dict(struct ksys_seg_writer *w, uint8_t *p, bool comm)
+{
+    uint32_t cnt = 0;
+
+    memset(w->slots, 0, (w->slot_mask + 1) * sizeof(*w->slots));
+    for (__u32 i = 0; i < w->n; i++) {
+        const struct ksys_event *e = &w->rows[i];
+        const char *s = comm ? e->comm : e->path;
+        size_t len = is_gap(e) ? 0 : strnlen(s, comm ? sizeof(e->comm) : sizeof(e->path));
+        uint32_t h = 2166136261u;
+
+        for (size_t k = 0; k < len; k++)
+            h = (h ^ (uint8_t)s[k]) * 16777619u;
+        for (uint32_t slot = h & w->slot_mask;; slot = (slot + 1) & w->slot_mask) {
+            uint32_t v = w->slots[slot];
+            if (!v) {
+                w->dstr[cnt] = s;
+                w->dlen[cnt] = (uint8_t)len;
+                w->slots[slot] = ++cnt;
+                w->tmp[i] = cnt - 1;
+                break;
+            }
+            if (w->dlen[v - 1] == len && !memcmp(w->dstr[v - 1], s, len)) {
+                w->tmp[i] = v - 1;
+                break;
+            }
+        }
+    }
+    p = put_varint(p, cnt);
+    for (uint32_t k = 0; k < cnt; k++) {
+        *p++ = w->dlen[k];      // 길이는 KSYS_PATH_LEN 이하라 varint 한 바이트
+        memcpy(p, w->dstr[k], w->dlen[k]);
+        p += w->dlen[k];
+    }
+    return put_bits(p, w->tmp, w->n);
+}
+
+// 레코드 필드 하나 -> tmp -> bitpack
+#define PUT_BITS_COL(w, p, expr)                            \
+    do {                                                    \
+        for (__u32 i_ = 0; i_ < (w)->n; i_++) {             \
+            const struct ksys_event *e = &(w)->rows[i_];    \
+            (w)->tmp[i_] = is_gap(e) ? 0 : (uint32_t)(expr); \
+        }                                                   \
+        (p) = put_bits((p), (w)->tmp, (w)->n);              \
+    } while (0)
+
+static int encode_block(struct ksys_seg_writer *w)
+{
+    uint8_t *base = w->out, *p = base + sizeof(struct ksys_seg_blk_hdr);
+    struct ksys_seg_footer f;
+    struct ksys_seg_blk_hdr bh;
+    uint64_t prev;
+    int64_t prev_tgid;
+
+    if (!w->n)
+        return 0;
+
+    memset(&f, 0, sizeof(f));
+    f.seq_min = f.ts_min = ~0ull;
+    f.tgid_min = INT32_MAX;
+    f.tgid_max = INT32_MIN;
+    f.nrows = w->n;
+    for (__u32 i = 0; i < w->n; i++) {
+        const struct ksys_event *e = &w->rows[i];
+        if (e->seq < f.seq_min) f.seq_min = e->seq;
+        if (e->seq > f.seq_max) f.seq_max = e->seq;
+        if (e->ts_ns < f.ts_min) f.ts_min = e->ts_ns;
+        if (e->ts_ns > f.ts_max) f.ts_max = e->ts_ns;
+        if (is_gap(e))
+            continue;
+        if (e->tgid < f.tgid_min) f.tgid_min = e->tgid;
+        if (e->tgid > f.tgid_max) f.tgid_max = e->tgid;
+    }
+
+    f.col_off[KSYS_SEG_COL_TYPE] = (__u32)(p - base);
+    for (__u32 i = 0; i < w->n; i++)
+        w->tmp[i] = w->rows[i].type;
+    p = put_bits(p, w->tmp, w->n);
+
+    f.col_off[KSYS_SEG_COL_SEQ] = (__u32)(p - base);
+    prev = 0;
+    for (__u32 i = 0; i < w->n; i++) {
+        p = put_varint(p, i ? zz((int64_t)(w->rows[i].seq - prev)) : w->rows[i].seq);
+        prev = w->rows[i].seq;
+    }
+
+    f.col_off[KSYS_SEG_COL_TS] = (__u32)(p - base);
+    prev = 0;
+    for (__u32 i = 0; i < w->n; i++) {
+        p = put_varint(p, i ? zz((int64_t)(w->rows[i].ts_ns - prev)) : w->rows[i].ts_ns);
+        prev = w->rows[i].ts_ns;
+    }
+
+    f.col_off[KSYS_SEG_COL_TGID] = (__u32)(p - base);
+    prev_tgid = 0;
+    for (__u32 i = 0; i < w->n; i++) {
+        int64_t t = is_gap(&w->rows[i]) ? 0 : w->rows[i].tgid;
+        p = put_varint(p, zz(t - prev_tgid));
+        prev_tgid = t;
+    }
+
+    f.col_off[KSYS_SEG_COL_PID] = (__u32)(p - base);
+    for (__u32 i = 0; i < w->n; i++) {
+        const struct ksys_event *e = &w->rows[i];
+        p = put_varint(p, is_gap(e) ? 0 : zz((int64_t)e->pid - e->tgid));
+    }
+
+    f.col_off[KSYS_SEG_COL_COMM] = (__u32)(p - base);
+    p = put_dict(w, p, true);
+    f.col_off[KSYS_SEG_COL_PATH] = (__u32)(p - base);
+    p = put_dict(w, p, false);
+
+    f.col_off[KSYS_SEG_COL_DFD] = (__u32)(p - base);
+    for (__u32 i = 0; i < w->n; i++)
+        p = put_varint(p, is_gap(&w->rows[i]) ? 0 : zz(w->rows[i].dfd));
+
+    f.col_off[KSYS_SEG_COL_FLAGS] = (__u32)(p - base);
+    PUT_BITS_COL(w, p, e->flags);
+    f.col_off[KSYS_SEG_COL_MODE] = (__u32)(p - base);
+    PUT_BITS_COL(w, p, e->mode);
+
+    f.col_off[KSYS_SEG_COL_RET] = (__u32)(p - base);
+    for (__u32 i = 0; i < w->n; i++)
+        p = put_varint(p, is_gap(&w->rows[i]) ? 0 : zz(w->rows[i].ret));
+
+    f.col_off[KSYS_SEG_COL_DEV] = (__u32)(p - base);
+    PUT_BITS_COL(w, p, e->dev);
+    f.col_off[KSYS_SEG_COL_GEN] = (__u32)(p - base);
+    PUT_BITS_COL(w, p, e->gen);
+
+    f.col_off[KSYS_SEG_COL_INO] = (__u32)(p - base);
+    for (__u32 i = 0; i < w->n; i++)
+        p = put_varint(p, is_gap(&w->rows[i]) ? 0 : w->rows[i].ino);
+
+    f.col_off[KSYS_SEG_COL_GAP] = (__u32)(p - base);
+    for (__u32 i = 0; i < w->n; i++) {
+        const struct ksys_gap *g = (const struct ksys_gap *)&w->rows[i];
+        if (!is_gap(&w->rows[i]))
+            continue;
+        p = put_varint(p, g->lost_from_seq);
+        p = put_varint(p, g->lost_to_seq);
+        p = put_varint(p, g->count);
+    }
+
+    for (int c = 0; c < KSYS_SEG_NCOLS; c++) {
+        __u32 end = c + 1 < KSYS_SEG_NCOLS ? f.col_off[c + 1] : (__u32)(p - base);
+        w->st.col_bytes[c] += end - f.col_off[c];
+    }
+    f.magic = KSYS_SEG_BLK_MAGIC;
+    memcpy(p, &f, sizeof(f));
+    p += sizeof(f);
+    bh.magic = KSYS_SEG_BLK_MAGIC;
+    bh.len = (__u32)(p - base);
+    memcpy(base, &bh, sizeof(bh));
+
+    if (w->st.blocks == w->index_cap) {
+        __u32 cap = w->index_cap ? 2 * w->index_cap : 64;
+        __u64 *idx = realloc(w->index, cap * sizeof(*idx));
+        if (!idx)
+            return -1;
+        w->index = idx;
+        w->index_cap = cap;
+    }
+    if (write_all(w->fd, base, bh.len) != 0)
+        return -1;
+    w->index[w->st.blocks++] = w->off;
+    w->off += bh.len;
+    w->st.bytes += bh.len;
+    w->st.rows += w->n;
+    w->n = 0;
+    return 0;
+}
+
+int ksys_seg_append(struct ksys_seg_writer *w, const struct ksys_event *ev, size_t n)
+{
+    while (n) {
+        size_t k = w->block_rows - w->n;
+
+        if (k > n)
+            k = n;
+        memcpy(&w->rows[w->n], ev, k * sizeof(*ev));
+        w->n += (__u32)k;
+        ev += k;
+        n -= k;
+        if (w->n == w->block_rows && encode_block(w) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int ksys_seg_flush(struct ksys_seg_writer *w)
+{
+    return encode_block(w);
+}
+
+int ksys_seg_writer_close(struct ksys_seg_writer *w)
+{
+    struct ksys_seg_trailer t;
+    int rc;
+
+    rc = encode_block(w);
+    if (rc == 0) {
+        t.index_off = w->off;
+        t.nblocks = (__u32)w->st.blocks;
+        t.magic = KSYS_SEG_IDX_MAGIC;
+        rc = write_all(w->fd, w->index, w->st.blocks * sizeof(*w->index));
+        if (rc == 0)
+            rc = write_all(w->fd, &t, sizeof(t));
+    }
+    if (close(w->fd) != 0 && rc == 0)
+        rc = -1;
+    free(w->rows);
+    free(w->tmp);
+    free(w->slots);
+    free(w->dstr);
+    free(w->dlen);
+    free(w->out);
+    free(w->index);
+    free(w);
+    return rc;
+}
+
+void ksys_seg_writer_stats(const struct ksys_seg_writer *w, struct ksys_seg_wstats *st)
+{
+    *st = w->st;
+}
+
+// --- Reader ---
+
+struct ksys_seg_reader {
+    const uint8_t *base;
+    size_t size;
+    __u32 block_rows;
+    __u64 *offs;
+    __u32 nblocks;
+
+    struct ksys_event *buf;     // scan 용 블록 하나
+    uint32_t *tmp;
+    const uint8_t **dstr;
+    uint8_t *dlen;
+};
+
+// off 에 온전한 블록이 있으면 길이, 아니면 0
+static __u32 check_block(const struct ksys_seg_reader *r, __u64 off)
+{
+    struct ksys_seg_blk_hdr bh;
+    struct ksys_seg_footer f;
+
+    if (off > r->size || r->size - off < sizeof(bh))
+        return 0;
+    memcpy(&bh, r->base + off, sizeof(bh));
+    if (bh.magic != KSYS_SEG_BLK_MAGIC || bh.len < sizeof(bh) + sizeof(f) || bh.len > r->size - off)
+        return 0;
+    memcpy(&f, r->base + off + bh.len - sizeof(f), sizeof(f));
+    if (f.magic != KSYS_SEG_BLK_MAGIC || !f.nrows || f.nrows > r->block_rows)
+        return 0;
+    // 열 오프셋은 헤더 뒤부터 푸터 앞까지 순서대로
+    for (int c = 0; c < KSYS_SEG_NCOLS; c++) {
+        __u32 lo = c ? f.col_off[c - 1] : (__u32)sizeof(bh);
+        if (f.col_off[c] < lo || f.col_off[c] > bh.len - sizeof(f))
+            return 0;
+    }
+    return bh.len;
+}
+
+static int load_index(struct ksys_seg_reader *r)
+{
+    struct ksys_seg_trailer t;
+    __u32 cap = 0;
+
+    if (r->size >= sizeof(struct ksys_seg_file_hdr) + sizeof(t)) {
+        memcpy(&t, r->base + r->size - sizeof(t), sizeof(t));
+        if (t.magic == KSYS_SEG_IDX_MAGIC && t.index_off <= r->size - sizeof(t) &&
+            (r->size - sizeof(t) - t.index_off) / sizeof(__u64) == t.nblocks) {
+            r->offs = malloc((t.nblocks ? t.nblocks : 1) * sizeof(*r->offs));
+            if (!r->offs)
+                return -1;
+            memcpy(r->offs, r->base + t.index_off, t.nblocks * sizeof(*r->offs));
+            r->nblocks = t.nblocks;
+            for (__u32 i = 0; i < r->nblocks; i++) {
+                if (!check_block(r, r->offs[i])) {
+                    errno = EPROTO;
+                    return -1;
+                }
+            }
+            return 0;
+        }
+    }
+
+    // 트레일러가 없음: 쓰다가 끊긴 파일. 앞에서부터 온전한 블록까지
+    for (__u64 off = sizeof(struct ksys_seg_file_hdr);;) {
+        __u32 len = check_block(r, off);
+        if (!len)
+            break;
+        if (r->nblocks == cap) {
+            __u64 *o;
+            cap = cap ? 2 * cap : 64;
+            o = realloc(r->offs, cap * sizeof(*o));
+            if (!o)
+                return -1;
+            r->offs = o;
+        }
+        r->offs[r->nblocks++] = off;
+        off += len;
+    }
+    return 0;
+}
+
+struct ksys_seg_reader *ksys_seg_open(const char *path)
+{
+    struct ksys_seg_reader *r;
+    struct ksys_seg_file_hdr h;
+    struct stat sb;
+    int fd, err;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+    r = calloc(1, sizeof(*r));
+    if (!r || fstat(fd, &sb) != 0)
+        goto fail;
+    if ((size_t)sb.st_size < sizeof(h)) {
+        errno = EPROTO;
+        goto fail;
+    }
+    r->size = (size_t)sb.st_size;
+    r->base = mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (r->base == MAP_FAILED) {
+        r->base = NULL;
+        goto fail;
+    }
+    close(fd);
+    fd = -1;
+    madvise((void *)r->base, r->size, MADV_SEQUENTIAL);
+
+    memcpy(&h, r->base, sizeof(h));
+    if (memcmp(h.magic, KSYS_SEG_MAGIC, sizeof(h.magic)) || h.version != KSYS_SEG_VERSION ||
+        h.ncols != KSYS_SEG_NCOLS || h.rec_size != sizeof(struct ksys_event) || !h.block_rows ||
+        h.block_rows > KSYS_SEG_BLOCK_ROWS_MAX) {
+        errno = EPROTO;
+        goto fail;
+    }
+    r->block_rows = h.block_rows;
+    r->buf = malloc(r->block_rows * sizeof(*r->buf));
+    r->tmp = malloc(r->block_rows * sizeof(*r->tmp));
+    r->dstr = malloc(r->block_rows * sizeof(*r->dstr));
+    r->dlen = malloc(r->block_rows);
+    if (!r->buf || !r->tmp || !r->dstr || !r->dlen || load_index(r) != 0)
+        goto fail;
+    return r;
+
+fail:
+    err = errno;
+    if (fd >= 0)
+        close(fd);
+    ksys_seg_close(r);
+    errno = err;
+    return NULL;
+}
+
+void ksys_seg_close(struct ksys_seg_reader *r)
+{
+    if (!r)
+        return;
+    if (r->base)
+        munmap((void *)r->base, r->size);
+    free(r->offs);
+    free(r->buf);
+    free(r->tmp);
+    free(r->dstr);
+    free(r->dlen);
+    free(r);
+}
+
+__u32 ksys_seg_nblocks(const struct ksys_seg_reader *r)
+{
+    return r->nblocks;
+}
+
+__u32 ksys_seg_block_rows(const struct ksys_seg_reader *r)
+{
+    return r->block_rows;
+}
+
+// 푸터는 정렬이 안 맞을 수 있지만 x86_64 에서는 그대로 읽어도 됨
+const struct ksys_seg_footer *ksys_seg_block(const struct ksys_seg_reader *r, __u32 i)
+{
+    struct ksys_seg_blk_hdr bh;
+
+    if (i >= r->nblocks)
+        return NULL;
+    memcpy(&bh, r->base + r->offs[i], sizeof(bh));
+    return (const struct ksys_seg_footer *)(r->base + r->offs[i] + bh.len - sizeof(struct ksys_seg_footer));
+}
+
+static void get_dict(struct ksys_seg_reader *r, struct cur *c, struct ksys_event *out, size_t n, bool comm)
+{
+    size_t max = comm ? KSYS_COMM_LEN : KSYS_PATH_LEN;
+    uint64_t cnt = get_varint(c);
+
+    if (c->bad || cnt > n) {
+        c->bad = true;
+        return;
+    }
+    for (uint64_t k = 0; k < cnt; k++) {
+        if (c->p >= c->end || *c->p > max || (size_t)(c->end - c->p) < 1u + *c->p) {
+            c->bad = true;
+            return;
+        }
+        r->dlen[k] = *c->p++;
+        r->dstr[k] = c->p;
+        c->p += r->dlen[k];
+    }
+    get_bits(c, r->tmp, n);
+    if (c->bad)
+        return;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t k = r->tmp[i];
+        if (k >= cnt) {
+            c->bad = true;
+            return;
+        }
+        memcpy(comm ? out[i].comm : out[i].path, r->dstr[k], r->dlen[k]);
+    }
+}
+
+ssize_t ksys_seg_read_block(struct ksys_seg_reader *r, __u32 i, struct ksys_event *out)
+{
+    const struct ksys_seg_footer *fp = ksys_seg_block(r, i);
+    struct ksys_seg_footer f;
+    const uint8_t *base;
+    struct cur c;
+    size_t n;
+
+    if (!fp) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(&f, fp, sizeof(f));
+    base = r->base + r->offs[i];
+    n = f.nrows;
+    memset(out, 0, n * sizeof(*out));
+
+// 열 k 의 범위로 커서를 맞춤
+#define COL(k)                                                                   \
+    (c.p = base + f.col_off[k],                                                  \
+     c.end = (k) + 1 < KSYS_SEG_NCOLS ? base + f.col_off[(k) + 1] : (const uint8_t *)fp, \
+     c.bad = false)
+
+    COL(KSYS_SEG_COL_TYPE);
+    get_bits(&c, r->tmp, n);
+    for (size_t k = 0; k < n && !c.bad; k++)
+        out[k].type = (__u16)r->tmp[k];
+    if (c.bad)
+        goto bad;
+
+    COL(KSYS_SEG_COL_SEQ);
+    for (size_t k = 0; k < n; k++)
+        out[k].seq = k ? out[k - 1].seq + (uint64_t)unzz(get_varint(&c)) : get_varint(&c);
+    if (c.bad)
+        goto bad;
+
+    COL(KSYS_SEG_COL_TS);
+    for (size_t k = 0; k < n; k++)
+        out[k].ts_ns = k ? out[k - 1].ts_ns + (uint64_t)unzz(get_varint(&c)) : get_varint(&c);
+    if (c.bad)
+        goto bad;
+
+    COL(KSYS_SEG_COL_TGID);
+    for (int64_t prev = 0, k = 0; k < (int64_t)n; k++) {
+        prev += unzz(get_varint(&c));
+        out[k].tgid = (__s32)prev;
+    }
+    if (c.bad)
+        goto bad;
+
+    COL(KSYS_SEG_COL_PID);
+    for (size_t k = 0; k < n; k++)
+        out[k].pid = (__s32)(out[k].tgid + unzz(get_varint(&c)));
+    if (c.bad)
+        goto bad;
+
+    COL(KSYS_SEG_COL_COMM);
+    get_dict(r, &c, out, n, true);
+    if (c.bad)
+        goto bad;
+    COL(KSYS_SEG_COL_PATH);
+    get_dict(r, &c, out, n, false);
+    if (c.bad)
+        goto bad;
+
+    COL(KSYS_SEG_COL_DFD);
+    for (size_t k = 0; k < n; k++)
+        out[k].dfd = (__s32)unzz(get_varint(&c));
+    if (c.bad)
+        goto bad;
+
+    COL(KSYS_SEG_COL_FLAGS);
+    get_bits(&c, r->tmp, n);
+    for (size_t k = 0; k < n && !c.bad; k++)
+        out[k].flags = (__s32)r->tmp[k];
+    COL(KSYS_SEG_COL_MODE);
+    get_bits(&c, r->tmp, n);
+    for (size_t k = 0; k < n && !c.bad; k++)
+        out[k].mode = (__u16)r->tmp[k];
+    if (c.bad)
+        goto bad;
+
+    COL(KSYS_SEG_COL_RET);
+    for (size_t k = 0; k < n; k++)
+        out[k].ret = (__s32)unzz(get_varint(&c));
+    if (c.bad)
+        goto bad;
+
+    COL(KSYS_SEG_COL_DEV);
+    get_bits(&c, r->tmp, n);
+    for (size_t k = 0; k < n && !c.bad; k++)
+        out[k].dev = r->tmp[k];
+    COL(KSYS_SEG_COL_GEN);
+    get_bits(&c, r->tmp, n);
+    for (size_t k = 0; k < n && !c.bad; k++)
+        out[k].gen = r->tmp[k];
+    if (c.bad)
+        goto bad;
+
+    COL(KSYS_SEG_COL_INO);
+    for (size_t k = 0; k < n; k++)
+        out[k].ino = get_varint(&c);
+    if (c.bad)
+        goto bad;
+
+    // gap 행은 seq/ts 만 쓰고 나머지는 ksys_gap 모양으로
+    COL(KSYS_SEG_COL_GAP);
+    for (size_t k = 0; k < n; k++) {
+        struct ksys_gap g;
+
+        if (out[k].type != KSYS_REC_GAP)
+            continue;
+        memset(&g, 0, sizeof(g));
+        g.seq = out[k].seq;
+        g.ts_ns = out[k].ts_ns;
+        g.lost_from_seq = get_varint(&c);
+        g.lost_to_seq = get_varint(&c);
+        g.count = get_varint(&c);
+        g.type = KSYS_REC_GAP;
+        memcpy(&out[k], &g, sizeof(g));
+    }
+    if (c.bad)
+        goto bad;
+#undef COL
+    return (ssize_t)n;
+
+bad:
+    errno = EPROTO;
+    return -1;
+}
+
+void ksys_seg_query_init(struct ksys_seg_query *q)
+{
+    q->seq_min = q->ts_min = 0;
+    q->seq_max = q->ts_max = ~0ull;
+    q->tgid = -1;
+}
+
+static bool block_may_match(const struct ksys_seg_footer *f, const struct ksys_seg_query *q)
+{
+    if (f->seq_max < q->seq_min || f->seq_min > q->seq_max)
+        return false;
+    if (f->ts_max < q->ts_min || f->ts_min > q->ts_max)
+        return false;
+    if (q->tgid >= 0 && (q->tgid < f->tgid_min || q->tgid > f->tgid_max))
+        return false;
+    return true;
+}
+
+static bool row_match(const struct ksys_event *e, const struct ksys_seg_query *q)
+{
+    if (e->seq < q->seq_min || e->seq > q->seq_max || e->ts_ns < q->ts_min || e->ts_ns > q->ts_max)
+        return false;
+    return q->tgid < 0 || (!is_gap(e) && e->tgid == q->tgid);
+}
+
+int ksys_seg_scan(struct ksys_seg_reader *r, const struct ksys_seg_query *q, ksys_seg_cb cb, void *arg,
+                  struct ksys_seg_scan_stats *st)
+{
+    struct ksys_seg_scan_stats s;
+
+    memset(&s, 0, sizeof(s));
+    for (__u32 i = 0; i < r->nblocks; i++) {
+        struct ksys_seg_footer f;
+        ssize_t n;
+        size_t m = 0;
+
+        s.blocks++;
+        memcpy(&f, ksys_seg_block(r, i), sizeof(f));
+        if (!block_may_match(&f, q)) {
+            s.blocks_skipped++;
+            continue;
+        }
+        n = ksys_seg_read_block(r, i, r->buf);
+        if (n < 0)
+            return -1;
+        s.rows_decoded += (__u64)n;
+        for (ssize_t k = 0; k < n; k++) {
+            if (!row_match(&r->buf[k], q))
+                continue;
+            if ((ssize_t)m != k)
+                r->buf[m] = r->buf[k];
+            m++;
+        }
+        s.rows_matched += m;
+        if (m && cb(arg, r->buf, m) != 0)
+            break;
+    }
+    if (st)
+        *st = s;
+    return 0;
+}
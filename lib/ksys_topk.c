@@ -0,0 +1,557 @@
+// lib/ksys_topk.c
+// 미끄러지는 창 위의 top-K 표. 구조 설명은 include/ksys/ksys_topk.h
+//
+// 조각 하나 x 차원 하나 = Space-Saving 표 하나 (struct ss) + count-min 한 벌.
+// 메모리는 전부 ksys_topk_new 에서 잡고, add/tick/query 에서는 할당하지 않음
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ksys/ksys_topk.h>
+
+#define NIL         UINT32_MAX
+#define CM_DEPTH    4
+#define KEY_MAX     KSYS_PATH_LEN
+
+// --- Stream Summary ---
+
+struct ss_ctr {
+    __u64 hash;
+    __u64 error;            // 이 칸을 물려받을 때 앞 주인의 count
+    __u32 bucket;
+    __u32 prev, next;       // 같은 버킷 안
+    __u32 hnext;            // 해시 체인
+    __s32 tgid;
+    __u32 klen;
+    char  key[KEY_MAX];
+    char  comm[KSYS_COMM_LEN];  // TGID 차원의 표시용
+};
+
+struct ss_bkt {
+    __u64 count;
+    __u32 head;             // 이 count 인 카운터들
+    __u32 prev, next;       // count 오름차순
+};
+
+struct ss {
+    struct ss_ctr *c;
+    struct ss_bkt *b;
+    __u32 *htab;            // 체인 머리 (카운터 번호)
+    __u32 hmask;
+    __u32 cap;
+    __u32 n;                // 쓴 카운터
+    __u32 bfree;            // 빈 버킷 (next 로 이음)
+    __u32 bmin;             // count 가 가장 작은 버킷
+    __u32 *cm;              // CM_DEPTH x cm_width
+};
+
+struct pane {
+    __u64 start_ns;
+    __u64 events;
+    struct ss ss[KSYS_TOPK_NDIMS];
+};
+
+// 질의 때 조각들을 키로 합치는 자리 (panes * capacity 개)
+struct mrg {
+    const struct ss_ctr *c; // 키 (처음 본 조각의 카운터)
+    __u64 count;            // 있는 조각의 count - min 의 합
+    __u64 lower;            // 있는 조각의 count - error 의 합
+};
+
+struct ksys_topk {
+    struct ksys_topk_opts o;
+    __u64 pane_ns;
+    __u32 cm_mask;
+    __u32 cur;              // 지금 채우는 조각
+    bool started;
+    struct pane *p;
+    struct mrg *m;
+    __u32 *mtab;            // mrg 열린 주소 해시
+    __u32 mmask;
+    __u32 *order;           // 정렬용 mrg 번호
+};
+
+static inline __u64 mix(__u64 h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+// 8 바이트씩 곱해 섞음 (sketch 줄마다 위/아래 32 비트를 따로 씀)
+static inline __u64 key_hash(const void *k, __u32 len)
+{
+    const unsigned char *s = k;
+    __u64 h = 0x9e3779b97f4a7c15ull ^ len, w;
+    for (; len >= 8; s += 8, len -= 8) {
+        memcpy(&w, s, 8);
+        h = (h ^ mix(w)) * 0xc2b2ae3d27d4eb4full;
+    }
+    if (len) {
+        w = 0;
+        memcpy(&w, s, len);
+        h = (h ^ mix(w)) * 0xc2b2ae3d27d4eb4full;
+    }
+    return mix(h);
+}
+
+static inline __u32 cm_idx(__u64 h, int row, __u32 mask)
+{
+    __u32 h1 = (__u32)h, h2 = (__u32)(h >> 32) | 1;
+    return (h1 + (__u32)row * h2) & mask;
+}
+
+static void ss_reset(struct ss *s, __u32 cm_len)
+{
+    memset(s->htab, 0xff, (size_t)(s->hmask + 1) * sizeof(*s->htab));
+    for (__u32 i = 0; i < s->cap; i++)
+        s->b[i].next = i + 1 < s->cap ? i + 1 : NIL;
+    s->bfree = 0;
+    s->bmin = NIL;
+    s->n = 0;
+    memset(s->cm, 0, (size_t)cm_len * sizeof(*s->cm));
+}
+
+static __u32 ss_find(const struct ss *s, __u64 h, const void *k, __u32 len)
+{
+    for (__u32 i = s->htab[h & s->hmask]; i != NIL; i = s->c[i].hnext) {
+        const struct ss_ctr *c = &s->c[i];
+        if (c->hash == h && c->klen == len && !memcmp(c->key, k, len))
+            return i;
+    }
+    return NIL;
+}
+
+static void ss_hash_del(struct ss *s, __u32 x)
+{
+    __u32 *pp = &s->htab[s->c[x].hash & s->hmask];
+    while (*pp != x)
+        pp = &s->c[*pp].hnext;
+    *pp = s->c[x].hnext;
+}
+
+static void ss_hash_add(struct ss *s, __u32 x)
+{
+    __u32 *head = &s->htab[s->c[x].hash & s->hmask];
+    s->c[x].hnext = *head;
+    *head = x;
+}
+
+// count 인 빈 버킷을 after 뒤에 (after == NIL 이면 맨 앞에) 끼움
+static __u32 bkt_new(struct ss *s, __u64 count, __u32 after)
+{
+    __u32 bi = s->bfree;
+    struct ss_bkt *b = &s->b[bi];
+    s->bfree = b->next;
+
+    b->count = count;
+    b->head = NIL;
+    b->prev = after;
+    b->next = after == NIL ? s->bmin : s->b[after].next;
+    if (b->next != NIL)
+        s->b[b->next].prev = bi;
+    if (after == NIL)
+        s->bmin = bi;
+    else
+        s->b[after].next = bi;
+    return bi;
+}
+
+static void bkt_free(struct ss *s, __u32 bi)
+{
+    struct ss_bkt *b = &s->b[bi];
+    if (b->prev != NIL)
+        s->b[b->prev].next = b->next;
+    else
+        s->bmin = b->next;
+    if (b->next != NIL)
+        s->b[b->next].prev = b->prev;
+    b->next = s->bfree;
+    s->bfree = bi;
+}
+
+static void ctr_link(struct ss *s, __u32 bi, __u32 x)
+{
+    struct ss_ctr *c = &s->c[x];
+    c->bucket = bi;
+    c->prev = NIL;
+    c->next = s->b[bi].head;
+    if (c->next != NIL)
+        s->c[c->next].prev = x;
+    s->b[bi].head = x;
+}
+
+// 버킷에서 빼고, 버킷이 비면 버킷도 돌려줌
+static void ctr_unlink(struct ss *s, __u32 x)
+{
+    struct ss_ctr *c = &s->c[x];
+    if (c->prev != NIL)
+        s->c[c->prev].next = c->next;
+    else
+        s->b[c->bucket].head = c->next;
+    if (c->next != NIL)
+        s->c[c->next].prev = c->prev;
+    if (s->b[c->bucket].head == NIL)
+        bkt_free(s, c->bucket);
+}
+
+// count + 1: 바로 다음 버킷이 count + 1 이면 거기로, 아니면 새 버킷.
+// 혼자 있던 버킷이면 버킷 count 만 올림 (버킷 수 <= 카운터 수 가 유지됨)
+static void ss_inc(struct ss *s, __u32 x)
+{
+    __u32 bi = s->c[x].bucket;
+    struct ss_bkt *b = &s->b[bi];
+    __u64 cnt = b->count + 1;
+    __u32 nb = b->next;
+    bool next_ok = nb != NIL && s->b[nb].count == cnt;
+
+    if (b->head == x && s->c[x].next == NIL && !next_ok) {
+        b->count = cnt;
+        return;
+    }
+    if (!next_ok)
+        nb = bkt_new(s, cnt, bi);
+    ctr_unlink(s, x);
+    ctr_link(s, nb, x);
+}
+
+static void ss_add(struct ss *s, __u32 cm_mask, const void *k, __u32 len, __s32 tgid, const char *comm)
+{
+    __u64 h = key_hash(k, len);
+    for (int r = 0; r < CM_DEPTH; r++)
+        s->cm[(size_t)r * (cm_mask + 1) + cm_idx(h, r, cm_mask)]++;
+
+    __u32 x = ss_find(s, h, k, len);
+    if (x != NIL) {
+        if (comm)
+            memcpy(s->c[x].comm, comm, KSYS_COMM_LEN);
+        ss_inc(s, x);
+        return;
+    }
+
+    struct ss_ctr *c;
+    if (s->n < s->cap) {
+        // 빈 칸: count 1 로 시작
+        x = s->n++;
+        c = &s->c[x];
+        c->error = 0;
+        __u32 bi = s->bmin;
+        if (bi == NIL || s->b[bi].count != 1)
+            bi = bkt_new(s, 1, NIL);
+        ctr_link(s, bi, x);
+    } else {
+        // 가장 작은 카운터를 물려받고 min + 1
+        x = s->b[s->bmin].head;
+        c = &s->c[x];
+        ss_hash_del(s, x);
+        c->error = s->b[s->bmin].count;
+    }
+    c->hash = h;
+    c->klen = len;
+    memcpy(c->key, k, len);
+    c->tgid = tgid;
+    if (comm)
+        memcpy(c->comm, comm, KSYS_COMM_LEN);
+    ss_hash_add(s, x);
+    if (c->error)
+        ss_inc(s, x);
+}
+
+static inline __u64 ss_count(const struct ss *s, const struct ss_ctr *c)
+{
+    return s->b[c->bucket].count;
+}
+
+// 표에 없는 키의 count 상한 (덜 찼으면 없는 키는 정말 0)
+static inline __u64 ss_min(const struct ss *s)
+{
+    return s->n < s->cap || s->bmin == NIL ? 0 : s->b[s->bmin].count;
+}
+
+// --- Keys ---
+
+// 앞 depth 개 성분. "/usr/lib/x/y.so" (2) -> "/usr/lib", "/etc/passwd" (2) -> "/etc", "a.txt" -> "."
+static __u32 path_prefix(const char *path, __u32 len, __u32 depth, const char **out)
+{
+    __u32 last = 0, seen = 0;
+    bool slash = false;
+    for (__u32 i = 1; i < len; i++) {
+        if (path[i] != '/')
+            continue;
+        slash = true;
+        last = i;
+        if (++seen == depth)
+            break;
+    }
+    if (!slash && path[0] != '/') {
+        *out = ".";
+        return 1;
+    }
+    *out = path;
+    return last ? last : 1;
+}
+
+// --- API ---
+
+void ksys_topk_opts_init(struct ksys_topk_opts *o)
+{
+    memset(o, 0, sizeof(*o));
+    o->capacity = 256;
+    o->panes = 6;
+    o->pane_sec = 10;
+    o->prefix_depth = 2;
+    o->cm_width = 1024;
+}
+
+static __u32 pow2_at_least(__u32 v)
+{
+    __u32 p = 1;
+    while (p < v)
+        p <<= 1;
+    return p;
+}
+
+struct ksys_topk *ksys_topk_new(const struct ksys_topk_opts *opts)
+{
+    struct ksys_topk_opts o;
+    ksys_topk_opts_init(&o);
+    if (opts) {
+        if (opts->capacity)
+            o.capacity = opts->capacity;
+        if (opts->panes)
+            o.panes = opts->panes;
+        if (opts->pane_sec)
+            o.pane_sec = opts->pane_sec;
+        if (opts->prefix_depth)
+            o.prefix_depth = opts->prefix_depth;
+        if (opts->cm_width)
+            o.cm_width = opts->cm_width;
+    }
+    if (o.capacity > (1u << 20) || o.panes > 64 || o.cm_width > (1u << 24)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    o.cm_width = pow2_at_least(o.cm_width);
+
+    struct ksys_topk *t = calloc(1, sizeof(*t));
+    if (!t)
+        return NULL;
+    t->o = o;
+    t->pane_ns = (__u64)o.pane_sec * 1000000000ull;
+    t->cm_mask = o.cm_width - 1;
+
+    __u32 hsize = pow2_at_least(o.capacity * 2);
+    size_t cm_len = (size_t)CM_DEPTH * o.cm_width;
+    t->p = calloc(o.panes, sizeof(*t->p));
+    if (!t->p)
+        goto fail;
+    for (__u32 i = 0; i < o.panes; i++) {
+        for (int d = 0; d < KSYS_TOPK_NDIMS; d++) {
+            struct ss *s = &t->p[i].ss[d];
+            s->cap = o.capacity;
+            s->hmask = hsize - 1;
+            s->c = calloc(o.capacity, sizeof(*s->c));
+            s->b = calloc(o.capacity, sizeof(*s->b));
+            s->htab = malloc(hsize * sizeof(*s->htab));
+            s->cm = malloc(cm_len * sizeof(*s->cm));
+            if (!s->c || !s->b || !s->htab || !s->cm)
+                goto fail;
+            ss_reset(s, cm_len);
+        }
+    }
+
+    __u32 mcap = o.panes * o.capacity;
+    t->mmask = pow2_at_least(mcap * 2) - 1;
+    t->m = malloc(mcap * sizeof(*t->m));
+    t->order = malloc(mcap * sizeof(*t->order));
+    t->mtab = malloc((size_t)(t->mmask + 1) * sizeof(*t->mtab));
+    if (!t->m || !t->order || !t->mtab)
+        goto fail;
+    return t;
+
+fail:
+    ksys_topk_free(t);
+    errno = ENOMEM;
+    return NULL;
+}
+
+void ksys_topk_free(struct ksys_topk *t)
+{
+    if (!t)
+        return;
+    if (t->p) {
+        for (__u32 i = 0; i < t->o.panes; i++) {
+            for (int d = 0; d < KSYS_TOPK_NDIMS; d++) {
+                struct ss *s = &t->p[i].ss[d];
+                free(s->c);
+                free(s->b);
+                free(s->htab);
+                free(s->cm);
+            }
+        }
+    }
+    free(t->p);
+    free(t->m);
+    free(t->order);
+    free(t->mtab);
+    free(t);
+}
+
+static void pane_reset(struct ksys_topk *t, struct pane *p, __u64 start)
+{
+    size_t cm_len = (size_t)CM_DEPTH * t->o.cm_width;
+    for (int d = 0; d < KSYS_TOPK_NDIMS; d++)
+        ss_reset(&p->ss[d], cm_len);
+    p->events = 0;
+    p->start_ns = start;
+}
+
+void ksys_topk_tick(struct ksys_topk *t, __u64 now)
+{
+    struct pane *p = &t->p[t->cur];
+    if (!t->started) {
+        t->started = true;
+        p->start_ns = now;
+        return;
+    }
+    if (now < p->start_ns + t->pane_ns)
+        return;
+
+    __u64 steps = (now - p->start_ns) / t->pane_ns;
+    __u64 start = p->start_ns + steps * t->pane_ns;
+    // 창 전체보다 오래 조용했으면 모든 조각을 비움
+    if (steps > t->o.panes)
+        steps = t->o.panes;
+    for (__u64 i = 0; i < steps; i++) {
+        t->cur = (t->cur + 1) % t->o.panes;
+        pane_reset(t, &t->p[t->cur], start);
+    }
+}
+
+void ksys_topk_add(struct ksys_topk *t, const struct ksys_event *ev)
+{
+    if (ev->type != KSYS_REC_OPENAT && ev->type != KSYS_REC_OPENAT_RET)
+        return;
+
+    struct pane *p = &t->p[t->cur];
+    __u32 m = t->cm_mask;
+    __u32 clen = strnlen(ev->comm, KSYS_COMM_LEN);
+    __u32 plen = strnlen(ev->path, KSYS_PATH_LEN);
+    const char *pre;
+    __u32 prelen = plen ? path_prefix(ev->path, plen, t->o.prefix_depth, &pre) : 0;
+
+    p->events++;
+    ss_add(&p->ss[KSYS_TOPK_TGID], m, &ev->tgid, sizeof(ev->tgid), ev->tgid, ev->comm);
+    ss_add(&p->ss[KSYS_TOPK_COMM], m, ev->comm, clen, 0, NULL);
+    ss_add(&p->ss[KSYS_TOPK_PATH], m, ev->path, plen, 0, NULL);
+    ss_add(&p->ss[KSYS_TOPK_PREFIX], m, prelen ? pre : "", prelen, 0, NULL);
+}
+
+static int order_cmp(const void *a, const void *b, void *arg)
+{
+    const struct mrg *m = arg;
+    __u64 x = m[*(const __u32 *)a].count, y = m[*(const __u32 *)b].count;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+int ksys_topk_query(struct ksys_topk *t, enum ksys_topk_dim dim, __u32 window_sec, struct ksys_topk_item *out,
+                    int max, __u64 *total)
+{
+    if ((unsigned)dim >= KSYS_TOPK_NDIMS || max < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    __u32 np = t->o.panes;
+    if (window_sec)
+        np = (window_sec + t->o.pane_sec - 1) / t->o.pane_sec;
+    if (np < 1)
+        np = 1;
+    if (np > t->o.panes)
+        np = t->o.panes;
+
+    // 최근 np 조각을 키로 합침. 조각에 없는 키는 그 조각의 min 만큼 셌을 수도 있음
+    __u64 min_sum = 0, events = 0;
+    __u32 nm = 0;
+    memset(t->mtab, 0xff, (size_t)(t->mmask + 1) * sizeof(*t->mtab));
+    for (__u32 k = 0; k < np; k++) {
+        const struct pane *p = &t->p[(t->cur + t->o.panes - k) % t->o.panes];
+        const struct ss *s = &p->ss[dim];
+        __u64 mn = ss_min(s);
+        min_sum += mn;
+        events += p->events;
+        for (__u32 i = 0; i < s->n; i++) {
+            const struct ss_ctr *c = &s->c[i];
+            __u32 j = c->hash & t->mmask;
+            while (t->mtab[j] != NIL) {
+                const struct ss_ctr *o = t->m[t->mtab[j]].c;
+                if (o->hash == c->hash && o->klen == c->klen && !memcmp(o->key, c->key, c->klen))
+                    break;
+                j = (j + 1) & t->mmask;
+            }
+            if (t->mtab[j] == NIL) {
+                t->mtab[j] = nm;
+                t->m[nm++] = (struct mrg){ .c = c };
+            }
+            struct mrg *g = &t->m[t->mtab[j]];
+            __u64 cnt = ss_count(s, c);
+            g->count += cnt - mn;
+            g->lower += cnt - c->error;
+        }
+    }
+
+    // count-min 으로 깎기: 줄마다 조각 합, 그중 최소
+    size_t w = t->cm_mask + 1;
+    for (__u32 i = 0; i < nm; i++) {
+        struct mrg *g = &t->m[i];
+        __u64 est = UINT64_MAX;
+        for (int r = 0; r < CM_DEPTH; r++) {
+            __u32 idx = cm_idx(g->c->hash, r, t->cm_mask);
+            __u64 sum = 0;
+            for (__u32 k = 0; k < np; k++)
+                sum += t->p[(t->cur + t->o.panes - k) % t->o.panes].ss[dim].cm[r * w + idx];
+            if (sum < est)
+                est = sum;
+        }
+        g->count += min_sum;
+        if (est < g->count)
+            g->count = est;
+        if (g->lower > g->count)
+            g->lower = g->count;
+        t->order[i] = i;
+    }
+    qsort_r(t->order, nm, sizeof(*t->order), order_cmp, t->m);
+
+    int n = (int)nm < max ? (int)nm : max;
+    for (int i = 0; i < n; i++) {
+        const struct mrg *g = &t->m[t->order[i]];
+        struct ksys_topk_item *it = &out[i];
+        memset(it, 0, sizeof(*it));
+        if (dim == KSYS_TOPK_TGID) {
+            memcpy(&it->tgid, g->c->key, sizeof(it->tgid));
+            memcpy(it->key, g->c->comm, KSYS_COMM_LEN);
+        } else {
+            memcpy(it->key, g->c->key, g->c->klen);
+        }
+        it->count = g->count;
+        it->error = g->count - g->lower;
+    }
+    if (total)
+        *total = events;
+    return n;
+}
+
+__u32 ksys_topk_window(const struct ksys_topk *t)
+{
+    return t->o.panes * t->o.pane_sec;
+}
+
+const char *ksys_topk_dim_name(enum ksys_topk_dim dim)
+{
+    static const char *const names[KSYS_TOPK_NDIMS] = { "tgid", "comm", "path", "prefix" };
+    return (unsigned)dim < KSYS_TOPK_NDIMS ? names[dim] : "?";
+}
@@ -0,0 +1,711 @@
+// lib/ksys_uring.c
+// io_uring 파일 출력. 구조는 include/ksys/ksys_uring.h
+//
+// 제출 큐에 넣는 쪽과 완료 큐를 거두는 쪽 모두 이 writer 를 부르는 스레드 하나뿐이라
+// 링 포인터는 그 스레드만 만지고, 커널과 주고받는 head/tail 만 acquire/release 로 읽고 씀
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/falloc.h>
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys_uring.h>
+
+#define URING_BUF_DEFAULT   (1024 * 1024)
+#define URING_NBUFS_DEFAULT 8
+#define URING_PATH_MAX      4096
+
+// user_data: 위 8 비트는 종류, 아래는 버퍼 번호
+#define UD_WRITE    (1ull << 56)
+#define UD_OPEN     (2ull << 56)
+#define UD_FALLOC   (3ull << 56)
+#define UD_KIND(ud) ((ud) & (0xffull << 56))
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+enum { NEXT_NONE, NEXT_OPENING, NEXT_ALLOC, NEXT_READY };
+
+struct ufile {
+    int fd;                     // -1: 비어 있음
+    __u64 off;                  // 다음 쓰기 위치 (direct 패딩 포함)
+    __u64 size;                 // 실제 바이트
+    unsigned int inflight;
+    bool retiring;              // 다 쓰면 자르고 닫음
+};
+
+struct ubuf {
+    char *p;
+    size_t len;                 // 모은 바이트
+    bool busy;                  // 커널에 나가 있음
+    int slot;                   // 쓰는 파일 자리
+    __u64 off;                  // 파일 위치
+    size_t wlen, done;          // 넘긴 길이 / 끝난 길이 (짧은 쓰기면 나머지를 다시)
+};
+
+struct ksys_uring_writer {
+    struct ksys_uring_opts o;
+    int ring_fd;
+
+    // 링 (mmap)
+    void *sq_ptr, *cq_ptr;
+    size_t sq_sz, cq_sz;
+    struct io_uring_sqe *sqes;
+    size_t sqes_sz;
+    unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array, sq_entries;
+    unsigned int *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned int sqe_tail;      // 채운 끝. ring_enter 때 sq_tail 로 내보냄
+    unsigned int to_submit;
+
+    struct ubuf *bufs;
+    unsigned int cur_buf;
+
+    struct ufile files[2];      // 등록 파일 자리 0/1
+    int cur;                    // 지금 쓰는 자리
+    unsigned int file_no;       // 지금 파일 번호
+    char path[URING_PATH_MAX];
+    int next_state;
+    int next_fd;
+    char next_path[URING_PATH_MAX];
+    uint64_t opened_ns;
+
+    int err;                    // 실패한 쓰기의 errno (그 뒤로는 모두 실패)
+    struct ksys_uring_stats st;
+};
+
+// --- Ring ---
+
+static int sys_setup(unsigned int entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_register(int fd, unsigned int op, const void *arg, unsigned int nr)
+{
+    return (int)syscall(__NR_io_uring_register, fd, op, arg, nr);
+}
+
+static int ring_init(struct ksys_uring_writer *w, unsigned int entries)
+{
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof(p));
+    w->ring_fd = sys_setup(entries, &p);
+    if (w->ring_fd < 0)
+        return -1;
+    w->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    w->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (w->cq_sz > w->sq_sz)
+            w->sq_sz = w->cq_sz;
+        w->cq_sz = w->sq_sz;
+    }
+    w->sq_ptr = mmap(NULL, w->sq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, w->ring_fd,
+                     IORING_OFF_SQ_RING);
+    if (w->sq_ptr == MAP_FAILED)
+        return -1;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        w->cq_ptr = w->sq_ptr;
+    } else {
+        w->cq_ptr = mmap(NULL, w->cq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, w->ring_fd,
+                         IORING_OFF_CQ_RING);
+        if (w->cq_ptr == MAP_FAILED)
+            return -1;
+    }
+    w->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    w->sqes = mmap(NULL, w->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, w->ring_fd,
+                   IORING_OFF_SQES);
+    if (w->sqes == MAP_FAILED)
+        return -1;
+
+    w->sq_head = (unsigned int *)((char *)w->sq_ptr + p.sq_off.head);
+    w->sq_tail = (unsigned int *)((char *)w->sq_ptr + p.sq_off.tail);
+    w->sq_mask = (unsigned int *)((char *)w->sq_ptr + p.sq_off.ring_mask);
+    w->sq_array = (unsigned int *)((char *)w->sq_ptr + p.sq_off.array);
+    w->sq_entries = p.sq_entries;
+    w->cq_head = (unsigned int *)((char *)w->cq_ptr + p.cq_off.head);
+    w->cq_tail = (unsigned int *)((char *)w->cq_ptr + p.cq_off.tail);
+    w->cq_mask = (unsigned int *)((char *)w->cq_ptr + p.cq_off.ring_mask);
+    w->cqes = (struct io_uring_cqe *)((char *)w->cq_ptr + p.cq_off.cqes);
+    // 배열은 칸 번호 그대로
+    for (unsigned int i = 0; i < w->sq_entries; i++)
+        w->sq_array[i] = i;
+    w->sqe_tail = *w->sq_tail;
+    return 0;
+}
+
+static void ring_free(struct ksys_uring_writer *w)
+{
+    if (w->sqes && w->sqes != MAP_FAILED)
+        munmap(w->sqes, w->sqes_sz);
+    if (w->cq_ptr && w->cq_ptr != MAP_FAILED && w->cq_ptr != w->sq_ptr)
+        munmap(w->cq_ptr, w->cq_sz);
+    if (w->sq_ptr && w->sq_ptr != MAP_FAILED)
+        munmap(w->sq_ptr, w->sq_sz);
+    if (w->ring_fd >= 0)
+        close(w->ring_fd);
+}
+
+// 넣어 둔 것을 넘기고, wait 개가 끝날 때까지 기다림
+static int ring_enter(struct ksys_uring_writer *w, unsigned int wait)
+{
+    __atomic_store_n(w->sq_tail, w->sqe_tail, __ATOMIC_RELEASE);
+    for (;;) {
+        int r = sys_enter(w->ring_fd, w->to_submit, wait, wait ? IORING_ENTER_GETEVENTS : 0);
+
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        w->st.enters++;
+        w->to_submit -= (unsigned int)r < w->to_submit ? (unsigned int)r : w->to_submit;
+        return 0;
+    }
+}
+
+static struct io_uring_sqe *get_sqe(struct ksys_uring_writer *w)
+{
+    unsigned int tail = w->sqe_tail;
+    struct io_uring_sqe *sqe;
+
+    // 가득 차면 먼저 넘김 (커널이 가져가면 head 가 움직임)
+    while (tail - __atomic_load_n(w->sq_head, __ATOMIC_ACQUIRE) >= w->sq_entries) {
+        if (ring_enter(w, 0) != 0)
+            return NULL;
+    }
+    sqe = &w->sqes[tail & *w->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    w->sqe_tail = tail + 1;
+    w->to_submit++;
+    return sqe;
+}
+
+// --- Completions ---
+
+static void set_err(struct ksys_uring_writer *w, int err)
+{
+    if (!w->err)
+        w->err = err;
+}
+
+static void file_update(struct ksys_uring_writer *w, int slot, int fd)
+{
+    struct io_uring_files_update up;
+
+    memset(&up, 0, sizeof(up));
+    up.offset = (__u32)slot;
+    up.fds = (__u64)(uintptr_t)&fd;
+    if (sys_register(w->ring_fd, IORING_REGISTER_FILES_UPDATE, &up, 1) < 0)
+        set_err(w, errno);
+}
+
+static int queue_write(struct ksys_uring_writer *w, unsigned int i)
+{
+    struct ubuf *b = &w->bufs[i];
+    struct io_uring_sqe *sqe = get_sqe(w);
+
+    if (!sqe)
+        return -1;
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->fd = b->slot;
+    sqe->off = b->off + b->done;
+    sqe->addr = (__u64)(uintptr_t)(b->p + b->done);
+    sqe->len = (__u32)(b->wlen - b->done);
+    sqe->buf_index = (__u16)i;
+    sqe->user_data = UD_WRITE | i;
+    return 0;
+}
+
+static void prepare_next(struct ksys_uring_writer *w);
+
+// 끝난 파일: 실제 크기로 자르고 (direct 패딩, 남은 선할당) 닫음
+static void retire_finish(struct ksys_uring_writer *w, int slot)
+{
+    struct ufile *f = &w->files[slot];
+
+    if (ftruncate(f->fd, (off_t)f->size) != 0)
+        set_err(w, errno);
+    if (close(f->fd) != 0)
+        set_err(w, errno);
+    file_update(w, slot, -1);
+    f->fd = -1;
+    f->retiring = false;
+    prepare_next(w);
+}
+
+static void on_write(struct ksys_uring_writer *w, unsigned int i, int res)
+{
+    struct ubuf *b = &w->bufs[i];
+    struct ufile *f = &w->files[b->slot];
+
+    if (res < 0) {
+        set_err(w, -res);
+    } else if (res == 0 && b->done < b->wlen) {
+        set_err(w, EIO);
+    } else {
+        b->done += (size_t)res;
+        // 짧은 쓰기: 나머지를 다시
+        if (b->done < b->wlen) {
+            if (queue_write(w, i) == 0)
+                return;
+            set_err(w, errno);
+        }
+    }
+    b->busy = false;
+    w->st.inflight--;
+    f->inflight--;
+    if (f->retiring && !f->inflight)
+        retire_finish(w, b->slot);
+}
+
+static void on_open(struct ksys_uring_writer *w, int res)
+{
+    int slot = w->cur ^ 1;
+    struct io_uring_sqe *sqe;
+
+    if (res < 0) {
+        set_err(w, -res);
+        w->next_state = NEXT_NONE;
+        return;
+    }
+    w->next_fd = res;
+    file_update(w, slot, res);
+    if (!w->o.prealloc) {
+        w->next_state = NEXT_READY;
+        return;
+    }
+    sqe = get_sqe(w);
+    if (!sqe) {
+        w->next_state = NEXT_READY;
+        return;
+    }
+    // KEEP_SIZE: 크기는 쓴 만큼만 늘어남 (읽는 쪽이 0 을 보지 않게)
+    sqe->opcode = IORING_OP_FALLOCATE;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->fd = slot;
+    sqe->off = 0;
+    sqe->addr = w->o.prealloc;          // FALLOCATE 는 길이를 addr 에
+    sqe->len = FALLOC_FL_KEEP_SIZE;     // mode 는 len 에
+    sqe->user_data = UD_FALLOC;
+    w->next_state = NEXT_ALLOC;
+    ring_enter(w, 0);
+}
+
+// 완료 큐에 있는 것을 모두 처리 (시스템 콜 없음)
+static void reap(struct ksys_uring_writer *w)
+{
+    unsigned int head = *w->cq_head;
+
+    while (head != __atomic_load_n(w->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &w->cqes[head & *w->cq_mask];
+        __u64 ud = cqe->user_data;
+        int res = cqe->res;
+
+        head++;
+        __atomic_store_n(w->cq_head, head, __ATOMIC_RELEASE);
+        switch (UD_KIND(ud)) {
+            case UD_WRITE:
+                on_write(w, (unsigned int)(ud & 0xffff), res);
+                break;
+            case UD_OPEN:
+                on_open(w, res);
+                break;
+            case UD_FALLOC:
+                // 선할당을 못 하는 파일시스템이어도 쓰기는 됨
+                w->next_state = NEXT_READY;
+                break;
+        }
+    }
+}
+
+// 하나라도 끝날 때까지 기다림
+static int wait_one(struct ksys_uring_writer *w)
+{
+    uint64_t t0 = now_ns();
+    int rc = ring_enter(w, 1);
+
+    w->st.stall_ns += now_ns() - t0;
+    reap(w);
+    return rc;
+}
+
+// --- Files ---
+
+static void make_path(const struct ksys_uring_writer *w, char *out, unsigned int no)
+{
+    snprintf(out, URING_PATH_MAX, "%s.%06u", w->o.prefix, no);
+}
+
+static int open_flags(const struct ksys_uring_writer *w)
+{
+    return O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | (w->o.direct ? O_DIRECT : 0);
+}
+
+// 다음 파일을 비동기로 열어 둠 (돌리는 설정이 있고 다음 자리가 비었을 때만)
+static void prepare_next(struct ksys_uring_writer *w)
+{
+    struct io_uring_sqe *sqe;
+
+    if ((!w->o.rotate_bytes && !w->o.rotate_sec) || w->next_state != NEXT_NONE ||
+        w->files[w->cur ^ 1].fd >= 0)
+        return;
+    make_path(w, w->next_path, w->file_no + 1);
+    sqe = get_sqe(w);
+    if (!sqe)
+        return;
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (__u64)(uintptr_t)w->next_path;
+    sqe->open_flags = (__u32)open_flags(w);
+    sqe->len = 0644;
+    sqe->user_data = UD_OPEN;
+    w->next_state = NEXT_OPENING;
+    ring_enter(w, 0);
+}
+
+static int append(struct ksys_uring_writer *w, const void *data, size_t len);
+
+// 새 파일 자리로 넘어가고 파일 헤더를 씀
+static int start_file(struct ksys_uring_writer *w, int slot, int fd)
+{
+    struct ufile *f = &w->files[slot];
+
+    memset(f, 0, sizeof(*f));
+    f->fd = fd;
+    w->cur = slot;
+    w->opened_ns = now_ns();
+    w->st.files++;
+    if (w->o.file_hdr_len)
+        return append(w, w->o.file_hdr, w->o.file_hdr_len);
+    return 0;
+}
+
+// --- Buffers ---
+
+// 다음 빈 버퍼로. 다 나가 있으면 하나 끝나기를 기다림
+static int next_buf(struct ksys_uring_writer *w)
+{
+    for (;;) {
+        for (unsigned int k = 1; k <= w->o.nbufs; k++) {
+            unsigned int i = (w->cur_buf + k) % w->o.nbufs;
+            if (!w->bufs[i].busy) {
+                w->cur_buf = i;
+                w->bufs[i].len = 0;
+                return 0;
+            }
+        }
+        reap(w);
+        if (w->err)
+            return -1;
+        if (w->st.inflight && wait_one(w) != 0)
+            return -1;
+    }
+}
+
+// 지금 버퍼의 앞 len 바이트를 지금 파일로 넘김. logical 은 실제 데이터 길이 (direct 패딩 제외).
+// 넘기지 않은 꼬리 (buf->len - len) 는 다음 버퍼 앞으로 옮김
+static int submit_buf(struct ksys_uring_writer *w, size_t len, size_t logical)
+{
+    struct ubuf *b = &w->bufs[w->cur_buf];
+    struct ufile *f = &w->files[w->cur];
+    size_t tail = b->len > len ? b->len - len : 0;
+    char *tail_src = b->p + len;
+
+    b->slot = w->cur;
+    b->off = f->off;
+    b->wlen = len;
+    b->done = 0;
+    b->busy = true;
+    f->off += len;
+    f->size += logical;
+    f->inflight++;
+    w->st.inflight++;
+    if (w->st.inflight > w->st.inflight_max)
+        w->st.inflight_max = w->st.inflight;
+    w->st.writes++;
+    w->st.bytes += logical;
+    if (queue_write(w, w->cur_buf) != 0 || ring_enter(w, 0) != 0) {
+        set_err(w, errno);
+        return -1;
+    }
+    reap(w);
+    if (next_buf(w) != 0)
+        return -1;
+    if (tail) {
+        memcpy(w->bufs[w->cur_buf].p, tail_src, tail);
+        w->bufs[w->cur_buf].len = tail;
+    }
+    return 0;
+}
+
+// 지금 버퍼를 넘김. final 이면 direct 라도 꼬리까지 (0 으로 채워서)
+static int push(struct ksys_uring_writer *w, bool final)
+{
+    struct ubuf *b = &w->bufs[w->cur_buf];
+    size_t len = b->len;
+
+    if (!len)
+        return 0;
+    if (!w->o.direct)
+        return submit_buf(w, len, len);
+    if (!final) {
+        len &= ~(size_t)(KSYS_URING_ALIGN - 1);
+        return len ? submit_buf(w, len, len) : 0;
+    }
+    {
+        size_t padded = (len + KSYS_URING_ALIGN - 1) & ~(size_t)(KSYS_URING_ALIGN - 1);
+        memset(b->p + len, 0, padded - len);
+        b->len = padded;
+        return submit_buf(w, padded, len);
+    }
+}
+
+static int rotate(struct ksys_uring_writer *w)
+{
+    int old = w->cur;
+
+    if (push(w, true) != 0)
+        return -1;
+    // 보통은 이미 열려 있음. 아니면 (디스크가 아주 느림) 앞 파일이 닫히고 다음 파일이 열리기를 기다림
+    while (w->next_state != NEXT_READY) {
+        if (w->next_state == NEXT_NONE)
+            prepare_next(w);
+        if (w->err)
+            return -1;
+        if (w->next_state == NEXT_NONE && !w->st.inflight) {
+            set_err(w, EIO);
+            return -1;
+        }
+        if (w->next_state != NEXT_READY && wait_one(w) != 0)
+            return -1;
+    }
+    w->files[old].retiring = true;
+    w->file_no++;
+    memcpy(w->path, w->next_path, sizeof(w->path));
+    w->next_state = NEXT_NONE;
+    if (start_file(w, old ^ 1, w->next_fd) != 0)
+        return -1;
+    if (!w->files[old].inflight)
+        retire_finish(w, old);
+    return 0;
+}
+
+static bool time_to_rotate(const struct ksys_uring_writer *w)
+{
+    return w->o.rotate_sec && now_ns() - w->opened_ns >= (uint64_t)w->o.rotate_sec * 1000000000ull;
+}
+
+static int append(struct ksys_uring_writer *w, const void *data, size_t len)
+{
+    const char *p = data;
+
+    while (len) {
+        struct ubuf *b = &w->bufs[w->cur_buf];
+        size_t k = w->o.buf_size - b->len;
+
+        if (k > len)
+            k = len;
+        memcpy(b->p + b->len, p, k);
+        b->len += k;
+        p += k;
+        len -= k;
+        if (b->len == w->o.buf_size) {
+            if (submit_buf(w, b->len, b->len) != 0)
+                return -1;
+            if (w->o.rotate_bytes && w->files[w->cur].off >= w->o.rotate_bytes && rotate(w) != 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+// --- API ---
+
+void ksys_uring_opts_init(struct ksys_uring_opts *o)
+{
+    memset(o, 0, sizeof(*o));
+}
+
+struct ksys_uring_writer *ksys_uring_open(const struct ksys_uring_opts *o)
+{
+    struct ksys_uring_writer *w;
+    struct iovec *iov = NULL;
+    int fds[2] = { -1, -1 };
+    int fd = -1, err;
+
+    if (!o->prefix || strlen(o->prefix) + 8 >= URING_PATH_MAX) {
+        errno = EINVAL;
+        return NULL;
+    }
+    w = calloc(1, sizeof(*w));
+    if (!w)
+        return NULL;
+    w->o = *o;
+    w->ring_fd = -1;
+    w->files[0].fd = w->files[1].fd = -1;
+    w->next_fd = -1;
+    if (!w->o.buf_size)
+        w->o.buf_size = URING_BUF_DEFAULT;
+    w->o.buf_size = (w->o.buf_size + KSYS_URING_ALIGN - 1) & ~(size_t)(KSYS_URING_ALIGN - 1);
+    if (!w->o.nbufs)
+        w->o.nbufs = URING_NBUFS_DEFAULT;
+    if (!w->o.prealloc)
+        w->o.prealloc = w->o.rotate_bytes;
+    // 헤더가 버퍼보다 크면 append 가 돌다가 rotate 로 다시 들어올 수 있음
+    if (w->o.file_hdr_len >= w->o.buf_size) {
+        errno = EINVAL;
+        goto fail;
+    }
+
+    w->bufs = calloc(w->o.nbufs, sizeof(*w->bufs));
+    iov = calloc(w->o.nbufs, sizeof(*iov));
+    if (!w->bufs || !iov)
+        goto fail;
+    for (unsigned int i = 0; i < w->o.nbufs; i++) {
+        if (posix_memalign((void **)&w->bufs[i].p, KSYS_URING_ALIGN, w->o.buf_size) != 0) {
+            errno = ENOMEM;
+            goto fail;
+        }
+        iov[i].iov_base = w->bufs[i].p;
+        iov[i].iov_len = w->o.buf_size;
+    }
+
+    // 쓰기 nbufs + open/fallocate 여유
+    if (ring_init(w, w->o.nbufs + 8) != 0)
+        goto fail;
+    if (sys_register(w->ring_fd, IORING_REGISTER_BUFFERS, iov, w->o.nbufs) < 0)
+        goto fail;
+    free(iov);
+    iov = NULL;
+
+    // 첫 파일은 바로 열고 공간을 잡음
+    w->file_no = 1;
+    make_path(w, w->path, w->file_no);
+    fd = open(w->path, open_flags(w), 0644);
+    if (fd < 0)
+        goto fail;
+    if (w->o.prealloc)
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)w->o.prealloc);
+    fds[0] = fd;
+    if (sys_register(w->ring_fd, IORING_REGISTER_FILES, fds, 2) < 0)
+        goto fail;
+    if (start_file(w, 0, fd) != 0)
+        goto fail;
+    fd = -1;
+    prepare_next(w);
+    return w;
+
+fail:
+    err = errno;
+    if (fd >= 0)
+        close(fd);
+    if (w->files[0].fd >= 0)
+        close(w->files[0].fd);
+    free(iov);
+    ring_free(w);
+    if (w->bufs) {
+        for (unsigned int i = 0; i < w->o.nbufs; i++)
+            free(w->bufs[i].p);
+    }
+    free(w->bufs);
+    free(w);
+    errno = err;
+    return NULL;
+}
+
+int ksys_uring_write(struct ksys_uring_writer *w, const void *data, size_t len)
+{
+    reap(w);
+    if (!w->err && time_to_rotate(w))
+        rotate(w);
+    if (w->err) {
+        errno = w->err;
+        return -1;
+    }
+    return append(w, data, len);
+}
+
+int ksys_uring_flush(struct ksys_uring_writer *w)
+{
+    reap(w);
+    if (!w->err) {
+        if (time_to_rotate(w))
+            rotate(w);
+        else
+            push(w, false);
+    }
+    if (w->err) {
+        errno = w->err;
+        return -1;
+    }
+    return 0;
+}
+
+int ksys_uring_close(struct ksys_uring_writer *w)
+{
+    int err;
+
+    // 닫는 동안 앞 파일이 끝나도 다음 파일을 또 열지 않게
+    w->o.rotate_bytes = 0;
+    w->o.rotate_sec = 0;
+    if (!w->err)
+        push(w, true);
+    // 나가 있는 것 (쓰기, 다음 파일 열기) 을 모두 거둠
+    while ((w->st.inflight || w->next_state == NEXT_OPENING || w->next_state == NEXT_ALLOC) &&
+           wait_one(w) == 0)
+        ;
+    for (int s = 0; s < 2; s++) {
+        if (w->files[s].fd >= 0 && w->files[s].retiring)
+            retire_finish(w, s);
+    }
+    if (w->files[w->cur].fd >= 0) {
+        w->files[w->cur].retiring = true;
+        retire_finish(w, w->cur);
+    }
+    // 미리 열어 둔 다음 파일은 쓰지 않았으니 지움
+    if (w->next_state == NEXT_READY && w->next_fd >= 0) {
+        close(w->next_fd);
+        unlink(w->next_path);
+    }
+    err = w->err;
+    ring_free(w);
+    for (unsigned int i = 0; i < w->o.nbufs; i++)
+        free(w->bufs[i].p);
+    free(w->bufs);
+    free(w);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+void ksys_uring_stats(const struct ksys_uring_writer *w, struct ksys_uring_stats *st)
+{
+    *st = w->st;
+}
+
+const char *ksys_uring_path(const struct ksys_uring_writer *w)
+{
+    return w->path;
+}
@@ -0,0 +1,680 @@
+// lib/ksys_wire.c
+// RAW / LP / MessagePack 쓰기와 읽기. 형식 설명은 include/ksys/ksys_wire.h
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <ksys/ksys_wire.h>
+
+#define KSYS_WIRE_BUF_DEFAULT   (256 * 1024)
+#define KSYS_WIRE_RBUF          (1024 * 1024)
+
+// LP payload: ksys_event 의 path 앞 | path 뒤 | path 문자열
+#define LP_HEAD     offsetof(struct ksys_event, path)
+#define LP_TAIL     (sizeof(struct ksys_event) - LP_HEAD - KSYS_PATH_LEN)
+#define LP_MAX      (4 + KSYS_WIRE_LP_FIXED + KSYS_PATH_LEN)
+
+// MessagePack 레코드 하나의 최대 길이 (키 14 개 + 문자열 2 개, 넉넉히)
+#define MP_MAX      512
+
+static const char *const fmt_names[] = {
+    [KSYS_WIRE_AUTO] = "auto",
+    [KSYS_WIRE_RAW] = "raw",
+    [KSYS_WIRE_LP] = "lp",
+    [KSYS_WIRE_MSGPACK] = "msgpack",
+};
+
+const char *ksys_wire_fmt_name(enum ksys_wire_fmt fmt)
+{
+    return (unsigned int)fmt <= KSYS_WIRE_MSGPACK ? fmt_names[fmt] : "?";
+}
+
+int ksys_wire_fmt_parse(const char *name)
+{
+    for (int f = KSYS_WIRE_RAW; f <= KSYS_WIRE_MSGPACK; f++) {
+        if (!strcmp(name, fmt_names[f]))
+            return f;
+    }
+    return -1;
+}
+
+// --- MessagePack Encoding ---
+
+static uint8_t *mp_be(uint8_t *p, uint64_t v, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; i--)
+        *p++ = (uint8_t)(v >> (i * 8));
+    return p;
+}
+
+static uint8_t *mp_uint(uint8_t *p, uint64_t v)
+{
+    if (v < 0x80) {
+        *p++ = (uint8_t)v;
+    } else if (v <= 0xff) {
+        *p++ = 0xcc;
+        *p++ = (uint8_t)v;
+    } else if (v <= 0xffff) {
+        *p++ = 0xcd;
+        p = mp_be(p, v, 2);
+    } else if (v <= 0xffffffffull) {
+        *p++ = 0xce;
+        p = mp_be(p, v, 4);
+    } else {
+        *p++ = 0xcf;
+        p = mp_be(p, v, 8);
+    }
+    return p;
+}
+
+static uint8_t *mp_int(uint8_t *p, int64_t v)
+{
+    if (v >= 0)
+        return mp_uint(p, (uint64_t)v);
+    if (v >= -32) {
+        *p++ = (uint8_t)(int8_t)v;      // negative fixint
+    } else if (v >= INT8_MIN) {
+        *p++ = 0xd0;
+        *p++ = (uint8_t)(int8_t)v;
+    } else if (v >= INT16_MIN) {
+        *p++ = 0xd1;
+        p = mp_be(p, (uint16_t)v, 2);
+    } else if (v >= INT32_MIN) {
+        *p++ = 0xd2;
+        p = mp_be(p, (uint32_t)v, 4);
+    } else {
+        *p++ = 0xd3;
+        p = mp_be(p, (uint64_t)v, 8);
+    }
+    return p;
+}
+
+static uint8_t *mp_str(uint8_t *p, const char *s, size_t n)
+{
+    if (n < 32) {
+        *p++ = (uint8_t)(0xa0 | n);
+    } else {
+        *p++ = 0xd9;        // 문자열은 KSYS_PATH_LEN 을 넘지 않음
+        *p++ = (uint8_t)n;
+    }
+    memcpy(p, s, n);
+    return p + n;
+}
+
+#define MP_KEY(p, k)    mp_str((p), (k), sizeof(k) - 1)
+
+static uint8_t *mp_cstr(uint8_t *p, const char *s, size_t max)
+{
+    return mp_str(p, s, strnlen(s, max));
+}
+
+static uint8_t *mp_record(uint8_t *p, const struct ksys_event *e)
+{
+    if (e->type == KSYS_REC_GAP) {
+        const struct ksys_gap *g = (const struct ksys_gap *)e;
+
+        *p++ = 0x86;
+        p = MP_KEY(p, "type");          p = MP_KEY(p, "gap");
+        p = MP_KEY(p, "seq");           p = mp_uint(p, g->seq);
+        p = MP_KEY(p, "ts_ns");         p = mp_uint(p, g->ts_ns);
+        p = MP_KEY(p, "lost_from_seq"); p = mp_uint(p, g->lost_from_seq);
+        p = MP_KEY(p, "lost_to_seq");   p = mp_uint(p, g->lost_to_seq);
+        p = MP_KEY(p, "count");         p = mp_uint(p, g->count);
+        return p;
+    }
+
+    if (e->type >= KSYS_REC_FORK && e->type <= KSYS_REC_EXIT) {
+        bool is_fork = e->type == KSYS_REC_FORK, is_exec = e->type == KSYS_REC_EXEC, is_exit = e->type == KSYS_REC_EXIT;
+
+        *p++ = (uint8_t)(0x80 | (6 + 2 * is_fork + 2 * is_exit + is_exec));
+        p = MP_KEY(p, "type");
+        p = is_fork ? MP_KEY(p, "fork") : is_exec ? MP_KEY(p, "exec") : MP_KEY(p, "exit");
+        p = MP_KEY(p, "seq");   p = mp_uint(p, e->seq);
+        p = MP_KEY(p, "ts_ns"); p = mp_uint(p, e->ts_ns);
+        p = MP_KEY(p, "pid");   p = mp_int(p, e->pid);
+        p = MP_KEY(p, "tgid");  p = mp_int(p, e->tgid);
+        if (is_fork) {
+            p = MP_KEY(p, "ppid");  p = mp_int(p, e->ppid);
+            p = MP_KEY(p, "ptgid"); p = mp_int(p, e->ptgid);
+        }
+        if (is_exit) {
+            p = MP_KEY(p, "exit_code");  p = mp_int(p, e->exit_code);
+            p = MP_KEY(p, "group_dead"); p = mp_uint(p, e->group_dead != 0);
+        }
+        p = MP_KEY(p, "comm"); p = mp_cstr(p, e->comm, sizeof(e->comm));
+        if (is_exec) {
+            p = MP_KEY(p, "path"); p = mp_cstr(p, e->path, sizeof(e->path));
+        }
+        return p;
+    }
+
+    bool ret = e->type == KSYS_REC_OPENAT_RET;
+
+    *p++ = (uint8_t)(0x80 | (ret ? 14 : 10));
+    p = MP_KEY(p, "type");  p = MP_KEY(p, "openat");
+    p = MP_KEY(p, "seq");   p = mp_uint(p, e->seq);
+    p = MP_KEY(p, "ts_ns"); p = mp_uint(p, e->ts_ns);
+    p = MP_KEY(p, "pid");   p = mp_int(p, e->pid);
+    p = MP_KEY(p, "tgid");  p = mp_int(p, e->tgid);
+    p = MP_KEY(p, "dfd");   p = mp_int(p, e->dfd);
+    p = MP_KEY(p, "flags"); p = mp_uint(p, (uint32_t)e->flags);
+    p = MP_KEY(p, "mode");  p = mp_uint(p, e->mode);
+    p = MP_KEY(p, "comm");  p = mp_cstr(p, e->comm, sizeof(e->comm));
+    p = MP_KEY(p, "path");  p = mp_cstr(p, e->path, sizeof(e->path));
+    if (ret) {
+        p = MP_KEY(p, "ret"); p = mp_int(p, e->ret);
+        p = MP_KEY(p, "dev"); p = mp_uint(p, e->dev);
+        p = MP_KEY(p, "ino"); p = mp_uint(p, e->ino);
+        p = MP_KEY(p, "gen"); p = mp_uint(p, e->gen);
+    }
+    return p;
+}
+
+// --- Writer ---
+
+int ksys_wire_writer_init(struct ksys_wire_writer *w, int fd, enum ksys_wire_fmt fmt, size_t cap)
+{
+    if (fmt < KSYS_WIRE_RAW || fmt > KSYS_WIRE_MSGPACK) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!cap)
+        cap = KSYS_WIRE_BUF_DEFAULT;
+    if (cap < 4 * (sizeof(struct ksys_event) + MP_MAX))
+        cap = 4 * (sizeof(struct ksys_event) + MP_MAX);
+    w->buf = malloc(cap);
+    if (!w->buf)
+        return -1;
+    w->fd = fd;
+    w->fmt = fmt;
+    w->len = 0;
+    w->cap = cap;
+    w->bytes = 0;
+
+    // 메모리 모드는 레코드만 (헤더는 실제로 쓰는 쪽이 한 번)
+    if (fd >= 0)
+        w->len = ksys_wire_hdr_init((struct ksys_wire_hdr *)w->buf, fmt);
+    return 0;
+}
+
+size_t ksys_wire_hdr_init(struct ksys_wire_hdr *h, enum ksys_wire_fmt fmt)
+{
+    if (fmt == KSYS_WIRE_MSGPACK)
+        return 0;
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, KSYS_WIRE_MAGIC, sizeof(h->magic));
+    h->version = KSYS_WIRE_VERSION;
+    h->format = (__u16)fmt;
+    h->rec_size = sizeof(struct ksys_event);
+    return sizeof(*h);
+}
+
+// iov 를 끝까지 (짧은 write 는 이어서)
+static int write_all(int fd, struct iovec *iov, int cnt, unsigned long long *bytes)
+{
+    while (cnt > 0) {
+        ssize_t r = writev(fd, iov, cnt);
+
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        *bytes += (size_t)r;
+        while (cnt > 0 && (size_t)r >= iov->iov_len) {
+            r -= (ssize_t)iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + r;
+            iov->iov_len -= (size_t)r;
+        }
+    }
+    return 0;
+}
+
+int ksys_wire_flush(struct ksys_wire_writer *w)
+{
+    struct iovec iov = { .iov_base = w->buf, .iov_len = w->len };
+    int rc;
+
+    if (!w->len || w->fd < 0)
+        return 0;
+    rc = write_all(w->fd, &iov, 1, &w->bytes);
+    w->len = 0;         // 실패해도 버림 (다음 배치가 밀리지 않게)
+    return rc;
+}
+
+void ksys_wire_writer_free(struct ksys_wire_writer *w)
+{
+    if (!w->buf)
+        return;
+    ksys_wire_flush(w);
+    free(w->buf);
+    w->buf = NULL;
+}
+
+// 메모리 모드에서는 비우는 대신 버퍼를 늘림
+static int make_room(struct ksys_wire_writer *w, size_t n)
+{
+    size_t cap = w->cap;
+    char *buf;
+
+    if (w->fd >= 0)
+        return ksys_wire_flush(w);
+    while (cap < w->len + n)
+        cap *= 2;
+    buf = realloc(w->buf, cap);
+    if (!buf)
+        return -1;
+    w->buf = buf;
+    w->cap = cap;
+    return 0;
+}
+
+static int write_raw(struct ksys_wire_writer *w, const struct ksys_event *ev, size_t n)
+{
+    size_t bytes = n * sizeof(*ev);
+
+    if (bytes >= w->cap / 4 && w->fd >= 0) {
+        struct iovec iov[2] = {
+            { .iov_base = w->buf, .iov_len = w->len },
+            { .iov_base = (void *)ev, .iov_len = bytes },
+        };
+        int rc = write_all(w->fd, w->len ? iov : iov + 1, w->len ? 2 : 1, &w->bytes);
+
+        w->len = 0;
+        return rc;
+    }
+    if (w->len + bytes > w->cap && make_room(w, bytes) != 0)
+        return -1;
+    memcpy(w->buf + w->len, ev, bytes);
+    w->len += bytes;
+    return 0;
+}
+
+int ksys_wire_write(struct ksys_wire_writer *w, const struct ksys_event *ev, size_t n)
+{
+    if (w->fmt == KSYS_WIRE_RAW)
+        return write_raw(w, ev, n);
+
+    for (size_t k = 0; k < n; k++) {
+        const struct ksys_event *e = &ev[k];
+        size_t max = w->fmt == KSYS_WIRE_LP ? LP_MAX : MP_MAX;
+
+        if (w->len + max > w->cap && make_room(w, max) != 0)
+            return -1;
+        if (w->fmt == KSYS_WIRE_LP) {
+            size_t plen = strnlen(e->path, sizeof(e->path));
+            __u32 len = (__u32)(KSYS_WIRE_LP_FIXED + plen);
+            char *p = w->buf + w->len;
+
+            memcpy(p, &len, 4);
+            memcpy(p + 4, e, LP_HEAD);
+            memcpy(p + 4 + LP_HEAD, (const char *)e + LP_HEAD + KSYS_PATH_LEN, LP_TAIL);
+            memcpy(p + 4 + KSYS_WIRE_LP_FIXED, e->path, plen);
+            w->len += 4 + len;
+        } else {
+            uint8_t *p = mp_record((uint8_t *)w->buf + w->len, e);
+            w->len = (size_t)((char *)p - w->buf);
+        }
+    }
+    return 0;
+}
+
+// --- MessagePack Decoding ---
+// 이 파일이 쓰는 타입만 (map, str, int/uint). 다른 것이 나오면 EPROTO
+
+enum { MP_OK = 0, MP_MORE, MP_BAD };
+
+struct mp_cur {
+    const uint8_t *p;
+    const uint8_t *end;
+    int err;
+};
+
+static const uint8_t *mp_take(struct mp_cur *c, size_t n)
+{
+    const uint8_t *p = c->p;
+
+    if (c->err)
+        return NULL;
+    if ((size_t)(c->end - c->p) < n) {
+        c->err = MP_MORE;
+        return NULL;
+    }
+    c->p += n;
+    return p;
+}
+
+static uint64_t mp_get_be(struct mp_cur *c, int bytes)
+{
+    const uint8_t *p = mp_take(c, (size_t)bytes);
+    uint64_t v = 0;
+
+    for (int i = 0; p && i < bytes; i++)
+        v = v << 8 | p[i];
+    return v;
+}
+
+static uint32_t mp_get_map(struct mp_cur *c)
+{
+    const uint8_t *t = mp_take(c, 1);
+
+    if (!t)
+        return 0;
+    if ((*t & 0xf0) == 0x80)
+        return *t & 0x0f;
+    if (*t == 0xde)
+        return (uint32_t)mp_get_be(c, 2);
+    c->err = MP_BAD;
+    return 0;
+}
+
+// 문자열이면 위치와 길이
+static const char *mp_get_str(struct mp_cur *c, size_t *n)
+{
+    const uint8_t *t = mp_take(c, 1);
+
+    if (!t)
+        return NULL;
+    if ((*t & 0xe0) == 0xa0)
+        *n = *t & 0x1f;
+    else if (*t == 0xd9)
+        *n = (size_t)mp_get_be(c, 1);
+    else if (*t == 0xda)
+        *n = (size_t)mp_get_be(c, 2);
+    else {
+        c->err = MP_BAD;
+        return NULL;
+    }
+    return (const char *)mp_take(c, *n);
+}
+
+// 정수 (부호 있든 없든 int64 로)
+static int64_t mp_get_int(struct mp_cur *c)
+{
+    const uint8_t *t = mp_take(c, 1);
+
+    if (!t)
+        return 0;
+    if (*t < 0x80)
+        return *t;
+    if (*t >= 0xe0)
+        return (int8_t)*t;
+    switch (*t) {
+        case 0xcc: return (int64_t)mp_get_be(c, 1);
+        case 0xcd: return (int64_t)mp_get_be(c, 2);
+        case 0xce: return (int64_t)mp_get_be(c, 4);
+        case 0xcf: return (int64_t)mp_get_be(c, 8);
+        case 0xd0: return (int8_t)mp_get_be(c, 1);
+        case 0xd1: return (int16_t)mp_get_be(c, 2);
+        case 0xd2: return (int32_t)mp_get_be(c, 4);
+        case 0xd3: return (int64_t)mp_get_be(c, 8);
+    }
+    c->err = MP_BAD;
+    return 0;
+}
+
+#define KEY_IS(k, n, lit)   ((n) == sizeof(lit) - 1 && !memcmp((k), (lit), (n)))
+
+// map 하나 -> e. 실패하면 c->err
+static void mp_decode(struct mp_cur *c, struct ksys_event *e)
+{
+    struct ksys_gap *g = (struct ksys_gap *)e;
+    uint32_t cnt = mp_get_map(c);
+    bool has_ret = false;
+
+    memset(e, 0, sizeof(*e));
+    e->type = KSYS_REC_OPENAT;
+    for (uint32_t i = 0; i < cnt && !c->err; i++) {
+        size_t kn, vn;
+        const char *k = mp_get_str(c, &kn);
+
+        if (!k)
+            return;
+        if (KEY_IS(k, kn, "type")) {
+            const char *v = mp_get_str(c, &vn);
+            if (!v)
+                return;
+            if (KEY_IS(v, vn, "gap")) e->type = KSYS_REC_GAP;
+            else if (KEY_IS(v, vn, "fork")) e->type = KSYS_REC_FORK;
+            else if (KEY_IS(v, vn, "exec")) e->type = KSYS_REC_EXEC;
+            else if (KEY_IS(v, vn, "exit")) e->type = KSYS_REC_EXIT;
+            else if (!KEY_IS(v, vn, "openat")) c->err = MP_BAD;
+        } else if (KEY_IS(k, kn, "comm") || KEY_IS(k, kn, "path")) {
+            bool comm = k[0] == 'c';
+            char *dst = comm ? e->comm : e->path;
+            size_t max = comm ? sizeof(e->comm) : sizeof(e->path);
+            const char *v = mp_get_str(c, &vn);
+            if (!v)
+                return;
+            if (vn > max)
+                vn = max;       // 쓸 때와 같이 NUL 없이 꽉 찬 것도 그대로
+            memcpy(dst, v, vn);
+        } else {
+            int64_t v = mp_get_int(c);
+            if (c->err)
+                return;
+            // lost_* 는 ksys_gap 자리에 (gap 레코드에는 pid 등이 없어서 겹치지 않음)
+            if (KEY_IS(k, kn, "seq")) e->seq = (__u64)v;
+            else if (KEY_IS(k, kn, "ts_ns")) e->ts_ns = (__u64)v;
+            else if (KEY_IS(k, kn, "lost_from_seq")) g->lost_from_seq = (__u64)v;
+            else if (KEY_IS(k, kn, "lost_to_seq")) g->lost_to_seq = (__u64)v;
+            else if (KEY_IS(k, kn, "count")) g->count = (__u64)v;
+            else if (KEY_IS(k, kn, "pid")) e->pid = (__s32)v;
+            else if (KEY_IS(k, kn, "tgid")) e->tgid = (__s32)v;
+            else if (KEY_IS(k, kn, "dfd")) e->dfd = (__s32)v;
+            else if (KEY_IS(k, kn, "ppid")) e->ppid = (__s32)v;
+            else if (KEY_IS(k, kn, "flags")) e->flags = (__s32)v;
+            else if (KEY_IS(k, kn, "ptgid")) e->ptgid = (__s32)v;
+            else if (KEY_IS(k, kn, "mode")) e->mode = (__u16)v;
+            else if (KEY_IS(k, kn, "ret")) { e->ret = (__s32)v; has_ret = true; }
+            else if (KEY_IS(k, kn, "exit_code")) e->exit_code = (__s32)v;
+            else if (KEY_IS(k, kn, "group_dead")) e->group_dead = (__s32)v;
+            else if (KEY_IS(k, kn, "dev")) e->dev = (__u32)v;
+            else if (KEY_IS(k, kn, "gen")) e->gen = (__u32)v;
+            else if (KEY_IS(k, kn, "ino")) e->ino = (__u64)v;
+            // 모르는 정수 키는 건너뜀 (뒤에 필드가 늘어도 읽히게)
+        }
+    }
+    if (e->type == KSYS_REC_GAP)
+        g->type = KSYS_REC_GAP;
+    else if (e->type == KSYS_REC_OPENAT && has_ret)
+        e->type = KSYS_REC_OPENAT_RET;
+}
+
+// --- Reader ---
+
+struct ksys_wire_reader {
+    int fd;
+    enum ksys_wire_fmt fmt;
+    uint8_t *buf;
+    size_t pos;         // 아직 안 읽은 시작
+    size_t end;         // 채워진 끝
+    bool eof;
+};
+
+// 남은 것을 앞으로 당기고 한 번 더 read. 반환: 읽은 바이트, 끝 0, 실패 -1
+static ssize_t fill(struct ksys_wire_reader *r)
+{
+    ssize_t n;
+
+    if (r->pos) {
+        memmove(r->buf, r->buf + r->pos, r->end - r->pos);
+        r->end -= r->pos;
+        r->pos = 0;
+    }
+    if (r->eof || r->end == KSYS_WIRE_RBUF)
+        return 0;
+    do {
+        n = read(r->fd, r->buf + r->end, KSYS_WIRE_RBUF - r->end);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0)
+        return -1;
+    if (n == 0)
+        r->eof = true;
+    r->end += (size_t)n;
+    return n;
+}
+
+// 적어도 need 바이트가 모일 때까지. 모자란 채로 끝나면 -1
+static int want(struct ksys_wire_reader *r, size_t need)
+{
+    while (r->end - r->pos < need) {
+        ssize_t n = fill(r);
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            return r->end - r->pos == 0 ? 0 : -2;
+    }
+    return 1;
+}
+
+struct ksys_wire_reader *ksys_wire_reader_open(int fd, enum ksys_wire_fmt fmt)
+{
+    struct ksys_wire_reader *r = calloc(1, sizeof(*r));
+    struct ksys_wire_hdr h;
+    int rc;
+
+    if (!r)
+        return NULL;
+    r->buf = malloc(KSYS_WIRE_RBUF);
+    if (!r->buf)
+        goto fail;
+    r->fd = fd;
+
+    rc = want(r, sizeof(KSYS_WIRE_MAGIC) - 1);
+    if (rc == -1)
+        goto fail;
+    if (rc == 1 && !memcmp(r->buf, KSYS_WIRE_MAGIC, sizeof(KSYS_WIRE_MAGIC) - 1)) {
+        if (fmt == KSYS_WIRE_MSGPACK || want(r, sizeof(h)) != 1)
+            goto bad;
+        memcpy(&h, r->buf, sizeof(h));
+        if (h.version != KSYS_WIRE_VERSION || h.rec_size != sizeof(struct ksys_event) ||
+            (h.format != KSYS_WIRE_RAW && h.format != KSYS_WIRE_LP) ||
+            (fmt != KSYS_WIRE_AUTO && fmt != h.format))
+            goto bad;
+        r->fmt = (enum ksys_wire_fmt)h.format;
+        r->pos = sizeof(h);
+    } else {
+        // 헤더가 없으면 MessagePack 만 가능 (빈 입력도 여기로)
+        if (fmt != KSYS_WIRE_AUTO && fmt != KSYS_WIRE_MSGPACK)
+            goto bad;
+        r->fmt = KSYS_WIRE_MSGPACK;
+    }
+    return r;
+
+bad:
+    errno = EPROTO;
+fail:
+    rc = errno;
+    ksys_wire_reader_close(r);
+    errno = rc;
+    return NULL;
+}
+
+void ksys_wire_reader_close(struct ksys_wire_reader *r)
+{
+    if (!r)
+        return;
+    free(r->buf);
+    free(r);
+}
+
+enum ksys_wire_fmt ksys_wire_reader_fmt(const struct ksys_wire_reader *r)
+{
+    return r->fmt;
+}
+
+// 버퍼에 있는 것만으로 레코드 하나. 1 성공, 0 더 필요, -1 깨짐
+static int parse_one(struct ksys_wire_reader *r, struct ksys_event *e)
+{
+    const uint8_t *p = r->buf + r->pos;
+    size_t avail = r->end - r->pos;
+
+    switch (r->fmt) {
+        case KSYS_WIRE_RAW:
+            if (avail < sizeof(*e))
+                return 0;
+            memcpy(e, p, sizeof(*e));
+            r->pos += sizeof(*e);
+            return 1;
+        case KSYS_WIRE_LP: {
+            __u32 len;
+
+            if (avail < 4)
+                return 0;
+            memcpy(&len, p, 4);
+            if (len < KSYS_WIRE_LP_FIXED || len > KSYS_WIRE_LP_FIXED + KSYS_PATH_LEN)
+                return -1;
+            if (avail < 4 + (size_t)len)
+                return 0;
+            memset(e, 0, sizeof(*e));
+            memcpy(e, p + 4, LP_HEAD);
+            memcpy((char *)e + LP_HEAD + KSYS_PATH_LEN, p + 4 + LP_HEAD, LP_TAIL);
+            memcpy(e->path, p + 4 + KSYS_WIRE_LP_FIXED, len - KSYS_WIRE_LP_FIXED);
+            r->pos += 4 + (size_t)len;
+            return 1;
+        }
+        default: {
+            struct mp_cur c = { .p = p, .end = p + avail, .err = MP_OK };
+
+            mp_decode(&c, e);
+            if (c.err == MP_MORE)
+                return 0;
+            if (c.err)
+                return -1;
+            r->pos += (size_t)(c.p - p);
+            return 1;
+        }
+    }
+}
+
+ssize_t ksys_wire_read(struct ksys_wire_reader *r, struct ksys_event *out, size_t max)
+{
+    size_t n = 0;
+
+    // RAW 는 통째로 복사
+    if (r->fmt == KSYS_WIRE_RAW && r->end - r->pos >= sizeof(*out)) {
+        n = (r->end - r->pos) / sizeof(*out);
+        if (n > max)
+            n = max;
+        memcpy(out, r->buf + r->pos, n * sizeof(*out));
+        r->pos += n * sizeof(*out);
+        return (ssize_t)n;
+    }
+
+    while (n < max) {
+        int rc = parse_one(r, &out[n]);
+
+        if (rc < 0) {
+            errno = EPROTO;
+            return -1;
+        }
+        if (rc > 0) {
+            n++;
+            continue;
+        }
+        // 버퍼에 있던 것은 다 냈으면 일단 돌려주고, 하나도 없을 때만 더 읽음
+        if (n)
+            break;
+        ssize_t got = fill(r);
+        if (got < 0)
+            return -1;
+        if (got == 0) {
+            if (r->end != r->pos) {
+                errno = EPROTO;     // 레코드 중간에서 끝남 (또는 버퍼보다 큰 레코드)
+                return -1;
+            }
+            return 0;
+        }
+    }
+    return (ssize_t)n;
+}
@@ -0,0 +1,509 @@
+// lib/ksysd_client.c
+// ksysd 에 붙는 클라이언트 쪽. 프로토콜은 include/ksys/ksysd.h
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksysd.h>
+
+void ksysd_filter_init(struct ksysd_filter *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->pid = -1;
+    f->tgid = -1;
+}
+
+static int send_filter(int fd, __u16 type, const struct ksysd_filter *f, const struct ksysd_qos *qos)
+{
+    struct ksysd_hello m;
+
+    memset(&m, 0, sizeof(m));
+    m.h.type = type;
+    m.h.version = KSYSD_VERSION;
+    if (f)
+        m.filter = *f;
+    else
+        ksysd_filter_init(&m.filter);
+    if (qos)
+        m.qos = *qos;
+    if (send(fd, &m, sizeof(m), MSG_NOSIGNAL) != (ssize_t)sizeof(m))
+        return -1;
+    return 0;
+}
+
+// path 가 NULL 이면 KSYSD_SOCK_PATH. 실패 -1 (errno)
+static int dial(const char *path)
+{
+    struct sockaddr_un sa;
+    int fd, err;
+
+    if (!path)
+        path = KSYSD_SOCK_PATH;
+    if (strlen(path) >= sizeof(sa.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strcpy(sa.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+int ksysd_client_open(struct ksysd_client *c, const char *path, const struct ksysd_filter *f,
+                      const struct ksysd_qos *qos)
+{
+    ssize_t r;
+    int err;
+
+    memset(c, 0, sizeof(c[0]));
+    c->fd = -1;
+    c->buf = malloc(KSYSD_MSG_MAX);
+    if (!c->buf)
+        return -1;
+    c->fd = dial(path);
+    if (c->fd < 0)
+        goto fail;
+    if (send_filter(c->fd, KSYSD_MSG_HELLO, f, qos) != 0)
+        goto fail;
+
+    // WELCOME 전에 EVENTS 가 올 일은 없음 (필터는 WELCOME 을 보낸 뒤에 켜짐)
+    do {
+        r = recv(c->fd, &c->info, sizeof(c->info), 0);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0)
+        goto fail;
+    if (r != (ssize_t)sizeof(c->info) || c->info.h.type != KSYSD_MSG_WELCOME ||
+        c->info.h.version != KSYSD_VERSION || c->info.rec_size != sizeof(struct ksys_event)) {
+        errno = r == 0 ? EPIPE : EPROTO;
+        goto fail;
+    }
+    c->drops = c->info.h.drops;
+    c->sample = 1;
+    return 0;
+
+fail:
+    err = errno;
+    ksysd_client_close(c);
+    errno = err;
+    return -1;
+}
+
+void ksysd_client_close(struct ksysd_client *c)
+{
+    if (c->fd >= 0)
+        close(c->fd);
+    c->fd = -1;
+    free(c->buf);
+    c->buf = NULL;
+}
+
+int ksysd_client_set_filter(struct ksysd_client *c, const struct ksysd_filter *f)
+{
+    return send_filter(c->fd, KSYSD_MSG_FILTER, f, NULL);
+}
+
+ssize_t ksysd_client_recv(struct ksysd_client *c, int timeout_ms, const struct ksys_event **ev)
+{
+    struct ksysd_hdr *h = c->buf;
+    ssize_t r;
+
+    for (;;) {
+        if (timeout_ms >= 0) {
+            struct pollfd p = { .fd = c->fd, .events = POLLIN };
+            int pr = poll(&p, 1, timeout_ms);
+
+            if (pr < 0)
+                return -1;
+            if (pr == 0)
+                return 0;
+        }
+        r = recv(c->fd, c->buf, KSYSD_MSG_MAX, 0);
+        if (r < 0)
+            return -1;
+        if (r == 0) {
+            errno = EPIPE;
+            return -1;
+        }
+        if ((size_t)r < sizeof(*h)) {
+            errno = EPROTO;
+            return -1;
+        }
+        if (h->type == KSYSD_MSG_AGG) {
+            if (h->n > KSYSD_AGG_MAX ||
+                (size_t)r != sizeof(*h) + sizeof(c->agg) + h->n * sizeof(struct ksysd_agg_ent)) {
+                errno = EPROTO;
+                return -1;
+            }
+            memcpy(&c->agg, h + 1, sizeof(c->agg));
+            memcpy(c->agg_ent, (const char *)(h + 1) + sizeof(c->agg), h->n * sizeof(struct ksysd_agg_ent));
+            c->agg_n = h->n;
+            c->aggs++;
+            c->lost = h->lost;
+            c->skipped = h->skipped;
+            c->drops = h->drops;
+            return 0;
+        }
+        // 모르는 메시지는 건너뜀 (새 데몬이 더 보내는 것)
+        if (h->type != KSYSD_MSG_EVENTS)
+            continue;
+        if (h->n > KSYSD_BATCH_MAX || (size_t)r != sizeof(*h) + h->n * sizeof(struct ksys_event)) {
+            errno = EPROTO;
+            return -1;
+        }
+        c->lost = h->lost;
+        c->skipped = h->skipped;
+        c->drops = h->drops;
+        c->sample = h->sample;
+        *ev = (const struct ksys_event *)(h + 1);
+        return h->n;
+    }
+}
+
+// 질의용 연결. 데몬이 멈춰도 묻는 쪽이 매달리지 않게 보내기/받기에 제한을 걸어 둠
+static int dial_query(const char *path)
+{
+    struct timeval tv = {
+        .tv_sec = KSYSD_QUERY_TIMEOUT_MS / 1000,
+        .tv_usec = (KSYSD_QUERY_TIMEOUT_MS % 1000) * 1000,
+    };
+    int fd;
+
+    fd = dial(path);
+    if (fd < 0)
+        return -1;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+int ksysd_query_stats(const char *path, struct ksysd_client_stat *out, int max)
+{
+    struct ksysd_hdr req, *h;
+    ssize_t r;
+    int fd, n, err;
+
+    fd = dial_query(path);
+    if (fd < 0)
+        return -1;
+    h = malloc(KSYSD_STATS_MSG_MAX);
+    if (!h) {
+        close(fd);
+        return -1;
+    }
+    memset(&req, 0, sizeof(req));
+    req.type = KSYSD_MSG_STATS;
+    req.version = KSYSD_VERSION;
+    n = -1;
+    if (send(fd, &req, sizeof(req), MSG_NOSIGNAL) != (ssize_t)sizeof(req))
+        goto out;
+    do {
+        r = recv(fd, h, KSYSD_STATS_MSG_MAX, 0);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0)
+        goto out;
+    if (r < (ssize_t)sizeof(*h) || h->type != KSYSD_MSG_STATS || h->version != KSYSD_VERSION ||
+        (size_t)r != sizeof(*h) + h->n * sizeof(struct ksysd_client_stat)) {
+        errno = r == 0 ? EPIPE : EPROTO;
+        goto out;
+    }
+    n = (int)h->n < max ? (int)h->n : max;
+    memcpy(out, h + 1, n * sizeof(*out));
+out:
+    err = errno;
+    free(h);
+    close(fd);
+    errno = err;
+    return n;
+}
+
+int ksysd_query_open(const char *path)
+{
+    return dial_query(path);
+}
+
+int ksysd_query_topk_fd(int fd, enum ksys_topk_dim dim, __u32 window_sec, struct ksys_topk_item *out, int max,
+                        struct ksysd_topk *info)
+{
+    struct ksysd_topk_req req;
+    struct ksysd_hdr *h;
+    const struct ksysd_topk *ti;
+    ssize_t r;
+    int n, err;
+
+    h = malloc(KSYSD_TOPK_MSG_MAX);
+    if (!h)
+        return -1;
+    memset(&req, 0, sizeof(req));
+    req.h.type = KSYSD_MSG_TOPK;
+    req.h.version = KSYSD_VERSION;
+    req.dim = (__u16)dim;
+    req.max = max > 0 && max < KSYSD_TOPK_MAX ? (__u16)max : KSYSD_TOPK_MAX;
+    req.window_sec = window_sec;
+    n = -1;
+    if (send(fd, &req, sizeof(req), MSG_NOSIGNAL) != (ssize_t)sizeof(req))
+        goto out;
+    do {
+        r = recv(fd, h, KSYSD_TOPK_MSG_MAX, 0);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0)
+        goto out;
+    if (r < (ssize_t)(sizeof(*h) + sizeof(*ti)) || h->type != KSYSD_MSG_TOPK || h->version != KSYSD_VERSION ||
+        (size_t)r != sizeof(*h) + sizeof(*ti) + h->n * sizeof(struct ksys_topk_item)) {
+        errno = r == 0 ? EPIPE : EPROTO;
+        goto out;
+    }
+    ti = (const struct ksysd_topk *)(h + 1);
+    if (info)
+        *info = *ti;
+    if (!ti->window_max) {
+        errno = EOPNOTSUPP;
+        goto out;
+    }
+    n = (int)h->n < max ? (int)h->n : max;
+    memcpy(out, ti + 1, n * sizeof(*out));
+out:
+    err = errno;
+    free(h);
+    errno = err;
+    return n;
+}
+
+int ksysd_query_topk(const char *path, enum ksys_topk_dim dim, __u32 window_sec, struct ksys_topk_item *out,
+                     int max, struct ksysd_topk *info)
+{
+    int fd, n, err;
+
+    fd = dial_query(path);
+    if (fd < 0)
+        return -1;
+    n = ksysd_query_topk_fd(fd, dim, window_sec, out, max, info);
+    err = errno;
+    close(fd);
+    errno = err;
+    return n;
+}
+
+// --- Shared Ring ---
+
+// SHM 응답과 함께 온 memfd. 실패 -1 (errno)
+static int recv_ring_fd(int sock)
+{
+    struct ksysd_hdr h;
+    struct iovec iov = { .iov_base = &h, .iov_len = sizeof(h) };
+    union {
+        struct cmsghdr c;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } u;
+    struct msghdr mh;
+    struct cmsghdr *cm;
+    ssize_t r;
+    int fd = -1;
+
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = u.buf;
+    mh.msg_controllen = sizeof(u.buf);
+    do {
+        r = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0)
+        return -1;
+    cm = CMSG_FIRSTHDR(&mh);
+    if (cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS &&
+        cm->cmsg_len == CMSG_LEN(sizeof(int)))
+        memcpy(&fd, CMSG_DATA(cm), sizeof(int));
+    if (r != (ssize_t)sizeof(h) || h.type != KSYSD_MSG_SHM || h.version != KSYSD_VERSION || fd < 0) {
+        if (fd >= 0)
+            close(fd);
+        // 링을 끈 데몬은 fd 없이 응답함
+        errno = r == 0 ? EPIPE : fd < 0 && r == (ssize_t)sizeof(h) ? ENOTSUP : EPROTO;
+        return -1;
+    }
+    return fd;
+}
+
+int ksysd_shm_open(struct ksysd_shm *s, const char *path, const struct ksysd_filter *f)
+{
+    const struct ksysd_shm_hdr *h;
+    struct ksysd_hdr req;
+    struct stat st;
+    void *p;
+    int fd, err;
+
+    memset(s, 0, sizeof(*s));
+    s->fd = dial(path);
+    if (s->fd < 0)
+        return -1;
+    memset(&req, 0, sizeof(req));
+    req.type = KSYSD_MSG_SHM;
+    req.version = KSYSD_VERSION;
+    if (send(s->fd, &req, sizeof(req), MSG_NOSIGNAL) != (ssize_t)sizeof(req))
+        goto fail;
+    fd = recv_ring_fd(s->fd);
+    if (fd < 0)
+        goto fail;
+    err = fstat(fd, &st) != 0 ? errno : (size_t)st.st_size < sizeof(*h) ? EPROTO : 0;
+    if (err) {
+        close(fd);
+        errno = err;
+        goto fail;
+    }
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    err = errno;
+    close(fd);
+    if (p == MAP_FAILED) {
+        errno = err;
+        goto fail;
+    }
+    h = p;
+    s->hdr = h;
+    s->map_len = st.st_size;
+    if (memcmp(h->magic, KSYSD_SHM_MAGIC, 8) || h->version != KSYSD_VERSION ||
+        h->rec_size != sizeof(struct ksys_event) || h->slot_size != sizeof(struct ksys_mmap_slot) ||
+        !h->ring_size || (h->ring_size & (h->ring_size - 1)) || h->map_size > s->map_len ||
+        h->data_off + (__u64)h->ring_size * h->slot_size > h->map_size) {
+        errno = EPROTO;
+        goto fail;
+    }
+    s->slots = (const struct ksys_mmap_slot *)((const char *)p + h->data_off);
+    s->mask = h->ring_size - 1;
+    s->cur.next_seq = ksys_load_acquire(&h->cur_seq);
+    if (f)
+        s->filter = *f;
+    else
+        ksysd_filter_init(&s->filter);
+    s->flt_all = s->filter.pid == -1 && s->filter.tgid == -1 && !s->filter.comm[0] && !s->filter.types &&
+                 !s->filter.path_prefix[0];
+    return 0;
+
+fail:
+    err = errno;
+    ksysd_shm_close(s);
+    errno = err;
+    return -1;
+}
+
+void ksysd_shm_close(struct ksysd_shm *s)
+{
+    if (s->hdr)
+        munmap((void *)s->hdr, s->map_len);
+    if (s->fd >= 0)
+        close(s->fd);
+    s->hdr = NULL;
+    s->fd = -1;
+}
+
+static bool shm_match(const struct ksysd_filter *f, const struct ksys_event *ev)
+{
+    if (ev->type == KSYS_REC_GAP)
+        return true;
+    if (f->types && (ev->type >= 32 || !(f->types & (1u << ev->type))))
+        return false;
+    if (f->pid != -1 && ev->pid != f->pid)
+        return false;
+    if (f->tgid != -1 && ev->tgid != f->tgid)
+        return false;
+    if (f->comm[0] && strncmp(ev->comm, f->comm, KSYS_COMM_LEN))
+        return false;
+    if (f->path_prefix[0]) {
+        if (!ksysd_rec_has_path(ev->type))
+            return false;
+        if (strncmp(ev->path, f->path_prefix, strnlen(f->path_prefix, KSYS_PATH_LEN)))
+            return false;
+    }
+    return true;
+}
+
+static __u64 shm_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (__u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// libsys 의 mmap 백엔드와 같은 순서: skip -> gap -> 필터 통과한 것만 복사
+size_t ksysd_shm_read(struct ksysd_shm *s, struct ksys_event *out, size_t max)
+{
+    struct ksys_cursor *c = &s->cur;
+    size_t n = 0;
+    __u64 cur;
+
+    if (!max)
+        return 0;
+    cur = ksys_load_acquire(&s->hdr->cur_seq);
+    ksys_cursor_skip(c, ksys_ring_oldest(cur, s->hdr->ring_size, 0), true);
+
+    n += ksys_cursor_gap(c, &out[n], shm_now_ns());
+
+    while (n < max && c->next_seq < cur) {
+        __u64 pos = c->next_seq;
+
+        // 복사하는 사이 덮어써졌으면 데몬이 한 바퀴 앞선 것. 지금 링에 남은 곳까지 유실로 건너뜀
+        if (!ksys_slot_read(ksys_ring_slot((struct ksys_mmap_slot *)s->slots, s->mask, pos), pos, &out[n])) {
+            __u64 oldest;
+
+            cur = ksys_load_acquire(&s->hdr->cur_seq);
+            oldest = ksys_ring_oldest(cur, s->hdr->ring_size, 0);
+            ksys_cursor_skip(c, oldest > pos ? oldest : pos + 1, true);
+            n += ksys_cursor_gap(c, &out[n], shm_now_ns());
+            continue;
+        }
+        c->next_seq++;
+        if (s->flt_all || shm_match(&s->filter, &out[n]))
+            n++;
+    }
+    return n;
+}
+
+int ksysd_shm_wait(struct ksysd_shm *s, int timeout_ms)
+{
+    const struct ksysd_shm_hdr *h = s->hdr;
+    struct timespec ts, *tp = NULL;
+
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+        tp = &ts;
+    }
+    for (;;) {
+        // futex 값을 먼저 읽어야 그 뒤에 나온 배치에서 FUTEX_WAIT 가 바로 돌아옴
+        __u32 v = ksys_load_acquire(&h->futex);
+
+        if (s->cur.gap_pending || s->cur.next_seq < ksys_load_acquire(&h->cur_seq))
+            return 1;
+        if (KSYS_READ_ONCE(h->flags) & KSYSD_SHM_CLOSED) {
+            errno = EPIPE;
+            return -1;
+        }
+        if (timeout_ms == 0)
+            return 0;
+        if (syscall(SYS_futex, &h->futex, FUTEX_WAIT, v, tp, NULL, 0) != 0) {
+            if (errno == ETIMEDOUT)
+                return 0;
+            if (errno != EAGAIN)
+                return -1;
+        }
+    }
+}
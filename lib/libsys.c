@@ -0,0 +1,482 @@
+// lib/libsys.c
+// libksys: /dev/ksys_trace (또는 fanotify) 소비자 라이브러리. API 는 include/ksys/ksys.h
+//
+// 백엔드별로 읽는 방법만 다르고 결과는 항상 ksys_event 배열 (gap 레코드 포함).
+// 받는 버퍼는 open 때 batch 개만큼 한 번 잡고, 배치마다 syscall 은 상수 개.
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys.h>
+#include <ksys/ksys_fanotify.h>
+
+#define KSYS_BATCH_DEFAULT  1024
+#define KSYS_MAP_TRIES      8       // ksys_map 이 리사이즈와 엇갈렸을 때 다시 해 보는 횟수
+
+struct ksys {
+    enum ksys_backend be;
+    int fd;                     // 장치 fd (FANOTIFY 면 -1)
+    struct ksys_fan *fan;
+    struct ksys_filter flt;
+    bool flt_all;               // 필터가 비었으면 MMAP 에서 비교 생략
+    __u32 opts;
+    __u32 batch;
+    struct ksys_event *buf;     // batch 개, ksys_batch.ev 가 가리킴
+    __u64 drops;                // BATCH/READ: 커널이 알려준 값
+
+    // MMAP
+    void *map;
+    size_t map_len;
+    const struct ksys_mmap_hdr *hdr;
+    const struct ksys_mmap_slot *slots;
+    __u32 ring_size;
+    __u32 ring_mask;
+    struct ksys_cursor cur;     // 유저 공간 커서 (drops 포함)
+    __u64 synced;               // 커널 쪽 커서를 마지막으로 맞춘 seq
+};
+
+static const char *const ksys_backend_names[] = {
+    [KSYS_BACKEND_AUTO] = "auto",
+    [KSYS_BACKEND_MMAP] = "mmap",
+    [KSYS_BACKEND_BATCH] = "batch",
+    [KSYS_BACKEND_READ] = "read",
+    [KSYS_BACKEND_FANOTIFY] = "fanotify",
+};
+
+static __u64 ksys_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (__u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void ksys_open_opts_init(struct ksys_open_opts *o)
+{
+    memset(o, 0, sizeof(*o));
+    o->dev = KSYS_DEV_PATH;
+    o->backend = KSYS_BACKEND_AUTO;
+    o->batch = KSYS_BATCH_DEFAULT;
+    o->filter.pid = -1;
+    o->filter.tgid = -1;
+    o->start.mode = KSYS_START_NOW;
+}
+
+const char *ksys_backend_name(enum ksys_backend b)
+{
+    return (unsigned int)b <= KSYS_BACKEND_FANOTIFY ? ksys_backend_names[b] : "?";
+}
+
+enum ksys_backend ksys_backend(const struct ksys *k)
+{
+    return k->be;
+}
+
+// --- MMAP ---
+
+static void ksys_unmap(struct ksys *k)
+{
+    if (k->map)
+        munmap(k->map, k->map_len);
+    k->map = NULL;
+    k->hdr = NULL;
+    k->slots = NULL;
+}
+
+// 헤더 페이지로 전체 크기를 알아낸 뒤 링 전체를 매핑. 리사이즈 (KSYS_MMAP_STALE) 뒤에도 다시 부름
+// 두 mmap 사이에 리사이즈가 끼면 다른 링이 매핑되므로, 매핑한 링의 헤더로 다시 확인하고 어긋나면 재시도
+static int ksys_map(struct ksys *k)
+{
+    long pg = sysconf(_SC_PAGESIZE);
+    const struct ksys_mmap_hdr *nh;
+    struct ksys_mmap_hdr h;
+    void *p;
+
+    for (int tries = 0; tries < KSYS_MAP_TRIES; tries++) {
+        p = mmap(NULL, (size_t)pg, PROT_READ, MAP_SHARED, k->fd, 0);
+        if (p == MAP_FAILED)
+            return -1;
+        memcpy(&h, p, sizeof(h));
+        munmap(p, (size_t)pg);
+
+        if (h.version != KSYS_MMAP_VERSION || h.slot_size != sizeof(struct ksys_mmap_slot)) {
+            errno = EPROTO;
+            return -1;
+        }
+        p = mmap(NULL, h.map_size, PROT_READ, MAP_SHARED, k->fd, 0);
+        if (p == MAP_FAILED) {
+            // 그 사이 링이 줄었으면 길이가 맞지 않음
+            if (errno == EINVAL)
+                continue;
+            return -1;
+        }
+        nh = p;
+        if (nh->ring_size != h.ring_size || nh->map_size != h.map_size || nh->hdr_size != h.hdr_size ||
+            (KSYS_READ_ONCE(nh->flags) & KSYS_MMAP_STALE)) {
+            munmap(p, h.map_size);
+            continue;
+        }
+
+        ksys_unmap(k);
+        k->map = p;
+        k->map_len = h.map_size;
+        k->hdr = p;
+        k->slots = (const struct ksys_mmap_slot *)((const char *)p + h.hdr_size);
+        k->ring_size = h.ring_size;
+        k->ring_mask = h.ring_size - 1;
+        return 0;
+    }
+    errno = EAGAIN;
+    return -1;
+}
+
+static __u64 ksys_mmap_oldest(const struct ksys *k, __u64 cur_seq)
+{
+    return ksys_ring_oldest(cur_seq, k->ring_size, KSYS_READ_ONCE(k->hdr->base_seq));
+}
+
+// 커널 쪽 커서를 우리 위치로. poll 이 맞게 깨우고, 커널 reader 가 뒤처진 것으로 보여
+// 오토튜너가 링을 키우지 않게 함
+static int ksys_mmap_sync(struct ksys *k)
+{
+    struct ksys_start st = { .mode = KSYS_START_SEQ, .seq = k->cur.next_seq };
+
+    if (ioctl(k->fd, KSYS_IOC_SET_START, &st) != 0)
+        return -1;
+    k->synced = k->cur.next_seq;
+    return 0;
+}
+
+// 커널 ksys_fill_locked 와 같은 순서: skip -> gap -> 필터 통과한 것만 복사
+static ssize_t ksys_mmap_fill(struct ksys *k)
+{
+    struct ksys_cursor *c = &k->cur;
+    size_t n = 0;
+    __u64 cur;
+
+    if (KSYS_READ_ONCE(k->hdr->flags) & KSYS_MMAP_STALE) {
+        if (ksys_map(k) != 0)
+            return -1;
+    }
+    cur = ksys_load_acquire(&k->hdr->cur_seq);
+    ksys_cursor_skip(c, ksys_mmap_oldest(k, cur), k->opts & KSYS_OPT_GAP_RECORDS);
+
+    n += ksys_cursor_gap(c, &k->buf[n], ksys_now_ns());
+
+    while (n < k->batch && c->next_seq < cur) {
+        __u64 s = c->next_seq;
+
+        // 복사하는 사이 덮어써졌으면 writer 가 한 바퀴 앞선 것. 지금 링에 남은 곳까지 유실로 건너뜀
+        if (!ksys_slot_read(ksys_ring_slot((struct ksys_mmap_slot *)k->slots, k->ring_mask, s), s, &k->buf[n])) {
+            __u64 oldest;
+
+            cur = ksys_load_acquire(&k->hdr->cur_seq);
+            oldest = ksys_mmap_oldest(k, cur);
+            ksys_cursor_skip(c, oldest > s ? oldest : s + 1, k->opts & KSYS_OPT_GAP_RECORDS);
+            n += ksys_cursor_gap(c, &k->buf[n], ksys_now_ns());
+            continue;
+        }
+        c->next_seq++;
+        if (k->flt_all || ksys_match_event(&k->flt, &k->buf[n]))
+            n++;
+    }
+
+    if (c->next_seq - k->synced > k->ring_size / 4)
+        ksys_mmap_sync(k);
+    return (ssize_t)n;
+}
+
+static int ksys_mmap_start(struct ksys *k, const struct ksys_start *st)
+{
+    __u64 cur = ksys_load_acquire(&k->hdr->cur_seq);
+    __u64 oldest = ksys_mmap_oldest(k, cur);
+
+    memset(&k->cur, 0, sizeof(k->cur));
+    switch (st->mode) {
+        case KSYS_START_NOW:
+            k->cur.next_seq = cur;
+            break;
+        case KSYS_START_OLDEST:
+            k->cur.next_seq = oldest;
+            break;
+        case KSYS_START_SEQ:
+            k->cur.next_seq = st->seq < oldest ? oldest : st->seq > cur ? cur : st->seq;
+            break;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    return ksys_mmap_sync(k);
+}
+
+// --- Open/Close ---
+
+// 장치 쪽 리더 설정. MMAP 도 poll 이 필터를 보고 깨우도록 같은 설정을 걸어 둠
+static int ksys_dev_setup(struct ksys *k, const struct ksys_open_opts *o)
+{
+    if (k->opts && ioctl(k->fd, KSYS_IOC_SET_OPTS, &k->opts) != 0)
+        return -1;
+    if (ioctl(k->fd, KSYS_IOC_SET_FILTER, &k->flt) != 0)
+        return -1;
+    if (k->be == KSYS_BACKEND_MMAP)
+        return ksys_mmap_start(k, &o->start);
+    return ioctl(k->fd, KSYS_IOC_SET_START, &o->start);
+}
+
+// buf_len 0 은 지원하면 EINVAL, 예전 모듈이면 ENOTTY
+static bool ksys_has_read_batch(int fd)
+{
+    struct ksys_read_batch rb;
+
+    memset(&rb, 0, sizeof(rb));
+    return ioctl(fd, KSYS_IOC_READ_BATCH, &rb) == 0 || errno != ENOTTY;
+}
+
+static int ksys_pick_dev_backend(struct ksys *k, enum ksys_backend want)
+{
+    if (want == KSYS_BACKEND_MMAP || want == KSYS_BACKEND_AUTO) {
+        if (ksys_map(k) == 0) {
+            k->be = KSYS_BACKEND_MMAP;
+            return 0;
+        }
+        if (want == KSYS_BACKEND_MMAP)
+            return -1;
+    }
+    if (want == KSYS_BACKEND_BATCH || want == KSYS_BACKEND_AUTO) {
+        if (ksys_has_read_batch(k->fd)) {
+            k->be = KSYS_BACKEND_BATCH;
+            return 0;
+        }
+        if (want == KSYS_BACKEND_BATCH) {
+            errno = ENOTTY;
+            return -1;
+        }
+    }
+    k->be = KSYS_BACKEND_READ;
+    return 0;
+}
+
+static int ksys_open_fan(struct ksys *k, const struct ksys_open_opts *o)
+{
+    struct ksys_fan_opts fo;
+
+    memset(&fo, 0, sizeof(fo));
+    if (o->fan)
+        fo = *o->fan;
+    fo.filter = k->flt;
+    k->fan = ksys_fan_open(&fo);
+    if (!k->fan)
+        return -1;
+    k->be = KSYS_BACKEND_FANOTIFY;
+    return 0;
+}
+
+struct ksys *ksys_open(const struct ksys_open_opts *o)
+{
+    struct ksys_open_opts def;
+    struct ksys *k;
+    int err;
+
+    if (!o) {
+        ksys_open_opts_init(&def);
+        o = &def;
+    }
+    if (o->opts & ~KSYS_OPT_MASK) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    k = calloc(1, sizeof(*k));
+    if (!k)
+        return NULL;
+    k->fd = -1;
+    k->flt = o->filter;
+    k->flt_all = ksys_filter_empty(&o->filter);
+    k->opts = o->opts;
+    k->batch = o->batch ? o->batch : KSYS_BATCH_DEFAULT;
+    if (k->batch < 2)
+        k->batch = 2;   // gap 하나 + 이벤트 하나, fanotify 는 이벤트 하나가 레코드 둘
+    k->buf = calloc(k->batch, sizeof(*k->buf));
+    if (!k->buf)
+        goto err;
+
+    if (o->backend == KSYS_BACKEND_FANOTIFY) {
+        if (ksys_open_fan(k, o) != 0)
+            goto err;
+        return k;
+    }
+
+    k->fd = open(o->dev ? o->dev : KSYS_DEV_PATH, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (k->fd < 0) {
+        // 모듈이 없는 호스트
+        if (o->backend == KSYS_BACKEND_AUTO && (errno == ENOENT || errno == ENODEV || errno == ENXIO)) {
+            if (ksys_open_fan(k, o) == 0)
+                return k;
+        }
+        goto err;
+    }
+    if (ksys_pick_dev_backend(k, o->backend) != 0 || ksys_dev_setup(k, o) != 0)
+        goto err;
+    return k;
+
+err:
+    err = errno;
+    ksys_close(k);
+    errno = err;
+    return NULL;
+}
+
+void ksys_close(struct ksys *k)
+{
+    if (!k)
+        return;
+    ksys_unmap(k);
+    if (k->fd >= 0)
+        close(k->fd);
+    ksys_fan_close(k->fan);
+    free(k->buf);
+    free(k);
+}
+
+int ksys_fd(const struct ksys *k)
+{
+    return k->be == KSYS_BACKEND_FANOTIFY ? ksys_fan_fd(k->fan) : k->fd;
+}
+
+int ksys_prepare_wait(struct ksys *k)
+{
+    if (k->be != KSYS_BACKEND_MMAP)
+        return 0;
+    if (k->cur.gap_pending || k->cur.next_seq < ksys_load_acquire(&k->hdr->cur_seq))
+        return 1;
+    // 여기서 맞춘 뒤에 들어온 이벤트는 커널 poll 이 봄
+    if (k->synced != k->cur.next_seq && ksys_mmap_sync(k) != 0)
+        return -1;
+    return 0;
+}
+
+// --- Read ---
+
+static int ksys_wait(struct ksys *k, int timeout_ms)
+{
+    struct pollfd p = { .fd = ksys_fd(k), .events = POLLIN };
+    int rc = ksys_prepare_wait(k);
+
+    if (rc != 0)
+        return rc;
+    return poll(&p, 1, timeout_ms);
+}
+
+static ssize_t ksys_read_once(struct ksys *k)
+{
+    switch (k->be) {
+        case KSYS_BACKEND_MMAP:
+            return ksys_mmap_fill(k);
+        case KSYS_BACKEND_FANOTIFY:
+            return ksys_fan_read(k->fan, k->buf, k->batch);
+        case KSYS_BACKEND_READ: {
+            struct ksys_stats st;
+            ssize_t r = read(k->fd, k->buf, (size_t)k->batch * sizeof(*k->buf));
+
+            if (r < 0)
+                return errno == EAGAIN ? 0 : -1;
+            if (ioctl(k->fd, KSYS_IOC_GET_STATS, &st) == 0)
+                k->drops = st.drops;
+            return r / (ssize_t)sizeof(*k->buf);
+        }
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+}
+
+int ksys_next_batch(struct ksys *k, int timeout_ms, struct ksys_batch *out)
+{
+    ssize_t n;
+
+    out->ev = k->buf;
+    out->n = 0;
+
+    if (k->be == KSYS_BACKEND_BATCH) {
+        // 대기와 복사를 ioctl 한 번에
+        struct ksys_read_batch rb;
+
+        memset(&rb, 0, sizeof(rb));
+        rb.buf = (__u64)(uintptr_t)k->buf;
+        rb.buf_len = k->batch * sizeof(*k->buf);
+        rb.min_events = 1;
+        rb.timeout_ms = timeout_ms;
+        if (ioctl(k->fd, KSYS_IOC_READ_BATCH, &rb) != 0)
+            return -1;
+        k->drops = rb.drops;
+        out->n = rb.nr_events;
+        out->drops = rb.drops;
+        return 0;
+    }
+
+    n = ksys_read_once(k);
+    if (n == 0 && timeout_ms != 0) {
+        int rc = ksys_wait(k, timeout_ms);
+
+        if (rc < 0)
+            return -1;
+        if (rc > 0)
+            n = ksys_read_once(k);
+    }
+    if (n < 0)
+        return -1;
+    out->n = (size_t)n;
+    out->drops = k->be == KSYS_BACKEND_MMAP ? k->cur.drops : k->drops;
+    return 0;
+}
+
+// --- Control ---
+
+int ksys_set_filter(struct ksys *k, const struct ksys_filter *f)
+{
+    if (k->be == KSYS_BACKEND_FANOTIFY) {
+        errno = ENOTSUP;    // fanotify 필터는 open 때만
+        return -1;
+    }
+    if (ioctl(k->fd, KSYS_IOC_SET_FILTER, f) != 0)
+        return -1;
+    k->flt = *f;
+    k->flt_all = ksys_filter_empty(f);
+    return 0;
+}
+
+static int ksys_dev_ioctl(struct ksys *k, unsigned long cmd, void *arg)
+{
+    if (k->fd < 0) {
+        errno = ENOTSUP;
+        return -1;
+    }
+    return ioctl(k->fd, cmd, arg);
+}
+
+int ksys_get_stats(struct ksys *k, struct ksys_stats *st)
+{
+    if (ksys_dev_ioctl(k, KSYS_IOC_GET_STATS, st) != 0)
+        return -1;
+    // MMAP 은 커널 커서를 가끔만 맞추므로 drops 는 유저 공간 커서 값
+    if (k->be == KSYS_BACKEND_MMAP)
+        st->drops = k->cur.drops;
+    return 0;
+}
+
+int ksys_get_config(struct ksys *k, struct ksys_config *c)
+{
+    return ksys_dev_ioctl(k, KSYS_IOC_GET_CONFIG, c);
+}
+
+int ksys_set_config(struct ksys *k, const struct ksys_config *c)
+{
+    return ksys_dev_ioctl(k, KSYS_IOC_SET_CONFIG, (void *)c);
+}
@@ -0,0 +1,181 @@
+// ksys_attach_bench.c
+// 실행 중인 커널에서 attach point 별 openat 한 건당 오버헤드를 재고 가장 빠른 것을 고름
+//
+//   gcc -O2 -Wall -I../include -o ksys_attach_bench ksys_attach_bench.c
+//   sudo ./ksys_attach_bench [--dev /dev/ksys_trace] [--iters N] [--rounds R] [--path FILE] [--apply]
+//
+// 모드마다 SET_CONFIG 로 attach 를 바꾼 뒤 openat+close 를 N 번 돌려 R 라운드 중 최소값을 씀.
+// 기준선은 attach=none (probe 없음). 측정하는 동안 전역 필터를 이 프로세스로 좁혀서
+// 모든 open 이 실제로 링에 기록되게 함 (다른 consumer 에는 잠깐 이 프로세스 이벤트만 보임).
+// 끝나면 원래 설정으로 되돌리고, --apply 면 가장 빠른 attach 로 바꿔 둠. 도중에 SIGINT/SIGTERM/SIGHUP
+// 을 받아도 되돌린 뒤 끝남 (SIGKILL 은 못 막으니 그때는 GET_CONFIG 로 확인하고 직접 되돌릴 것).
+// 전역 설정을 바꾸므로 다른 consumer 가 도는 동안에는 돌리지 말 것
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys.h>
+
+static const char *attach_names[] = { "wrapper", "openat2", "tracepoint", "none" };
+
+// 시그널 핸들러가 되돌릴 원래 설정 (narrowed 인 동안만)
+static int dev_fd = -1;
+static struct ksys_config orig;
+static volatile sig_atomic_t narrowed;
+
+static void on_signal(int sig)
+{
+    // ioctl 은 async-signal-safe. 되돌린 뒤 기본 동작으로 다시 보내서 종료 상태를 그대로
+    if (narrowed)
+        ioctl(dev_fd, KSYS_IOC_SET_CONFIG, &orig);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// openat+close 한 번의 평균 (ns). 라운드 중 최소값
+static double time_opens(const char *path, int iters, int rounds)
+{
+    double best = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        uint64_t t0 = now_ns();
+        for (int i = 0; i < iters; i++) {
+            int fd = openat(AT_FDCWD, path, O_RDONLY);
+            if (fd >= 0)
+                close(fd);
+        }
+        double per = (double)(now_ns() - t0) / iters;
+        if (r == 0 || per < best)
+            best = per;
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    const char *dev = "/dev/ksys_trace";
+    const char *path = "/dev/null";
+    int iters = 200000, rounds = 5;
+    bool apply = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--dev") && i + 1 < argc) {
+            dev = argv[++i];
+        } else if (!strcmp(argv[i], "--iters") && i + 1 < argc) {
+            iters = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--path") && i + 1 < argc) {
+            path = argv[++i];
+        } else if (!strcmp(argv[i], "--apply")) {
+            apply = true;
+        } else {
+            fprintf(stderr, "usage: %s [--dev PATH] [--iters N] [--rounds R] [--path FILE] [--apply]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (iters < 1) iters = 1;
+    if (rounds < 1) rounds = 1;
+
+    int fd = open(dev, O_RDONLY);
+    if (fd < 0) {
+        perror("open");
+        return 1;
+    }
+
+    struct ksys_config c;
+    if (ioctl(fd, KSYS_IOC_GET_CONFIG, &orig) != 0) {
+        perror("ioctl GET_CONFIG");
+        close(fd);
+        return 1;
+    }
+
+    // 필터를 좁히기 전에 걸어 둠
+    {
+        struct sigaction sa;
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = on_signal;
+        sigemptyset(&sa.sa_mask);
+        dev_fd = fd;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+        sigaction(SIGHUP, &sa, NULL);
+    }
+
+    // 기준선 먼저, 그 다음 후보들
+    static const int order[] = { KSYS_ATTACH_NONE, KSYS_ATTACH_WRAPPER, KSYS_ATTACH_OPENAT2, KSYS_ATTACH_TRACEPOINT };
+    double ns[4] = { 0 };
+    bool ok[4] = { false };
+
+    for (size_t k = 0; k < sizeof(order) / sizeof(order[0]); k++) {
+        int a = order[k];
+
+        c = orig;
+        c.pid = -1;
+        c.tgid = getpid();
+        c.comm[0] = '\0';
+        c.sample_every = 1;
+        c.attach = (uint32_t)a;
+        narrowed = 1;
+        if (ioctl(fd, KSYS_IOC_SET_CONFIG, &c) != 0) {
+            printf("%-10s  unsupported (%s)\n", attach_names[a], strerror(errno));
+            if (a == KSYS_ATTACH_NONE) {
+                close(fd);
+                return 1;
+            }
+            continue;
+        }
+
+        time_opens(path, iters / 10 + 1, 1);   // 워밍업
+        ns[a] = time_opens(path, iters, rounds);
+        ok[a] = true;
+
+        if (a == KSYS_ATTACH_NONE)
+            printf("%-10s  %8.1f ns/open (baseline)\n", attach_names[a], ns[a]);
+        else
+            printf("%-10s  %8.1f ns/open  overhead %+7.1f ns/event\n",
+                   attach_names[a], ns[a], ns[a] - ns[KSYS_ATTACH_NONE]);
+    }
+
+    int best = -1;
+    for (int a = KSYS_ATTACH_WRAPPER; a <= KSYS_ATTACH_TRACEPOINT; a++) {
+        if (ok[a] && (best < 0 || ns[a] < ns[best]))
+            best = a;
+    }
+    if (best >= 0)
+        printf("fastest: %s\n", attach_names[best]);
+    else
+        printf("fastest: none supported\n");
+
+    c = orig;
+    if (apply && best >= 0)
+        c.attach = (uint32_t)best;
+    if (ioctl(fd, KSYS_IOC_SET_CONFIG, &c) != 0) {
+        perror("ioctl SET_CONFIG (restore)");
+        close(fd);
+        return 1;
+    }
+    narrowed = 0;
+    if (apply && best >= 0)
+        printf("applied attach=%s\n", attach_names[best]);
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,361 @@
+// ksys_core_bench.c
+// include/ksys/ksys_core.h 의 링/커서/필터 코어를 유저 공간에서 돌려 보는 경합 하네스
+// (모듈 insmod 없이 락 설계 비교 / drop 계산 회귀 확인용)
+//
+//   gcc -O2 -Wall -pthread -I../include -o ksys_core_bench ksys_core_bench.c
+//   ./ksys_core_bench [-p PRODUCERS] [-r READERS] [-s RING] [-d SEC] [-b BATCH]
+//                     [--lock spin|mutex|ticket] [--read locked|lockless] [--gaps]
+//
+// locked   : 커널 read() 경로와 같음. 락 안에서 skip -> 최대 BATCH 개 복사
+// lockless : mmap reader 와 같음. cur_seq(acquire) 를 보고 ksys_slot_read 로 검증하며 복사
+//
+// 끝나면 reader 마다 (받은 수 + drops) 가 전체 seq 수와 같은지, 받은 seq 가 단조 증가하는지,
+// 그리고 seq 틈으로 직접 센 유실이 커서의 drops 와 같은지 확인. 어긋나면 exit 1
+#define _GNU_SOURCE
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys_core.h>
+
+enum lock_kind { LOCK_SPIN, LOCK_MUTEX, LOCK_TICKET };
+enum read_kind { READ_LOCKED, READ_LOCKLESS };
+
+#define HIST_BUCKETS 48     // log2(ns)
+
+struct ticket_lock {
+    _Alignas(64) uint32_t next;
+    _Alignas(64) uint32_t owner;
+};
+
+struct ring {
+    struct ksys_mmap_slot *slots;
+    uint32_t size, mask;
+    _Alignas(64) uint64_t seq;      // 락 안에서만 씀
+    _Alignas(64) uint64_t cur_seq;  // lockless reader 용 release 사본
+    enum lock_kind kind;
+    pthread_spinlock_t spin;
+    pthread_mutex_t mutex;
+    struct ticket_lock ticket;
+};
+
+struct reader {
+    pthread_t th;
+    struct ring *rg;
+    struct ksys_cursor cur;
+    uint64_t got;
+    uint64_t seen_lost;         // 받은 seq 사이 틈으로 직접 센 유실
+    uint64_t last_seq;
+    uint64_t bad_order;
+    uint64_t hist[HIST_BUCKETS];
+    int id;
+};
+
+struct producer {
+    pthread_t th;
+    struct ring *rg;
+    uint64_t pushed;
+    int id;
+};
+
+static volatile int stop_producers;
+static volatile int stop_readers;
+static enum read_kind read_mode = READ_LOCKED;
+static uint32_t batch = 256;
+static int gaps;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// --- Locks ---
+
+static void ring_lock(struct ring *rg)
+{
+    switch (rg->kind) {
+        case LOCK_SPIN:
+            pthread_spin_lock(&rg->spin);
+            break;
+        case LOCK_MUTEX:
+            pthread_mutex_lock(&rg->mutex);
+            break;
+        case LOCK_TICKET: {
+            uint32_t me = __atomic_fetch_add(&rg->ticket.next, 1, __ATOMIC_RELAXED);
+            // 코어보다 스레드가 많으면 순서가 온 스레드가 선점돼 있을 수 있어 가끔 양보
+            for (uint32_t spins = 0; __atomic_load_n(&rg->ticket.owner, __ATOMIC_ACQUIRE) != me; spins++) {
+                if ((spins & 1023) == 1023)
+                    sched_yield();
+                else
+                    __builtin_ia32_pause();
+            }
+            break;
+        }
+    }
+}
+
+static void ring_unlock(struct ring *rg)
+{
+    switch (rg->kind) {
+        case LOCK_SPIN:
+            pthread_spin_unlock(&rg->spin);
+            break;
+        case LOCK_MUTEX:
+            pthread_mutex_unlock(&rg->mutex);
+            break;
+        case LOCK_TICKET:
+            __atomic_store_n(&rg->ticket.owner, rg->ticket.owner + 1, __ATOMIC_RELEASE);
+            break;
+    }
+}
+
+// --- Producer ---
+
+// 커널 ksys_rb_push_locked 와 같은 순서: 락 -> publish -> seq++ -> cur_seq release
+static void *producer_main(void *arg)
+{
+    struct producer *p = arg;
+    struct ring *rg = p->rg;
+    struct ksys_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.pid = ev.tgid = 1000 + p->id;
+    snprintf(ev.comm, sizeof(ev.comm), "prod%d", p->id);
+    strcpy(ev.path, "/bench/ksys_core");
+
+    while (!stop_producers) {
+        ev.ts_ns = now_ns();
+        ring_lock(rg);
+        ksys_slot_publish(ksys_ring_slot(rg->slots, rg->mask, rg->seq), &ev, rg->seq);
+        rg->seq++;
+        ksys_store_release(&rg->cur_seq, rg->seq);
+        ring_unlock(rg);
+        p->pushed++;
+    }
+    return NULL;
+}
+
+// --- Reader ---
+
+static void reader_account(struct reader *r, const struct ksys_event *ev, uint64_t t)
+{
+    uint64_t lat = t > ev->ts_ns ? t - ev->ts_ns : 0;
+    int b = lat ? 63 - __builtin_clzll(lat) : 0;
+
+    if (r->got && ev->seq <= r->last_seq)
+        r->bad_order++;
+    else if (ev->seq > r->last_seq + (r->got ? 1 : 0))
+        r->seen_lost += ev->seq - r->last_seq - (r->got ? 1 : 0);
+    r->last_seq = ev->seq;
+    r->got++;
+    r->hist[b < HIST_BUCKETS ? b : HIST_BUCKETS - 1]++;
+}
+
+// 커널 ksys_fill_locked 와 같음
+static uint32_t reader_pass_locked(struct reader *r, struct ksys_event *buf)
+{
+    struct ring *rg = r->rg;
+    struct ksys_filter all = { .pid = -1, .tgid = -1 };
+    uint32_t n = 0;
+
+    ring_lock(rg);
+    ksys_cursor_skip(&r->cur, ksys_ring_oldest(rg->seq, rg->size, 0), gaps);
+    r->cur.gap_pending = false;
+    while (n < batch && r->cur.next_seq < rg->seq) {
+        const struct ksys_event *ev = &ksys_ring_slot(rg->slots, rg->mask, r->cur.next_seq)->et;
+        if (ksys_match_event(&all, ev))
+            buf[n++] = *ev;
+        r->cur.next_seq++;
+    }
+    ring_unlock(rg);
+    return n;
+}
+
+// mmap reader 와 같음. 검증에 실패한 슬롯은 그 사이 덮어써진 것이므로 drops 로
+static uint32_t reader_pass_lockless(struct reader *r, struct ksys_event *buf)
+{
+    struct ring *rg = r->rg;
+    uint64_t cur = ksys_load_acquire(&rg->cur_seq);
+    uint32_t n = 0;
+
+    ksys_cursor_skip(&r->cur, ksys_ring_oldest(cur, rg->size, 0), gaps);
+    r->cur.gap_pending = false;
+    while (n < batch && r->cur.next_seq < cur) {
+        uint64_t s = r->cur.next_seq++;
+        if (ksys_slot_read(ksys_ring_slot(rg->slots, rg->mask, s), s, &buf[n]))
+            n++;
+        else
+            r->cur.drops++;
+    }
+    return n;
+}
+
+static void *reader_main(void *arg)
+{
+    struct reader *r = arg;
+    struct ksys_event *buf = calloc(batch, sizeof(*buf));
+
+    for (;;) {
+        uint32_t n = (read_mode == READ_LOCKED) ? reader_pass_locked(r, buf) : reader_pass_lockless(r, buf);
+        uint64_t t = now_ns();
+
+        for (uint32_t i = 0; i < n; i++)
+            reader_account(r, &buf[i], t);
+        if (n == 0) {
+            // 생산이 끝났고 다 따라잡았으면 종료
+            if (stop_readers && r->cur.next_seq >= ksys_load_acquire(&r->rg->cur_seq))
+                break;
+            sched_yield();
+        }
+    }
+    free(buf);
+    return NULL;
+}
+
+static uint64_t hist_pct(const uint64_t *h, uint64_t total, double pct)
+{
+    uint64_t want = (uint64_t)(total * pct), acc = 0;
+
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        acc += h[b];
+        if (acc > want)
+            return 2ull << b;   // 버킷 상한
+    }
+    return 2ull << (HIST_BUCKETS - 1);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-p PRODUCERS] [-r READERS] [-s RING] [-d SEC] [-b BATCH]\n"
+            "          [--lock spin|mutex|ticket] [--read locked|lockless] [--gaps]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    int nprod = 4, nread = 2, secs = 3;
+    uint32_t size = 1u << 16;
+    struct ring rg;
+
+    memset(&rg, 0, sizeof(rg));
+    rg.kind = LOCK_SPIN;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            nprod = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            nread = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            size = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            secs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            batch = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--lock") && i + 1 < argc) {
+            const char *v = argv[++i];
+            if (!strcmp(v, "spin")) rg.kind = LOCK_SPIN;
+            else if (!strcmp(v, "mutex")) rg.kind = LOCK_MUTEX;
+            else if (!strcmp(v, "ticket")) rg.kind = LOCK_TICKET;
+            else { usage(argv[0]); return 2; }
+        } else if (!strcmp(argv[i], "--read") && i + 1 < argc) {
+            const char *v = argv[++i];
+            if (!strcmp(v, "locked")) read_mode = READ_LOCKED;
+            else if (!strcmp(v, "lockless")) read_mode = READ_LOCKLESS;
+            else { usage(argv[0]); return 2; }
+        } else if (!strcmp(argv[i], "--gaps")) {
+            gaps = 1;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (nprod < 1) nprod = 1;
+    if (nread < 0) nread = 0;
+    if (secs < 1) secs = 1;
+    if (batch < 1) batch = 1;
+    // 커널과 같이 2의 거듭제곱
+    if (size < 64) size = 64;
+    while (size & (size - 1))
+        size += size & -size;
+
+    rg.size = size;
+    rg.mask = size - 1;
+    rg.slots = aligned_alloc(64, (size_t)size * sizeof(struct ksys_mmap_slot));
+    if (!rg.slots) {
+        perror("aligned_alloc");
+        return 1;
+    }
+    memset(rg.slots, 0, (size_t)size * sizeof(struct ksys_mmap_slot));
+    pthread_spin_init(&rg.spin, PTHREAD_PROCESS_PRIVATE);
+    pthread_mutex_init(&rg.mutex, NULL);
+
+    struct producer *ps = calloc(nprod, sizeof(*ps));
+    struct reader *rs = calloc(nread ? nread : 1, sizeof(*rs));
+
+    for (int i = 0; i < nread; i++) {
+        rs[i].rg = &rg;
+        rs[i].id = i;
+        pthread_create(&rs[i].th, NULL, reader_main, &rs[i]);
+    }
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < nprod; i++) {
+        ps[i].rg = &rg;
+        ps[i].id = i;
+        pthread_create(&ps[i].th, NULL, producer_main, &ps[i]);
+    }
+
+    sleep(secs);
+    stop_producers = 1;
+    for (int i = 0; i < nprod; i++)
+        pthread_join(ps[i].th, NULL);
+    double dt = (now_ns() - t0) / 1e9;
+    stop_readers = 1;
+    for (int i = 0; i < nread; i++)
+        pthread_join(rs[i].th, NULL);
+
+    static const char *lock_names[] = { "spin", "mutex", "ticket" };
+    uint64_t total = rg.seq, pushed = 0;
+    int bad = 0;
+
+    for (int i = 0; i < nprod; i++)
+        pushed += ps[i].pushed;
+    printf("lock=%s read=%s producers=%d readers=%d ring=%u batch=%u\n",
+           lock_names[rg.kind], read_mode == READ_LOCKED ? "locked" : "lockless", nprod, nread, size, batch);
+    printf("produce   %" PRIu64 " events in %.2fs = %.2f Mev/s\n", total, dt, total / dt / 1e6);
+    if (pushed != total) {
+        printf("ERROR     producers counted %" PRIu64 " but seq is %" PRIu64 "\n", pushed, total);
+        bad = 1;
+    }
+
+    for (int i = 0; i < nread; i++) {
+        struct reader *r = &rs[i];
+        // 마지막으로 받은 뒤 끝까지 못 받은 꼬리도 seq 틈
+        uint64_t tail = r->got ? total - r->last_seq - 1 : total;
+        uint64_t seen = r->seen_lost + tail;
+        bool ok = r->got + r->cur.drops == total && seen == r->cur.drops && !r->bad_order;
+
+        printf("reader%-2d  got=%" PRIu64 " (%.2f Mev/s) drops=%" PRIu64 " (%.3f%%)  lat p50<=%" PRIu64
+               "ns p99<=%" PRIu64 "ns p99.9<=%" PRIu64 "ns  accounting %s\n",
+               i, r->got, r->got / dt / 1e6, (uint64_t)r->cur.drops, total ? 100.0 * r->cur.drops / total : 0.0,
+               hist_pct(r->hist, r->got, 0.50), hist_pct(r->hist, r->got, 0.99), hist_pct(r->hist, r->got, 0.999),
+               ok ? "exact" : "MISMATCH");
+        if (!ok) {
+            printf("          got+drops=%" PRIu64 " total=%" PRIu64 " seq-gaps=%" PRIu64 " out-of-order=%" PRIu64 "\n",
+                   (uint64_t)(r->got + r->cur.drops), total, seen, r->bad_order);
+            bad = 1;
+        }
+    }
+
+    free(ps);
+    free(rs);
+    free(rg.slots);
+    return bad;
+}
@@ -0,0 +1,313 @@
+// ksys_fan_bench.c
+// fanotify 백엔드 (lib/ksys_fanotify.c) 와 커널 모듈의 openat 한 건당 비용/유실 비교
+//
+//   gcc -O2 -Wall -I../include -o ksys_fan_bench ksys_fan_bench.c ../lib/ksys_fanotify.c
+//   sudo ./ksys_fan_bench [--dir DIR] [--files K] [--iters N] [--dev /dev/ksys_trace]
+//                         [--no-path] [--unlimited]
+//
+// 자식 프로세스가 DIR 안의 파일 K 개를 돌아가며 openat+close 를 N 번 하고 걸린 시간을 보고,
+// 부모는 그동안 각 백엔드에서 자식 tgid 의 레코드만 세어 got/N 으로 유실을 계산.
+// 모드: baseline (추적 없음) / fanotify / module (장치가 있을 때)
+// 장치가 있으면 baseline 과 fanotify 동안 attach=none 으로 두어 모듈 probe 비용이 섞이지 않게 함.
+// fanotify 는 큐에 남은 같은 (파일, 프로세스) 이벤트를 합치므로 K 가 작을수록 got 이 줄어듦
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys.h>
+#include <ksys/ksys_fanotify.h>
+
+enum { MODE_BASE, MODE_FAN, MODE_MOD };
+static const char *mode_names[] = { "baseline", "fanotify", "module" };
+
+#define BATCH 512
+#define DRAIN_MS 300    // 자식이 끝난 뒤 이만큼 조용하면 다 받은 것으로 봄
+
+static char dir[256];
+static int nfiles = 64;
+static long iters = 200000;
+static unsigned int fan_flags;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// --- Load Generator ---
+
+// go 파이프에서 1 바이트를 받으면 시작, 끝나면 걸린 ns 를 res 파이프로
+static pid_t spawn_loader(int *go_w, int *res_r)
+{
+    int go[2], res[2];
+    pid_t pid;
+
+    if (pipe(go) || pipe(res))
+        return -1;
+    pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        char **paths = calloc(nfiles, sizeof(*paths));
+        char c;
+
+        close(go[1]);
+        close(res[0]);
+        for (int i = 0; i < nfiles; i++) {
+            if (asprintf(&paths[i], "%s/f%03d", dir, i) < 0)
+                _exit(1);
+        }
+        if (read(go[0], &c, 1) != 1)
+            _exit(1);
+        uint64_t t0 = now_ns();
+        for (long i = 0; i < iters; i++) {
+            int fd = openat(AT_FDCWD, paths[i % nfiles], O_RDONLY);
+            if (fd >= 0)
+                close(fd);
+        }
+        uint64_t dt = now_ns() - t0;
+        if (write(res[1], &dt, sizeof(dt)) != sizeof(dt))
+            _exit(1);
+        _exit(0);
+    }
+    close(go[0]);
+    close(res[1]);
+    *go_w = go[1];
+    *res_r = res[0];
+    return pid;
+}
+
+// --- Consumers ---
+
+struct result {
+    bool ok;
+    double ns_per_open;
+    uint64_t got;
+    uint64_t gaps;
+};
+
+static uint64_t count_child(const struct ksys_event *ev, size_t n, pid_t child, uint64_t *gaps)
+{
+    uint64_t got = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (ev[i].type == KSYS_REC_GAP)
+            (*gaps)++;
+        else if ((ev[i].type == KSYS_REC_OPENAT || ev[i].type == KSYS_REC_OPENAT_RET) && ev[i].tgid == child)
+            got++;
+    }
+    return got;
+}
+
+// 자식을 돌리면서 src (fanotify fd 또는 장치 fd) 를 소비. src < 0 이면 소비 없이 시간만
+static int run_child(pid_t child, int go_w, int res_r, int mode, struct ksys_fan *fan, int dev, struct result *r)
+{
+    static struct ksys_event buf[BATCH];
+    int src = mode == MODE_FAN ? ksys_fan_fd(fan) : mode == MODE_MOD ? dev : -1;
+    uint64_t dt = 0;
+    bool done = false;
+
+    if (write(go_w, "g", 1) != 1)
+        return -1;
+    for (;;) {
+        // 결과를 받은 뒤에는 res_r 가 계속 POLLHUP 이라 빼 둠 (fd < 0 은 무시됨)
+        struct pollfd p[2] = { { .fd = done ? -1 : res_r, .events = POLLIN }, { .fd = src, .events = POLLIN } };
+        int rc = poll(p, src >= 0 ? 2 : 1, done ? DRAIN_MS : -1);
+
+        if (rc < 0 && errno != EINTR)
+            return -1;
+        if (rc == 0)
+            break;      // done 이후 조용함
+        if (!done && (p[0].revents & (POLLIN | POLLHUP))) {
+            if (read(res_r, &dt, sizeof(dt)) != sizeof(dt))
+                return -1;
+            done = true;
+            if (src < 0)
+                break;
+        }
+        if (src >= 0 && (p[1].revents & POLLIN)) {
+            ssize_t n;
+            if (mode == MODE_FAN) {
+                while ((n = ksys_fan_read(fan, buf, BATCH)) > 0)
+                    r->got += count_child(buf, (size_t)n, child, &r->gaps);
+            } else {
+                while ((n = read(dev, buf, sizeof(buf))) > 0)
+                    r->got += count_child(buf, (size_t)n / sizeof(buf[0]), child, &r->gaps);
+            }
+            if (n < 0 && errno != EAGAIN)
+                return -1;
+        }
+    }
+    waitpid(child, NULL, 0);
+    r->ns_per_open = (double)dt / iters;
+    r->ok = true;
+    return 0;
+}
+
+static int set_attach(int dev, const struct ksys_config *orig, pid_t tgid, uint32_t attach)
+{
+    struct ksys_config c = *orig;
+
+    if (dev < 0)
+        return 0;
+    c.pid = -1;
+    c.tgid = tgid;
+    c.comm[0] = '\0';
+    c.sample_every = 1;
+    c.attach = attach;
+    return ioctl(dev, KSYS_IOC_SET_CONFIG, &c);
+}
+
+static int run_mode(int mode, int dev, const struct ksys_config *orig, struct result *r)
+{
+    struct ksys_fan *fan = NULL;
+    int go_w, res_r, rc;
+    pid_t child;
+
+    memset(r, 0, sizeof(*r));
+    child = spawn_loader(&go_w, &res_r);
+    if (child < 0)
+        return -1;
+
+    if (mode == MODE_MOD) {
+        uint32_t a = orig->attach == KSYS_ATTACH_NONE ? KSYS_ATTACH_WRAPPER : orig->attach;
+        rc = set_attach(dev, orig, child, a);
+    } else {
+        rc = set_attach(dev, orig, child, KSYS_ATTACH_NONE);
+    }
+    if (rc == 0 && mode == MODE_FAN) {
+        const char *paths[] = { dir };
+        struct ksys_fan_opts o = {
+            .paths = paths, .npaths = 1, .flags = fan_flags,
+            .filter = { .pid = -1, .tgid = child },
+        };
+        fan = ksys_fan_open(&o);
+        if (!fan)
+            rc = -1;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "%-9s  setup failed: %s\n", mode_names[mode], strerror(errno));
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+        close(go_w);
+        close(res_r);
+        return -1;
+    }
+
+    rc = run_child(child, go_w, res_r, mode, fan, dev, r);
+    close(go_w);
+    close(res_r);
+    if (fan) {
+        struct ksys_fan_stats st;
+        ksys_fan_get_stats(fan, &st);
+        printf("           fan: events=%" PRIu64 " filtered=%" PRIu64 " overflows=%" PRIu64
+               " fid hit/miss=%" PRIu64 "/%" PRIu64 " resolve_fail=%" PRIu64 " comm_miss=%" PRIu64 "\n",
+               (uint64_t)st.events, (uint64_t)st.filtered, (uint64_t)st.overflows, (uint64_t)st.fid_hits,
+               (uint64_t)st.fid_misses, (uint64_t)st.resolve_fail, (uint64_t)st.comm_misses);
+        ksys_fan_close(fan);
+    }
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    const char *devpath = "/dev/ksys_trace";
+    bool own_dir = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--dir") && i + 1 < argc) {
+            snprintf(dir, sizeof(dir), "%s", argv[++i]);
+        } else if (!strcmp(argv[i], "--files") && i + 1 < argc) {
+            nfiles = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--iters") && i + 1 < argc) {
+            iters = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--dev") && i + 1 < argc) {
+            devpath = argv[++i];
+        } else if (!strcmp(argv[i], "--no-path")) {
+            fan_flags |= KSYS_FAN_NO_PATH;
+        } else if (!strcmp(argv[i], "--unlimited")) {
+            fan_flags |= KSYS_FAN_UNLIMITED;
+        } else {
+            fprintf(stderr, "usage: %s [--dir DIR] [--files K] [--iters N] [--dev PATH] [--no-path] [--unlimited]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (nfiles < 1) nfiles = 1;
+    if (iters < 1) iters = 1;
+
+    if (!dir[0]) {
+        snprintf(dir, sizeof(dir), "/tmp/ksys_fan_bench.XXXXXX");
+        if (!mkdtemp(dir)) {
+            perror("mkdtemp");
+            return 1;
+        }
+        own_dir = true;
+    }
+    for (int i = 0; i < nfiles; i++) {
+        char p[300];
+        snprintf(p, sizeof(p), "%s/f%03d", dir, i);
+        int fd = open(p, O_WRONLY | O_CREAT, 0644);
+        if (fd < 0) {
+            perror(p);
+            return 1;
+        }
+        close(fd);
+    }
+
+    struct ksys_config orig;
+    int dev = open(devpath, O_RDONLY | O_NONBLOCK);
+    if (dev >= 0 && ioctl(dev, KSYS_IOC_GET_CONFIG, &orig) != 0) {
+        perror("ioctl GET_CONFIG");
+        close(dev);
+        dev = -1;
+    }
+    if (dev < 0)
+        printf("module    %s not available, comparing fanotify against baseline only\n", devpath);
+
+    struct result res[3];
+    int last = dev >= 0 ? MODE_MOD : MODE_FAN;
+
+    printf("dir=%s files=%d iters=%ld\n", dir, nfiles, iters);
+    for (int m = MODE_BASE; m <= last; m++) {
+        if (run_mode(m, dev, &orig, &res[m]) != 0)
+            continue;
+        if (m == MODE_BASE) {
+            printf("%-9s  %8.1f ns/open\n", mode_names[m], res[m].ns_per_open);
+            continue;
+        }
+        printf("%-9s  %8.1f ns/open  overhead %+7.1f ns/event  got %" PRIu64 "/%ld (loss %.2f%%)  gaps=%" PRIu64 "\n",
+               mode_names[m], res[m].ns_per_open,
+               res[MODE_BASE].ok ? res[m].ns_per_open - res[MODE_BASE].ns_per_open : 0.0,
+               res[m].got, iters, 100.0 * (iters - (double)res[m].got) / iters, res[m].gaps);
+    }
+
+    if (dev >= 0) {
+        if (ioctl(dev, KSYS_IOC_SET_CONFIG, &orig) != 0)
+            perror("ioctl SET_CONFIG (restore)");
+        close(dev);
+    }
+    if (own_dir) {
+        for (int i = 0; i < nfiles; i++) {
+            char p[300];
+            snprintf(p, sizeof(p), "%s/f%03d", dir, i);
+            unlink(p);
+        }
+        rmdir(dir);
+    }
+    return 0;
+}
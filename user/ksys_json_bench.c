@@ -0,0 +1,306 @@
+// ksys_json_bench.c
+// lib/ksys_json.c 인코더와 예전 printf 기반 print_event_json 의 처리량 비교 (장치 없이 합성 레코드로)
+//
+//   gcc -O2 -Wall -I../include -o ksys_json_bench ksys_json_bench.c ../lib/ksys_json.c
+//   ./ksys_json_bench [-n EVENTS] [-b BATCH] [-o OUT] [--esc PCT] [--ret] [--proc]
+//
+// BATCH 개마다 예전 쪽은 fflush(stdout), 새 쪽은 ksys_json_flush (ksysdump_json 의 드레인 단위와 같음).
+// OUT 기본은 /dev/null (포맷 비용만). --esc 는 경로에 이스케이프할 문자가 섞인 레코드 비율 (%).
+// 시작 전에 두 인코더 출력이 바이트 단위로 같은지 먼저 확인하고, 다르면 exit 1
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys.h>
+#include <ksys/ksys_json.h>
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// --- Legacy Encoder ---
+// user-041 이전 ksysdump_json.c 의 출력 함수 그대로 (비교 기준)
+
+static void json_escape_print(const char *s, size_t maxlen)
+{
+    putchar('"');
+    for (size_t i = 0; i < maxlen && s[i]; i++) {
+        unsigned char c = (unsigned char)s[i];
+        switch (c) {
+        case '\"': fputs("\\\"", stdout); break;
+        case '\\': fputs("\\\\", stdout); break;
+        case '\b': fputs("\\b", stdout); break;
+        case '\f': fputs("\\f", stdout); break;
+        case '\n': fputs("\\n", stdout); break;
+        case '\r': fputs("\\r", stdout); break;
+        case '\t': fputs("\\t", stdout); break;
+        default:
+            if (c < 0x20) printf("\\u%04x", (unsigned)c);
+            else putchar((int)c);
+            break;
+        }
+    }
+    putchar('"');
+}
+
+static void print_event_json(const struct ksys_event *e)
+{
+    fputs("{\"type\":\"openat\"", stdout);
+    printf(",\"seq\":%llu", e->seq);
+    printf(",\"ts_ns\":%llu", e->ts_ns);
+    printf(",\"pid\":%d", e->pid);
+    printf(",\"tgid\":%d", e->tgid);
+    printf(",\"dfd\":%d", e->dfd);
+    printf(",\"flags\":%u", e->flags);
+    printf(",\"mode\":%u", e->mode);
+    fputs(",\"comm\":", stdout); json_escape_print(e->comm, sizeof(e->comm));
+    fputs(",\"path\":", stdout); json_escape_print(e->path, sizeof(e->path));
+    if (e->type == KSYS_REC_OPENAT_RET)
+        printf(",\"ret\":%d,\"dev\":%u,\"ino\":%llu,\"gen\":%u", e->ret, e->dev, e->ino, e->gen);
+    fputs("}\n", stdout);
+}
+
+static void print_gap_json(const struct ksys_gap *g)
+{
+    printf("{\"type\":\"gap\",\"seq\":%llu,\"ts_ns\":%llu"
+           ",\"lost_from_seq\":%llu,\"lost_to_seq\":%llu,\"count\":%llu}\n",
+           g->seq, g->ts_ns, g->lost_from_seq, g->lost_to_seq, g->count);
+}
+
+static void print_proc_json(const struct ksys_event *e)
+{
+    static const char *names[] = { [KSYS_REC_FORK] = "fork", [KSYS_REC_EXEC] = "exec", [KSYS_REC_EXIT] = "exit" };
+
+    printf("{\"type\":\"%s\",\"seq\":%llu,\"ts_ns\":%llu,\"pid\":%d,\"tgid\":%d",
+           names[e->type], e->seq, e->ts_ns, e->pid, e->tgid);
+    if (e->type == KSYS_REC_FORK)
+        printf(",\"ppid\":%d,\"ptgid\":%d", e->ppid, e->ptgid);
+    if (e->type == KSYS_REC_EXIT)
+        printf(",\"exit_code\":%d,\"group_dead\":%s", e->exit_code, e->group_dead ? "true" : "false");
+    fputs(",\"comm\":", stdout); json_escape_print(e->comm, sizeof(e->comm));
+    if (e->type == KSYS_REC_EXEC) {
+        fputs(",\"path\":", stdout); json_escape_print(e->path, sizeof(e->path));
+    }
+    fputs("}\n", stdout);
+}
+
+static void print_records_json(const struct ksys_event *evs, size_t cnt)
+{
+    for (size_t k = 0; k < cnt; k++) {
+        if (evs[k].type == KSYS_REC_GAP)
+            print_gap_json((const struct ksys_gap *)&evs[k]);
+        else if (evs[k].type >= KSYS_REC_FORK && evs[k].type <= KSYS_REC_EXIT)
+            print_proc_json(&evs[k]);
+        else
+            print_event_json(&evs[k]);
+    }
+}
+
+// --- Synthetic Records ---
+
+static const char *const dirs[] = { "/usr/lib/x86_64-linux-gnu", "/etc", "/proc/self", "/home/user/project/src",
+                                    "/var/log", "/tmp" };
+static const char *const comms[] = { "bash", "python3", "nginx", "systemd-journal", "cc1", "java" };
+
+// 레코드 n 개. esc_pct % 는 경로에 따옴표/역슬래시/제어문자를 넣음
+static void gen_records(struct ksys_event *ev, size_t n, int esc_pct, bool ret, bool proc)
+{
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+
+    memset(ev, 0, n * sizeof(*ev));
+    for (size_t i = 0; i < n; i++) {
+        struct ksys_event *e = &ev[i];
+
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        e->seq = 1000000 + i;
+        e->ts_ns = 1700000000000000000ull + i * 1733;
+        e->pid = (int32_t)(1000 + x % 40000);
+        e->tgid = e->pid - (int32_t)(x % 3);
+        snprintf(e->comm, sizeof(e->comm), "%s", comms[x % 6]);
+        if ((int)(x >> 32) % 100 < esc_pct)
+            snprintf(e->path, sizeof(e->path), "%s/we\"ird\\name\t%llu", dirs[(x >> 8) % 6],
+                     (unsigned long long)(x % 1000));
+        else
+            snprintf(e->path, sizeof(e->path), "%s/file_%llu.so", dirs[(x >> 8) % 6],
+                     (unsigned long long)(x % 100000));
+        e->dfd = -100;
+        e->flags = 0x80000;
+        e->mode = 0;
+        e->type = ret ? KSYS_REC_OPENAT_RET : KSYS_REC_OPENAT;
+        e->ret = (int32_t)(x % 64);
+        e->dev = 0x803;
+        e->gen = (uint32_t)x;
+        e->ino = x % 10000000;
+        if (proc && i % 16 == 5) {
+            e->type = KSYS_REC_FORK + (x >> 16) % 3;
+            e->ppid = e->pid - 1;
+            e->ptgid = e->tgid - 1;
+        } else if (i % 997 == 500) {
+            struct ksys_gap *g = (struct ksys_gap *)e;
+            memset(g, 0, sizeof(*g));
+            g->seq = 1000000 + i;
+            g->ts_ns = 1700000000000000000ull;
+            g->lost_from_seq = g->seq - 10;
+            g->lost_to_seq = g->seq;
+            g->count = 10;
+            g->type = KSYS_REC_GAP;
+        }
+    }
+}
+
+// --- Runs ---
+
+// 반환: 걸린 ns. bytes 에 출력 바이트
+static uint64_t run_legacy(int fd, const struct ksys_event *ev, size_t n, size_t batch, uint64_t *bytes)
+{
+    uint64_t t0;
+    long start, end;
+
+    fflush(stdout);
+    if (dup2(fd, STDOUT_FILENO) < 0)
+        return 0;
+    start = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+    t0 = now_ns();
+    for (size_t off = 0; off < n; off += batch) {
+        print_records_json(ev + off, n - off < batch ? n - off : batch);
+        fflush(stdout);
+    }
+    t0 = now_ns() - t0;
+    end = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+    *bytes = start >= 0 && end >= start ? (uint64_t)(end - start) : 0;
+    return t0;
+}
+
+static uint64_t run_encoder(int fd, const struct ksys_event *ev, size_t n, size_t batch, uint64_t *bytes)
+{
+    struct ksys_json j;
+    uint64_t t0;
+
+    if (ksys_json_init(&j, fd, 0) != 0)
+        return 0;
+    t0 = now_ns();
+    for (size_t off = 0; off < n; off += batch) {
+        ksys_json_records(&j, ev + off, n - off < batch ? n - off : batch);
+        ksys_json_flush(&j);
+    }
+    t0 = now_ns() - t0;
+    *bytes = j.bytes;
+    ksys_json_free(&j);
+    return t0;
+}
+
+// 같은 레코드를 두 인코더로 memfd 에 써서 비교
+static bool check_same(const struct ksys_event *ev, size_t n)
+{
+    int a = memfd_create("ksys_json_legacy", 0), b = memfd_create("ksys_json_new", 0);
+    uint64_t la = 0, lb = 0;
+    bool same = false;
+
+    if (a < 0 || b < 0)
+        return false;
+    run_legacy(a, ev, n, n, &la);
+    run_encoder(b, ev, n, n, &lb);
+    if (la == lb && la > 0) {
+        char *pa = mmap(NULL, la, PROT_READ, MAP_SHARED, a, 0);
+        char *pb = mmap(NULL, lb, PROT_READ, MAP_SHARED, b, 0);
+        if (pa != MAP_FAILED && pb != MAP_FAILED) {
+            same = !memcmp(pa, pb, la);
+            if (!same) {
+                size_t k = 0;
+                while (pa[k] == pb[k]) k++;
+                fprintf(stderr, "mismatch at byte %zu\n", k);
+            }
+        }
+        if (pa != MAP_FAILED) munmap(pa, la);
+        if (pb != MAP_FAILED) munmap(pb, lb);
+    } else {
+        fprintf(stderr, "length mismatch: legacy %llu, encoder %llu\n",
+                (unsigned long long)la, (unsigned long long)lb);
+    }
+    close(a);
+    close(b);
+    return same;
+}
+
+static void report(const char *name, uint64_t ns, size_t n, uint64_t bytes)
+{
+    double s = ns / 1e9;
+    fprintf(stderr, "%-8s %8.1f ns/event  %8.2f Mevents/s  %8.1f MB/s  (%llu bytes)\n",
+            name, (double)ns / n, n / s / 1e6, bytes / s / 1e6, (unsigned long long)bytes);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 2000000, batch = 256;
+    const char *outpath = "/dev/null";
+    int esc_pct = 1;
+    bool ret = false, proc = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            n = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            batch = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            outpath = argv[++i];
+        } else if (!strcmp(argv[i], "--esc") && i + 1 < argc) {
+            esc_pct = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--ret")) {
+            ret = true;
+        } else if (!strcmp(argv[i], "--proc")) {
+            proc = true;
+        } else {
+            fprintf(stderr, "usage: %s [-n EVENTS] [-b BATCH] [-o OUT] [--esc PCT] [--ret] [--proc]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (n < 1) n = 1;
+    if (batch < 1) batch = 1;
+
+    struct ksys_event *ev = malloc(n * sizeof(*ev));
+    if (!ev) {
+        perror("malloc");
+        return 1;
+    }
+    gen_records(ev, n, esc_pct, ret, proc);
+
+    if (!check_same(ev, n < 100000 ? n : 100000)) {
+        fprintf(stderr, "encoder output differs from legacy print_event_json\n");
+        return 1;
+    }
+
+    int fd = open(outpath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(outpath);
+        return 1;
+    }
+    fprintf(stderr, "events=%zu batch=%zu esc=%d%% ret=%d proc=%d out=%s\n", n, batch, esc_pct, ret, proc, outpath);
+
+    uint64_t lb = 0, eb = 0;
+    uint64_t lt = run_legacy(fd, ev, n, batch, &lb);
+    if (ftruncate(fd, 0) == 0)
+        lseek(fd, 0, SEEK_SET);
+    uint64_t et = run_encoder(fd, ev, n, batch, &eb);
+
+    // /dev/null 은 lseek 가 0 이라 바이트 수는 인코더 쪽 값으로
+    if (!lb)
+        lb = eb;
+    report("printf", lt, n, lb);
+    report("encoder", et, n, eb);
+    fprintf(stderr, "speedup  %.2fx\n", et ? (double)lt / et : 0.0);
+    close(fd);
+    free(ev);
+    return 0;
+}
@@ -0,0 +1,265 @@
+// ksys_mmap_bench.c
+// mmap 한 링을 순차 소비하는 속도 비교: huge page (2MB) vs 4K 백킹
+//
+//   gcc -O2 -Wall -I../include -o ksys_mmap_bench ksys_mmap_bench.c
+//
+//   ./ksys_mmap_bench --anon --slots 1048576      같은 레이아웃의 익명 메모리로 THP on/off 비교
+//   ./ksys_mmap_bench --dev  [--passes N]         /dev/ksys_trace 매핑 스캔
+//                                                 (ring_huge=1 / ring_huge=0 로 각각 로드해 비교)
+//   ./ksys_mmap_bench --dev --follow SEC          실제 이벤트를 seq 순서로 따라가며 소비
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys.h>
+
+struct ring {
+    const struct ksys_mmap_hdr *hdr;
+    const struct ksys_mmap_slot *slots;
+    uint32_t mask;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// seq 슬롯을 out 에 복사. 덮어써졌거나 쓰는 중이면 false
+static bool ring_read(const struct ring *r, uint64_t seq, struct ksys_event *out)
+{
+    const struct ksys_mmap_slot *s = &r->slots[seq & r->mask];
+
+    if (__atomic_load_n(&s->seq_end, __ATOMIC_ACQUIRE) != seq)
+        return false;
+    memcpy(out, &s->et, sizeof(*out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&s->seq_begin, __ATOMIC_RELAXED) == seq;
+}
+
+// 링 전체를 passes 번 순차 스캔. 슬롯마다 seq 검사 + 본문 복사 (소비자가 하는 일과 같음)
+static void bench_scan(const char *label, const struct ring *r, int passes)
+{
+    struct ksys_event ev;
+    uint64_t ok = 0, sum = 0, t0, dt;
+    uint32_t n = r->mask + 1;
+
+    t0 = now_ns();
+    for (int p = 0; p < passes; p++) {
+        for (uint32_t i = 0; i < n; i++) {
+            const struct ksys_mmap_slot *s = &r->slots[i];
+            uint64_t seq = __atomic_load_n(&s->seq_end, __ATOMIC_ACQUIRE);
+
+            if (ring_read(r, seq, &ev)) {
+                ok++;
+                sum += ev.ts_ns ^ ev.ino;  // 복사가 최적화로 사라지지 않게
+            }
+        }
+    }
+    dt = now_ns() - t0;
+
+    double slots = (double)n * passes;
+    printf("%-10s slots=%u passes=%d  %.2f ns/slot  %.1f Mslot/s  %.2f GB/s  (valid=%" PRIu64 " sum=%" PRIx64 ")\n",
+           label, n, passes, dt / slots, slots * 1e3 / dt,
+           slots * sizeof(struct ksys_mmap_slot) / dt, ok, sum);
+}
+
+// cur_seq 를 따라가며 seq 순서대로 소비. 놓친 건 lost 로 셈
+static void bench_follow(const struct ring *r, int secs)
+{
+    struct ksys_event ev;
+    uint64_t next = __atomic_load_n(&r->hdr->cur_seq, __ATOMIC_ACQUIRE);
+    uint64_t got = 0, lost = 0, spins = 0;
+    uint64_t end = now_ns() + (uint64_t)secs * 1000000000ull;
+
+    while (now_ns() < end) {
+        uint64_t cur = __atomic_load_n(&r->hdr->cur_seq, __ATOMIC_ACQUIRE);
+
+        // 오토튜너가 링을 바꿨으면 이 매핑은 더 이상 갱신되지 않음
+        if (__atomic_load_n(&r->hdr->flags, __ATOMIC_ACQUIRE) & KSYS_MMAP_STALE) {
+            printf("follow    ring was resized, stopping (remap to continue)\n");
+            break;
+        }
+        if (next == cur) {
+            spins++;
+            usleep(100);
+            continue;
+        }
+        // 링 한 바퀴보다 뒤처졌으면 가장 오래된 곳으로 점프
+        if (cur - next > (uint64_t)r->mask + 1) {
+            lost += cur - (r->mask + 1) - next;
+            next = cur - (r->mask + 1);
+        }
+        for (; next < cur; next++) {
+            if (ring_read(r, next, &ev))
+                got++;
+            else
+                lost++;
+        }
+    }
+    printf("follow    %ds  events=%" PRIu64 " (%.0f/s)  lost=%" PRIu64 "  idle_polls=%" PRIu64 "\n",
+           secs, got, (double)got / secs, lost, spins);
+}
+
+static int run_dev(const char *path, int passes, int follow)
+{
+    struct ksys_mmap_hdr h;
+    struct ring r;
+    void *base;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        perror("open");
+        return 1;
+    }
+    // 헤더 페이지만 먼저 매핑해서 전체 크기를 알아냄
+    base = mmap(NULL, 4096, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        perror("mmap hdr");
+        close(fd);
+        return 1;
+    }
+    h = *(const struct ksys_mmap_hdr *)base;
+    munmap(base, 4096);
+
+    if (h.version != KSYS_MMAP_VERSION || h.slot_size != sizeof(struct ksys_mmap_slot)) {
+        fprintf(stderr, "mmap ABI mismatch: version=%u slot_size=%u\n", h.version, h.slot_size);
+        close(fd);
+        return 1;
+    }
+
+    base = mmap(NULL, h.map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        perror("mmap ring");
+        close(fd);
+        return 1;
+    }
+    printf("dev       ring=%u slots node=%d chunk=%u KB map=%llu MB\n",
+           h.ring_size, h.node, h.chunk_size >> 10, h.map_size >> 20);
+
+    r.hdr = base;
+    r.slots = (const struct ksys_mmap_slot *)((const char *)base + h.hdr_size);
+    r.mask = h.ring_size - 1;
+
+    if (follow > 0)
+        bench_follow(&r, follow);
+    else
+        bench_scan(h.chunk_size > 4096 ? "dev-huge" : "dev-4k", &r, passes);
+
+    munmap(base, h.map_size);
+    close(fd);
+    return 0;
+}
+
+// 커널 링과 같은 레이아웃을 익명 메모리에 만들어 THP on/off 로 스캔
+static int run_anon_one(const char *label, uint32_t slots, int passes, int advice)
+{
+    size_t huge = 2u << 20;
+    size_t bytes = 4096 + (size_t)slots * sizeof(struct ksys_mmap_slot);
+    struct ksys_mmap_hdr *h;
+    struct ring r;
+    void *base;
+
+    bytes = (bytes + huge - 1) & ~(huge - 1);
+    // 2MB 경계에 맞추려고 넉넉히 잡고 앞부분을 버림
+    base = mmap(NULL, bytes + huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        perror("mmap anon");
+        return 1;
+    }
+    void *aligned = (void *)(((uintptr_t)base + huge - 1) & ~(uintptr_t)(huge - 1));
+    if (madvise(aligned, bytes, advice) && errno != EINVAL)
+        perror("madvise");
+
+    h = aligned;
+    h->version = KSYS_MMAP_VERSION;
+    h->ring_size = slots;
+    h->slot_size = sizeof(struct ksys_mmap_slot);
+    h->hdr_size = 4096;
+
+    r.hdr = h;
+    r.slots = (const struct ksys_mmap_slot *)((char *)aligned + 4096);
+    r.mask = slots - 1;
+
+    // 첫 터치에서 페이지가 잡히도록 전 슬롯을 채움
+    struct ksys_mmap_slot *w = (struct ksys_mmap_slot *)r.slots;
+    for (uint32_t i = 0; i < slots; i++) {
+        w[i].seq_begin = i;
+        w[i].et.seq = i;
+        w[i].et.ts_ns = i * 1000ull;
+        w[i].et.ino = i;
+        w[i].seq_end = i;
+    }
+    h->cur_seq = slots;
+
+    bench_scan(label, &r, passes);
+    munmap(base, bytes + huge);
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s --anon [--slots N] [--passes N]\n"
+            "       %s --dev [PATH] [--passes N | --follow SEC]\n",
+            prog, prog);
+}
+
+int main(int argc, char **argv)
+{
+    const char *dev = "/dev/ksys_trace";
+    bool anon = false, use_dev = false;
+    uint32_t slots = 1u << 20;
+    int passes = 10, follow = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--anon")) {
+            anon = true;
+        } else if (!strcmp(argv[i], "--dev")) {
+            use_dev = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                dev = argv[++i];
+        } else if (!strcmp(argv[i], "--slots") && i + 1 < argc) {
+            slots = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--passes") && i + 1 < argc) {
+            passes = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--follow") && i + 1 < argc) {
+            follow = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (!anon && !use_dev) {
+        usage(argv[0]);
+        return 2;
+    }
+    // 커널과 같이 2의 거듭제곱으로 올림
+    if (slots < 64)
+        slots = 64;
+    while (slots & (slots - 1))
+        slots += slots & -slots;
+    if (passes < 1)
+        passes = 1;
+
+    if (anon) {
+        if (run_anon_one("anon-4k", slots, passes, MADV_NOHUGEPAGE))
+            return 1;
+        if (run_anon_one("anon-huge", slots, passes, MADV_HUGEPAGE))
+            return 1;
+    }
+    if (use_dev)
+        return run_dev(dev, passes, follow);
+    return 0;
+}
@@ -0,0 +1,256 @@
+// ksys_seg_bench.c
+// lib/ksys_seg.c 세그먼트 파일의 압축률과 스캔 속도 (장치 없이 합성 레코드로)
+//
+//   gcc -O2 -Wall -I../include -o ksys_seg_bench ksys_seg_bench.c ../lib/ksys_seg.c ../lib/ksys_json.c
+//   ./ksys_seg_bench [-n EVENTS] [-r BLOCK_ROWS] [-o FILE] [--keep]
+//
+// 같은 레코드를 raw (ksys_event 그대로), NDJSON (ksys_json), 세그먼트로 썼을 때 바이트/이벤트를 비교하고,
+// 세그먼트 전체 스캔과 좁은 조건 (ts 1% 구간, tgid 하나) 스캔의 속도와 건너뛴 블록 수를 봄.
+// 전체 스캔 결과가 원본과 바이트 단위로 같은지 먼저 확인하고, 다르면 exit 1
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys.h>
+#include <ksys/ksys_json.h>
+#include <ksys/ksys_seg.h>
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// --- Synthetic Records ---
+
+static const char *const dirs[] = { "/usr/lib/x86_64-linux-gnu", "/etc", "/proc/self", "/home/user/project/src",
+                                    "/var/log", "/tmp" };
+static const char *const comms[] = { "bash", "python3", "nginx", "systemd-journal", "cc1", "java" };
+
+#define LIVE_PROCS  8
+
+// 실제 트레이스처럼 살아 있는 프로세스 몇 개가 번갈아 열고, 가끔 하나가 새 tgid 로 바뀜.
+// 프로세스마다 자주 여는 파일이 정해져 있어 경로가 반복됨
+static void gen_records(struct ksys_event *ev, size_t n)
+{
+    int32_t live[LIVE_PROCS], next_tgid = 2000;
+    uint64_t x = 0x9e3779b97f4a7c15ull, ts = 1700000000000000000ull;
+
+    for (int k = 0; k < LIVE_PROCS; k++)
+        live[k] = next_tgid++;
+    memset(ev, 0, n * sizeof(*ev));
+    for (size_t i = 0; i < n; i++) {
+        struct ksys_event *e = &ev[i];
+        int32_t tgid;
+
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        if (i % 5000 == 4999)
+            live[x % LIVE_PROCS] = next_tgid++;
+        tgid = live[(x >> 8) % LIVE_PROCS];
+        ts += 200 + x % 4000;
+
+        e->seq = 1000000 + i;
+        e->ts_ns = ts;
+        e->tgid = tgid;
+        e->pid = tgid + (int32_t)((x >> 20) % 4);
+        snprintf(e->comm, sizeof(e->comm), "%s", comms[tgid % 6]);
+        snprintf(e->path, sizeof(e->path), "%s/file_%d.so", dirs[(tgid + (x >> 24)) % 6],
+                 (int)((x >> 32) % 48));
+        e->dfd = -100;
+        e->flags = (x >> 40) % 4 ? 0x80000 : 0x80241;
+        e->mode = e->flags & 0x40 ? 0644 : 0;
+        e->type = KSYS_REC_OPENAT_RET;
+        e->ret = (x >> 44) % 16 ? (int32_t)(3 + (x >> 48) % 20) : -2;
+        e->dev = e->ret < 0 ? 0 : 0x803;
+        e->gen = e->ret < 0 ? 0 : (uint32_t)(x >> 12) & 0xffff;
+        e->ino = e->ret < 0 ? 0 : 100000 + (x >> 28) % 500000;
+        if (i % 9973 == 5000) {
+            struct ksys_gap *g = (struct ksys_gap *)e;
+            memset(g, 0, sizeof(*g));
+            g->seq = 1000000 + i;
+            g->ts_ns = ts;
+            g->lost_from_seq = g->seq - 10;
+            g->lost_to_seq = g->seq;
+            g->count = 10;
+            g->type = KSYS_REC_GAP;
+        }
+    }
+}
+
+// --- Scan Callbacks ---
+
+struct verify {
+    const struct ksys_event *ev;
+    size_t n;
+    size_t at;
+    bool bad;
+};
+
+static int verify_cb(void *arg, const struct ksys_event *ev, size_t n)
+{
+    struct verify *v = arg;
+
+    if (v->at + n > v->n || memcmp(&v->ev[v->at], ev, n * sizeof(*ev))) {
+        for (size_t k = 0; k < n && v->at + k < v->n; k++) {
+            if (memcmp(&v->ev[v->at + k], &ev[k], sizeof(*ev))) {
+                fprintf(stderr, "mismatch at record %zu (seq %llu)\n", v->at + k, v->ev[v->at + k].seq);
+                break;
+            }
+        }
+        v->bad = true;
+        return 1;
+    }
+    v->at += n;
+    return 0;
+}
+
+static int count_cb(void *arg, const struct ksys_event *ev, size_t n)
+{
+    uint64_t *sum = arg;
+
+    // 실제로 레코드를 건드리게
+    for (size_t k = 0; k < n; k++)
+        *sum += ev[k].ino;
+    return 0;
+}
+
+static int scan(struct ksys_seg_reader *r, const char *name, const struct ksys_seg_query *q)
+{
+    struct ksys_seg_scan_stats st;
+    uint64_t sum = 0, t0 = now_ns();
+
+    if (ksys_seg_scan(r, q, count_cb, &sum, &st) != 0) {
+        perror("ksys_seg_scan");
+        return -1;
+    }
+    t0 = now_ns() - t0;
+    fprintf(stderr, "%-10s %8.2f ms  blocks %llu/%llu skipped  decoded %llu  matched %llu  (%.1f Mrows/s decoded)\n",
+            name, t0 / 1e6, st.blocks_skipped, st.blocks, st.rows_decoded, st.rows_matched,
+            t0 ? st.rows_decoded / (t0 / 1e9) / 1e6 : 0.0);
+    return 0;
+}
+
+static const char *const col_names[KSYS_SEG_NCOLS] = {
+    "type", "seq", "ts", "tgid", "pid", "comm", "path", "dfd", "flags", "mode", "ret", "dev", "gen", "ino", "gap",
+};
+
+int main(int argc, char **argv)
+{
+    size_t n = 2000000;
+    __u32 block_rows = 0;
+    const char *path = "/tmp/ksys_seg_bench.kseg";
+    bool keep = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            n = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            block_rows = (__u32)strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            path = argv[++i];
+        } else if (!strcmp(argv[i], "--keep")) {
+            keep = true;
+        } else {
+            fprintf(stderr, "usage: %s [-n EVENTS] [-r BLOCK_ROWS] [-o FILE] [--keep]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (n < 1) n = 1;
+
+    struct ksys_event *ev = malloc(n * sizeof(*ev));
+    if (!ev) {
+        perror("malloc");
+        return 1;
+    }
+    gen_records(ev, n);
+
+    // NDJSON 은 크기만 (버퍼 단위로 /dev/null 에)
+    struct ksys_json j;
+    int null_fd = open("/dev/null", O_WRONLY);
+    uint64_t json_bytes = 0;
+    if (null_fd >= 0 && ksys_json_init(&j, null_fd, 0) == 0) {
+        for (size_t off = 0; off < n; off += 1024) {
+            ksys_json_records(&j, ev + off, n - off < 1024 ? n - off : 1024);
+            ksys_json_flush(&j);
+        }
+        json_bytes = j.bytes;
+        ksys_json_free(&j);
+    }
+    if (null_fd >= 0)
+        close(null_fd);
+
+    // 장치에서 오는 것처럼 1024 개씩
+    struct ksys_seg_writer *w = ksys_seg_writer_open(path, block_rows);
+    struct ksys_seg_wstats ws;
+    if (!w) {
+        perror(path);
+        return 1;
+    }
+    uint64_t wt = now_ns();
+    for (size_t off = 0; off < n; off += 1024) {
+        if (ksys_seg_append(w, ev + off, n - off < 1024 ? n - off : 1024) != 0) {
+            perror("ksys_seg_append");
+            return 1;
+        }
+    }
+    ksys_seg_writer_stats(w, &ws);
+    if (ksys_seg_writer_close(w) != 0) {
+        perror("ksys_seg_writer_close");
+        return 1;
+    }
+    wt = now_ns() - wt;
+
+    struct ksys_seg_reader *r = ksys_seg_open(path);
+    if (!r) {
+        perror(path);
+        return 1;
+    }
+    struct ksys_seg_query q;
+    struct verify v = { .ev = ev, .n = n };
+    ksys_seg_query_init(&q);
+    if (ksys_seg_scan(r, &q, verify_cb, &v, NULL) != 0 || v.bad || v.at != n) {
+        fprintf(stderr, "segment round trip differs from input (%zu of %zu records matched)\n", v.at, n);
+        return 1;
+    }
+
+    uint64_t raw_bytes = sizeof(struct ksys_event) * n;
+    fprintf(stderr, "events=%zu block_rows=%u blocks=%u file=%s\n", n, ksys_seg_block_rows(r), ksys_seg_nblocks(r),
+            path);
+    fprintf(stderr, "raw        %8.1f bytes/event\n", (double)raw_bytes / n);
+    fprintf(stderr, "ndjson     %8.1f bytes/event\n", (double)json_bytes / n);
+    fprintf(stderr, "segment    %8.1f bytes/event  (%.1fx vs raw, %.1fx vs ndjson)\n", (double)ws.bytes / n,
+            (double)raw_bytes / ws.bytes, (double)json_bytes / ws.bytes);
+    fprintf(stderr, "  columns:");
+    for (int c = 0; c < KSYS_SEG_NCOLS; c++)
+        fprintf(stderr, " %s=%.2f", col_names[c], (double)ws.col_bytes[c] / n);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "write      %8.2f ms  (%.1f Mevents/s)\n", wt / 1e6, n / (wt / 1e9) / 1e6);
+
+    if (scan(r, "full", &q) != 0)
+        return 1;
+    // 가운데 1% 시간 구간
+    q.ts_min = ev[n / 2].ts_ns;
+    q.ts_max = ev[n / 2 + n / 100].ts_ns;
+    if (scan(r, "ts 1%", &q) != 0)
+        return 1;
+    // 중간쯤 살아 있던 프로세스 하나
+    ksys_seg_query_init(&q);
+    q.tgid = ev[n / 2].type == KSYS_REC_GAP ? ev[n / 2 + 1].tgid : ev[n / 2].tgid;
+    if (scan(r, "tgid", &q) != 0)
+        return 1;
+
+    ksys_seg_close(r);
+    if (!keep)
+        unlink(path);
+    free(ev);
+    return 0;
+}
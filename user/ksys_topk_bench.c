@@ -0,0 +1,224 @@
+// ksys_topk_bench.c
+// lib/ksys_topk.c 의 이벤트당 비용과 정확도 (장치 없이 Zipf 분포 합성 레코드로)
+//
+//   gcc -O2 -Wall -I../include -o ksys_topk_bench ksys_topk_bench.c ../lib/ksys_topk.c -lm
+//   ./ksys_topk_bench [-n EVENTS] [-k CAPACITY] [-p PATHS] [-s ZIPF_S]
+//
+// 경로 PATHS 개, 프로세스 4096 개를 Zipf 로 뽑아 넣고 ns/이벤트를 잼 (capacity 를 바꿔도 거의
+// 같아야 함). 정확히 센 값과 비교해서 상위 20 개 중 몇 개를 맞혔는지, 보고된 항목마다
+// count - error <= 실제 <= count 가 지켜지는지 봄. 어기면 exit 1.
+// 마지막으로 시간을 창 길이만큼 넘겨서 옛 조각이 빠지는지 확인
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ksys/ksys.h>
+#include <ksys/ksys_topk.h>
+
+#define NPROCS  4096
+#define TOP     20
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// --- Synthetic Stream ---
+
+static double *zipf_cdf(uint32_t n, double s)
+{
+    double *cdf = malloc(n * sizeof(*cdf)), sum = 0;
+    for (uint32_t i = 0; i < n; i++)
+        sum += 1.0 / pow(i + 1, s);
+    double acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        acc += 1.0 / pow(i + 1, s) / sum;
+        cdf[i] = acc;
+    }
+    return cdf;
+}
+
+static uint32_t zipf_pick(const double *cdf, uint32_t n, double u)
+{
+    uint32_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (cdf[mid] < u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static inline uint64_t xorshift(uint64_t *x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+static const char *const dirs[] = { "/usr/lib/x86_64-linux-gnu", "/etc/ssl/certs", "/proc/self", "/home/user/src",
+                                    "/var/log/nginx", "/usr/share/zoneinfo" };
+
+// --- Check ---
+
+static int check(struct ksys_topk *t, enum ksys_topk_dim dim, const uint64_t *exact, uint32_t nkeys,
+                 char (*names)[KSYS_PATH_LEN])
+{
+    struct ksys_topk_item it[TOP];
+    __u64 total;
+    uint64_t t0 = now_ns();
+    int n = ksys_topk_query(t, dim, 0, it, TOP, &total);
+    t0 = now_ns() - t0;
+
+    // 정확한 상위 TOP 의 경계값
+    uint64_t *sorted = malloc(nkeys * sizeof(*sorted));
+    memcpy(sorted, exact, nkeys * sizeof(*sorted));
+    for (int i = 0; i < TOP && i < (int)nkeys; i++) {
+        uint32_t best = i;
+        for (uint32_t j = i + 1; j < nkeys; j++)
+            if (sorted[j] > sorted[best])
+                best = j;
+        uint64_t tmp = sorted[i];
+        sorted[i] = sorted[best];
+        sorted[best] = tmp;
+    }
+    uint64_t cut = sorted[(nkeys < TOP ? nkeys : TOP) - 1];
+    free(sorted);
+
+    int hit = 0, bad = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t truth = 0;
+        for (uint32_t j = 0; j < nkeys; j++) {
+            bool same = dim == KSYS_TOPK_TGID ? it[i].tgid == (int32_t)(1000 + j)
+                                              : !strncmp(it[i].key, names[j], KSYS_PATH_LEN);
+            if (same) {
+                truth = exact[j];
+                break;
+            }
+        }
+        if (truth >= cut)
+            hit++;
+        if (truth > it[i].count || truth < it[i].count - it[i].error) {
+            fprintf(stderr, "  bound broken: %.64s count %llu error %llu exact %llu\n", it[i].key, it[i].count,
+                    it[i].error, (unsigned long long)truth);
+            bad++;
+        }
+    }
+    fprintf(stderr, "%-6s top%d hit %d/%d  total %llu  query %.1f us  (#1 %.40s %llu +-%llu)\n",
+            ksys_topk_dim_name(dim), TOP, hit, n, total, t0 / 1e3, n ? it[0].key : "", n ? it[0].count : 0,
+            n ? it[0].error : 0);
+    return bad;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 2000000;
+    uint32_t cap = 256, npaths = 100000;
+    double s = 1.1;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:k:p:s:")) != -1) {
+        switch (c) {
+        case 'n': n = strtoull(optarg, NULL, 0); break;
+        case 'k': cap = strtoul(optarg, NULL, 0); break;
+        case 'p': npaths = strtoul(optarg, NULL, 0); break;
+        case 's': s = strtod(optarg, NULL); break;
+        default:
+            fprintf(stderr, "usage: %s [-n EVENTS] [-k CAPACITY] [-p PATHS] [-s ZIPF_S]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!npaths)
+        npaths = 1;
+
+    char (*paths)[KSYS_PATH_LEN] = calloc(npaths, KSYS_PATH_LEN);
+    char (*comms)[KSYS_PATH_LEN] = calloc(NPROCS, KSYS_PATH_LEN);
+    uint32_t *pi = malloc(n * sizeof(*pi)), *ti = malloc(n * sizeof(*ti));
+    uint64_t *pex = calloc(npaths, sizeof(*pex)), *tex = calloc(NPROCS, sizeof(*tex));
+    double *pcdf = zipf_cdf(npaths, s), *tcdf = zipf_cdf(NPROCS, s);
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+
+    for (uint32_t i = 0; i < npaths; i++)
+        snprintf(paths[i], KSYS_PATH_LEN, "%s/f%u", dirs[i % 6], i);
+    for (uint32_t i = 0; i < NPROCS; i++)
+        snprintf(comms[i], KSYS_COMM_LEN, "proc%u", i);
+    // 뽑기는 시간 밖에서
+    for (size_t i = 0; i < n; i++) {
+        pi[i] = zipf_pick(pcdf, npaths, (xorshift(&x) >> 11) * 0x1.0p-53);
+        ti[i] = zipf_pick(tcdf, NPROCS, (xorshift(&x) >> 11) * 0x1.0p-53);
+        pex[pi[i]]++;
+        tex[ti[i]]++;
+    }
+
+    struct ksys_topk_opts o;
+    ksys_topk_opts_init(&o);
+    o.capacity = cap;
+    struct ksys_topk *t = ksys_topk_new(&o);
+    if (!t) {
+        perror("ksys_topk_new");
+        return 1;
+    }
+
+    struct ksys_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = KSYS_REC_OPENAT_RET;
+    uint64_t base = 1000000000ull;
+    ksys_topk_tick(t, base);
+
+    // 레코드 채우기만 한 비용을 빼기 위해 같은 루프를 한 번 빈 채로
+    uint64_t sink = 0, t0 = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        memcpy(ev.path, paths[pi[i]], KSYS_PATH_LEN);
+        memcpy(ev.comm, comms[ti[i]], KSYS_COMM_LEN);
+        ev.tgid = 1000 + ti[i];
+        sink += ev.path[5] + ev.tgid;
+        __asm__ volatile("" ::: "memory");
+    }
+    uint64_t fill = now_ns() - t0;
+
+    t0 = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        memcpy(ev.path, paths[pi[i]], KSYS_PATH_LEN);
+        memcpy(ev.comm, comms[ti[i]], KSYS_COMM_LEN);
+        ev.tgid = 1000 + ti[i];
+        ksys_topk_add(t, &ev);
+    }
+    t0 = now_ns() - t0;
+    fprintf(stderr, "capacity %u  window %us  %zu events  %u paths  zipf %.2f\n", cap, ksys_topk_window(t), n,
+            npaths, s);
+    fprintf(stderr, "add    %.1f ns/event (4 dims, fill %.1f ns subtracted)  %.1f Mev/s\n",
+            (double)(t0 - fill) / n, (double)fill / n, n / (t0 / 1e9) / 1e6);
+
+    int bad = 0;
+    bad += check(t, KSYS_TOPK_PATH, pex, npaths, paths);
+    bad += check(t, KSYS_TOPK_TGID, tex, NPROCS, NULL);
+
+    // 창을 지나면 비어야 함
+    struct ksys_topk_item it[1];
+    __u64 total;
+    ksys_topk_tick(t, base + (uint64_t)ksys_topk_window(t) * 1000000000ull);
+    int left = ksys_topk_query(t, KSYS_TOPK_PATH, 0, it, 1, &total);
+    fprintf(stderr, "after window: %d items, total %llu\n", left, total);
+    if (left || total)
+        bad++;
+
+    ksys_topk_free(t);
+    if (sink == 1)
+        putchar(0);
+    if (bad) {
+        fprintf(stderr, "FAIL: %d\n", bad);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+// ksysd_qos_test.c
+// 떠 있는 ksysd 에 큐를 터무니없이 크게 달라는 HELLO 를 보내서 데몬이 자르는지 확인
+//
+//   gcc -O2 -Wall -I../include -o ksysd_qos_test ksysd_qos_test.c ../lib/ksysd_client.c
+//   ./ksysd_qos_test [SOCK]
+//
+// queue_kb = UINT32_MAX 로 붙어서 WELCOME 의 queue_kb 가 KSYSD_QUEUE_KB_MAX 이하인지,
+// STATS 에 보이는 이 클라이언트의 queue_cap 이 그 크기에 맞는지, 그 뒤에도 데몬이 새 연결을
+// 받는지 봄. 하나라도 어기면 exit 1
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <ksys/ksysd.h>
+
+int main(int argc, char **argv)
+{
+    const char *sock = argc > 1 ? argv[1] : NULL;
+    struct ksysd_client c, c2;
+    struct ksysd_client_stat st[KSYSD_MAX_CLIENTS];
+    struct ksysd_qos qos;
+    __u32 want_cap = (__u32)(((__u64)KSYSD_QUEUE_KB_MAX << 10) / KSYSD_MSG_MAX);
+    int n, bad = 0;
+
+    memset(&qos, 0, sizeof(qos));
+    qos.queue_kb = UINT32_MAX;
+    if (ksysd_client_open(&c, sock, NULL, &qos) != 0) {
+        perror("ksysd_client_open");
+        return 1;
+    }
+    printf("asked queue_kb %u, got %u (max %u)\n", qos.queue_kb, c.info.qos.queue_kb, KSYSD_QUEUE_KB_MAX);
+    if (c.info.qos.queue_kb > KSYSD_QUEUE_KB_MAX)
+        bad++;
+
+    n = ksysd_query_stats(sock, st, KSYSD_MAX_CLIENTS);
+    if (n < 0) {
+        perror("ksysd_query_stats");
+        bad++;
+    }
+    for (int i = 0; i < n; i++) {
+        if (st[i].pid != getpid() || !st[i].active)
+            continue;
+        printf("queue_cap %u messages (expected %u)\n", st[i].queue_cap, want_cap);
+        if (st[i].queue_cap > want_cap)
+            bad++;
+    }
+
+    // 데몬이 아직 살아서 받는지
+    if (ksysd_client_open(&c2, sock, NULL, NULL) != 0) {
+        perror("second client");
+        bad++;
+    } else {
+        ksysd_client_close(&c2);
+    }
+    ksysd_client_close(&c);
+    if (bad) {
+        fprintf(stderr, "FAIL: %d\n", bad);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -1,87 +1,533 @@
 // user/ksysdump.c
-
-#include <poll.h>
+// libksys 로 읽는 가장 단순한 소비자 (백엔드는 라이브러리가 고름)
+//
+//   gcc -O2 -Wall -pthread -I../include -o ksysdump ksysdump.c ../lib/libsys.c ../lib/ksys_fanotify.c
+//       ../lib/ksys_json.c ../lib/ksys_wire.c ../lib/ksys_seg.c ../lib/ksys_pipe.c ../lib/ksys_uring.c
+//   sudo ./ksysdump [--backend auto|mmap|batch|read|fanotify] [--format text|json|raw|lp|msgpack]
+//                   [--threads N|auto [--pipe-stats SEC]]
+//                   [--out PREFIX [--rotate-size MB] [--rotate-sec S] [--prealloc MB] [--direct]]
+//   sudo ./ksysdump --seg FILE                    // 세그먼트 파일로 저장 (Ctrl-C 로 마무리)
+//   ./ksysdump --input FILE|- [--format ...]      // raw/lp/msgpack 스트림이나 세그먼트 파일을 다시 읽음
+//
+// 예: sudo ./ksysdump --format raw | ./ksysdump --input - --format json
+// json 은 ksysdump_json 과 같은 줄, raw/lp/msgpack 은 include/ksys/ksys_wire.h,
+// 세그먼트는 include/ksys/ksys_seg.h. 배치마다 write 한 번 (세그먼트는 블록이 찰 때마다)
+//
+// --threads 는 읽기 / 인코딩 N 스레드 / 쓰기를 나눔 (include/ksys/ksys_pipe.h). 인코딩이 밀려도
+// 읽기가 멈추지 않아 drops 가 줄어듦. 출력 순서는 그대로. json/raw/lp/msgpack 만
+//
+// --out 은 stdout 대신 io_uring 으로 PREFIX.000001 ... 에 씀 (include/ksys/ksys_uring.h).
+// 디스크가 잠깐 느려도 읽는 루프는 write() 에 묶이지 않음. raw/lp 는 파일마다 헤더가 붙어
+// 돌린 파일 하나만으로도 --input 으로 읽을 수 있음
+#include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
-#include <sys/ioctl.h>
-#include <sys/types.h>
 
-#define KSYS_COMM_LEN 16
-#define KSYS_PATH_LEN 64
-#define KSYS_IOC_MAGIC 'k'
+#include <ksys/ksys.h>
+#include <ksys/ksys_json.h>
+#include <ksys/ksys_pipe.h>
+#include <ksys/ksys_seg.h>
+#include <ksys/ksys_uring.h>
+#include <ksys/ksys_wire.h>
 
+enum { OUT_TEXT, OUT_JSON, OUT_WIRE, OUT_SEG };
 
-struct ksys_stats {
-    uint64_t cur_seq;
-    uint64_t drops;
-    uint32_t ring_size;
-    uint32_t _pad;
+struct sink {
+    int kind;
+    struct ksys_json js;
+    struct ksys_wire_writer w;
+    struct ksys_seg_writer *seg;
+    struct ksys_uring_writer *ur;   // --out: 인코더는 메모리 모드, 바이트는 여기로
+    struct ksys_wire_hdr hdr;
 };
 
-#define KSYS_IOC_GET_STATS _IOR(KSYS_IOC_MAGIC, 1, struct ksys_stats)
-
-struct ksys_event {
-    uint64_t seq;
-    uint64_t ts_ns;                   // timestamp (ns)
-    int32_t  pid;                     // pid_t 와 크기가 같다고 가정 (x86_64)
-    int32_t  tgid;                    // tgid
-    char     comm[KSYS_COMM_LEN];     // 프로세스 이름
-    char     path[KSYS_PATH_LEN];     // 파일 경로
-    int32_t  dfd;                     // dir fd (AT_FDCWD == -100)
-    int32_t  flags;                   // open flags
-    uint32_t mode;                    // umode_t (퍼미션 비트)
-};
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop = 1;
+}
+
+// uo 가 있으면 (--out) stdout 대신 io_uring 파일로
+static int sink_init(struct sink *s, const char *fmt, const char *seg, struct ksys_uring_opts *uo)
+{
+    int wf;
+
+    if (seg) {
+        s->kind = OUT_SEG;
+        s->seg = ksys_seg_writer_open(seg, 0);
+        return s->seg ? 0 : -1;
+    }
+    if (!strcmp(fmt, "text")) {
+        s->kind = OUT_TEXT;
+        return 0;
+    }
+    if (!strcmp(fmt, "json")) {
+        s->kind = OUT_JSON;
+        if (ksys_json_init(&s->js, uo ? -1 : STDOUT_FILENO, 0) != 0)
+            return -1;
+    } else {
+        wf = ksys_wire_fmt_parse(fmt);
+        if (wf < 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (!uo && isatty(STDOUT_FILENO)) {
+            errno = ENOTTY;     // 터미널에 바이너리를 쏟지 않음
+            return -1;
+        }
+        s->kind = OUT_WIRE;
+        if (ksys_wire_writer_init(&s->w, uo ? -1 : STDOUT_FILENO, (enum ksys_wire_fmt)wf, 0) != 0)
+            return -1;
+        if (uo) {
+            uo->file_hdr = &s->hdr;
+            uo->file_hdr_len = ksys_wire_hdr_init(&s->hdr, (enum ksys_wire_fmt)wf);
+        }
+    }
+    if (uo) {
+        s->ur = ksys_uring_open(uo);
+        if (!s->ur)
+            return -1;
+    }
+    return 0;
+}
 
-int main(void)
+// 메모리 모드 인코더에 모인 것을 io_uring 파일로
+static int sink_drain(struct sink *s, char *buf, size_t *len)
 {
-    int fd;
-    struct ksys_stats st;
-    size_t i, cnt;
+    int rc = ksys_uring_write(s->ur, buf, *len);
+
+    *len = 0;
+    return rc;
+}
+
+// 세그먼트는 여기서 인덱스/트레일러를 쓰고, --out 은 남은 쓰기를 기다림
+static int sink_free(struct sink *s)
+{
+    int rc = 0;
+
+    if (s->kind == OUT_JSON)
+        ksys_json_free(&s->js);
+    else if (s->kind == OUT_WIRE)
+        ksys_wire_writer_free(&s->w);
+    else if (s->kind == OUT_SEG)
+        return s->seg ? ksys_seg_writer_close(s->seg) : 0;
+    if (s->ur) {
+        struct ksys_uring_stats us;
+
+        ksys_uring_stats(s->ur, &us);
+        fprintf(stderr, "[out] files=%llu bytes=%llu writes=%llu enters=%llu inflight_max=%u stall=%.1fms\n",
+                us.files, us.bytes, us.writes, us.enters, us.inflight_max, us.stall_ns / 1e6);
+        rc = ksys_uring_close(s->ur);
+        s->ur = NULL;
+    }
+    return rc;
+}
+
+// 배치 하나를 쓰고 바로 내보냄
+static int sink_put(struct sink *s, const struct ksys_event *ev, size_t n)
+{
+    size_t i;
+
+    switch (s->kind) {
+        case OUT_JSON:
+            if (ksys_json_records(&s->js, ev, n) != 0)
+                return -1;
+            return s->ur ? sink_drain(s, s->js.buf, &s->js.len) : ksys_json_flush(&s->js);
+        case OUT_WIRE:
+            if (ksys_wire_write(&s->w, ev, n) != 0)
+                return -1;
+            return s->ur ? sink_drain(s, s->w.buf, &s->w.len) : ksys_wire_flush(&s->w);
+        case OUT_SEG:
+            return ksys_seg_append(s->seg, ev, n);
+    }
+    if (n)
+        printf("got %zu events\n", n);
+    for (i = 0; i < n; i++) {
+        const struct ksys_event *e = &ev[i];
+        if (e->type == KSYS_REC_GAP)
+            continue;
+        printf("[%3zu] pid=%d tgid=%d comm=%s dfd=%d flags=0x%x mode=%o path=%s\n",
+               i, e->pid, e->tgid, e->comm, e->dfd, e->flags, e->mode, e->path);
+    }
+    return fflush(stdout) == 0 ? 0 : -1;
+}
+
+static int seg_put(void *arg, const struct ksys_event *ev, size_t n)
+{
+    if (sink_put(arg, ev, n) != 0) {
+        perror("write");
+        return 1;
+    }
+    return 0;
+}
+
+// 세그먼트 파일은 mmap 으로 블록 단위로 풂
+static int run_seg_input(const char *path, struct sink *s)
+{
+    struct ksys_seg_reader *r = ksys_seg_open(path);
+    struct ksys_seg_query q;
+    int rc;
+
+    if (!r) {
+        perror(path);
+        return 1;
+    }
+    fprintf(stderr, "input=%s format=seg blocks=%u\n", path, ksys_seg_nblocks(r));
+    ksys_seg_query_init(&q);
+    rc = ksys_seg_scan(r, &q, seg_put, s, NULL);
+    if (rc != 0)
+        perror("ksys_seg_scan");
+    ksys_seg_close(r);
+    return rc != 0 ? 1 : 0;
+}
+
+// --input: 파일/파이프에서 읽어 형식만 바꿈
+static int run_input(const char *path, struct sink *s)
+{
+    static struct ksys_event buf[1024];
+    struct ksys_wire_reader *r;
+    int fd = strcmp(path, "-") ? open(path, O_RDONLY | O_CLOEXEC) : STDIN_FILENO;
+    char magic[8];
+    ssize_t n;
 
-    fd = open("/dev/ksys_trace", O_RDONLY | O_NONBLOCK);
     if (fd < 0) {
-        perror("open /dev/ksys_trace");
+        perror(path);
         return 1;
     }
-    struct pollfd pfd = {.fd = fd, .events = POLLIN};
-    // struct pollfd fd -> fd, events -> 대기 중인 이벤트, revent ->  fd에 발생한 event를 의미
-    for(;;)
-    {
-        int pr = poll(&pfd, 1, -1); // 무한 대기
-        if (pr == -1)
-        {
-            perror("poll");
+    // 일반 파일이면 세그먼트인지 먼저 봄 (파이프는 되돌릴 수 없으니 wire 형식만)
+    if (fd != STDIN_FILENO && pread(fd, magic, sizeof(magic), 0) == (ssize_t)sizeof(magic) &&
+        !memcmp(magic, KSYS_SEG_MAGIC, sizeof(magic))) {
+        close(fd);
+        return run_seg_input(path, s);
+    }
+    r = ksys_wire_reader_open(fd, KSYS_WIRE_AUTO);
+    if (!r) {
+        perror("ksys_wire_reader_open");
+        return 1;
+    }
+    fprintf(stderr, "input=%s format=%s\n", path, ksys_wire_fmt_name(ksys_wire_reader_fmt(r)));
+    while ((n = ksys_wire_read(r, buf, sizeof(buf) / sizeof(buf[0]))) > 0) {
+        if (sink_put(s, buf, (size_t)n) != 0) {
+            perror("write");
             break;
         }
-        if (pfd.revents & POLLIN) {
-            struct ksys_event event[128];
-            ssize_t n;
-            n = read(fd, event, sizeof(event));
-            if (n < 0) {
-                perror("read");
-                close(fd);
-                return 1;
+    }
+    if (n < 0)
+        perror("ksys_wire_read");
+    ksys_wire_reader_close(r);
+    if (fd != STDIN_FILENO)
+        close(fd);
+    return n < 0 ? 1 : 0;
+}
+
+// --- Pipeline ---
+
+// 인코더 스레드에서 (sink 는 읽기만). 슬롯 버퍼를 메모리 모드 인코더에 빌려줌
+static int pipe_encode(void *arg, const struct ksys_event *ev, size_t n, struct ksys_pipe_buf *out)
+{
+    const struct sink *s = arg;
+    int rc;
+
+    if (s->kind == OUT_JSON) {
+        struct ksys_json j = { .fd = -1, .buf = out->buf, .cap = out->cap };
+
+        rc = ksys_json_records(&j, ev, n);
+        out->buf = j.buf;
+        out->cap = j.cap;
+        out->len = j.len;
+    } else {
+        struct ksys_wire_writer w = { .fd = -1, .fmt = s->w.fmt, .buf = out->buf, .cap = out->cap };
+
+        rc = ksys_wire_write(&w, ev, n);
+        out->buf = w.buf;
+        out->cap = w.cap;
+        out->len = w.len;
+    }
+    return rc;
+}
+
+// writer 스레드에서. 짧은 writev 는 이어서
+static int pipe_write(void *arg, const struct iovec *in, int cnt)
+{
+    const struct sink *s = arg;
+    struct iovec iov[16], *v = iov;
+
+    if (s->ur) {
+        for (int i = 0; i < cnt; i++) {
+            if (ksys_uring_write(s->ur, in[i].iov_base, in[i].iov_len) != 0)
+                return -1;
+        }
+        return 0;
+    }
+    if (cnt > 16) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(iov, in, cnt * sizeof(*in));
+    while (cnt > 0) {
+        ssize_t r = writev(STDOUT_FILENO, v, cnt);
+
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        while (cnt > 0 && (size_t)r >= v->iov_len) {
+            r -= (ssize_t)v->iov_len;
+            v++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            v->iov_base = (char *)v->iov_base + r;
+            v->iov_len -= (size_t)r;
+        }
+    }
+    return 0;
+}
+
+// writer 스레드에서 1 초 동안 조용할 때. 단일 스레드 루프의 빈 배치 처리와 같음 (--rotate-sec 도 여기서)
+static int pipe_idle(void *arg)
+{
+    const struct sink *s = arg;
+
+    return ksys_uring_flush(s->ur);
+}
+
+static void print_pipe_stats(const struct ksys_pipe_stats *ps, double secs)
+{
+    fprintf(stderr,
+            "[pipe] events=%llu (%.0f/s) bytes=%llu drops=%llu encoders=%u slots=%u"
+            " depth free=%u work=%u/%u done=%u/%u reorder=%u/%u"
+            " stall=%.1fms encode=%.1fms write=%.1fms writer_wait=%.1fms\n",
+            ps->events, secs > 0 ? ps->events / secs : 0.0, ps->bytes, ps->drops, ps->encoders, ps->slots,
+            ps->free_depth, ps->work_depth, ps->work_depth_max, ps->done_depth, ps->done_depth_max,
+            ps->reorder_depth, ps->reorder_depth_max, ps->reader_stall_ns / 1e6, ps->encode_ns / 1e6,
+            ps->write_ns / 1e6, ps->writer_wait_ns / 1e6);
+}
+
+// 시그널이 오거나 어느 단계가 실패할 때까지. stats_sec 초마다 단계별 통계
+static int run_pipe(struct ksys *k, struct sink *s, unsigned int threads, int stats_sec)
+{
+    struct ksys_pipe_opts po;
+    struct ksys_pipe_stats ps;
+    struct ksys_pipe *p;
+    unsigned long long last_drops = 0;
+    struct timespec t0, t1;
+    int ticks = 0;
+
+    // raw/lp 파일 헤더는 여기서 먼저 (--out 이면 파일마다 ksys_uring 이 붙임)
+    if (s->kind == OUT_WIRE && !s->ur && ksys_wire_flush(&s->w) != 0) {
+        perror("write");
+        return 1;
+    }
+    ksys_pipe_opts_init(&po);
+    po.encoders = threads;
+    po.batch = 1024;
+    po.encode = s->kind == OUT_WIRE && s->w.fmt == KSYS_WIRE_RAW ? NULL : pipe_encode;
+    po.write = pipe_write;
+    po.idle = s->ur ? pipe_idle : NULL;
+    po.arg = s;
+    p = ksys_pipe_start(k, &po);
+    if (!p) {
+        perror("ksys_pipe_start");
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while (!stop && !ksys_pipe_error(p)) {
+        struct timespec tick = { 0, 100 * 1000 * 1000 };
+
+        nanosleep(&tick, NULL);
+        ksys_pipe_stats(p, &ps);
+        if (ps.drops != last_drops) {
+            fprintf(stderr, "[stats] drops=%llu\n", ps.drops);
+            last_drops = ps.drops;
+        }
+        if (stats_sec > 0 && ++ticks % (stats_sec * 10) == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            print_pipe_stats(&ps, (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+        }
+    }
+    if (ksys_pipe_stop(p, &ps) != 0) {
+        perror("pipeline");
+        return 1;
+    }
+    if (stats_sec > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        print_pipe_stats(&ps, (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+    }
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--backend auto|mmap|batch|read|fanotify] [--format text|json|raw|lp|msgpack]\n"
+            "          [--threads N|auto [--pipe-stats SEC]]\n"
+            "          [--out PREFIX [--rotate-size MB] [--rotate-sec S] [--prealloc MB] [--direct]]\n"
+            "       %s [--backend ...] --seg FILE\n"
+            "       %s --input FILE|- [--format text|json|raw|lp|msgpack]\n",
+            prog, prog, prog);
+}
+
+int main(int argc, char **argv)
+{
+    struct ksys_open_opts o;
+    struct ksys_batch b;
+    struct ksys *k;
+    struct sink s;
+    const char *fmt = "text", *input = NULL, *seg = NULL;
+    unsigned long long last_drops = 0;
+    int rc = 0, threads = -1, pipe_stats = 0;
+    struct ksys_uring_opts uo;
+
+    ksys_open_opts_init(&o);
+    ksys_uring_opts_init(&uo);
+    o.batch = 128;
+    memset(&s, 0, sizeof(s));
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--backend") && i + 1 < argc) {
+            const char *v = argv[++i];
+            for (o.backend = KSYS_BACKEND_AUTO; o.backend <= KSYS_BACKEND_FANOTIFY; o.backend++) {
+                if (!strcmp(v, ksys_backend_name(o.backend)))
+                    break;
             }
-            cnt = n / sizeof(struct ksys_event);
-            printf("got %zu events\n", cnt);
-            for (i = 0; i < cnt; i++) {
-                struct ksys_event *e = &event[i];
-                printf("[%3zu] pid=%d tgid=%d comm=%s dfd=%d flags=0x%x mode=%o path=%s\n",
-                       i, e->pid, e->tgid, e->comm, e->dfd, e->flags, e->mode, e->path);
+            if (o.backend > KSYS_BACKEND_FANOTIFY) {
+                fprintf(stderr, "unknown backend: %s\n", v);
+                return 2;
             }
-        }
-        if (ioctl(fd, KSYS_IOC_GET_STATS, &st) == 0) {
-            if (st.drops) {
-                fprintf(stderr, "[stats] drops=%llu cur_seq=%llu ring=%u\n",
-                (unsigned long long)st.drops,
-                (unsigned long long)st.cur_seq,
-                st.ring_size);
+        } else if (!strcmp(argv[i], "--format") && i + 1 < argc) {
+            fmt = argv[++i];
+        } else if (!strncmp(argv[i], "--format=", 9)) {
+            fmt = argv[i] + 9;
+        } else if (!strcmp(argv[i], "--input") && i + 1 < argc) {
+            input = argv[++i];
+        } else if (!strcmp(argv[i], "--seg") && i + 1 < argc) {
+            seg = argv[++i];
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            const char *v = argv[++i];
+            threads = strcmp(v, "auto") ? atoi(v) : 0;
+            if (threads < 0) {
+                usage(argv[0]);
+                return 2;
             }
+        } else if (!strcmp(argv[i], "--pipe-stats") && i + 1 < argc) {
+            pipe_stats = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            uo.prefix = argv[++i];
+        } else if (!strcmp(argv[i], "--rotate-size") && i + 1 < argc) {
+            uo.rotate_bytes = strtoull(argv[++i], NULL, 10) << 20;
+        } else if (!strcmp(argv[i], "--rotate-sec") && i + 1 < argc) {
+            uo.rotate_sec = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--prealloc") && i + 1 < argc) {
+            uo.prealloc = strtoull(argv[++i], NULL, 10) << 20;
+        } else if (!strcmp(argv[i], "--direct")) {
+            uo.direct = true;
+        } else {
+            usage(argv[0]);
+            return 2;
         }
     }
-    close(fd);
-    return 0;
-}
\ No newline at end of file
+    if (seg && input) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (threads >= 0 && (seg || input || !strcmp(fmt, "text"))) {
+        fprintf(stderr, "--threads needs live capture with --format json|raw|lp|msgpack\n");
+        return 2;
+    }
+    if (uo.prefix && (seg || input || !strcmp(fmt, "text"))) {
+        fprintf(stderr, "--out needs live capture with --format json|raw|lp|msgpack\n");
+        return 2;
+    }
+    if (sink_init(&s, fmt, seg, uo.prefix ? &uo : NULL) != 0) {
+        if (errno == ENOTTY)
+            fprintf(stderr, "--format %s writes binary; redirect stdout to a file or pipe\n", fmt);
+        else if (errno == EINVAL)
+            usage(argv[0]);
+        else
+            perror(seg ? seg : uo.prefix ? uo.prefix : "output");
+        sink_free(&s);
+        return 2;
+    }
+    // 바이너리/json 을 크게 묶어 보낼 때는 배치를 키움
+    if (s.kind != OUT_TEXT)
+        o.batch = 1024;
+
+    if (input) {
+        rc = run_input(input, &s);
+        sink_free(&s);
+        return rc;
+    }
+
+    k = ksys_open(&o);
+    if (!k) {
+        perror("ksys_open");
+        sink_free(&s);
+        return 1;
+    }
+    fprintf(stderr, "backend=%s format=%s\n", ksys_backend_name(ksys_backend(k)), seg ? "seg" : fmt);
+
+    // 세그먼트는 끝에 인덱스를, 파이프라인은 남은 배치를, --out 은 남은 버퍼를 써야 하므로
+    // 시그널로 루프를 빠져나와 닫음 (SA_RESTART 없이)
+    if (seg || threads >= 0 || s.ur) {
+        struct sigaction sa;
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = on_signal;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+    }
+
+    if (threads >= 0) {
+        rc = run_pipe(k, &s, (unsigned int)threads, pipe_stats);
+        ksys_close(k);
+        sink_free(&s);
+        return rc;
+    }
+
+    while (!stop) {
+        // 세그먼트와 --out 은 1 초 동안 조용하면 모은 만큼 내보냄 (--rotate-sec 도 여기서)
+        if (ksys_next_batch(k, seg || s.ur ? 1000 : -1, &b) != 0) {
+            if (errno == EINTR)
+                continue;
+            perror("ksys_next_batch");
+            rc = 1;
+            break;
+        }
+        if (seg && !b.n && ksys_seg_flush(s.seg) != 0) {
+            perror(seg);
+            rc = 1;
+            break;
+        }
+        if (s.ur && !b.n && ksys_uring_flush(s.ur) != 0) {
+            perror(uo.prefix);
+            rc = 1;
+            break;
+        }
+        if (sink_put(&s, b.ev, b.n) != 0) {
+            perror("write");
+            rc = 1;
+            break;
+        }
+        if (b.drops != last_drops) {
+            fprintf(stderr, "[stats] drops=%llu\n", (unsigned long long)b.drops);
+            last_drops = b.drops;
+        }
+    }
+    ksys_close(k);
+    if (sink_free(&s) != 0) {
+        perror(seg ? seg : "output");
+        rc = 1;
+    }
+    if (seg && !rc)
+        fprintf(stderr, "wrote %s\n", seg);
+    return rc;
+}
@@ -1,8 +1,10 @@
 // ksysdump_json.c
+// /dev/ksys_trace 를 JSON Lines 로 stdout 에 (인코딩은 lib/ksys_json.c, 드레인마다 write 한 번)
+//
+//   gcc -O2 -Wall -I../include -o ksysdump_json ksysdump_json.c ../lib/ksys_json.c
 #define _GNU_SOURCE
 #include <errno.h>
 #include <fcntl.h>
-#include <inttypes.h>
 #include <poll.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -13,98 +15,130 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 
-#ifndef KSYS_COMM_LEN
-#define KSYS_COMM_LEN 16
-#endif
-
-#ifndef KSYS_PATH_LEN
-#define KSYS_PATH_LEN 64
-#endif
-
-struct ksys_event {
-    uint64_t seq;
-    uint64_t ts_ns;                   // timestamp (ns)
-    int32_t  pid;                     // pid_t 와 크기가 같다고 가정 (x86_64)
-    int32_t  tgid;                    // tgid
-    char     comm[KSYS_COMM_LEN];     // 프로세스 이름
-    char     path[KSYS_PATH_LEN];     // 파일 경로
-    int32_t  dfd;                     // dir fd (AT_FDCWD == -100)
-    int32_t  flags;                   // open flags
-    uint32_t mode;                    // umode_t (퍼미션 비트)
-};
-
+#include <ksys/ksys.h>
+#include <ksys/ksys_json.h>
 
-#define KSYS_IOC_MAGIC      'k'
-struct ksys_stats {
-    uint64_t cur_seq;
-    uint64_t drops;
-    uint32_t ring_size;
-    uint32_t _pad;
-};
-#define KSYS_IOC_GET_STATS  _IOR(KSYS_IOC_MAGIC, 1, struct ksys_stats)
+static struct ksys_json js;      // stdout
 
-struct ksys_filter {
-    int32_t pid;
-    int32_t tgid;
-    char    comm[KSYS_COMM_LEN];
+static const struct { const char *name; uint32_t bit; } field_names[] = {
+    { "seq", KSYS_FIELD_SEQ },   { "ts_ns", KSYS_FIELD_TS },     { "pid", KSYS_FIELD_PID },
+    { "tgid", KSYS_FIELD_TGID }, { "dfd", KSYS_FIELD_DFD },      { "flags", KSYS_FIELD_FLAGS },
+    { "mode", KSYS_FIELD_MODE }, { "comm", KSYS_FIELD_COMM },    { "path", KSYS_FIELD_PATH },
+    { "ret", KSYS_FIELD_RET },   { "dev", KSYS_FIELD_DEV },      { "gen", KSYS_FIELD_GEN },
+    { "ino", KSYS_FIELD_INO },
 };
-#define KSYS_IOC_SET_FILTER _IOW(KSYS_IOC_MAGIC, 2, struct ksys_filter)
 
-struct ksys_start {
-    uint32_t mode; // 0=NOW,1=OLDEST,2=SEQ
-    uint32_t _pad;
-    uint64_t seq;
-};
-#define KSYS_IOC_SET_START  _IOW(KSYS_IOC_MAGIC, 3, struct ksys_start)
-enum { KSYS_START_NOW=0, KSYS_START_OLDEST=1, KSYS_START_SEQ=2 };
-
-static void json_escape_print(const char *s, size_t maxlen)
+static uint32_t parse_fields(const char *spec)
 {
-    putchar('"');
-    for (size_t i = 0; i < maxlen && s[i]; i++) {
-        unsigned char c = (unsigned char)s[i];
-        switch (c) {
-        case '\"': fputs("\\\"", stdout); break;
-        case '\\': fputs("\\\\", stdout); break;
-        case '\b': fputs("\\b", stdout); break;
-        case '\f': fputs("\\f", stdout); break;
-        case '\n': fputs("\\n", stdout); break;
-        case '\r': fputs("\\r", stdout); break;
-        case '\t': fputs("\\t", stdout); break;
-        default:
-            if (c < 0x20) printf("\\u%04x", (unsigned)c);
-            else putchar((int)c);
-            break;
+    uint32_t mask = 0;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        size_t k;
+        for (k = 0; k < sizeof(field_names) / sizeof(field_names[0]); k++) {
+            if (!strcmp(tok, field_names[k].name)) {
+                mask |= field_names[k].bit;
+                break;
+            }
         }
+        if (k == sizeof(field_names) / sizeof(field_names[0]))
+            return 0;
     }
-    putchar('"');
+    return mask;
+}
+
+// --fields 에 쓸 수 있는 이름 (parse_fields 와 같은 표)
+static void print_field_names(FILE *f)
+{
+    for (size_t k = 0; k < sizeof(field_names) / sizeof(field_names[0]); k++)
+        fprintf(f, "%s%s", k ? "," : "", field_names[k].name);
+}
+
+// 오토튜닝이 꺼져 있거나 예전 모듈이면 아무것도 출력하지 않음
+static void print_tune_json(int fd)
+{
+    static const char *reasons[] = { "none", "grow_drops", "grow_lag", "shrink_idle", "alloc_fail" };
+    struct ksys_tune_stats t;
+
+    if (ioctl(fd, KSYS_IOC_GET_TUNE, &t) != 0 || !t.enabled)
+        return;
+    ksys_json_printf(&js, "{\"type\":\"tune\",\"ring_size\":%u,\"ring_min\":%u,\"ring_max\":%u"
+                     ",\"lag_max\":%llu,\"drops_total\":%llu,\"grows\":%llu,\"shrinks\":%llu"
+                     ",\"last\":{\"reason\":\"%s\",\"from\":%u,\"to\":%u,\"ts\":%llu},\"base_seq\":%llu}\n",
+                     t.ring_size, t.ring_min, t.ring_max, t.lag_max, t.drops_total, t.grows, t.shrinks,
+                     t.last_reason < 5 ? reasons[t.last_reason] : "?", t.last_from, t.last_to, t.last_ns,
+                     t.base_seq);
 }
 
-static void print_event_json(const struct ksys_event *e)
+// --batch: epoll + read + GET_STATS 대신 READ_BATCH 한 번으로 처리
+static int run_batch_loop(int fd, uint32_t min_events, int32_t timeout_ms, bool packed)
 {
-    fputs("{\"type\":\"openat\"", stdout);
-    printf(",\"seq\":%" PRIu64, e->seq);
-    printf(",\"ts_ns\":%" PRIu64, e->ts_ns);
-    printf(",\"pid\":%d", e->pid);
-    printf(",\"tgid\":%d", e->tgid);
-    printf(",\"dfd\":%d", e->dfd);
-    printf(",\"flags\":%u", e->flags);
-    printf(",\"mode\":%u", e->mode);
-    fputs(",\"comm\":", stdout); json_escape_print(e->comm, sizeof(e->comm));
-    fputs(",\"path\":", stdout); json_escape_print(e->path, sizeof(e->path));
-    fputs("}\n", stdout);
+    static struct ksys_event evs[256];
+    uint64_t last_drops = 0;
+
+    for (;;) {
+        struct ksys_read_batch rb;
+
+        memset(&rb, 0, sizeof(rb));
+        rb.buf = (uint64_t)(uintptr_t)evs;
+        rb.buf_len = sizeof(evs);
+        rb.min_events = min_events;
+        rb.timeout_ms = timeout_ms;
+
+        if (ioctl(fd, KSYS_IOC_READ_BATCH, &rb) != 0) {
+            if (errno == EINTR) {
+                struct ksys_stats st2;
+                if (ioctl(fd, KSYS_IOC_GET_STATS, &st2) == 0) ksys_json_stats(&js, &st2);
+                return 0;
+            }
+            perror("ioctl READ_BATCH");
+            return 1;
+        }
+
+        ksys_json_buf(&js, evs, rb.nr_bytes, packed);
+        if (rb.drops != last_drops) {
+            ksys_json_printf(&js, "{\"type\":\"stats\",\"cur_seq\":%llu,\"drops\":%llu}\n",
+                             rb.cur_seq, rb.drops);
+            last_drops = rb.drops;
+        }
+        ksys_json_flush(&js);
+    }
 }
 
-static void print_stats_json(const struct ksys_stats *st)
+// --cfg-*: 현재 설정을 읽어 바뀐 항목만 덮어쓰고 한 번에 교체
+struct cfg_update {
+    bool set_pid, set_tgid, set_comm, set_sample, set_wake, set_capture, set_attach;
+    struct ksys_config v;
+};
+
+static int apply_config(int fd, const struct cfg_update *u)
 {
-    printf("{\"type\":\"stats\",\"cur_seq\":%" PRIu64 ",\"drops\":%" PRIu64 ",\"ring_size\":%u}\n",
-           st->cur_seq, st->drops, st->ring_size);
+    struct ksys_config c;
+
+    if (!(u->set_pid || u->set_tgid || u->set_comm || u->set_sample || u->set_wake || u->set_capture ||
+          u->set_attach))
+        return 0;
+    if (ioctl(fd, KSYS_IOC_GET_CONFIG, &c) != 0) return -1;
+    if (u->set_pid) c.pid = u->v.pid;
+    if (u->set_tgid) c.tgid = u->v.tgid;
+    if (u->set_comm) memcpy(c.comm, u->v.comm, sizeof(c.comm));
+    if (u->set_sample) c.sample_every = u->v.sample_every;
+    if (u->set_wake) c.wake_batch = u->v.wake_batch;
+    if (u->set_capture) c.capture = u->v.capture;
+    if (u->set_attach) c.attach = u->v.attach;
+    return ioctl(fd, KSYS_IOC_SET_CONFIG, &c);
 }
 
-static int apply_filter_start(int fd, const struct ksys_filter *flt, const struct ksys_start *st)
+static int apply_filter_start(int fd, const struct ksys_filter *flt, const struct ksys_start *st,
+                              uint32_t opts, uint32_t proj, const struct ksys_group_join *grp)
 {
+    if (opts && ioctl(fd, KSYS_IOC_SET_OPTS, &opts) != 0) return -1;
+    if (proj && ioctl(fd, KSYS_IOC_SET_PROJECTION, &proj) != 0) return -1;
     if (ioctl(fd, KSYS_IOC_SET_FILTER, flt) != 0) return -1;
     if (ioctl(fd, KSYS_IOC_SET_START,  st)  != 0) return -1;
+    // CLAIM 그룹은 이미 있으면 그룹 커서를 따라가므로 SET_START 뒤에 가입
+    if (grp && ioctl(fd, KSYS_IOC_JOIN_GROUP, grp) != 0) return -1;
     return 0;
 }
 
@@ -113,6 +147,15 @@ int main(int argc, char **argv)
     const char *dev = "/dev/ksys_trace";
     int stats_every = 0;      // N회 드레인마다 stats 출력
     bool use_et = false;      // --et면 EPOLLET
+    uint32_t opts = 0;        // --gaps면 KSYS_OPT_GAP_RECORDS
+    uint32_t batch_min = 0;   // --batch N이면 READ_BATCH 루프
+    int32_t batch_timeout = 100;
+    struct ksys_group_join grp;
+    bool use_group = false;
+    uint32_t proj = 0;        // --fields 면 packed 레코드
+    struct cfg_update cfg;
+
+    memset(&cfg, 0, sizeof(cfg));
     struct ksys_filter flt;
     struct ksys_start st;
 
@@ -133,6 +176,75 @@ int main(int argc, char **argv)
             if (stats_every < 0) stats_every = 0;
         } else if (!strcmp(argv[i], "--et")) {
             use_et = true;
+        } else if (!strcmp(argv[i], "--batch") && i + 1 < argc) {
+            batch_min = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if (batch_min == 0) batch_min = 1;
+        } else if (!strcmp(argv[i], "--batch-timeout") && i + 1 < argc) {
+            batch_timeout = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--group") && i + 1 < argc) {
+            memset(&grp, 0, sizeof(grp));
+            grp.mode = KSYS_GROUP_CLAIM;
+            grp.id = (uint32_t)strtoul(argv[++i], NULL, 10);
+            use_group = true;
+        } else if (!strcmp(argv[i], "--shard") && i + 1 < argc) {
+            const char *v = argv[++i];
+            unsigned k, n;
+            memset(&grp, 0, sizeof(grp));
+            if (!strncmp(v, "tgid:", 5)) { grp.mode = KSYS_GROUP_SHARD_TGID; v += 5; }
+            else if (!strncmp(v, "seq:", 4)) { grp.mode = KSYS_GROUP_SHARD_SEQ; v += 4; }
+            else grp.mode = KSYS_GROUP_SHARD_TGID;
+            if (sscanf(v, "%u/%u", &k, &n) != 2 || n == 0 || k >= n) {
+                fprintf(stderr, "bad --shard: %s ([tgid:|seq:]K/N)\n", argv[i]);
+                return 2;
+            }
+            grp.shard = k;
+            grp.nr_shards = n;
+            use_group = true;
+        } else if (!strcmp(argv[i], "--fields") && i + 1 < argc) {
+            proj = parse_fields(argv[++i]);
+            if (!proj) {
+                fprintf(stderr, "bad --fields: %s (", argv[i]);
+                print_field_names(stderr);
+                fprintf(stderr, ")\n");
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--cfg-pid") && i + 1 < argc) {
+            cfg.v.pid = atoi(argv[++i]); cfg.set_pid = true;
+        } else if (!strcmp(argv[i], "--cfg-tgid") && i + 1 < argc) {
+            cfg.v.tgid = atoi(argv[++i]); cfg.set_tgid = true;
+        } else if (!strcmp(argv[i], "--cfg-comm") && i + 1 < argc) {
+            snprintf(cfg.v.comm, sizeof(cfg.v.comm), "%s", argv[++i]); cfg.set_comm = true;
+        } else if (!strcmp(argv[i], "--cfg-sample") && i + 1 < argc) {
+            cfg.v.sample_every = (uint32_t)strtoul(argv[++i], NULL, 10); cfg.set_sample = true;
+        } else if (!strcmp(argv[i], "--cfg-wake-batch") && i + 1 < argc) {
+            cfg.v.wake_batch = (uint32_t)strtoul(argv[++i], NULL, 10); cfg.set_wake = true;
+        } else if (!strcmp(argv[i], "--cfg-capture") && i + 1 < argc) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "%s", argv[++i]);
+            cfg.v.capture = 0;
+            for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+                if (!strcmp(tok, "inode")) cfg.v.capture |= KSYS_CAP_INODE;
+                else if (!strcmp(tok, "proc")) cfg.v.capture |= KSYS_CAP_PROC;
+                else if (!strcmp(tok, "nocomm")) cfg.v.capture |= KSYS_CAP_NO_COMM;
+                else if (strcmp(tok, "none")) {
+                    fprintf(stderr, "bad --cfg-capture: %s (none|inode,proc,nocomm)\n", argv[i]);
+                    return 2;
+                }
+            }
+            cfg.set_capture = true;
+        } else if (!strcmp(argv[i], "--cfg-attach") && i + 1 < argc) {
+            const char *v = argv[++i];
+            if (!strcmp(v, "wrapper")) cfg.v.attach = KSYS_ATTACH_WRAPPER;
+            else if (!strcmp(v, "openat2")) cfg.v.attach = KSYS_ATTACH_OPENAT2;
+            else if (!strcmp(v, "tracepoint")) cfg.v.attach = KSYS_ATTACH_TRACEPOINT;
+            else if (!strcmp(v, "none")) cfg.v.attach = KSYS_ATTACH_NONE;
+            else {
+                fprintf(stderr, "bad --cfg-attach: %s (wrapper|openat2|tracepoint|none)\n", v);
+                return 2;
+            }
+            cfg.set_attach = true;
+        } else if (!strcmp(argv[i], "--gaps")) {
+            opts |= KSYS_OPT_GAP_RECORDS;
         } else if (!strcmp(argv[i], "--pid") && i + 1 < argc) {
             flt.pid = atoi(argv[++i]);
         } else if (!strcmp(argv[i], "--tgid") && i + 1 < argc) {
@@ -151,21 +263,43 @@ int main(int argc, char **argv)
         } else {
             fprintf(stderr,
                 "usage: %s [--dev /dev/ksys_trace] [--pid TID] [--tgid PID] [--comm NAME]\n"
-                "          [--from now|oldest|seq:<N>] [--et] [--stats-every N]\n",
+                "          [--from now|oldest|seq:<N>] [--et] [--gaps] [--stats-every N]\n"
+                "          [--batch MIN_EVENTS [--batch-timeout MS]]\n"
+                "          [--group ID | --shard [tgid:|seq:]K/N] [--fields a,b,c]\n"
+                "          [--cfg-pid N] [--cfg-tgid N] [--cfg-comm NAME] [--cfg-sample N] [--cfg-wake-batch N]\n"
+                "          [--cfg-capture none|inode,proc,nocomm] [--cfg-attach wrapper|openat2|tracepoint|none]\n",
                 argv[0]);
+            fprintf(stderr, "fields: ");
+            print_field_names(stderr);
+            fprintf(stderr, "\n");
             return 2;
         }
     }
 
+    if (ksys_json_init(&js, STDOUT_FILENO, 0) != 0) { perror("ksys_json_init"); return 1; }
+
     int fd = open(dev, O_RDONLY | O_NONBLOCK);
     if (fd < 0) { perror("open"); return 1; }
 
-    if (apply_filter_start(fd, &flt, &st) != 0) {
-        perror("ioctl SET_FILTER/SET_START");
+    if (apply_config(fd, &cfg) != 0) {
+        perror("ioctl GET_CONFIG/SET_CONFIG");
         close(fd);
         return 1;
     }
 
+    if (apply_filter_start(fd, &flt, &st, opts, proj, use_group ? &grp : NULL) != 0) {
+        perror("ioctl SET_OPTS/SET_PROJECTION/SET_FILTER/SET_START/JOIN_GROUP");
+        close(fd);
+        return 1;
+    }
+
+    if (batch_min) {
+        int rc = run_batch_loop(fd, batch_min, batch_timeout, proj != 0);
+        ksys_json_free(&js);
+        close(fd);
+        return rc;
+    }
+
     int ep = epoll_create1(0);
     if (ep < 0) { perror("epoll_create1"); close(fd); return 1; }
 
@@ -189,7 +323,7 @@ int main(int argc, char **argv)
         if (n < 0) {
             if (errno == EINTR) {
                 struct ksys_stats st2;
-                if (ioctl(fd, KSYS_IOC_GET_STATS, &st2) == 0) print_stats_json(&st2);
+                if (ioctl(fd, KSYS_IOC_GET_STATS, &st2) == 0) ksys_json_stats(&js, &st2);
                 break;
             }
             perror("epoll_wait");
@@ -210,6 +344,7 @@ int main(int argc, char **argv)
                     if (errno == EINTR)
                         continue;
                     perror("read");
+                    ksys_json_free(&js);
                     close(ep);
                     close(fd);
                     return 0;
@@ -217,9 +352,7 @@ int main(int argc, char **argv)
                 if (r == 0) 
                     break;
 
-                size_t cnt = (size_t)r / sizeof(evs[0]);
-                for (size_t k = 0; k < cnt; k++)
-                    print_event_json(&evs[k]);
+                ksys_json_buf(&js, evs, (size_t)r, proj != 0);
             }
 
             drain_round++;
@@ -227,18 +360,23 @@ int main(int argc, char **argv)
                 struct ksys_stats st2;
                 if (ioctl(fd, KSYS_IOC_GET_STATS, &st2) == 0) 
                 {
-                    print_stats_json(&st2);
+                    ksys_json_stats(&js, &st2);
+                    print_tune_json(fd);
                 }    
             } else {
                 struct ksys_stats st2;
                 if (ioctl(fd, KSYS_IOC_GET_STATS, &st2) == 0) {
                     if (st2.drops != last_drops) {
-                        print_stats_json(&st2);
+                        ksys_json_stats(&js, &st2);
                         last_drops = st2.drops;
                     }
                 }
             }
-            fflush(stdout);
+            ksys_json_flush(&js);
         }
     }
+    ksys_json_free(&js);
+    close(ep);
+    close(fd);
+    return 0;
 }
@@ -14,49 +14,7 @@
 #include <time.h>          //  추가: clock_gettime
 #include <unistd.h>
 
-#ifndef KSYS_COMM_LEN
-#define KSYS_COMM_LEN 16
-#endif
-
-#ifndef KSYS_PATH_LEN
-#define KSYS_PATH_LEN 64
-#endif
-
-struct ksys_event {
-    uint64_t seq;
-    uint64_t ts_ns;
-    int32_t  pid;
-    int32_t  tgid;
-    char     comm[KSYS_COMM_LEN];
-    char     path[KSYS_PATH_LEN];
-    int32_t  dfd;
-    int32_t  flags;
-    uint32_t mode;
-};
-
-#define KSYS_IOC_MAGIC      'k'
-struct ksys_stats {
-    uint64_t cur_seq;
-    uint64_t drops;
-    uint32_t ring_size;
-    uint32_t _pad;
-};
-#define KSYS_IOC_GET_STATS  _IOR(KSYS_IOC_MAGIC, 1, struct ksys_stats)
-
-struct ksys_filter {
-    int32_t pid;
-    int32_t tgid;
-    char    comm[KSYS_COMM_LEN];
-};
-#define KSYS_IOC_SET_FILTER _IOW(KSYS_IOC_MAGIC, 2, struct ksys_filter)
-
-struct ksys_start {
-    uint32_t mode; // 0=NOW,1=OLDEST,2=SEQ
-    uint32_t _pad;
-    uint64_t seq;
-};
-#define KSYS_IOC_SET_START  _IOW(KSYS_IOC_MAGIC, 3, struct ksys_start)
-enum { KSYS_START_NOW=0, KSYS_START_OLDEST=1, KSYS_START_SEQ=2 };
+#include <ksys/ksys.h>
 
 // =======  성능 계측용 카운터 =======
 static uint64_t g_epoll_wake = 0;   // epoll_wait가 깨어난 횟수(= loop wake)
@@ -155,8 +113,8 @@ static void json_escape_print(const char *s, size_t maxlen)
 static void print_event_json(const struct ksys_event *e)
 {
     fputs("{\"type\":\"openat\"", stdout);
-    printf(",\"seq\":%" PRIu64, e->seq);
-    printf(",\"ts_ns\":%" PRIu64, e->ts_ns);
+    printf(",\"seq\":%llu", e->seq);
+    printf(",\"ts_ns\":%llu", e->ts_ns);
     printf(",\"pid\":%d", e->pid);
     printf(",\"tgid\":%d", e->tgid);
     printf(",\"dfd\":%d", e->dfd);
@@ -169,7 +127,7 @@ static void print_event_json(const struct ksys_event *e)
 
 static void print_stats_json(const struct ksys_stats *st)
 {
-    printf("{\"type\":\"stats\",\"cur_seq\":%" PRIu64 ",\"drops\":%" PRIu64 ",\"ring_size\":%u}\n",
+    printf("{\"type\":\"stats\",\"cur_seq\":%llu,\"drops\":%llu,\"ring_size\":%u}\n",
            st->cur_seq, st->drops, st->ring_size);
 }
 